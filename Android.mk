@@ -40,6 +40,19 @@ LOCAL_MODULE:= tm
 LOCAL_MODULE_TAGS:= test
 include $(BUILD_HEAPTRACKED_EXECUTABLE)
 
+# the same malloc/free benchmark with and without the tracker
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= htbench.c
+LOCAL_MODULE:= htbench
+LOCAL_MODULE_TAGS:= test
+include $(BUILD_HEAPTRACKED_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= htbench.c
+LOCAL_MODULE:= htbench_plain
+LOCAL_MODULE_TAGS:= test
+include $(BUILD_EXECUTABLE)
+
 else
 BUILD_HEAPTRACKED_SHARED_LIBRARY:=$(BUILD_SHARED_LIBRARY)
 BUILD_HEAPTRACKED_EXECUTABLE:= $(BUILD_EXECUTABLE)
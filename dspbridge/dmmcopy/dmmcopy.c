@@ -67,7 +67,7 @@
 /* Messaging DSP commands */
 #define DMM_SETUPBUFFERS    0xABCD
 #define DMM_WRITEREADY      0xADDD
-#define PAGE_ALIGN_MASK		0xfffff000	/* Align mask for a 0x1000 page */
+#define PAGE_ALIGN_MASK		(~0xfffUL)	/* Align mask for a 0x1000 page */
 #define PAGE_ALIGN_UNMASK	0x00000fff	/* Unmask for a 0x1000 page */
 
 UINT g_dwDSPWordSize = 1;	// default for 2430
@@ -23,3 +23,25 @@ LOCAL_MODULE:= libbridge
 LOCAL_MODULE_TAGS := optional
 include $(BUILD_SHARED_LIBRARY)
 
+
+# Host libbridge whose traps go to the in-process simulator (dspsim.c)
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	DSPManager.c \
+	DSPProcessor.c \
+	DSPProcessor_OEM.c \
+	DSPNode.c \
+	DSPStrm.c \
+	perfutils.c \
+	dspsim.c \
+	dsptrap.c
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/inc
+
+LOCAL_CFLAGS += -Wall -fno-strict-aliasing -fgnu89-inline -DLINUX -DOMAP_3430 -DDSPBRIDGE_SIMULATOR
+
+LOCAL_MODULE:= libbridge_sim
+LOCAL_MODULE_TAGS := optional tests
+include $(BUILD_HOST_STATIC_LIBRARY)
@@ -85,8 +85,6 @@ static sem_t semOpenClose;
 #define LOG_TAG "TI_DSPManager"
 
 /*  ----------------------------------- Definitions */
-/* #define BRIDGE_DRIVER_NAME  "/dev/dspbridge"*/
-#define BRIDGE_DRIVER_NAME  "/dev/DspBridge"
 #define SYSFS_DRV_STATE		"/sys/devices/platform/C6410/drv_state"
 #define ROOT_ACCESS		1406
 #define RUNNING			0x2
@@ -120,7 +118,7 @@ DBAPI DspManager_Open(UINT argc, PVOID argp)
 
 	sem_wait(&semOpenClose);
 	if (usage_count == 0) {	/* try opening handle to Bridge driver */
-		status = open(BRIDGE_DRIVER_NAME, O_RDWR);
+		status = DSPTRAP_Open();
 		if (status >= 0)
 			hMediaFile = status;
 	}
@@ -153,7 +151,7 @@ DBAPI DspManager_Close(UINT argc, PVOID argp)
 
 	if (usage_count == 1) {
 		munmap_all();
-		status = close(hMediaFile);
+		status = DSPTRAP_Close(hMediaFile);
 		if (status >= 0)
 			hMediaFile = -1;
 	}
@@ -0,0 +1,2340 @@
+/*
+ * dspbridge/mpu_api/src/bridge/dspsim.c
+ *
+ * DSP-BIOS Bridge driver support functions for TI OMAP processors.
+ *
+ * Copyright (C) 2007 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 of the License.
+ *
+ * This program is distributed .as is. WITHOUT ANY WARRANTY of any kind,
+ * whether express or implied; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/*
+ *  ======== dspsim.c ========
+ *  Description:
+ *      In-process DSP/BIOS Bridge simulator, see dspsim.h.
+ *
+ *      There is no DSP thread.  Every message a node sends and every buffer
+ *      it completes is queued with the time at which it becomes ready, and
+ *      the node keeps the time at which it is done with the work queued so
+ *      far, so requests to a node are serialized like on the DSP.  Blocking
+ *      calls sleep on a single condition until the earliest ready time or
+ *      their timeout.  All simulator state is guarded by one lock; handlers
+ *      and latencies run without it.
+ *
+ *      CMM reports one SM segment.  It lives in the unlinked temporary file
+ *      that is the backend's handle, so the API maps it with mmap() as it
+ *      does from the driver; SM message buffers and the buffers of zero-copy
+ *      and DSP-DMA streams are carved from it.  Streams copy the data in
+ *      every mode.
+ *
+ *      The dmmcopy and zerocopymsg sample nodes have built-in handlers, all
+ *      other nodes echo unless DSPSIM_RegisterNode() says otherwise.
+ *
+ *  Public Functions:
+ *      DSPSIM_GetConfig
+ *      DSPSIM_SetConfig
+ *      DSPSIM_GetStats
+ *      DSPSIM_RegisterNode
+ *      DSPSIM_SendMessage
+ *      DSPSIM_Translate
+ */
+
+/*  ----------------------------------- Host OS */
+#include <host_os.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/time.h>
+
+/*  ----------------------------------- DSP/BIOS Bridge */
+#include <dbdefs.h>
+#include <errno.h>
+
+/*  ----------------------------------- Trace & Debug */
+#include <dbg.h>
+#include <dbg_zones.h>
+
+/*  ----------------------------------- OS Adaptation Layer */
+#include <memry.h>
+
+/*  ----------------------------------- Others */
+#include <dsptrap.h>
+
+/*  ----------------------------------- This */
+#include <dspsim.h>
+#include "_dbdebug.h"
+
+/*  ----------------------------------- Defines, Data Structures, Typedefs */
+#define SIGNATURE_PROC		0x434f5250	/* "PROC" */
+#define SIGNATURE_NODE		0x45444f4e	/* "NODE" */
+#define SIGNATURE_STRM		0x4d525453	/* "STRM" */
+#define SIGNATURE_EVNT		0x544e5645	/* "EVNT" */
+
+#define SIM_FOREVER		(~0ULL)
+#define SIM_MAXSTRMBUFS		16
+#define SIM_DMMBASE		0x20000000UL	/* DSP virtual range for DMM */
+#define SIM_DMMEND		0xE0000000UL
+#define SIM_PAGESIZE		4096UL
+#define SIM_SMBASE		0x10000UL	/* SM segment offset in the handle */
+#define SIM_SMSIZE		0x10000UL
+#define SIM_SMALIGN		128UL		/* SM allocation granularity */
+#define SIM_SMFILE		"/tmp/dspsimXXXXXX"
+#define SIM_SPINTIME		100	/* us, shorter delays are busy-waited */
+
+#define SIM_ENV_TRAP		"DSPBRIDGE_SIM_TRAP_US"
+#define SIM_ENV_MSG		"DSPBRIDGE_SIM_MSG_US"
+#define SIM_ENV_MAP		"DSPBRIDGE_SIM_MAP_US"
+#define SIM_ENV_STRM		"DSPBRIDGE_SIM_STRM_BPMS"
+
+/* dmmcopy sample node commands */
+#define SIM_DMM_SETUPBUFFERS	0xABCD
+#define SIM_DMM_WRITEREADY	0xADDD
+
+typedef unsigned long long SIMTIME;	/* us on the monotonic clock */
+
+/* Objects an event can be registered on */
+enum SIM_OWNER {
+	SIM_OWNER_PROC,
+	SIM_OWNER_NODE,
+	SIM_OWNER_STRM
+};
+
+/* Event registered through a DSP_NOTIFICATION, stored in its handle */
+struct SIM_EVENT {
+	ULONG dwSignature;
+	UINT uEventMask;
+	UINT uSignalled;	/* notifications not yet returned by MGR_WAIT */
+	enum SIM_OWNER uOwner;
+	PVOID pOwner;
+	struct DSP_NOTIFICATION *hNotification;
+	struct SIM_EVENT *next;
+};
+
+/*
+ * DMM reservation (pMpuAddr NULL) or mapping of a DSP virtual range, or SM
+ * buffer at offset ulDspAddr in the segment
+ */
+struct SIM_RANGE {
+	ULONG ulDspAddr;
+	ULONG ulSize;
+	BYTE *pMpuAddr;
+	PVOID pOwner;		/* SM buffer: node it is freed with */
+	struct SIM_RANGE *next;
+};
+
+/* Per processor state, shared by all handles attached to it */
+struct SIM_DSP {
+	DSP_PROCSTATE iState;
+	struct SIM_RANGE *pRsvs;	/* sorted by address */
+	struct SIM_RANGE *pMaps;
+};
+
+struct SIM_PROC {
+	ULONG dwSignature;
+	UINT uProcessor;
+	struct SIM_EVENT *pEvents;
+	struct SIM_PROC *next;
+};
+
+struct SIM_MSG {
+	struct DSP_MSG msg;
+	SIMTIME tReady;
+};
+
+struct SIM_BUF {
+	BYTE *pBuf;
+	ULONG ulBytes;
+	ULONG ulBufSize;
+	DWORD dwArg;
+	SIMTIME tReady;		/* SIM_FOREVER while waiting for node output */
+};
+
+/* Node output that arrived before an output buffer was issued */
+struct SIM_CHUNK {
+	SIMTIME tReady;
+	ULONG ulBytes;
+	DWORD dwArg;
+	struct SIM_CHUNK *next;
+	BYTE data[1];
+};
+
+struct SIM_NODE;
+
+struct SIM_STRM {
+	ULONG dwSignature;
+	struct SIM_NODE *pNode;
+	UINT uDirection;
+	UINT uIndex;
+	UINT lMode;
+	UINT uNumBufs;
+	UINT uTimeout;
+	UINT uSegment;		/* SM segment of the buffers, 0 is local */
+	BYTE *pVirtBase;	/* stream's mapping of the SM segment */
+	struct SIM_BUF aBufs[SIM_MAXSTRMBUFS];	/* issued, in order */
+	UINT uHead;
+	UINT uCount;
+	ULONG ulBytes;		/* total bytes transferred */
+	struct SIM_EVENT *pEvents;
+	struct SIM_STRM *next;
+};
+
+struct SIM_NODE {
+	ULONG dwSignature;
+	UINT uProcessor;
+	struct DSP_UUID uuid;
+	DSP_NODESTATE iState;
+	INT iPriority;
+	UINT uTimeout;
+	DSPSIM_MSGHANDLER pfnHandler;
+	PVOID pArg;
+	DWORD adwCtx[2];	/* built-in handler state */
+	BYTE *pSmBase;		/* node's mapping of the SM segment */
+	struct SIM_MSG *aMsgs;	/* messages to the GPP */
+	UINT uMsgDepth;
+	UINT uHead;
+	UINT uCount;
+	SIMTIME tBusy;		/* node is done with its queued work */
+	struct SIM_CHUNK *pChunks;
+	struct SIM_CHUNK **ppChunkTail;
+	struct SIM_STRM *pStrms;
+	struct SIM_EVENT *pEvents;
+	struct SIM_NODE *next;
+};
+
+struct SIM_HANDLER {
+	struct DSP_UUID uuid;
+	DSPSIM_MSGHANDLER pfnHandler;
+	PVOID pArg;
+	struct SIM_HANDLER *next;
+};
+
+/*  ----------------------------------- Globals */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;	/* any queue changed */
+	struct DSPSIM_CONFIG cfg;
+	struct DSPSIM_STATS stats;
+	struct SIM_DSP aDsp[DSPSIM_MAXPROCESSORS];
+	struct SIM_PROC *pProcs;
+	struct SIM_NODE *pNodes;
+	struct SIM_HANDLER *pHandlers;
+	struct SIM_RANGE *pSmBufs;	/* sorted by offset */
+} sim = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	{ 1, 0, 0, 0, 0, 64 },
+};
+
+static int SimOpen(void);
+static int SimClose(int hDriver);
+static int SimTrap(int hDriver, Trapped_Args *args, int cmd);
+
+const struct DSPTRAP_BACKEND DSPSIM_Backend = {
+	"simulator", SimOpen, SimClose, SimTrap
+};
+
+/*
+ *  ======== SimNow ========
+ */
+static SIMTIME SimNow(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (SIMTIME)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*
+ *  ======== SimDeadline ========
+ *  Purpose:
+ *      Convert a Bridge timeout in ms to an absolute time.
+ */
+static SIMTIME SimDeadline(UINT uTimeout)
+{
+	if (uTimeout == (UINT)DSP_FOREVER)
+		return SIM_FOREVER;
+
+	return SimNow() + (SIMTIME)uTimeout * 1000;
+}
+
+/*
+ *  ======== SimDelay ========
+ *  Purpose:
+ *      Spend tDelay us without the simulator lock.
+ */
+static VOID SimDelay(SIMTIME tDelay)
+{
+	struct timespec ts;
+	SIMTIME tEnd;
+
+	if (tDelay == 0)
+		return;
+
+	if (tDelay < SIM_SPINTIME) {
+		tEnd = SimNow() + tDelay;
+		while (SimNow() < tEnd)
+			;
+		return;
+	}
+	ts.tv_sec = tDelay / 1000000;
+	ts.tv_nsec = (tDelay % 1000000) * 1000;
+	while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+		;
+}
+
+/*
+ *  ======== SimWait ========
+ *  Purpose:
+ *      Sleep on the simulator condition until tUntil at the latest.  Called
+ *      with the lock held.  The condition runs on the realtime clock, so
+ *      the monotonic wake-up time is converted to a realtime one.
+ */
+static VOID SimWait(SIMTIME tUntil)
+{
+	struct timeval tv;
+	struct timespec ts;
+	SIMTIME tNow = SimNow();
+	SIMTIME tAbs;
+
+	if (tUntil <= tNow)
+		return;
+
+	sim.stats.ulWaits++;
+	if (tUntil == SIM_FOREVER) {
+		pthread_cond_wait(&sim.cond, &sim.lock);
+		return;
+	}
+	gettimeofday(&tv, NULL);
+	tAbs = (SIMTIME)tv.tv_sec * 1000000 + tv.tv_usec + (tUntil - tNow);
+	ts.tv_sec = tAbs / 1000000;
+	ts.tv_nsec = (tAbs % 1000000) * 1000;
+	pthread_cond_timedwait(&sim.cond, &sim.lock, &ts);
+}
+
+static SIMTIME SimMin(SIMTIME t1, SIMTIME t2)
+{
+	return t1 < t2 ? t1 : t2;
+}
+
+static SIMTIME SimMax(SIMTIME t1, SIMTIME t2)
+{
+	return t1 > t2 ? t1 : t2;
+}
+
+/*
+ *  ======== SimEnv ========
+ *  Purpose:
+ *      Override *puValue with a numeric environment variable, if set.
+ */
+static VOID SimEnv(const char *pszName, UINT *puValue)
+{
+	const char *pszValue = getenv(pszName);
+
+	if (pszValue && *pszValue)
+		*puValue = strtoul(pszValue, NULL, 0);
+}
+
+static bool SimUuidEqual(CONST struct DSP_UUID *pUuid1,
+			 CONST struct DSP_UUID *pUuid2)
+{
+	/* field by field, the padding of a 64-bit ULONG is not copied */
+	return pUuid1->ulData1 == pUuid2->ulData1 &&
+	       pUuid1->usData2 == pUuid2->usData2 &&
+	       pUuid1->usData3 == pUuid2->usData3 &&
+	       pUuid1->ucData4 == pUuid2->ucData4 &&
+	       pUuid1->ucData5 == pUuid2->ucData5 &&
+	       memcmp(pUuid1->ucData6, pUuid2->ucData6,
+		      sizeof(pUuid1->ucData6)) == 0;
+}
+
+/*  ----------------------------------- Object lookup */
+
+static struct SIM_PROC *SimGetProc(DSP_HPROCESSOR hProcessor)
+{
+	struct SIM_PROC *pProc;
+
+	for (pProc = sim.pProcs; pProc; pProc = pProc->next) {
+		if (pProc == (struct SIM_PROC *)hProcessor)
+			return pProc;
+	}
+	return NULL;
+}
+
+static struct SIM_NODE *SimGetNode(DSP_HNODE hNode)
+{
+	struct SIM_NODE *pNode;
+
+	for (pNode = sim.pNodes; pNode; pNode = pNode->next) {
+		if (pNode == (struct SIM_NODE *)hNode)
+			return pNode;
+	}
+	return NULL;
+}
+
+static struct SIM_STRM *SimGetStrm(DSP_HSTREAM hStream)
+{
+	struct SIM_NODE *pNode;
+	struct SIM_STRM *pStrm;
+
+	for (pNode = sim.pNodes; pNode; pNode = pNode->next) {
+		for (pStrm = pNode->pStrms; pStrm; pStrm = pStrm->next) {
+			if (pStrm == (struct SIM_STRM *)hStream)
+				return pStrm;
+		}
+	}
+	return NULL;
+}
+
+/*  ----------------------------------- Notifications */
+
+/*
+ *  ======== SimSignal ========
+ *  Purpose:
+ *      Signal the events of an object registered for any of uMask.
+ */
+static VOID SimSignal(struct SIM_EVENT *pEvents, UINT uMask)
+{
+	struct SIM_EVENT *pEvent;
+
+	for (pEvent = pEvents; pEvent; pEvent = pEvent->next) {
+		if (pEvent->uEventMask & uMask)
+			pEvent->uSignalled++;
+	}
+	pthread_cond_broadcast(&sim.cond);
+}
+
+static VOID SimFreeEvents(struct SIM_EVENT *pEvents)
+{
+	struct SIM_EVENT *pEvent;
+
+	while (pEvents) {
+		pEvent = pEvents;
+		pEvents = pEvent->next;
+		pEvent->dwSignature = 0;
+		free(pEvent);
+	}
+}
+
+/*
+ *  ======== SimRegisterNotify ========
+ *  Purpose:
+ *      Register hNotification for uEventMask on an object, or unregister
+ *      it if uEventMask is 0.
+ */
+static int SimRegisterNotify(struct SIM_EVENT **ppEvents,
+			     enum SIM_OWNER uOwner, PVOID pOwner,
+			     UINT uEventMask, UINT uNotifyType,
+			     struct DSP_NOTIFICATION *hNotification)
+{
+	struct SIM_EVENT **ppEvent;
+	struct SIM_EVENT *pEvent;
+
+	if (!hNotification)
+		return -EFAULT;
+
+	for (ppEvent = ppEvents; *ppEvent; ppEvent = &(*ppEvent)->next) {
+		if ((*ppEvent)->hNotification == hNotification)
+			break;
+	}
+	pEvent = *ppEvent;
+	if (uEventMask == 0) {
+		if (pEvent) {
+			*ppEvent = pEvent->next;
+			pEvent->next = NULL;
+			SimFreeEvents(pEvent);
+		}
+		return 0;
+	}
+	if (uNotifyType != DSP_SIGNALEVENT)
+		return -ENOSYS;
+
+	if (!pEvent) {
+		pEvent = calloc(1, sizeof(*pEvent));
+		if (!pEvent)
+			return -ENOMEM;
+
+		pEvent->dwSignature = SIGNATURE_EVNT;
+		pEvent->uOwner = uOwner;
+		pEvent->pOwner = pOwner;
+		pEvent->hNotification = hNotification;
+		*ppEvent = pEvent;
+	}
+	pEvent->uEventMask = uEventMask;
+	hNotification->handle = pEvent;
+	return 0;
+}
+
+/*
+ *  ======== SimGetEvent ========
+ *  Purpose:
+ *      Find the live event of a notification.  The handle is not trusted,
+ *      it may outlive the object the event was registered on.
+ */
+static struct SIM_EVENT *SimGetEvent(struct DSP_NOTIFICATION *hNotification)
+{
+	struct SIM_PROC *pProc;
+	struct SIM_NODE *pNode;
+	struct SIM_STRM *pStrm;
+	struct SIM_EVENT *pEvent;
+
+	if (!hNotification)
+		return NULL;
+
+	for (pProc = sim.pProcs; pProc; pProc = pProc->next) {
+		for (pEvent = pProc->pEvents; pEvent; pEvent = pEvent->next) {
+			if (pEvent->hNotification == hNotification)
+				return pEvent;
+		}
+	}
+	for (pNode = sim.pNodes; pNode; pNode = pNode->next) {
+		for (pEvent = pNode->pEvents; pEvent; pEvent = pEvent->next) {
+			if (pEvent->hNotification == hNotification)
+				return pEvent;
+		}
+		for (pStrm = pNode->pStrms; pStrm; pStrm = pStrm->next) {
+			for (pEvent = pStrm->pEvents; pEvent;
+			     pEvent = pEvent->next) {
+				if (pEvent->hNotification == hNotification)
+					return pEvent;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  ======== SimEventReady ========
+ *  Purpose:
+ *      Check an event.  Message-ready and I/O completion are level
+ *      triggered so that queued items are reported once their ready time
+ *      has passed; *ptNext is lowered to the next such time.
+ */
+static bool SimEventReady(struct SIM_EVENT *pEvent, SIMTIME tNow,
+			  SIMTIME *ptNext)
+{
+	struct SIM_NODE *pNode;
+	struct SIM_STRM *pStrm;
+	SIMTIME tReady = SIM_FOREVER;
+
+	if (pEvent->uSignalled)
+		return true;
+
+	if (pEvent->uOwner == SIM_OWNER_NODE &&
+	    (pEvent->uEventMask & DSP_NODEMESSAGEREADY)) {
+		pNode = pEvent->pOwner;
+		if (pNode->uCount)
+			tReady = pNode->aMsgs[pNode->uHead].tReady;
+	} else if (pEvent->uOwner == SIM_OWNER_STRM &&
+		   (pEvent->uEventMask & DSP_STREAMIOCOMPLETION)) {
+		pStrm = pEvent->pOwner;
+		if (pStrm->uCount)
+			tReady = pStrm->aBufs[pStrm->uHead].tReady;
+	}
+	if (tReady <= tNow)
+		return true;
+
+	*ptNext = SimMin(*ptNext, tReady);
+	return false;
+}
+
+/*
+ *  ======== SimMgrWait ========
+ */
+static int SimMgrWait(struct DSP_NOTIFICATION **aNotifications, UINT uCount,
+		      UINT *puIndex, UINT uTimeout)
+{
+	SIMTIME tDeadline = SimDeadline(uTimeout);
+	SIMTIME tNow, tNext;
+	struct SIM_EVENT *pEvent;
+	UINT i;
+
+	if (!aNotifications || !puIndex)
+		return -EFAULT;
+
+	for (;;) {
+		tNow = SimNow();
+		tNext = tDeadline;
+		for (i = 0; i < uCount; i++) {
+			pEvent = SimGetEvent(aNotifications[i]);
+			if (!pEvent)
+				return -EFAULT;
+
+			if (SimEventReady(pEvent, tNow, &tNext)) {
+				if (pEvent->uSignalled)
+					pEvent->uSignalled--;
+				*puIndex = i;
+				return 0;
+			}
+		}
+		if (tNow >= tDeadline)
+			return -ETIME;
+
+		SimWait(tNext);
+	}
+}
+
+/*  ----------------------------------- Processor */
+
+/*
+ *  ======== SimSetProcState ========
+ */
+static VOID SimSetProcState(UINT uProcessor, DSP_PROCSTATE iState)
+{
+	struct SIM_PROC *pProc;
+
+	sim.aDsp[uProcessor].iState = iState;
+	for (pProc = sim.pProcs; pProc; pProc = pProc->next) {
+		if (pProc->uProcessor == uProcessor)
+			SimSignal(pProc->pEvents, DSP_PROCESSORSTATECHANGE);
+	}
+}
+
+/*
+ *  ======== SimProcAttach ========
+ */
+static int SimProcAttach(UINT uProcessor, DSP_HPROCESSOR *phProcessor)
+{
+	struct SIM_PROC *pProc;
+
+	if (uProcessor >= sim.cfg.uNumProcessors)
+		return -EINVAL;
+
+	pProc = calloc(1, sizeof(*pProc));
+	if (!pProc)
+		return -ENOMEM;
+
+	pProc->dwSignature = SIGNATURE_PROC;
+	pProc->uProcessor = uProcessor;
+	pProc->next = sim.pProcs;
+	sim.pProcs = pProc;
+	*phProcessor = pProc;
+	return 0;
+}
+
+/*
+ *  ======== SimProcDetach ========
+ */
+static int SimProcDetach(DSP_HPROCESSOR hProcessor)
+{
+	struct SIM_PROC **ppProc;
+	struct SIM_PROC *pProc;
+
+	for (ppProc = &sim.pProcs; *ppProc; ppProc = &(*ppProc)->next) {
+		if (*ppProc == (struct SIM_PROC *)hProcessor)
+			break;
+	}
+	pProc = *ppProc;
+	if (!pProc)
+		return -EFAULT;
+
+	*ppProc = pProc->next;
+	SimFreeEvents(pProc->pEvents);
+	pProc->dwSignature = 0;
+	free(pProc);
+	return 0;
+}
+
+/*
+ *  ======== SimReserve ========
+ *  Purpose:
+ *      First-fit allocation of a page aligned DSP virtual range.
+ */
+static int SimReserve(struct SIM_DSP *pDsp, ULONG ulSize, PVOID *ppRsvAddr)
+{
+	struct SIM_RANGE **ppRsv;
+	struct SIM_RANGE *pRsv;
+	ULONG ulAddr = SIM_DMMBASE;
+
+	ulSize = (ulSize + SIM_PAGESIZE - 1) & ~(SIM_PAGESIZE - 1);
+	if (ulSize == 0)
+		return -EINVAL;
+
+	for (ppRsv = &pDsp->pRsvs; *ppRsv; ppRsv = &(*ppRsv)->next) {
+		if ((*ppRsv)->ulDspAddr - ulAddr >= ulSize)
+			break;
+		ulAddr = (*ppRsv)->ulDspAddr + (*ppRsv)->ulSize;
+	}
+	if (SIM_DMMEND - ulAddr < ulSize)
+		return -ENOMEM;
+
+	pRsv = calloc(1, sizeof(*pRsv));
+	if (!pRsv)
+		return -ENOMEM;
+
+	pRsv->ulDspAddr = ulAddr;
+	pRsv->ulSize = ulSize;
+	pRsv->next = *ppRsv;
+	*ppRsv = pRsv;
+	*ppRsvAddr = (PVOID)ulAddr;
+	return 0;
+}
+
+/*
+ *  ======== SimUnmapRange ========
+ *  Purpose:
+ *      Remove the mappings overlapping [ulAddr, ulAddr + ulSize).
+ */
+static VOID SimUnmapRange(struct SIM_DSP *pDsp, ULONG ulAddr, ULONG ulSize)
+{
+	struct SIM_RANGE **ppMap = &pDsp->pMaps;
+	struct SIM_RANGE *pMap;
+
+	while ((pMap = *ppMap) != NULL) {
+		if (pMap->ulDspAddr < ulAddr + ulSize &&
+		    ulAddr < pMap->ulDspAddr + pMap->ulSize) {
+			*ppMap = pMap->next;
+			free(pMap);
+			sim.stats.ulUnmaps++;
+		} else {
+			ppMap = &pMap->next;
+		}
+	}
+}
+
+/*
+ *  ======== SimUnreserve ========
+ */
+static int SimUnreserve(struct SIM_DSP *pDsp, PVOID pRsvAddr)
+{
+	struct SIM_RANGE **ppRsv;
+	struct SIM_RANGE *pRsv;
+
+	for (ppRsv = &pDsp->pRsvs; *ppRsv; ppRsv = &(*ppRsv)->next) {
+		if ((*ppRsv)->ulDspAddr == (ULONG)pRsvAddr)
+			break;
+	}
+	pRsv = *ppRsv;
+	if (!pRsv)
+		return -EFAULT;
+
+	SimUnmapRange(pDsp, pRsv->ulDspAddr, pRsv->ulSize);
+	*ppRsv = pRsv->next;
+	free(pRsv);
+	return 0;
+}
+
+/*
+ *  ======== SimMap ========
+ *  Purpose:
+ *      Map an MPU buffer into a reserved range.  As on the DMM, the DSP
+ *      address keeps the page offset of the MPU address.
+ */
+static int SimMap(struct SIM_DSP *pDsp, PVOID pMpuAddr, ULONG ulSize,
+		  PVOID pReqAddr, PVOID *ppMapAddr, ULONG *pulPages)
+{
+	struct SIM_RANGE *pRsv;
+	struct SIM_RANGE *pMap;
+	ULONG ulOffset = (ULONG)pMpuAddr & (SIM_PAGESIZE - 1);
+	ULONG ulAddr = (ULONG)pReqAddr & ~(SIM_PAGESIZE - 1);
+	ULONG ulSpan = (ulOffset + ulSize + SIM_PAGESIZE - 1) &
+		       ~(SIM_PAGESIZE - 1);
+
+	if (!pMpuAddr || ulSize == 0)
+		return -EINVAL;
+
+	for (pRsv = pDsp->pRsvs; pRsv; pRsv = pRsv->next) {
+		if (pRsv->ulDspAddr <= ulAddr &&
+		    ulAddr - pRsv->ulDspAddr + ulSpan <= pRsv->ulSize)
+			break;
+	}
+	if (!pRsv)
+		return -EFAULT;
+
+	pMap = calloc(1, sizeof(*pMap));
+	if (!pMap)
+		return -ENOMEM;
+
+	SimUnmapRange(pDsp, ulAddr, ulSpan);
+	pMap->ulDspAddr = ulAddr + ulOffset;
+	pMap->ulSize = ulSize;
+	pMap->pMpuAddr = pMpuAddr;
+	pMap->next = pDsp->pMaps;
+	pDsp->pMaps = pMap;
+	*ppMapAddr = (PVOID)pMap->ulDspAddr;
+	*pulPages = ulSpan / SIM_PAGESIZE;
+	sim.stats.ulMaps++;
+	return 0;
+}
+
+/*
+ *  ======== SimUnmap ========
+ */
+static int SimUnmap(struct SIM_DSP *pDsp, PVOID pMapAddr, ULONG *pulPages)
+{
+	struct SIM_RANGE *pMap;
+	ULONG ulAddr = (ULONG)pMapAddr;
+
+	for (pMap = pDsp->pMaps; pMap; pMap = pMap->next) {
+		if (pMap->ulDspAddr <= ulAddr &&
+		    ulAddr < pMap->ulDspAddr + pMap->ulSize)
+			break;
+	}
+	if (!pMap)
+		return -EFAULT;
+
+	*pulPages = ((pMap->ulDspAddr & (SIM_PAGESIZE - 1)) + pMap->ulSize +
+		     SIM_PAGESIZE - 1) / SIM_PAGESIZE;
+	SimUnmapRange(pDsp, pMap->ulDspAddr, pMap->ulSize);
+	return 0;
+}
+
+/*
+ *  ======== SimTranslate ========
+ *  Purpose:
+ *      MPU address of [ulDspAddr, ulDspAddr + ulSize) if one mapping of the
+ *      processor covers it, else NULL.
+ */
+static BYTE *SimTranslate(struct SIM_DSP *pDsp, ULONG ulDspAddr, ULONG ulSize)
+{
+	struct SIM_RANGE *pMap;
+	ULONG ulOffset;
+
+	for (pMap = pDsp->pMaps; pMap; pMap = pMap->next) {
+		ulOffset = ulDspAddr - pMap->ulDspAddr;
+		if (pMap->ulDspAddr <= ulDspAddr && ulOffset < pMap->ulSize &&
+		    ulSize <= pMap->ulSize - ulOffset)
+			return pMap->pMpuAddr + ulOffset;
+	}
+	return NULL;
+}
+
+/*  ----------------------------------- SM */
+
+/*
+ *  ======== SimSmAlloc ========
+ *  Purpose:
+ *      First-fit allocation from the SM segment.  The buffer is freed with
+ *      pNode at the latest.
+ */
+static int SimSmAlloc(struct SIM_NODE *pNode, ULONG ulSize, ULONG *pulOffset)
+{
+	struct SIM_RANGE **ppBuf;
+	struct SIM_RANGE *pBuf;
+	ULONG ulOffset = 0;
+
+	ulSize = (ulSize + SIM_SMALIGN - 1) & ~(SIM_SMALIGN - 1);
+	if (ulSize == 0)
+		return -EINVAL;
+
+	for (ppBuf = &sim.pSmBufs; *ppBuf; ppBuf = &(*ppBuf)->next) {
+		if ((*ppBuf)->ulDspAddr - ulOffset >= ulSize)
+			break;
+		ulOffset = (*ppBuf)->ulDspAddr + (*ppBuf)->ulSize;
+	}
+	if (SIM_SMSIZE - ulOffset < ulSize)
+		return -ENOMEM;
+
+	pBuf = calloc(1, sizeof(*pBuf));
+	if (!pBuf)
+		return -ENOMEM;
+
+	pBuf->ulDspAddr = ulOffset;
+	pBuf->ulSize = ulSize;
+	pBuf->pOwner = pNode;
+	pBuf->next = *ppBuf;
+	*ppBuf = pBuf;
+	*pulOffset = ulOffset;
+	return 0;
+}
+
+/*
+ *  ======== SimSmFree ========
+ *  Purpose:
+ *      Free the SM buffer at pBuf of the segment mapped at pBase.
+ */
+static int SimSmFree(BYTE *pBase, BYTE *pBuf)
+{
+	struct SIM_RANGE **ppBuf;
+	struct SIM_RANGE *pRange;
+
+	if (!pBase || pBuf < pBase || pBuf >= pBase + SIM_SMSIZE)
+		return -EFAULT;
+
+	for (ppBuf = &sim.pSmBufs; *ppBuf; ppBuf = &(*ppBuf)->next) {
+		if ((*ppBuf)->ulDspAddr == (ULONG)(pBuf - pBase))
+			break;
+	}
+	pRange = *ppBuf;
+	if (!pRange)
+		return -EFAULT;
+
+	*ppBuf = pRange->next;
+	free(pRange);
+	return 0;
+}
+
+/*
+ *  ======== SimSmFreeAll ========
+ *  Purpose:
+ *      Free the SM buffers of pNode, or all of them if pNode is NULL.
+ */
+static VOID SimSmFreeAll(struct SIM_NODE *pNode)
+{
+	struct SIM_RANGE **ppBuf = &sim.pSmBufs;
+	struct SIM_RANGE *pBuf;
+
+	while ((pBuf = *ppBuf) != NULL) {
+		if (!pNode || pBuf->pOwner == pNode) {
+			*ppBuf = pBuf->next;
+			free(pBuf);
+		} else {
+			ppBuf = &pBuf->next;
+		}
+	}
+}
+
+/*  ----------------------------------- Node */
+
+/*
+ *  ======== SimNodeProps ========
+ *  Purpose:
+ *      Database properties of a simulated node: a task node with one input
+ *      and one output stream.
+ */
+static VOID SimNodeProps(CONST struct DSP_UUID *pNodeID,
+			 struct DSP_NDBPROPS *pProps)
+{
+	struct SIM_HANDLER *pHandler;
+
+	memset(pProps, 0, sizeof(*pProps));
+	pProps->cbStruct = sizeof(*pProps);
+	pProps->uiNodeID = *pNodeID;
+	strcpy(pProps->acName, "LOOPBACK");
+	for (pHandler = sim.pHandlers; pHandler; pHandler = pHandler->next) {
+		if (SimUuidEqual(&pHandler->uuid, pNodeID)) {
+			strcpy(pProps->acName, "SIMNODE");
+			break;
+		}
+	}
+	pProps->uNodeType = NODE_TASK;
+	pProps->iPriority = 5;
+	pProps->uStackSize = 1024;
+	pProps->uMessageDepth = sim.cfg.uMsgDepth;
+	pProps->uNumInputStreams = 1;
+	pProps->uNumOutputStreams = 1;
+	pProps->uTimeout = 10000;
+}
+
+/*
+ *  ======== SimEchoHandler ========
+ *  Purpose:
+ *      Default node behaviour: send every message back.
+ */
+static VOID SimEchoHandler(DSP_HNODE hNode, CONST struct DSP_MSG *pMsg,
+			   PVOID pArg)
+{
+	DSPSIM_SendMessage(hNode, pMsg);
+}
+
+/*
+ *  ======== SimDmmCopyHandler ========
+ *  Purpose:
+ *      dmmcopy node.  DMM_SETUPBUFFERS passes the DSP addresses of the
+ *      buffer the DSP receives in and of the one it sends from,
+ *      DMM_WRITEREADY copies dwArg1 words from the first to the second and
+ *      answers.  Words are bytes on the simulated DSPTYPE_64.
+ */
+static VOID SimDmmCopyHandler(DSP_HNODE hNode, CONST struct DSP_MSG *pMsg,
+			      PVOID pArg)
+{
+	struct DSP_MSG msg = *pMsg;
+	struct SIM_NODE *pNode;
+	BYTE *pDst = NULL;
+	BYTE *pSrc = NULL;
+
+	pthread_mutex_lock(&sim.lock);
+	pNode = SimGetNode(hNode);
+	if (pNode && pMsg->dwCmd == SIM_DMM_SETUPBUFFERS) {
+		pNode->adwCtx[0] = pMsg->dwArg1;
+		pNode->adwCtx[1] = pMsg->dwArg2;
+	} else if (pNode && pMsg->dwCmd == SIM_DMM_WRITEREADY) {
+		pSrc = SimTranslate(&sim.aDsp[pNode->uProcessor],
+				    pNode->adwCtx[0], pMsg->dwArg1);
+		pDst = SimTranslate(&sim.aDsp[pNode->uProcessor],
+				    pNode->adwCtx[1], pMsg->dwArg1);
+	}
+	pthread_mutex_unlock(&sim.lock);
+
+	switch (pMsg->dwCmd) {
+	case SIM_DMM_SETUPBUFFERS:
+		break;
+	case SIM_DMM_WRITEREADY:
+		if (pDst && pSrc)
+			memmove(pDst, pSrc, pMsg->dwArg1);
+		else
+			msg.dwArg1 = 0;
+		DSPSIM_SendMessage(hNode, &msg);
+		break;
+	default:
+		DSPSIM_SendMessage(hNode, pMsg);
+		break;
+	}
+}
+
+/*
+ *  ======== SimZcMsgHandler ========
+ *  Purpose:
+ *      zerocopymsg node.  Answers a DSP_RMSBUFDESC message, an SM buffer of
+ *      dwArg2 32-bit words at dwArg1, with a new SM buffer holding the
+ *      words doubled.  The answer has no buffer if there is no room.
+ */
+static VOID SimZcMsgHandler(DSP_HNODE hNode, CONST struct DSP_MSG *pMsg,
+			    PVOID pArg)
+{
+	struct DSP_MSG msg = *pMsg;
+	struct SIM_NODE *pNode;
+	ULONG ulBytes = pMsg->dwArg2 * sizeof(UINT);
+	BYTE *pIn = (BYTE *)pMsg->dwArg1;
+	UINT *pOut = NULL;
+	ULONG ulOffset;
+	ULONG i;
+
+	if (pMsg->dwCmd != DSP_RMSBUFDESC) {
+		DSPSIM_SendMessage(hNode, pMsg);
+		return;
+	}
+	pthread_mutex_lock(&sim.lock);
+	pNode = SimGetNode(hNode);
+	if (pNode && pNode->pSmBase && pIn >= pNode->pSmBase &&
+	    ulBytes <= SIM_SMSIZE &&
+	    (ULONG)(pIn - pNode->pSmBase) <= SIM_SMSIZE - ulBytes &&
+	    SimSmAlloc(pNode, ulBytes, &ulOffset) == 0)
+		pOut = (UINT *)(pNode->pSmBase + ulOffset);
+	pthread_mutex_unlock(&sim.lock);
+
+	if (pOut) {
+		for (i = 0; i < pMsg->dwArg2; i++)
+			pOut[i] = 2 * ((UINT *)pIn)[i];
+		msg.dwArg1 = (DWORD)pOut;
+	} else {
+		msg.dwArg1 = 0;
+		msg.dwArg2 = 0;
+	}
+	DSPSIM_SendMessage(hNode, &msg);
+}
+
+/* Sample nodes with a built-in handler */
+static const struct {
+	struct DSP_UUID uuid;
+	DSPSIM_MSGHANDLER pfnHandler;
+} aSimBuiltins[] = {
+	/* DMMCOPY_TI */
+	{ { 0x28ba464f, 0x9c3e, 0x484e, 0x99, 0x0f,
+	    { 0x48, 0x30, 0x5b, 0x18, 0x38, 0x48 } }, SimDmmCopyHandler },
+	/* ZCMSG_TI */
+	{ { 0x30dbd781, 0xf3fb, 0x11d5, 0xa8, 0xdd,
+	    { 0x00, 0xb0, 0xd0, 0x55, 0xf6, 0xd1 } }, SimZcMsgHandler },
+};
+
+static VOID SimFreeChunks(struct SIM_NODE *pNode)
+{
+	struct SIM_CHUNK *pChunk;
+
+	while (pNode->pChunks) {
+		pChunk = pNode->pChunks;
+		pNode->pChunks = pChunk->next;
+		free(pChunk);
+	}
+	pNode->ppChunkTail = &pNode->pChunks;
+}
+
+/*
+ *  ======== SimSetNodeState ========
+ */
+static VOID SimSetNodeState(struct SIM_NODE *pNode, DSP_NODESTATE iState)
+{
+	pNode->iState = iState;
+	SimSignal(pNode->pEvents, DSP_NODESTATECHANGE);
+}
+
+/*
+ *  ======== SimNodeAllocate ========
+ */
+static int SimNodeAllocate(DSP_HPROCESSOR hProcessor,
+			   CONST struct DSP_UUID *pNodeID,
+			   CONST struct DSP_NODEATTRIN *pAttrIn,
+			   DSP_HNODE *phNode)
+{
+	struct SIM_PROC *pProc = SimGetProc(hProcessor);
+	struct SIM_HANDLER *pHandler;
+	struct SIM_NODE *pNode;
+	UINT i;
+
+	if (!pProc || !pNodeID || !phNode)
+		return -EFAULT;
+
+	if (sim.aDsp[pProc->uProcessor].iState != PROC_RUNNING)
+		return -EBADR;
+
+	pNode = calloc(1, sizeof(*pNode));
+	if (pNode)
+		pNode->aMsgs = calloc(sim.cfg.uMsgDepth, sizeof(struct SIM_MSG));
+	if (!pNode || !pNode->aMsgs) {
+		free(pNode);
+		return -ENOMEM;
+	}
+	pNode->dwSignature = SIGNATURE_NODE;
+	pNode->uProcessor = pProc->uProcessor;
+	pNode->uuid = *pNodeID;
+	pNode->iState = NODE_ALLOCATED;
+	pNode->iPriority = pAttrIn ? pAttrIn->iPriority : 5;
+	pNode->uTimeout = pAttrIn ? pAttrIn->uTimeout : (UINT)DSP_FOREVER;
+	pNode->uMsgDepth = sim.cfg.uMsgDepth;
+	pNode->pfnHandler = SimEchoHandler;
+	pNode->ppChunkTail = &pNode->pChunks;
+	for (i = 0; i < sizeof(aSimBuiltins) / sizeof(aSimBuiltins[0]); i++) {
+		if (SimUuidEqual(&aSimBuiltins[i].uuid, pNodeID))
+			pNode->pfnHandler = aSimBuiltins[i].pfnHandler;
+	}
+	for (pHandler = sim.pHandlers; pHandler; pHandler = pHandler->next) {
+		if (SimUuidEqual(&pHandler->uuid, pNodeID)) {
+			pNode->pfnHandler = pHandler->pfnHandler;
+			pNode->pArg = pHandler->pArg;
+			break;
+		}
+	}
+	pNode->next = sim.pNodes;
+	sim.pNodes = pNode;
+	*phNode = pNode;
+	return 0;
+}
+
+/*
+ *  ======== SimNodeDelete ========
+ *  Purpose:
+ *      Free a node with its streams; buffers still issued are dropped.
+ */
+static int SimNodeDelete(DSP_HNODE hNode)
+{
+	struct SIM_NODE **ppNode;
+	struct SIM_NODE *pNode;
+	struct SIM_STRM *pStrm;
+
+	for (ppNode = &sim.pNodes; *ppNode; ppNode = &(*ppNode)->next) {
+		if (*ppNode == (struct SIM_NODE *)hNode)
+			break;
+	}
+	pNode = *ppNode;
+	if (!pNode)
+		return -EFAULT;
+
+	*ppNode = pNode->next;
+	while (pNode->pStrms) {
+		pStrm = pNode->pStrms;
+		pNode->pStrms = pStrm->next;
+		SimFreeEvents(pStrm->pEvents);
+		pStrm->dwSignature = 0;
+		free(pStrm);
+	}
+	SimFreeChunks(pNode);
+	SimSmFreeAll(pNode);
+	SimFreeEvents(pNode->pEvents);
+	pNode->dwSignature = 0;
+	free(pNode->aMsgs);
+	free(pNode);
+	pthread_cond_broadcast(&sim.cond);
+	return 0;
+}
+
+/*
+ *  ======== SimNodeGetAttr ========
+ */
+static int SimNodeGetAttr(struct SIM_NODE *pNode, struct DSP_NODEATTR *pAttr)
+{
+	struct SIM_STRM *pStrm;
+
+	if (!pAttr)
+		return -EFAULT;
+
+	memset(pAttr, 0, sizeof(*pAttr));
+	pAttr->cbStruct = sizeof(*pAttr);
+	pAttr->inNodeAttrIn.cbStruct = sizeof(pAttr->inNodeAttrIn);
+	pAttr->inNodeAttrIn.iPriority = pNode->iPriority;
+	pAttr->inNodeAttrIn.uTimeout = pNode->uTimeout;
+	for (pStrm = pNode->pStrms; pStrm; pStrm = pStrm->next) {
+		if (pStrm->uDirection == DSP_TONODE)
+			pAttr->uInputs++;
+		else
+			pAttr->uOutputs++;
+	}
+	pAttr->iNodeInfo.cbStruct = sizeof(pAttr->iNodeInfo);
+	SimNodeProps(&pNode->uuid, &pAttr->iNodeInfo.nbNodeDatabaseProps);
+	pAttr->iNodeInfo.uExecutionPriority = pNode->iPriority;
+	pAttr->iNodeInfo.nsExecutionState = pNode->iState;
+	pAttr->iNodeInfo.uNumberStreams = pAttr->uInputs + pAttr->uOutputs;
+	return 0;
+}
+
+/*
+ *  ======== SimQueueMessage ========
+ *  Purpose:
+ *      Queue a message from a node to the GPP after the node's current work.
+ */
+static int SimQueueMessage(struct SIM_NODE *pNode, CONST struct DSP_MSG *pMsg)
+{
+	struct SIM_MSG *pSlot;
+
+	if (pNode->uCount == pNode->uMsgDepth)
+		return -ENOSPC;
+
+	pNode->tBusy = SimMax(SimNow(), pNode->tBusy) + sim.cfg.uMsgLatency;
+	pSlot = &pNode->aMsgs[(pNode->uHead + pNode->uCount) % pNode->uMsgDepth];
+	pSlot->msg = *pMsg;
+	pSlot->tReady = pNode->tBusy;
+	pNode->uCount++;
+	sim.stats.ulMsgsFromDsp++;
+	pthread_cond_broadcast(&sim.cond);
+	return 0;
+}
+
+/*
+ *  ======== SimNodePutMessage ========
+ *  Purpose:
+ *      Wait for room in the node's queue, then run its handler.  The queue
+ *      of replies bounds the messages in flight as the DSP's would.
+ */
+static int SimNodePutMessage(DSP_HNODE hNode, CONST struct DSP_MSG *pMsg,
+			     UINT uTimeout)
+{
+	SIMTIME tDeadline = SimDeadline(uTimeout);
+	struct SIM_NODE *pNode;
+	DSPSIM_MSGHANDLER pfnHandler;
+	PVOID pArg;
+
+	if (!pMsg)
+		return -EFAULT;
+
+	for (;;) {
+		pNode = SimGetNode(hNode);
+		if (!pNode)
+			return -EFAULT;
+
+		if (pNode->iState == NODE_ALLOCATED ||
+		    pNode->iState == NODE_DONE)
+			return -EBADR;
+
+		if (pNode->uCount < pNode->uMsgDepth)
+			break;
+
+		if (SimNow() >= tDeadline)
+			return -ETIME;
+
+		SimWait(tDeadline);
+	}
+	pfnHandler = pNode->pfnHandler;
+	pArg = pNode->pArg;
+	sim.stats.ulMsgsToDsp++;
+
+	pthread_mutex_unlock(&sim.lock);
+	pfnHandler(hNode, pMsg, pArg);
+	pthread_mutex_lock(&sim.lock);
+	return 0;
+}
+
+/*
+ *  ======== SimNodeGetMessage ========
+ */
+static int SimNodeGetMessage(DSP_HNODE hNode, struct DSP_MSG *pMsg,
+			     UINT uTimeout)
+{
+	SIMTIME tDeadline = SimDeadline(uTimeout);
+	struct SIM_NODE *pNode;
+	struct SIM_MSG *pSlot;
+	SIMTIME tNow;
+
+	if (!pMsg)
+		return -EFAULT;
+
+	for (;;) {
+		pNode = SimGetNode(hNode);
+		if (!pNode)
+			return -EFAULT;
+
+		tNow = SimNow();
+		pSlot = &pNode->aMsgs[pNode->uHead];
+		if (pNode->uCount && pSlot->tReady <= tNow) {
+			*pMsg = pSlot->msg;
+			pNode->uHead = (pNode->uHead + 1) % pNode->uMsgDepth;
+			pNode->uCount--;
+			pthread_cond_broadcast(&sim.cond);
+			return 0;
+		}
+		if (tNow >= tDeadline)
+			return -ETIME;
+
+		SimWait(pNode->uCount ? SimMin(pSlot->tReady, tDeadline) :
+			tDeadline);
+	}
+}
+
+/*  ----------------------------------- Stream */
+
+/*
+ *  ======== SimStrmOpen ========
+ */
+static int SimStrmOpen(DSP_HNODE hNode, UINT uDirection, UINT uIndex,
+		       CONST struct STRM_ATTR *pAttr, DSP_HSTREAM *phStream)
+{
+	struct SIM_NODE *pNode = SimGetNode(hNode);
+	struct DSP_STREAMATTRIN *pAttrIn = pAttr ? pAttr->pStreamAttrIn : NULL;
+	struct SIM_STRM *pStrm;
+
+	if (!pNode || !phStream)
+		return -EFAULT;
+
+	if (uDirection != DSP_TONODE && uDirection != DSP_FROMNODE)
+		return -EINVAL;
+
+	for (pStrm = pNode->pStrms; pStrm; pStrm = pStrm->next) {
+		if (pStrm->uDirection == uDirection && pStrm->uIndex == uIndex)
+			return -EBADR;
+	}
+	if (pAttrIn && pAttrIn->lMode != STRMMODE_PROCCOPY &&
+	    (pAttrIn->uSegment != 1 || !pAttr->pVirtBase))
+		return -EBADR;		/* one SM segment */
+
+	pStrm = calloc(1, sizeof(*pStrm));
+	if (!pStrm)
+		return -ENOMEM;
+
+	pStrm->dwSignature = SIGNATURE_STRM;
+	pStrm->pNode = pNode;
+	pStrm->uDirection = uDirection;
+	pStrm->uIndex = uIndex;
+	pStrm->lMode = STRMMODE_PROCCOPY;
+	pStrm->uNumBufs = SIM_MAXSTRMBUFS;
+	pStrm->uTimeout = (UINT)DSP_FOREVER;
+	if (pAttrIn && pAttrIn->lMode != STRMMODE_PROCCOPY) {
+		pStrm->lMode = pAttrIn->lMode;
+		pStrm->uSegment = pAttrIn->uSegment;
+		pStrm->pVirtBase = pAttr->pVirtBase;
+	}
+	if (pAttrIn) {
+		if (pAttrIn->uNumBufs && pAttrIn->uNumBufs < SIM_MAXSTRMBUFS)
+			pStrm->uNumBufs = pAttrIn->uNumBufs;
+		pStrm->uTimeout = pAttrIn->uTimeout;
+	}
+	pStrm->next = pNode->pStrms;
+	pNode->pStrms = pStrm;
+	*phStream = pStrm;
+	return 0;
+}
+
+/*
+ *  ======== SimStrmClose ========
+ */
+static int SimStrmClose(DSP_HSTREAM hStream)
+{
+	struct SIM_STRM *pStrm = SimGetStrm(hStream);
+	struct SIM_STRM **ppStrm;
+
+	if (!pStrm)
+		return -EFAULT;
+
+	if (pStrm->uCount)
+		return -EPIPE;
+
+	for (ppStrm = &pStrm->pNode->pStrms; *ppStrm != pStrm;
+	     ppStrm = &(*ppStrm)->next)
+		;
+	*ppStrm = pStrm->next;
+	SimFreeEvents(pStrm->pEvents);
+	pStrm->dwSignature = 0;
+	free(pStrm);
+	return 0;
+}
+
+/*
+ *  ======== SimStrmAllocateBuffers ========
+ *  Purpose:
+ *      Allocate the buffers of an SM stream from the segment.
+ */
+static int SimStrmAllocateBuffers(struct SIM_STRM *pStrm, UINT uSize,
+				  BYTE **apBuffer, UINT uNumBufs)
+{
+	ULONG ulOffset;
+	int status = 0;
+	UINT i;
+
+	if (!pStrm->pVirtBase)
+		return -EPERM;		/* local buffers are the API's */
+
+	for (i = 0; i < uNumBufs; i++) {
+		status = SimSmAlloc(pStrm->pNode, uSize, &ulOffset);
+		if (status)
+			break;
+		apBuffer[i] = pStrm->pVirtBase + ulOffset;
+	}
+	if (status) {
+		while (i--) {
+			SimSmFree(pStrm->pVirtBase, apBuffer[i]);
+			apBuffer[i] = NULL;
+		}
+	}
+	return status;
+}
+
+/*
+ *  ======== SimStrmFreeBuffers ========
+ */
+static int SimStrmFreeBuffers(struct SIM_STRM *pStrm, BYTE **apBuffer,
+			      UINT uNumBufs)
+{
+	int status = 0;
+	UINT i;
+
+	if (!pStrm->pVirtBase)
+		return -EPERM;
+
+	for (i = 0; i < uNumBufs; i++) {
+		if (!apBuffer[i])
+			continue;
+		if (SimSmFree(pStrm->pVirtBase, apBuffer[i]))
+			status = -EFAULT;
+		else
+			apBuffer[i] = NULL;
+	}
+	return status;
+}
+
+/*
+ *  ======== SimFillBuffer ========
+ *  Purpose:
+ *      Complete an output buffer with node output.
+ */
+static VOID SimFillBuffer(struct SIM_STRM *pStrm, struct SIM_BUF *pBuf,
+			  CONST BYTE *pData, ULONG ulBytes, DWORD dwArg,
+			  SIMTIME tReady)
+{
+	if (ulBytes > pBuf->ulBufSize)
+		ulBytes = pBuf->ulBufSize;
+	memcpy(pBuf->pBuf, pData, ulBytes);
+	pBuf->ulBytes = ulBytes;
+	pBuf->dwArg = dwArg;
+	pBuf->tReady = tReady;
+	pStrm->ulBytes += ulBytes;
+}
+
+/*
+ *  ======== SimEcho ========
+ *  Purpose:
+ *      Pass input data of a node to its output stream: into the oldest
+ *      output buffer still waiting, or queued until one is issued.  The
+ *      data is dropped if the node has no output stream.
+ */
+static VOID SimEcho(struct SIM_NODE *pNode, CONST BYTE *pData, ULONG ulBytes,
+		    DWORD dwArg, SIMTIME tReady)
+{
+	struct SIM_STRM *pStrm;
+	struct SIM_CHUNK *pChunk;
+	struct SIM_BUF *pBuf;
+	UINT i;
+
+	for (pStrm = pNode->pStrms; pStrm; pStrm = pStrm->next) {
+		if (pStrm->uDirection == DSP_FROMNODE)
+			break;
+	}
+	if (!pStrm)
+		return;
+
+	for (i = 0; i < pStrm->uCount; i++) {
+		pBuf = &pStrm->aBufs[(pStrm->uHead + i) % SIM_MAXSTRMBUFS];
+		if (pBuf->tReady == SIM_FOREVER) {
+			SimFillBuffer(pStrm, pBuf, pData, ulBytes, dwArg, tReady);
+			return;
+		}
+	}
+	pChunk = malloc(sizeof(*pChunk) + ulBytes);
+	if (!pChunk)
+		return;
+
+	memcpy(pChunk->data, pData, ulBytes);
+	pChunk->tReady = tReady;
+	pChunk->ulBytes = ulBytes;
+	pChunk->dwArg = dwArg;
+	pChunk->next = NULL;
+	*pNode->ppChunkTail = pChunk;
+	pNode->ppChunkTail = &pChunk->next;
+}
+
+/*
+ *  ======== SimStrmIssue ========
+ */
+static int SimStrmIssue(DSP_HSTREAM hStream, BYTE *pBuffer, ULONG ulBytes,
+			ULONG ulBufSize, DWORD dwArg)
+{
+	struct SIM_STRM *pStrm = SimGetStrm(hStream);
+	struct SIM_NODE *pNode;
+	struct SIM_CHUNK *pChunk;
+	struct SIM_BUF *pBuf;
+	SIMTIME tNow = SimNow();
+
+	if (!pStrm || !pBuffer)
+		return -EFAULT;
+
+	if (pStrm->uCount == pStrm->uNumBufs)
+		return -ENOSR;
+
+	pNode = pStrm->pNode;
+	pBuf = &pStrm->aBufs[(pStrm->uHead + pStrm->uCount) % SIM_MAXSTRMBUFS];
+	pBuf->pBuf = pBuffer;
+	pBuf->ulBufSize = ulBufSize;
+	pStrm->uCount++;
+	sim.stats.ulBufsIssued++;
+	if (pStrm->uDirection == DSP_TONODE) {
+		pNode->tBusy = SimMax(tNow, pNode->tBusy);
+		if (sim.cfg.uStrmBandwidth)
+			pNode->tBusy += (SIMTIME)ulBytes * 1000 /
+					sim.cfg.uStrmBandwidth;
+		pBuf->ulBytes = ulBytes;
+		pBuf->dwArg = dwArg;
+		pBuf->tReady = pNode->tBusy;
+		pStrm->ulBytes += ulBytes;
+		sim.stats.ulBytesIssued += ulBytes;
+		SimEcho(pNode, pBuffer, ulBytes, dwArg, pNode->tBusy);
+	} else if (pNode->pChunks) {
+		pChunk = pNode->pChunks;
+		pNode->pChunks = pChunk->next;
+		if (!pNode->pChunks)
+			pNode->ppChunkTail = &pNode->pChunks;
+		SimFillBuffer(pStrm, pBuf, pChunk->data, pChunk->ulBytes,
+			      pChunk->dwArg, pChunk->tReady);
+		free(pChunk);
+	} else {
+		pBuf->ulBytes = 0;
+		pBuf->dwArg = dwArg;
+		pBuf->tReady = SIM_FOREVER;
+	}
+	pthread_cond_broadcast(&sim.cond);
+	return 0;
+}
+
+/*
+ *  ======== SimStrmReclaim ========
+ */
+static int SimStrmReclaim(DSP_HSTREAM hStream, BYTE **ppBuffer,
+			  ULONG *pulBytes, ULONG *pulBufSize, DWORD *pdwArg)
+{
+	struct SIM_STRM *pStrm = SimGetStrm(hStream);
+	SIMTIME tDeadline;
+	SIMTIME tNow;
+	struct SIM_BUF *pBuf;
+
+	if (!pStrm || !ppBuffer || !pulBytes || !pdwArg)
+		return -EFAULT;
+
+	tDeadline = SimDeadline(pStrm->uTimeout);
+	for (;;) {
+		if (SimGetStrm(hStream) != pStrm)
+			return -EFAULT;
+
+		if (pStrm->uCount == 0)
+			return -EPERM;
+
+		tNow = SimNow();
+		pBuf = &pStrm->aBufs[pStrm->uHead];
+		if (pBuf->tReady <= tNow) {
+			*ppBuffer = pBuf->pBuf;
+			*pulBytes = pBuf->ulBytes;
+			if (pulBufSize)
+				*pulBufSize = pBuf->ulBufSize;
+			*pdwArg = pBuf->dwArg;
+			pStrm->uHead = (pStrm->uHead + 1) % SIM_MAXSTRMBUFS;
+			pStrm->uCount--;
+			return 0;
+		}
+		if (tNow >= tDeadline)
+			return -ETIME;
+
+		SimWait(SimMin(pBuf->tReady, tDeadline));
+	}
+}
+
+/*
+ *  ======== SimStrmIdle ========
+ *  Purpose:
+ *      Complete output buffers still waiting with no data.  Input buffers
+ *      are discarded if bFlush is set, or waited for otherwise.
+ */
+static int SimStrmIdle(DSP_HSTREAM hStream, bool bFlush)
+{
+	struct SIM_STRM *pStrm = SimGetStrm(hStream);
+	SIMTIME tDeadline;
+	SIMTIME tNow, tLast;
+	struct SIM_BUF *pBuf;
+	UINT i;
+
+	if (!pStrm)
+		return -EFAULT;
+
+	if (pStrm->uDirection == DSP_FROMNODE || bFlush) {
+		tNow = SimNow();
+		for (i = 0; i < pStrm->uCount; i++) {
+			pBuf = &pStrm->aBufs[(pStrm->uHead + i) %
+					     SIM_MAXSTRMBUFS];
+			if (pBuf->tReady > tNow) {
+				pBuf->tReady = tNow;
+				if (pStrm->uDirection == DSP_FROMNODE)
+					pBuf->ulBytes = 0;
+			}
+		}
+		if (pStrm->uDirection == DSP_FROMNODE)
+			SimFreeChunks(pStrm->pNode);
+		SimSignal(pStrm->pEvents, DSP_STREAMDONE);
+		return 0;
+	}
+
+	tDeadline = SimDeadline(pStrm->uTimeout);
+	for (;;) {
+		if (SimGetStrm(hStream) != pStrm)
+			return -EFAULT;
+
+		tNow = SimNow();
+		tLast = 0;
+		for (i = 0; i < pStrm->uCount; i++) {
+			pBuf = &pStrm->aBufs[(pStrm->uHead + i) %
+					     SIM_MAXSTRMBUFS];
+			tLast = SimMax(tLast, pBuf->tReady);
+		}
+		if (tLast <= tNow) {
+			SimSignal(pStrm->pEvents, DSP_STREAMDONE);
+			return 0;
+		}
+		if (tNow >= tDeadline)
+			return -ETIME;
+
+		SimWait(SimMin(tLast, tDeadline));
+	}
+}
+
+/*
+ *  ======== SimStrmSelect ========
+ */
+static int SimStrmSelect(DSP_HSTREAM *aStreamTab, UINT nStreams, UINT *pMask,
+			 UINT uTimeout)
+{
+	SIMTIME tDeadline = SimDeadline(uTimeout);
+	SIMTIME tNow, tNext, tReady;
+	struct SIM_STRM *pStrm;
+	UINT i;
+
+	if (!aStreamTab || !pMask || nStreams == 0 || nStreams > 32)
+		return -EINVAL;
+
+	for (;;) {
+		tNow = SimNow();
+		tNext = tDeadline;
+		*pMask = 0;
+		for (i = 0; i < nStreams; i++) {
+			pStrm = SimGetStrm(aStreamTab[i]);
+			if (!pStrm)
+				return -EFAULT;
+
+			if (pStrm->uCount == 0)
+				continue;
+
+			tReady = pStrm->aBufs[pStrm->uHead].tReady;
+			if (tReady <= tNow)
+				*pMask |= 1 << i;
+			else
+				tNext = SimMin(tNext, tReady);
+		}
+		if (*pMask || tNow >= tDeadline || uTimeout == 0)
+			return 0;
+
+		SimWait(tNext);
+	}
+}
+
+/*
+ *  ======== SimStrmGetInfo ========
+ */
+static int SimStrmGetInfo(struct SIM_STRM *pStrm, struct STRM_INFO *pInfo)
+{
+	struct DSP_STREAMINFO *pUser;
+
+	if (!pInfo || !pInfo->pUser)
+		return -EFAULT;
+
+	pInfo->lMode = pStrm->lMode;
+	pInfo->uSegment = pStrm->uSegment;
+	pInfo->pVirtBase = pStrm->pVirtBase;
+	pUser = pInfo->pUser;
+	pUser->cbStruct = sizeof(*pUser);
+	pUser->uNumberBufsAllowed = pStrm->uNumBufs;
+	pUser->uNumberBufsInStream = pStrm->uCount;
+	pUser->ulNumberBytes = pStrm->ulBytes;
+	pUser->hSyncObjectHandle = NULL;
+	if (pStrm->uCount == 0)
+		pUser->ssStreamState = STREAM_IDLE;
+	else if (pStrm->aBufs[pStrm->uHead].tReady <= SimNow())
+		pUser->ssStreamState = STREAM_READY;
+	else
+		pUser->ssStreamState = STREAM_PENDING;
+	return 0;
+}
+
+/*  ----------------------------------- Backend */
+
+/*
+ *  ======== SimOpen ========
+ *  Purpose:
+ *      Reset the simulator and apply the environment.  The handle is an
+ *      unlinked temporary file holding the SM segment at SIM_SMBASE, which
+ *      the API maps through the handle.
+ */
+static int SimOpen(void)
+{
+	char szPath[] = SIM_SMFILE;
+	int hDriver;
+	int status;
+	UINT i;
+
+	hDriver = mkstemp(szPath);
+	if (hDriver < 0)
+		return -errno;
+
+	unlink(szPath);
+	if (ftruncate(hDriver, SIM_SMBASE + SIM_SMSIZE) < 0) {
+		status = -errno;
+		close(hDriver);
+		return status;
+	}
+
+	pthread_mutex_lock(&sim.lock);
+	memset(&sim.stats, 0, sizeof(sim.stats));
+	SimEnv(SIM_ENV_TRAP, &sim.cfg.uTrapLatency);
+	SimEnv(SIM_ENV_MSG, &sim.cfg.uMsgLatency);
+	SimEnv(SIM_ENV_MAP, &sim.cfg.uMapLatency);
+	SimEnv(SIM_ENV_STRM, &sim.cfg.uStrmBandwidth);
+	for (i = 0; i < DSPSIM_MAXPROCESSORS; i++)
+		sim.aDsp[i].iState = PROC_RUNNING;
+	pthread_mutex_unlock(&sim.lock);
+
+	DEBUGMSG(DSPAPI_ZONE_FUNCTION, (TEXT("DSPSIM: SimOpen\r\n")));
+	return hDriver;
+}
+
+/*
+ *  ======== SimClose ========
+ *  Purpose:
+ *      Free everything the process left allocated.
+ */
+static int SimClose(int hDriver)
+{
+	struct SIM_RANGE *pRange;
+	UINT i;
+
+	pthread_mutex_lock(&sim.lock);
+	while (sim.pNodes)
+		SimNodeDelete(sim.pNodes);
+	while (sim.pProcs)
+		SimProcDetach(sim.pProcs);
+	for (i = 0; i < DSPSIM_MAXPROCESSORS; i++) {
+		while ((pRange = sim.aDsp[i].pMaps) != NULL) {
+			sim.aDsp[i].pMaps = pRange->next;
+			free(pRange);
+		}
+		while ((pRange = sim.aDsp[i].pRsvs) != NULL) {
+			sim.aDsp[i].pRsvs = pRange->next;
+			free(pRange);
+		}
+	}
+	SimSmFreeAll(NULL);
+	pthread_mutex_unlock(&sim.lock);
+
+	return close(hDriver) < 0 ? -errno : 0;
+}
+
+/*
+ *  ======== SimTrap ========
+ */
+static int SimTrap(int hDriver, Trapped_Args *args, int cmd)
+{
+	struct SIM_PROC *pProc = NULL;
+	struct SIM_NODE *pNode;
+	struct SIM_STRM *pStrm;
+	struct SIM_HANDLER *pHandler;
+	struct DSP_PROCESSORINFO *pProcInfo;
+	struct DSP_RESOURCEINFO *pResInfo;
+	struct CMM_INFO *pCmmInfo;
+	struct DSP_BUFFERATTR *pBufAttr;
+	struct SIM_RANGE *pRange;
+	ULONG ulOffset;
+	ULONG ulPages = 0;
+	int status = 0;
+	UINT i;
+
+	SimDelay(sim.cfg.uTrapLatency);
+
+	pthread_mutex_lock(&sim.lock);
+	sim.stats.ulTraps++;
+	switch (cmd) {
+	/* MGR */
+	case CMD_MGR_ENUMNODE_INFO_OFFSET:
+		i = 0;
+		for (pHandler = sim.pHandlers; pHandler; pHandler =
+		     pHandler->next) {
+			if (i++ == args->ARGS_MGR_ENUMNODE_INFO.uNode)
+				SimNodeProps(&pHandler->uuid,
+					args->ARGS_MGR_ENUMNODE_INFO.pNDBProps);
+		}
+		*args->ARGS_MGR_ENUMNODE_INFO.puNumNodes = i;
+		if (args->ARGS_MGR_ENUMNODE_INFO.uNode >= i)
+			status = -EINVAL;
+		break;
+	case CMD_MGR_ENUMPROC_INFO_OFFSET:
+		i = args->ARGS_MGR_ENUMPROC_INFO.uProcessor;
+		*args->ARGS_MGR_ENUMPROC_INFO.puNumProcs =
+			sim.cfg.uNumProcessors;
+		if (i >= sim.cfg.uNumProcessors) {
+			status = -EINVAL;
+			break;
+		}
+		pProcInfo = args->ARGS_MGR_ENUMPROC_INFO.pProcessorInfo;
+		memset(pProcInfo, 0, sizeof(*pProcInfo));
+		pProcInfo->cbStruct = sizeof(*pProcInfo);
+		pProcInfo->uProcessorType = DSPTYPE_64;
+		pProcInfo->uClockRate = 430000;
+		pProcInfo->ulExternalMemSize = SIM_DMMEND - SIM_DMMBASE;
+		pProcInfo->uProcessorID = i;
+		pProcInfo->nNodeMinPriority = 1;
+		pProcInfo->nNodeMaxPriority = 15;
+		break;
+	case CMD_MGR_REGISTEROBJECT_OFFSET:
+	case CMD_MGR_UNREGISTEROBJECT_OFFSET:
+		break;
+	case CMD_MGR_WAIT_OFFSET:
+		status = SimMgrWait(args->ARGS_MGR_WAIT.aNotifications,
+				    args->ARGS_MGR_WAIT.uCount,
+				    args->ARGS_MGR_WAIT.puIndex,
+				    args->ARGS_MGR_WAIT.uTimeout);
+		break;
+
+	/* PROC */
+	case CMD_PROC_ATTACH_OFFSET:
+		status = SimProcAttach(args->ARGS_PROC_ATTACH.uProcessor,
+				       args->ARGS_PROC_ATTACH.phProcessor);
+		break;
+	case CMD_PROC_DETACH_OFFSET:
+		status = SimProcDetach(args->ARGS_PROC_DETACH.hProcessor);
+		break;
+	case CMD_PROC_CTRL_OFFSET:
+		if (!SimGetProc(args->ARGS_PROC_CTRL.hProcessor))
+			status = -EFAULT;
+		break;
+	case CMD_PROC_ENUMNODE_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_ENUMNODE_INFO.hProcessor);
+		if (!pProc) {
+			status = -EFAULT;
+			break;
+		}
+		i = 0;
+		for (pNode = sim.pNodes; pNode; pNode = pNode->next) {
+			if (pNode->uProcessor != pProc->uProcessor)
+				continue;
+			if (i < args->ARGS_PROC_ENUMNODE_INFO.uNodeTabSize)
+				args->ARGS_PROC_ENUMNODE_INFO.aNodeTab[i] =
+					pNode;
+			i++;
+		}
+		*args->ARGS_PROC_ENUMNODE_INFO.puNumNodes = i;
+		*args->ARGS_PROC_ENUMNODE_INFO.puAllocated = i;
+		if (i > args->ARGS_PROC_ENUMNODE_INFO.uNodeTabSize)
+			status = -EINVAL;
+		break;
+	case CMD_PROC_ENUMRESOURCES_OFFSET:
+		if (!SimGetProc(args->ARGS_PROC_ENUMRESOURCES.hProcessor)) {
+			status = -EFAULT;
+			break;
+		}
+		pResInfo = args->ARGS_PROC_ENUMRESOURCES.pResourceInfo;
+		memset(pResInfo, 0, sizeof(*pResInfo));
+		pResInfo->cbStruct = sizeof(*pResInfo);
+		pResInfo->uResourceType =
+			args->ARGS_PROC_ENUMRESOURCES.uResourceType;
+		if (pResInfo->uResourceType != DSP_RESOURCE_PROCLOAD) {
+			pResInfo->result.memStat.ulSize = 0x100000;
+			pResInfo->result.memStat.ulTotalFreeSize = 0x100000;
+			pResInfo->result.memStat.ulLenMaxFreeBlock = 0x100000;
+			pResInfo->result.memStat.ulNumFreeBlocks = 1;
+		}
+		break;
+	case CMD_PROC_GETSTATE_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_GETSTATE.hProcessor);
+		if (!pProc) {
+			status = -EFAULT;
+			break;
+		}
+		memset(args->ARGS_PROC_GETSTATE.pProcStatus, 0,
+		       sizeof(struct DSP_PROCESSORSTATE));
+		args->ARGS_PROC_GETSTATE.pProcStatus->cbStruct =
+			sizeof(struct DSP_PROCESSORSTATE);
+		args->ARGS_PROC_GETSTATE.pProcStatus->iState =
+			sim.aDsp[pProc->uProcessor].iState;
+		break;
+	case CMD_PROC_GETTRACE_OFFSET:
+		if (!SimGetProc(args->ARGS_PROC_GETTRACE.hProcessor))
+			status = -EFAULT;
+		else if (args->ARGS_PROC_GETTRACE.uMaxSize)
+			args->ARGS_PROC_GETTRACE.pBuf[0] = '\0';
+		break;
+	case CMD_PROC_LOAD_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_LOAD.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			SimSetProcState(pProc->uProcessor, PROC_LOADED);
+		break;
+	case CMD_PROC_START_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_START.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else if (sim.aDsp[pProc->uProcessor].iState != PROC_LOADED)
+			status = -EBADR;
+		else
+			SimSetProcState(pProc->uProcessor, PROC_RUNNING);
+		break;
+	case CMD_PROC_STOP_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_STOP.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			SimSetProcState(pProc->uProcessor, PROC_STOPPED);
+		break;
+	case CMD_PROC_REGISTERNOTIFY_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_REGISTER_NOTIFY.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			status = SimRegisterNotify(&pProc->pEvents,
+				SIM_OWNER_PROC, pProc,
+				args->ARGS_PROC_REGISTER_NOTIFY.uEventMask,
+				args->ARGS_PROC_REGISTER_NOTIFY.uNotifyType,
+				args->ARGS_PROC_REGISTER_NOTIFY.hNotification);
+		break;
+	case CMD_PROC_RSVMEM_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_RSVMEM.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			status = SimReserve(&sim.aDsp[pProc->uProcessor],
+					    args->ARGS_PROC_RSVMEM.ulSize,
+					    args->ARGS_PROC_RSVMEM.ppRsvAddr);
+		break;
+	case CMD_PROC_UNRSVMEM_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_UNRSVMEM.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			status = SimUnreserve(&sim.aDsp[pProc->uProcessor],
+					      args->ARGS_PROC_UNRSVMEM.pRsvAddr);
+		break;
+	case CMD_PROC_MAPMEM_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_MAPMEM.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			status = SimMap(&sim.aDsp[pProc->uProcessor],
+					args->ARGS_PROC_MAPMEM.pMpuAddr,
+					args->ARGS_PROC_MAPMEM.ulSize,
+					args->ARGS_PROC_MAPMEM.pReqAddr,
+					args->ARGS_PROC_MAPMEM.ppMapAddr,
+					&ulPages);
+		break;
+	case CMD_PROC_UNMAPMEM_OFFSET:
+		pProc = SimGetProc(args->ARGS_PROC_UNMAPMEM.hProcessor);
+		if (!pProc)
+			status = -EFAULT;
+		else
+			status = SimUnmap(&sim.aDsp[pProc->uProcessor],
+					  args->ARGS_PROC_UNMAPMEM.pMapAddr,
+					  &ulPages);
+		break;
+	case CMD_PROC_FLUSHMEMORY_OFFSET:
+		if (!SimGetProc(args->ARGS_PROC_FLUSHMEMORY.hProcessor))
+			status = -EFAULT;
+		break;
+	case CMD_PROC_INVALIDATEMEMORY_OFFSET:
+		if (!SimGetProc(args->ARGS_PROC_INVALIDATEMEMORY.hProcessor))
+			status = -EFAULT;
+		break;
+
+	/* NODE */
+	case CMD_NODE_ALLOCATE_OFFSET:
+		status = SimNodeAllocate(args->ARGS_NODE_ALLOCATE.hProcessor,
+					 args->ARGS_NODE_ALLOCATE.pNodeID,
+					 args->ARGS_NODE_ALLOCATE.pAttrIn,
+					 args->ARGS_NODE_ALLOCATE.phNode);
+		break;
+	case CMD_NODE_ALLOCMSGBUF_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_ALLOCMSGBUF.hNode);
+		pBufAttr = args->ARGS_NODE_ALLOCMSGBUF.pAttr;
+		if (!pNode) {
+			status = -EFAULT;
+		} else if (pBufAttr &&
+			   (pBufAttr->uSegment & MEMRY_SETVIRTUALSEGID)) {
+			/* the node's mapping of the segment */
+			pNode->pSmBase = *args->ARGS_NODE_ALLOCMSGBUF.pBuffer;
+		} else if (pBufAttr &&
+			   (pBufAttr->uSegment & MEMRY_GETVIRTUALSEGID)) {
+			*args->ARGS_NODE_ALLOCMSGBUF.pBuffer = pNode->pSmBase;
+		} else {
+			*args->ARGS_NODE_ALLOCMSGBUF.pBuffer = NULL;
+			if (pNode->pSmBase &&
+			    SimSmAlloc(pNode, args->ARGS_NODE_ALLOCMSGBUF.uSize,
+				       &ulOffset) == 0)
+				*args->ARGS_NODE_ALLOCMSGBUF.pBuffer =
+					pNode->pSmBase + ulOffset;
+		}
+		break;
+	case CMD_NODE_FREEMSGBUF_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_FREEMSGBUF.hNode);
+		pBufAttr = args->ARGS_NODE_FREEMSGBUF.pAttr;
+		if (!pNode)
+			status = -EFAULT;
+		else if (!pBufAttr ||
+			 !(pBufAttr->uSegment & MEMRY_MASKVIRTUALSEGID))
+			status = SimSmFree(pNode->pSmBase,
+					   args->ARGS_NODE_FREEMSGBUF.pBuffer);
+		break;
+	case CMD_NODE_CHANGEPRIORITY_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_CHANGEPRIORITY.hNode);
+		if (!pNode)
+			status = -EFAULT;
+		else
+			pNode->iPriority =
+				args->ARGS_NODE_CHANGEPRIORITY.iPriority;
+		break;
+	case CMD_NODE_CONNECT_OFFSET:
+		/* either end can be the GPP */
+		if (args->ARGS_NODE_CONNECT.hNode == (DSP_HNODE)DSP_HGPPNODE) {
+			if (!SimGetNode(args->ARGS_NODE_CONNECT.hOtherNode))
+				status = -EFAULT;
+		} else if (!SimGetNode(args->ARGS_NODE_CONNECT.hNode)) {
+			status = -EFAULT;
+		} else if (args->ARGS_NODE_CONNECT.hOtherNode !=
+			   (DSP_HNODE)DSP_HGPPNODE &&
+			   !SimGetNode(args->ARGS_NODE_CONNECT.hOtherNode)) {
+			status = -EFAULT;
+		}
+		break;
+	case CMD_NODE_CREATE_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_CREATE.hNode);
+		if (!pNode)
+			status = -EFAULT;
+		else if (pNode->iState != NODE_ALLOCATED)
+			status = -EBADR;
+		else
+			SimSetNodeState(pNode, NODE_CREATED);
+		break;
+	case CMD_NODE_RUN_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_RUN.hNode);
+		if (!pNode)
+			status = -EFAULT;
+		else if (pNode->iState != NODE_CREATED &&
+			 pNode->iState != NODE_PAUSED)
+			status = -EBADR;
+		else
+			SimSetNodeState(pNode, NODE_RUNNING);
+		break;
+	case CMD_NODE_PAUSE_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_PAUSE.hNode);
+		if (!pNode)
+			status = -EFAULT;
+		else if (pNode->iState != NODE_RUNNING)
+			status = -EBADR;
+		else
+			SimSetNodeState(pNode, NODE_PAUSED);
+		break;
+	case CMD_NODE_TERMINATE_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_TERMINATE.hNode);
+		if (!pNode) {
+			status = -EFAULT;
+		} else if (pNode->iState != NODE_RUNNING &&
+			   pNode->iState != NODE_PAUSED) {
+			status = -EBADR;
+		} else {
+			SimSetNodeState(pNode, NODE_DONE);
+			*args->ARGS_NODE_TERMINATE.pStatus = 0;
+		}
+		break;
+	case CMD_NODE_DELETE_OFFSET:
+		status = SimNodeDelete(args->ARGS_NODE_DELETE.hNode);
+		break;
+	case CMD_NODE_GETATTR_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_GETATTR.hNode);
+		if (!pNode)
+			status = -EFAULT;
+		else
+			status = SimNodeGetAttr(pNode,
+					args->ARGS_NODE_GETATTR.pAttr);
+		break;
+	case CMD_NODE_GETUUIDPROPS_OFFSET:
+		if (!SimGetProc(args->ARGS_NODE_GETUUIDPROPS.hProcessor))
+			status = -EFAULT;
+		else
+			SimNodeProps(args->ARGS_NODE_GETUUIDPROPS.pNodeID,
+				     args->ARGS_NODE_GETUUIDPROPS.pNodeProps);
+		break;
+	case CMD_NODE_PUTMESSAGE_OFFSET:
+		status = SimNodePutMessage(args->ARGS_NODE_PUTMESSAGE.hNode,
+					   args->ARGS_NODE_PUTMESSAGE.pMessage,
+					   args->ARGS_NODE_PUTMESSAGE.uTimeout);
+		break;
+	case CMD_NODE_GETMESSAGE_OFFSET:
+		status = SimNodeGetMessage(args->ARGS_NODE_GETMESSAGE.hNode,
+					   args->ARGS_NODE_GETMESSAGE.pMessage,
+					   args->ARGS_NODE_GETMESSAGE.uTimeout);
+		break;
+	case CMD_NODE_REGISTERNOTIFY_OFFSET:
+		pNode = SimGetNode(args->ARGS_NODE_REGISTERNOTIFY.hNode);
+		if (!pNode)
+			status = -EFAULT;
+		else
+			status = SimRegisterNotify(&pNode->pEvents,
+				SIM_OWNER_NODE, pNode,
+				args->ARGS_NODE_REGISTERNOTIFY.uEventMask,
+				args->ARGS_NODE_REGISTERNOTIFY.uNotifyType,
+				args->ARGS_NODE_REGISTERNOTIFY.hNotification);
+		break;
+
+	/* STRM */
+	case CMD_STRM_OPEN_OFFSET:
+		status = SimStrmOpen(args->ARGS_STRM_OPEN.hNode,
+				     args->ARGS_STRM_OPEN.uDirection,
+				     args->ARGS_STRM_OPEN.uIndex,
+				     args->ARGS_STRM_OPEN.pAttrIn,
+				     args->ARGS_STRM_OPEN.phStream);
+		break;
+	case CMD_STRM_CLOSE_OFFSET:
+		status = SimStrmClose(args->ARGS_STRM_CLOSE.hStream);
+		break;
+	case CMD_STRM_ISSUE_OFFSET:
+		status = SimStrmIssue(args->ARGS_STRM_ISSUE.hStream,
+				      args->ARGS_STRM_ISSUE.pBuffer,
+				      args->ARGS_STRM_ISSUE.dwBytes,
+				      args->ARGS_STRM_ISSUE.dwBufSize,
+				      args->ARGS_STRM_ISSUE.dwArg);
+		break;
+	case CMD_STRM_RECLAIM_OFFSET:
+		status = SimStrmReclaim(args->ARGS_STRM_RECLAIM.hStream,
+					args->ARGS_STRM_RECLAIM.pBufPtr,
+					args->ARGS_STRM_RECLAIM.pBytes,
+					args->ARGS_STRM_RECLAIM.pBufSize,
+					args->ARGS_STRM_RECLAIM.pdwArg);
+		break;
+	case CMD_STRM_IDLE_OFFSET:
+		status = SimStrmIdle(args->ARGS_STRM_IDLE.hStream,
+				     args->ARGS_STRM_IDLE.bFlush);
+		break;
+	case CMD_STRM_SELECT_OFFSET:
+		status = SimStrmSelect(args->ARGS_STRM_SELECT.aStreamTab,
+				       args->ARGS_STRM_SELECT.nStreams,
+				       args->ARGS_STRM_SELECT.pMask,
+				       args->ARGS_STRM_SELECT.uTimeout);
+		break;
+	case CMD_STRM_GETINFO_OFFSET:
+		pStrm = SimGetStrm(args->ARGS_STRM_GETINFO.hStream);
+		if (!pStrm)
+			status = -EFAULT;
+		else
+			status = SimStrmGetInfo(pStrm,
+					args->ARGS_STRM_GETINFO.pStreamInfo);
+		break;
+	case CMD_STRM_GETEVENTHANDLE_OFFSET:
+		status = -ENOSYS;
+		break;
+	case CMD_STRM_REGISTERNOTIFY_OFFSET:
+		pStrm = SimGetStrm(args->ARGS_STRM_REGISTERNOTIFY.hStream);
+		if (!pStrm)
+			status = -EFAULT;
+		else
+			status = SimRegisterNotify(&pStrm->pEvents,
+				SIM_OWNER_STRM, pStrm,
+				args->ARGS_STRM_REGISTERNOTIFY.uEventMask,
+				args->ARGS_STRM_REGISTERNOTIFY.uNotifyType,
+				args->ARGS_STRM_REGISTERNOTIFY.hNotification);
+		break;
+	case CMD_STRM_ALLOCATEBUFFER_OFFSET:
+		pStrm = SimGetStrm(args->ARGS_STRM_ALLOCATEBUFFER.hStream);
+		if (!pStrm)
+			status = -EFAULT;
+		else
+			status = SimStrmAllocateBuffers(pStrm,
+				args->ARGS_STRM_ALLOCATEBUFFER.uSize,
+				args->ARGS_STRM_ALLOCATEBUFFER.apBuffer,
+				args->ARGS_STRM_ALLOCATEBUFFER.uNumBufs);
+		break;
+	case CMD_STRM_FREEBUFFER_OFFSET:
+		pStrm = SimGetStrm(args->ARGS_STRM_FREEBUFFER.hStream);
+		if (!pStrm)
+			status = -EFAULT;
+		else
+			status = SimStrmFreeBuffers(pStrm,
+				args->ARGS_STRM_FREEBUFFER.apBuffer,
+				args->ARGS_STRM_FREEBUFFER.uNumBufs);
+		break;
+
+	/* CMM */
+	case CMD_CMM_GETHANDLE_OFFSET:
+		*args->ARGS_CMM_GETHANDLE.phCmmMgr = (struct CMM_OBJECT *)&sim;
+		break;
+	case CMD_CMM_GETINFO_OFFSET:
+		pCmmInfo = args->ARGS_CMM_GETINFO.pCmmInfo;
+		memset(pCmmInfo, 0, sizeof(*pCmmInfo));
+		for (pRange = sim.pSmBufs; pRange; pRange = pRange->next)
+			pCmmInfo->ulTotalInUseCnt++;
+		pCmmInfo->ulNumGPPSMSegs = 1;
+		pCmmInfo->ulMinBlockSize = SIM_SMALIGN;
+		pCmmInfo->segInfo[0].dwSegBasePa = SIM_SMBASE;
+		pCmmInfo->segInfo[0].ulTotalSegSize = SIM_SMSIZE;
+		pCmmInfo->segInfo[0].dwGPPBasePA = SIM_SMBASE;
+		pCmmInfo->segInfo[0].ulGPPSize = SIM_SMSIZE;
+		pCmmInfo->segInfo[0].ulInUseCnt = pCmmInfo->ulTotalInUseCnt;
+		break;
+	case CMD_CMM_ALLOCBUF_OFFSET:
+	case CMD_CMM_FREEBUF_OFFSET:
+		status = -EPERM;
+		break;
+
+	default:
+		status = -ENOSYS;
+		DEBUGMSG(DSPAPI_ZONE_ERROR,
+			(TEXT("DSPSIM: unsupported command\r\n")));
+		break;
+	}
+	pthread_mutex_unlock(&sim.lock);
+
+	SimDelay((SIMTIME)ulPages * sim.cfg.uMapLatency);
+	return status;
+}
+
+/*
+ *  ======== DSPSIM_GetConfig ========
+ */
+VOID DSPSIM_GetConfig(OUT struct DSPSIM_CONFIG *pConfig)
+{
+	pthread_mutex_lock(&sim.lock);
+	*pConfig = sim.cfg;
+	pthread_mutex_unlock(&sim.lock);
+}
+
+/*
+ *  ======== DSPSIM_SetConfig ========
+ *  Purpose:
+ *      Change the configuration.  The processor count and message depth
+ *      apply to processors and nodes attached or allocated afterwards.
+ */
+VOID DSPSIM_SetConfig(IN CONST struct DSPSIM_CONFIG *pConfig)
+{
+	pthread_mutex_lock(&sim.lock);
+	sim.cfg = *pConfig;
+	if (sim.cfg.uNumProcessors == 0)
+		sim.cfg.uNumProcessors = 1;
+	if (sim.cfg.uNumProcessors > DSPSIM_MAXPROCESSORS)
+		sim.cfg.uNumProcessors = DSPSIM_MAXPROCESSORS;
+	if (sim.cfg.uMsgDepth == 0)
+		sim.cfg.uMsgDepth = 1;
+	pthread_mutex_unlock(&sim.lock);
+}
+
+/*
+ *  ======== DSPSIM_GetStats ========
+ */
+VOID DSPSIM_GetStats(OUT struct DSPSIM_STATS *pStats)
+{
+	pthread_mutex_lock(&sim.lock);
+	*pStats = sim.stats;
+	pthread_mutex_unlock(&sim.lock);
+}
+
+/*
+ *  ======== DSPSIM_RegisterNode ========
+ */
+int DSPSIM_RegisterNode(IN CONST struct DSP_UUID *pNodeID,
+			DSPSIM_MSGHANDLER pfnHandler, PVOID pArg)
+{
+	struct SIM_HANDLER **ppHandler;
+	struct SIM_HANDLER *pHandler;
+	int status = 0;
+
+	if (!pNodeID)
+		return -EFAULT;
+
+	pthread_mutex_lock(&sim.lock);
+	for (ppHandler = &sim.pHandlers; *ppHandler;
+	     ppHandler = &(*ppHandler)->next) {
+		if (SimUuidEqual(&(*ppHandler)->uuid, pNodeID))
+			break;
+	}
+	pHandler = *ppHandler;
+	if (!pfnHandler) {
+		if (pHandler) {
+			*ppHandler = pHandler->next;
+			free(pHandler);
+		}
+	} else {
+		if (!pHandler) {
+			pHandler = calloc(1, sizeof(*pHandler));
+			if (pHandler) {
+				pHandler->uuid = *pNodeID;
+				*ppHandler = pHandler;
+			}
+		}
+		if (pHandler) {
+			pHandler->pfnHandler = pfnHandler;
+			pHandler->pArg = pArg;
+		} else {
+			status = -ENOMEM;
+		}
+	}
+	pthread_mutex_unlock(&sim.lock);
+	return status;
+}
+
+/*
+ *  ======== DSPSIM_SendMessage ========
+ */
+int DSPSIM_SendMessage(DSP_HNODE hNode, IN CONST struct DSP_MSG *pMsg)
+{
+	struct SIM_NODE *pNode;
+	int status;
+
+	if (!pMsg)
+		return -EFAULT;
+
+	pthread_mutex_lock(&sim.lock);
+	pNode = SimGetNode(hNode);
+	if (pNode)
+		status = SimQueueMessage(pNode, pMsg);
+	else
+		status = -EFAULT;
+	pthread_mutex_unlock(&sim.lock);
+	return status;
+}
+
+/*
+ *  ======== DSPSIM_Translate ========
+ */
+PVOID DSPSIM_Translate(DSP_HNODE hNode, ULONG ulDspAddr)
+{
+	struct SIM_NODE *pNode;
+	PVOID pMpuAddr = NULL;
+
+	pthread_mutex_lock(&sim.lock);
+	pNode = SimGetNode(hNode);
+	if (pNode)
+		pMpuAddr = SimTranslate(&sim.aDsp[pNode->uProcessor],
+					ulDspAddr, 1);
+	pthread_mutex_unlock(&sim.lock);
+	return pMpuAddr;
+}
@@ -42,11 +42,96 @@
 
 /*  ----------------------------------- This */
 #include <dsptrap.h>
+#ifdef DSPBRIDGE_SIMULATOR
+#include <dspsim.h>
+#endif
 #include <_dbdebug.h>
 
+/*  ----------------------------------- Definitions */
+/* #define BRIDGE_DRIVER_NAME  "/dev/dspbridge"*/
+#define BRIDGE_DRIVER_NAME  "/dev/DspBridge"
+
 /*  ----------------------------------- Globals */
 extern int hMediaFile;		/* class driver handle */
 
+/* Backend of the open handle, chosen by the first DSPTRAP_Open() */
+static const struct DSPTRAP_BACKEND *pTrapBackend;
+
+/*
+ *  ======== DriverOpen ========
+ */
+static int DriverOpen(void)
+{
+	int hDriver = open(BRIDGE_DRIVER_NAME, O_RDWR);
+
+	return hDriver >= 0 ? hDriver : -errno;
+}
+
+/*
+ *  ======== DriverClose ========
+ */
+static int DriverClose(int hDriver)
+{
+	return close(hDriver) < 0 ? -errno : 0;
+}
+
+/*
+ *  ======== DriverTrap ========
+ */
+static int DriverTrap(int hDriver, Trapped_Args *args, int cmd)
+{
+	int dwResult = ioctl(hDriver, cmd, args);
+
+	if (dwResult < 0)
+		dwResult = -errno;
+	return dwResult;
+}
+
+const struct DSPTRAP_BACKEND DSPTRAP_DriverBackend = {
+	"driver", DriverOpen, DriverClose, DriverTrap
+};
+
+/*
+ *  ======== DSPTRAP_SetBackend ========
+ *  Purpose:
+ *      Select the backend used by the next DspManager_Open().  Fails while
+ *      a handle is open.
+ */
+int DSPTRAP_SetBackend(const struct DSPTRAP_BACKEND *pBackend)
+{
+	if (hMediaFile >= 0)
+		return -EBUSY;
+
+	pTrapBackend = pBackend;
+	return 0;
+}
+
+/*
+ *  ======== DSPTRAP_Open ========
+ *  Purpose:
+ *      Open the selected backend.  The default is the simulator in the
+ *      DSPBRIDGE_SIMULATOR (host) build, the driver otherwise.
+ */
+int DSPTRAP_Open(void)
+{
+	if (!pTrapBackend)
+#ifdef DSPBRIDGE_SIMULATOR
+		pTrapBackend = &DSPSIM_Backend;
+#else
+		pTrapBackend = &DSPTRAP_DriverBackend;
+#endif
+
+	return pTrapBackend->pfnOpen();
+}
+
+/*
+ *  ======== DSPTRAP_Close ========
+ */
+int DSPTRAP_Close(int hDriver)
+{
+	return pTrapBackend->pfnClose(hDriver);
+}
+
 /*
  * ======== DSPTRAP_Trap ========
  */
@@ -55,11 +140,9 @@ int DSPTRAP_Trap(Trapped_Args *args, int cmd)
 	int dwResult = -EFAULT;/* returned from call into class driver */
 
 	if (hMediaFile >= 0)
-		dwResult = ioctl(hMediaFile, cmd, args);
+		dwResult = pTrapBackend->pfnTrap(hMediaFile, args, cmd);
 	else
 		DEBUGMSG(DSPAPI_ZONE_FUNCTION, "Invalid handle to driver\n");
 
-	if (dwResult < 0)
-		dwResult = -errno;
 	return dwResult;
 }
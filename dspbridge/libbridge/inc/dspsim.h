@@ -0,0 +1,115 @@
+/*
+ * dspbridge/mpu_api/inc/dspsim.h
+ *
+ * DSP-BIOS Bridge driver support functions for TI OMAP processors.
+ *
+ * Copyright (C) 2007 Texas Instruments, Inc.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation version 2.1 of the License.
+ *
+ * This program is distributed .as is. WITHOUT ANY WARRANTY of any kind,
+ * whether express or implied; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+/*
+ *  ======== dspsim.h ========
+ *  Purpose:
+ *      In-process DSP/BIOS Bridge simulator.  It is a trap backend that
+ *      emulates processors, nodes, messages, streams, DMM, shared memory and
+ *      notifications without /dev/DspBridge, so that the API, LCML and the
+ *      OMX components can be run and timed on a host.
+ *
+ *      Every node is a loopback "codec": messages put to a node come back
+ *      from it, and buffers issued to its input stream are copied into the
+ *      buffers issued to its output stream.  The USN commands of the socket
+ *      nodes share their codes with the matching acknowledgements, so the
+ *      echo also drives LCML.  The dmmcopy and zerocopymsg sample nodes do
+ *      what their DSP side does.  Other node behaviour can be plugged in
+ *      with DSPSIM_RegisterNode().
+ *
+ *      The simulator is only compiled into the host library libbridge_sim,
+ *      built with DSPBRIDGE_SIMULATOR, where it is the default backend.
+ *      The device libbridge always talks to the driver.  Latencies
+ *      are read from the environment when the backend is opened:
+ *          DSPBRIDGE_SIM_TRAP_US   us spent in every trap
+ *          DSPBRIDGE_SIM_MSG_US    us for a node to answer a message
+ *          DSPBRIDGE_SIM_MAP_US    us per 4KB page mapped or unmapped
+ *          DSPBRIDGE_SIM_STRM_BPMS stream bytes processed per ms
+ */
+
+#ifndef DSPSIM_
+#define DSPSIM_
+
+#include <dsptrap.h>
+
+#define DSPSIM_MAXPROCESSORS	3
+
+/* Simulator timing and sizing */
+struct DSPSIM_CONFIG {
+	UINT uNumProcessors;	/* processors reported, 1..DSPSIM_MAXPROCESSORS */
+	UINT uTrapLatency;	/* us spent in every trap */
+	UINT uMsgLatency;	/* us for a node to answer a message */
+	UINT uMapLatency;	/* us per 4KB page mapped or unmapped */
+	UINT uStrmBandwidth;	/* stream bytes a node processes per ms, 0 is
+				 * unlimited */
+	UINT uMsgDepth;		/* messages a node queues to the GPP */
+};
+
+/* Counters since the backend was opened */
+struct DSPSIM_STATS {
+	ULONG ulTraps;
+	ULONG ulMsgsToDsp;
+	ULONG ulMsgsFromDsp;
+	ULONG ulBufsIssued;
+	ULONG ulBytesIssued;
+	ULONG ulMaps;
+	ULONG ulUnmaps;
+	ULONG ulWaits;		/* MGR_WAIT, STRM_SELECT and blocking calls
+				 * that had to sleep */
+};
+
+/*
+ * Called from DSPNode_PutMessage() for every message put to a node, without
+ * the simulator lock held.  Replies are sent with DSPSIM_SendMessage().
+ */
+typedef VOID(*DSPSIM_MSGHANDLER) (DSP_HNODE hNode,
+				  CONST struct DSP_MSG *pMsg, PVOID pArg);
+
+extern const struct DSPTRAP_BACKEND DSPSIM_Backend;
+
+extern VOID DSPSIM_GetConfig(OUT struct DSPSIM_CONFIG *pConfig);
+extern VOID DSPSIM_SetConfig(IN CONST struct DSPSIM_CONFIG *pConfig);
+extern VOID DSPSIM_GetStats(OUT struct DSPSIM_STATS *pStats);
+
+/*
+ *  ======== DSPSIM_RegisterNode ========
+ *  Purpose:
+ *      Install the message handler of nodes allocated with pNodeID, or
+ *      restore the loopback handler if pfnHandler is NULL.
+ */
+extern int DSPSIM_RegisterNode(IN CONST struct DSP_UUID *pNodeID,
+			       DSPSIM_MSGHANDLER pfnHandler, PVOID pArg);
+
+/*
+ *  ======== DSPSIM_SendMessage ========
+ *  Purpose:
+ *      Queue a message from a node to the GPP.  It becomes ready after the
+ *      configured message latency.
+ *  Returns:
+ *      0, -EFAULT for a bad node, -ENOSPC if the node's queue is full.
+ */
+extern int DSPSIM_SendMessage(DSP_HNODE hNode, IN CONST struct DSP_MSG *pMsg);
+
+/*
+ *  ======== DSPSIM_Translate ========
+ *  Purpose:
+ *      Return the MPU address mapped at DSP address ulDspAddr on the
+ *      processor of hNode, or NULL if nothing is mapped there.
+ */
+extern PVOID DSPSIM_Translate(DSP_HNODE hNode, ULONG ulDspAddr);
+
+#endif				/* DSPSIM_ */
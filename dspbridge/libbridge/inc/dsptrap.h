@@ -43,7 +43,24 @@
     (TI_FUNCTION_OFFSET + (x)), METHOD_BUFFERED, FILE_ANY_ACCESS)
 #endif
 
+/*
+ * Trap backend.  The driver backend passes traps to the class driver,
+ * DSPSIM_Backend (dspsim.h) emulates the driver in-process and is only
+ * built with DSPBRIDGE_SIMULATOR.
+ */
+struct DSPTRAP_BACKEND {
+	const char *pszName;
+	int (*pfnOpen)(void);	/* returns a handle >= 0, or -errno */
+	int (*pfnClose)(int hDriver);
+	int (*pfnTrap)(int hDriver, Trapped_Args * args, int cmd);
+};
+
+extern const struct DSPTRAP_BACKEND DSPTRAP_DriverBackend;
+
 /* Function Prototypes */
 extern int DSPTRAP_Trap(Trapped_Args * args, int cmd);
+extern int DSPTRAP_Open(void);
+extern int DSPTRAP_Close(int hDriver);
+extern int DSPTRAP_SetBackend(const struct DSPTRAP_BACKEND *pBackend);
 
 #endif				/* DSPTRAP_ */
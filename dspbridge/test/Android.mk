@@ -0,0 +1,88 @@
+LOCAL_PATH:= $(call my-dir)
+
+# The samples built for the host against libbridge_sim, the DSP Bridge
+# simulator.  dspsim_test.sh runs them and checks their output.
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	../ping/ping.c
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/../inc \
+	$(LOCAL_PATH)/../libbridge/inc
+
+LOCAL_STATIC_LIBRARIES := \
+	libbridge_sim
+
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_CFLAGS += -Wall -g -O2 -fgnu89-inline -DOMAP_3430
+
+LOCAL_MODULE:= ping_sim
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	../strmcopy/strmcopy.c
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/../inc \
+	$(LOCAL_PATH)/../libbridge/inc
+
+LOCAL_STATIC_LIBRARIES := \
+	libbridge_sim
+
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_CFLAGS += -Wall -g -O2 -fgnu89-inline -DOMAP_3430
+
+LOCAL_MODULE:= strmcopy_sim
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	../dmmcopy/dmmcopy.c
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/../inc \
+	$(LOCAL_PATH)/../libbridge/inc
+
+LOCAL_STATIC_LIBRARIES := \
+	libbridge_sim
+
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_CFLAGS += -Wall -g -O2 -fgnu89-inline -DOMAP_3430
+
+LOCAL_MODULE:= dmmcopy_sim
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_HOST_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+	../zerocopymsg/zerocopymsg.c
+
+LOCAL_C_INCLUDES += \
+	$(LOCAL_PATH)/../inc \
+	$(LOCAL_PATH)/../libbridge/inc
+
+LOCAL_STATIC_LIBRARIES := \
+	libbridge_sim
+
+LOCAL_LDLIBS += -lpthread -lrt
+
+LOCAL_CFLAGS += -Wall -g -O2 -fgnu89-inline -DOMAP_3430
+
+LOCAL_MODULE:= zerocopymsg_sim
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_HOST_EXECUTABLE)
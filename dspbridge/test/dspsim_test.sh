@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Runs the dspbridge samples on the host against the DSP Bridge simulator
+# (the *_sim executables built by test/Android.mk) and checks their output.
+#
+# Usage: dspsim_test.sh [<directory of the *_sim executables>]
+#
+
+BIN=${1:-$ANDROID_HOST_OUT/bin}
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+FAILED=0
+
+result()
+{
+	if [ "$1" -eq 0 ]; then
+		echo "PASS: $2"
+	else
+		echo "FAIL: $2, log in $3"
+		cat "$3"
+		FAILED=1
+	fi
+}
+
+# 300000 bytes: several dmmcopy buffers and a partial last one
+head -c 300000 /dev/urandom > "$TMP/in"
+
+# ping: every message comes back
+"$BIN/ping_sim" 10 > "$TMP/ping.log" 2>&1
+[ "$(grep -c '^Ping:' "$TMP/ping.log")" -eq 10 ]
+result $? "ping" "$TMP/ping.log"
+
+# strmcopy: the file goes through the node's streams unchanged, with
+# proc-copy, DSP-DMA and zero-copy (SHMSEG0) transports
+for MODE in 0 1 2; do
+	"$BIN/strmcopy_sim" $MODE "$TMP/in" "$TMP/strm$MODE" \
+		> "$TMP/strm$MODE.log" 2>&1
+	grep -q "RunTask succeeded" "$TMP/strm$MODE.log" &&
+		cmp -s "$TMP/in" "$TMP/strm$MODE"
+	result $? "strmcopy mode $MODE" "$TMP/strm$MODE.log"
+done
+
+# dmmcopy: the node copies between DMM mapped buffers
+"$BIN/dmmcopy_sim" "$TMP/in" "$TMP/dmm" < /dev/null > "$TMP/dmm.log" 2>&1
+! grep -q "don't match" "$TMP/dmm.log" && cmp -s "$TMP/in" "$TMP/dmm"
+result $? "dmmcopy" "$TMP/dmm.log"
+
+# zerocopymsg: the node answers with an SM buffer of the doubled words
+"$BIN/zerocopymsg_sim" > "$TMP/zc.log" 2>&1
+grep -q "Zero copy Message is successfully received" "$TMP/zc.log" &&
+	! grep -q "failed" "$TMP/zc.log"
+result $? "zerocopymsg" "$TMP/zc.log"
+
+exit $FAILED
@@ -19,6 +19,7 @@
 #include <pthread.h>
 #include <time.h>
 #include <stdarg.h>
+#include <signal.h>
 
 #include "mapinfo.h"
 
@@ -28,31 +29,55 @@ extern void *__real_realloc(void *ptr, size_t size);
 extern void *__real_calloc(int nmemb, int size);
 extern void __real_free(void *ptr);
 
-static mapinfo *milist;
+static mapindex *milist;
 
 #define MAX_BACKTRACE_DEPTH 15
 #define ALLOCATION_TAG      0x1ee7d00d
+#define UNSAMPLED_TAG       0xfa57a110
+#define UNSAMPLED_FREED_TAG 0xfa57dead
 #define BACKLOG_TAG         0xbabecafe
 #define FREE_POISON         0xa5
 #define BACKLOG_MAX         50
 #define FRONT_GUARD         0xaa
 #define FRONT_GUARD_LEN     (1<<4)
+#define FRONT_GUARD_WORD    (FRONT_GUARD * 0x01010101u)
 #define REAR_GUARD          0xbb
 #define REAR_GUARD_LEN      (1<<4)
-#define SCANNER_SLEEP_S     3
+#define SCANNER_SLEEP_S     3       /* between passes over the heap */
+#define SCANNER_SLICE_MS    20      /* between slices of a pass */
+#define SCANNER_SLICE       256     /* allocations per shard per slice */
+#define SHARDS              16      /* power of two */
+#define SHARD_BACKLOG_MIN   2       /* kept per shard whatever the total */
+#define STACK_BUCKETS       4096    /* power of two */
+#define STACK_CHUNK         1024    /* stacks per chunk of the id table */
+#define STACK_CHUNKS        64
+#define PROFILE_TOP         32      /* sites in a profile dump */
+#define SAMPLE_ALL_X        40      /* size / interval above which p == 1 */
 
 struct hdr {
     uint32_t tag;
     struct hdr *prev;
     struct hdr *next;
-    intptr_t bt[MAX_BACKTRACE_DEPTH];
-    int bt_depth;
-    intptr_t freed_bt[MAX_BACKTRACE_DEPTH];
-    int freed_bt_depth;
+    uint32_t bt_id;         /* interned stack, see intern_stack() */
+    uint32_t freed_bt_id;
     size_t size;
+    size_t weight;          /* bytes this allocation stands for */
+    uint32_t pad;           /* 48 bytes on 32-bit, 64 on 64-bit */
     char front_guard[FRONT_GUARD_LEN];
 } __attribute__((packed));
 
+/* user(hdr) must keep the alignment malloc() promises */
+typedef char hdr_size_is_aligned[sizeof(struct hdr) % 8 ? -1 : 1];
+
+/* In sampling mode, allocations that are not sampled only carry this tag.
+ * It sits where the end of the front guard is in a full header, so free()
+ * can tell them apart from the word in front of the pointer.
+ */
+struct tiny {
+    uint32_t size;
+    uint32_t tag;
+} __attribute__((packed));
+
 struct ftr {
     char rear_guard[REAR_GUARD_LEN];
 } __attribute__((packed));
@@ -72,6 +97,21 @@ static inline struct hdr *meta(void *user)
     return ((struct hdr *)user) - 1;
 }
 
+static inline struct tiny *to_tiny(void *user)
+{
+    return ((struct tiny *)user) - 1;
+}
+
+static inline int is_tiny(void *user)
+{
+    return to_tiny(user)->tag == UNSAMPLED_TAG;
+}
+
+static inline int is_freed_tiny(void *user)
+{
+    return to_tiny(user)->tag == UNSAMPLED_FREED_TAG;
+}
+
 extern int __android_log_vprint(int prio, const char *tag, const char *fmt, va_list ap);
 static void default_log(const char *fmt, ...)
 {
@@ -86,34 +126,424 @@ void (*malloc_log)(const char *fmt, ...) = default_log;
 /* Call this ad dlclose() to get leaked memory */
 void free_leaked_memory(void);
 
-static unsigned num;
-static struct hdr *first;
-static struct hdr *last;
-static pthread_rwlock_t lock = PTHREAD_RWLOCK_INITIALIZER;
+/* Allocations are spread over shards by address, so that threads allocating
+ * at the same time rarely share a lock.  A shard keeps its live allocations
+ * and its share of the backlog of freed ones under one lock; an allocation
+ * always goes to the same shard when it is freed, whichever thread frees it.
+ */
+struct shard {
+    pthread_mutex_t lock;
+    unsigned num;
+    struct hdr *first;
+    struct hdr *last;
+    struct hdr *scan;   /* next allocation for the scanner in this pass */
+    int scan_done;      /* this pass is over for the shard */
+    unsigned backlog_num;
+    struct hdr *backlog_first;
+    struct hdr *backlog_last;
+} __attribute__((aligned(64)));
+
+/* static, malloc may be called before any constructor has run */
+static struct shard shards[SHARDS] = {
+    [0 ... SHARDS - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+/* BACKLOG_MAX is shared by all shards: a shard gives up its oldest entry
+ * when the total is over it, unless it holds no more than its floor.  Each
+ * shard keeps its last SHARD_BACKLOG_MIN frees, so the total stays under
+ * BACKLOG_MAX + SHARDS * SHARD_BACKLOG_MIN.
+ */
+static unsigned backlog_total;
+
+static inline struct shard *to_shard(struct hdr *hdr)
+{
+    uintptr_t a = (uintptr_t)hdr;
+    return &shards[((a >> 4) ^ (a >> 12)) & (SHARDS - 1)];
+}
+
+/* HEAPTRACKER_SAMPLE_INTERVAL=<bytes> turns on sampling: sample points fall
+ * on the stream of allocated bytes as a Poisson process with that mean
+ * spacing, and only an allocation that contains a sample point gets the full
+ * header, the backtrace and the guards.  One of size s is then sampled with
+ * probability p = 1 - exp(-s / interval) and stands for s / p bytes in the
+ * profile.  0 tracks every allocation, which is also what happens until the
+ * constructor has run.  Each thread keeps its own distance to the next point.
+ */
+static size_t sample_interval;
+static pthread_key_t sampler_key;
+static pthread_once_t sampler_once = PTHREAD_ONCE_INIT;
+
+struct sampler {
+    long long bytes_left;
+    uint32_t rand;
+};
+
+/* shared, unlocked, by threads that could not get their own */
+static struct sampler fallback_sampler = { 0, 0x9e3779b9 };
+
+#define LN2 0.69314718055994530942
+
+/* no libm here; these only run once per sample */
+static double sampler_log(double x)
+{
+    double t, t2;
+    int e = 0;
+    while (x >= 2) {
+        x *= 0.5;
+        e++;
+    }
+    while (x < 1) {
+        x *= 2;
+        e--;
+    }
+    t = (x - 1) / (x + 1);
+    t2 = t * t;
+    return e * LN2 +
+           2 * t * (1 + t2 * (1. / 3 + t2 * (1. / 5 + t2 * (1. / 7 + t2 / 9))));
+}
+
+/* 1 - exp(-x) for x >= 0, without cancellation for small x */
+static double sample_probability(double x)
+{
+    double term = 1, sum = 0, scale = 1;
+    int n;
+
+    if (x > SAMPLE_ALL_X)
+        return 1;
+    if (x < LN2) {
+        for (n = 1, term = x; n < 12; n++) {
+            sum += term;
+            term *= -x / (n + 1);
+        }
+        return sum;
+    }
+    while (x > LN2) {
+        x -= LN2;
+        scale *= 0.5;
+    }
+    for (n = 1, sum = 1; n < 12; n++) {
+        term *= -x / n;
+        sum += term;
+    }
+    return 1 - scale * sum;
+}
+
+static inline uint32_t sampler_rand(struct sampler *sampler)
+{
+    uint32_t x = sampler->rand;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return sampler->rand = x;
+}
+
+/* exponentially distributed, mean sample_interval, at least 1 */
+static long long next_sample(struct sampler *sampler)
+{
+    /* 24 random bits, never 0 */
+    double u = (sampler_rand(sampler) >> 8) + 1;
+    long long next = (24 * LN2 - sampler_log(u)) * sample_interval;
+    return next > 0 ? next : 1;
+}
+
+static void free_sampler(void *sampler)
+{
+    __real_free(sampler);
+}
+
+static void create_sampler_key(void)
+{
+    pthread_key_create(&sampler_key, free_sampler);
+}
+
+static struct sampler *get_sampler(void)
+{
+    struct sampler *sampler;
+    struct timespec ts;
+
+    pthread_once(&sampler_once, create_sampler_key);
+    sampler = pthread_getspecific(sampler_key);
+    if (sampler)
+        return sampler;
+
+    sampler = __real_malloc(sizeof(*sampler));
+    if (!sampler || pthread_setspecific(sampler_key, sampler)) {
+        __real_free(sampler);
+        return &fallback_sampler;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    sampler->rand = ((uint32_t)(uintptr_t)sampler ^ (uint32_t)ts.tv_nsec) | 1;
+    sampler->bytes_left = next_sample(sampler);
+    return sampler;
+}
+
+/* Returns 1 if an allocation of this size gets tracked, with the bytes it
+ * stands for in *weight.
+ */
+static inline int sample(size_t size, size_t *weight)
+{
+    struct sampler *sampler;
+    size_t interval = sample_interval;
+
+    if (!interval) {
+        *weight = size;
+        return 1;
+    }
+
+    sampler = get_sampler();
+    sampler->bytes_left -= size;
+    if (sampler->bytes_left > 0)
+        return 0;
+    /* the process is memoryless, draw from the last point on */
+    while (sampler->bytes_left <= 0)
+        sampler->bytes_left += next_sample(sampler);
+    *weight = size / sample_probability((double)size / interval) + 0.5;
+    return 1;
+}
+
+/* Stack traces are interned: every distinct trace is stored once, never
+ * freed, and referenced from the allocations by a 32-bit id.  Id 0 is the
+ * empty trace, which is also what is left when the table is full.  Lookups
+ * do not lock, new traces are published with a barrier under stack_lock.
+ * Each trace also counts the allocations made from it, which is the
+ * per-site profile, and caches the resolved frames for the reports.  In
+ * sampling mode the counts are weighted, unbiased estimates.
+ */
+struct stack {
+    struct stack *next;     /* in the hash bucket */
+    uint32_t hash;
+    uint32_t id;
+    int depth;
+    intptr_t bt[MAX_BACKTRACE_DEPTH];
+    int resolved;
+    const mapinfo *mi[MAX_BACKTRACE_DEPTH];
+    unsigned rel_pc[MAX_BACKTRACE_DEPTH];
+    size_t live_bytes;
+    size_t live_num;
+    size_t total_num;
+    size_t total_bytes;
+    size_t dumped_num;      /* total_num at the last profile dump */
+};
+
+static struct stack *stack_buckets[STACK_BUCKETS];
+static struct stack **stack_ids[STACK_CHUNKS];
+static uint32_t num_stacks = 1;
+static pthread_mutex_t stack_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t hash_stack(const intptr_t *bt, int depth)
+{
+    uint32_t hash = 2166136261u;
+    int i;
+    for (i = 0; i < depth; i++)
+        hash = (hash ^ (uint32_t)bt[i]) * 16777619u;
+    return hash;
+}
+
+static inline struct stack *find_stack(uint32_t hash, const intptr_t *bt, int depth)
+{
+    struct stack *stack;
+    for (stack = stack_buckets[hash & (STACK_BUCKETS - 1)]; stack; stack = stack->next)
+        if (stack->hash == hash && stack->depth == depth &&
+            !memcmp(stack->bt, bt, depth * sizeof(intptr_t)))
+            return stack;
+    return NULL;
+}
+
+static uint32_t intern_stack(const intptr_t *bt, int depth)
+{
+    uint32_t hash, id;
+    struct stack *stack;
+    struct stack **chunk;
+
+    if (depth <= 0)
+        return 0;
+    if (depth > MAX_BACKTRACE_DEPTH)
+        depth = MAX_BACKTRACE_DEPTH;
+
+    hash = hash_stack(bt, depth);
+    stack = find_stack(hash, bt, depth);
+    if (stack)
+        return stack->id;
+
+    pthread_mutex_lock(&stack_lock);
+    stack = find_stack(hash, bt, depth);
+    if (stack) {
+        pthread_mutex_unlock(&stack_lock);
+        return stack->id;
+    }
+    id = num_stacks;
+    chunk = id / STACK_CHUNK < STACK_CHUNKS ? stack_ids[id / STACK_CHUNK] : NULL;
+    if (!chunk && id / STACK_CHUNK < STACK_CHUNKS) {
+        chunk = __real_malloc(STACK_CHUNK * sizeof(struct stack *));
+        stack_ids[id / STACK_CHUNK] = chunk;
+    }
+    stack = chunk ? __real_malloc(sizeof(struct stack)) : NULL;
+    if (!stack) {
+        pthread_mutex_unlock(&stack_lock);
+        return 0;
+    }
+    memset(stack, 0, sizeof(*stack));
+    stack->hash = hash;
+    stack->id = id;
+    stack->depth = depth;
+    memcpy(stack->bt, bt, depth * sizeof(intptr_t));
+    stack->next = stack_buckets[hash & (STACK_BUCKETS - 1)];
+    chunk[id % STACK_CHUNK] = stack;
+    /* the stack must be complete before lookups can see it */
+    __sync_synchronize();
+    num_stacks++;
+    stack_buckets[hash & (STACK_BUCKETS - 1)] = stack;
+    pthread_mutex_unlock(&stack_lock);
+    return id;
+}
+
+/* ids only come from published stacks, whose slots are already set */
+static inline struct stack *to_stack(uint32_t id)
+{
+    if (!id || id / STACK_CHUNK >= STACK_CHUNKS)
+        return NULL;
+    return stack_ids[id / STACK_CHUNK][id % STACK_CHUNK];
+}
+
+static inline uint32_t record_stack(void)
+{
+    intptr_t bt[MAX_BACKTRACE_DEPTH];
+    return intern_stack(bt, heaptracker_stacktrace(bt, MAX_BACKTRACE_DEPTH));
+}
+
+/* the number of allocations a sample stands for, 1 when not sampling */
+static inline size_t weight_num(struct hdr *hdr)
+{
+    size_t num;
+    if (!hdr->size)
+        return 1;
+    num = (hdr->weight + hdr->size / 2) / hdr->size;
+    return num ? num : 1;
+}
+
+static inline void profile_live(struct hdr *hdr)
+{
+    struct stack *stack = to_stack(hdr->bt_id);
+    if (stack) {
+        __sync_fetch_and_add(&stack->live_bytes, hdr->weight);
+        __sync_fetch_and_add(&stack->live_num, weight_num(hdr));
+    }
+}
+
+static inline void profile_add(struct hdr *hdr)
+{
+    struct stack *stack = to_stack(hdr->bt_id);
+    profile_live(hdr);
+    if (stack) {
+        __sync_fetch_and_add(&stack->total_bytes, hdr->weight);
+        __sync_fetch_and_add(&stack->total_num, weight_num(hdr));
+    }
+}
+
+static inline void profile_del(struct hdr *hdr)
+{
+    struct stack *stack = to_stack(hdr->bt_id);
+    if (stack) {
+        __sync_fetch_and_sub(&stack->live_bytes, hdr->weight);
+        __sync_fetch_and_sub(&stack->live_num, weight_num(hdr));
+    }
+}
+
+static void print_stack(uint32_t id)
+{
+    struct stack *stack = to_stack(id);
+    int cnt;
+
+    malloc_log("*** *** *** *** *** *** *** *** *** *** *** *** *** *** *** ***\n");
+    if (!stack)
+        return;
 
-static unsigned backlog_num;
-static struct hdr *backlog_first;
-static struct hdr *backlog_last;
-static pthread_rwlock_t backlog_lock = PTHREAD_RWLOCK_INITIALIZER;
+    /* racing threads resolve to the same values; frames that are in no map
+     * yet are tried again, their library may be loaded later
+     */
+    if (!stack->resolved) {
+        int resolved = 1;
+        for (cnt = 0; cnt < stack->depth; cnt++) {
+            stack->mi[cnt] = pc_to_mapinfo(milist, stack->bt[cnt], &stack->rel_pc[cnt]);
+            if (!stack->mi[cnt])
+                resolved = 0;
+        }
+        __sync_synchronize();
+        stack->resolved = resolved;
+    }
+    for (cnt = 0; cnt < stack->depth; cnt++)
+        malloc_log("\t#%02d  pc %08x  %s\n", cnt,
+                   stack->mi[cnt] ? stack->rel_pc[cnt] : (unsigned)stack->bt[cnt],
+                   stack->mi[cnt] ? stack->mi[cnt]->name : "(unknown)");
+}
 
 void print_backtrace(const intptr_t *bt, int depth)
 {
-    mapinfo *mi;
-    int cnt, rel_pc;
     intptr_t self_bt[MAX_BACKTRACE_DEPTH];
 
     if (!bt) {
         depth = heaptracker_stacktrace(self_bt, MAX_BACKTRACE_DEPTH);
         bt = self_bt;
     }
+    print_stack(intern_stack(bt, depth));
+}
 
-    malloc_log("*** *** *** *** *** *** *** *** *** *** *** *** *** *** *** ***\n");
-    for (cnt = 0; cnt < depth && cnt < MAX_BACKTRACE_DEPTH; cnt++) {
-        mi = pc_to_mapinfo(milist, bt[cnt], &rel_pc);
-        malloc_log("\t#%02d  pc %08x  %s\n", cnt,
-                   mi ? rel_pc : bt[cnt],
-                   mi ? mi->name : "(unknown)");
+static int compare_live_bytes(const void *a, const void *b)
+{
+    const struct stack *x = *(struct stack * const *)a;
+    const struct stack *y = *(struct stack * const *)b;
+    return (x->live_bytes < y->live_bytes) - (x->live_bytes > y->live_bytes);
+}
+
+/* Log the PROFILE_TOP call sites holding the most live bytes, with how many
+ * allocations per second each made since the previous dump.
+ */
+void heaptracker_dump_profile(void)
+{
+    static struct timespec last_dump;
+    struct timespec now;
+    struct stack **sites;
+    uint32_t i, n = 0, count = num_stacks;
+    size_t live_bytes = 0;
+    long ms;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (now.tv_sec - last_dump.tv_sec) * 1000 +
+         (now.tv_nsec - last_dump.tv_nsec) / 1000000;
+    if (ms <= 0)
+        ms = 1;
+    last_dump = now;
+
+    sites = __real_malloc(count * sizeof(struct stack *));
+    if (!sites)
+        return;
+    for (i = 1; i < count; i++) {
+        struct stack *stack = to_stack(i);
+        if (stack && (stack->live_num || stack->total_num != stack->dumped_num)) {
+            sites[n++] = stack;
+            live_bytes += stack->live_bytes;
+        }
+    }
+    qsort(sites, n, sizeof(struct stack *), compare_live_bytes);
+
+    malloc_log("+++ HEAP PROFILE: %u BYTES LIVE FROM %u SITES, %u STACKS INTERNED\n",
+               live_bytes, n, count - 1);
+    if (sample_interval)
+        malloc_log("+++ ESTIMATED FROM ONE SAMPLE PER %u BYTES ALLOCATED\n",
+                   sample_interval);
+    for (i = 0; i < n && i < PROFILE_TOP; i++) {
+        struct stack *stack = sites[i];
+        size_t total_num = stack->total_num;
+        malloc_log("+++ SITE %u: %u BYTES IN %u LIVE ALLOCATIONS, %u ALLOCATIONS/S, "
+                   "%u BYTES IN %u ALLOCATIONS TOTAL\n",
+                   stack->id, stack->live_bytes, stack->live_num,
+                   (unsigned)((total_num - stack->dumped_num) * 1000 / ms),
+                   stack->total_bytes, total_num);
+        print_stack(stack->id);
     }
+    for (i = 0; i < n; i++)
+        sites[i]->dumped_num = sites[i]->total_num;
+    __real_free(sites);
 }
 
 static inline void init_front_guard(struct hdr *hdr)
@@ -183,27 +613,56 @@ static inline int __del(struct hdr *hdr, struct hdr **first, struct hdr **last)
     return 0;
 }
 
-static inline void add(struct hdr *hdr, size_t size)
+static inline void add(struct hdr *hdr, size_t size, size_t weight)
 {
-    pthread_rwlock_wrlock(&lock);
+    struct shard *shard = to_shard(hdr);
     hdr->tag = ALLOCATION_TAG;
     hdr->size = size;
+    hdr->weight = weight;
     init_front_guard(hdr);
     init_rear_guard(hdr);
-    num++;
-    __add(hdr, &first, &last);
-    pthread_rwlock_unlock(&lock);
+    profile_add(hdr);
+    pthread_mutex_lock(&shard->lock);
+    shard->num++;
+    __add(hdr, &shard->first, &shard->last);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/* puts back an allocation del() took out, it is not a new allocation */
+static inline void relink(struct hdr *hdr)
+{
+    struct shard *shard = to_shard(hdr);
+    hdr->tag = ALLOCATION_TAG;
+    init_front_guard(hdr);
+    init_rear_guard(hdr);
+    profile_live(hdr);
+    pthread_mutex_lock(&shard->lock);
+    shard->num++;
+    __add(hdr, &shard->first, &shard->last);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+/* the scanner must not be left pointing at an allocation that goes away */
+static inline void __del_live(struct shard *shard, struct hdr *hdr)
+{
+    if (shard->scan == hdr)
+        shard->scan = hdr->next;
+    __del(hdr, &shard->first, &shard->last);
+    shard->num--;
+    profile_del(hdr);
 }
 
 static inline int del(struct hdr *hdr)
 {
+    struct shard *shard;
+
     if (hdr->tag != ALLOCATION_TAG)
         return -1;
 
-    pthread_rwlock_wrlock(&lock);
-    __del(hdr, &first, &last);
-    num--;
-    pthread_rwlock_unlock(&lock);
+    shard = to_shard(hdr);
+    pthread_mutex_lock(&shard->lock);
+    __del_live(shard, hdr);
+    pthread_mutex_unlock(&shard->lock);
     return 0;
 }
 
@@ -277,93 +736,153 @@ static inline int __check_allocation(struct hdr *hdr, int *safe)
     if (!valid && *safe) {
         malloc_log("+++ ALLOCATION %p SIZE %d ALLOCATED HERE:\n",
                         user(hdr), hdr->size);
-        print_backtrace(hdr->bt, hdr->bt_depth);
+        print_stack(hdr->bt_id);
         if (hdr->tag == BACKLOG_TAG) {
             malloc_log("+++ ALLOCATION %p SIZE %d FREED HERE:\n",
                        user(hdr), hdr->size);
-            print_backtrace(hdr->freed_bt, hdr->freed_bt_depth);
+            print_stack(hdr->freed_bt_id);
         }
     }
 
     return valid;
 }
 
-static inline int __del_and_check(struct hdr *hdr,
-                                   struct hdr **first, struct hdr **last, unsigned *cnt,
-                                   int *safe)
-{
-    int valid;
-    valid = __check_allocation(hdr, safe);
-    if (safe) {
-        (*cnt)--;
-        __del(hdr, first, last);
-    }
-    return valid;
-}
-
-static inline void __del_from_backlog(struct hdr *hdr)
+static inline void __del_from_backlog(struct shard *shard, struct hdr *hdr)
 {
         int safe;
-        (void)__del_and_check(hdr,
-                              &backlog_first, &backlog_last, &backlog_num,
-                              &safe);
+        (void)__check_allocation(hdr, &safe);
+        shard->backlog_num--;
+        __sync_fetch_and_sub(&backlog_total, 1);
+        __del(hdr, &shard->backlog_first, &shard->backlog_last);
         hdr->tag = 0; /* clear the tag */
 }
 
 static inline void del_from_backlog(struct hdr *hdr)
 {
-    pthread_rwlock_wrlock(&backlog_lock);
-    __del_from_backlog(hdr);
-    pthread_rwlock_unlock(&backlog_lock);
+    struct shard *shard = to_shard(hdr);
+    pthread_mutex_lock(&shard->lock);
+    __del_from_backlog(shard, hdr);
+    pthread_mutex_unlock(&shard->lock);
 }
 
-static inline int del_leak(struct hdr *hdr, int *safe)
+static inline int del_leak(struct shard *shard, struct hdr *hdr, int *safe)
 {
     int valid;
-    pthread_rwlock_wrlock(&lock);
-    valid = __del_and_check(hdr,
-                            &first, &last, &num,
-                            safe);
-    pthread_rwlock_unlock(&lock);
+    pthread_mutex_lock(&shard->lock);
+    valid = __check_allocation(hdr, safe);
+    __del_live(shard, hdr);
+    pthread_mutex_unlock(&shard->lock);
     return valid;
 }
 
 static inline void add_to_backlog(struct hdr *hdr)
 {
-    pthread_rwlock_wrlock(&backlog_lock);
+    struct shard *shard = to_shard(hdr);
+    struct hdr *gone = NULL;
+
     hdr->tag = BACKLOG_TAG;
-    backlog_num++;
-    __add(hdr, &backlog_first, &backlog_last);
     poison(hdr);
+    pthread_mutex_lock(&shard->lock);
+    shard->backlog_num++;
+    __add(hdr, &shard->backlog_first, &shard->backlog_last);
     /* If we've exceeded the maximum backlog, clear it up */
-    while (backlog_num > BACKLOG_MAX) {
-        struct hdr *gone = backlog_first;
-        __del_from_backlog(gone);
+    if (__sync_add_and_fetch(&backlog_total, 1) > BACKLOG_MAX &&
+            shard->backlog_num > SHARD_BACKLOG_MIN) {
+        gone = shard->backlog_first;
+        __del_from_backlog(shard, gone);
+    }
+    pthread_mutex_unlock(&shard->lock);
+    if (gone)
         __real_free(gone);
+}
+
+/* The allocator may reuse the first words of a block once it is freed, tag
+ * included, so in sampling mode the header in front of the pointer is only
+ * looked at when the word before it still reads as the end of a front guard.
+ */
+static inline int has_hdr(void *user)
+{
+    return !sample_interval || to_tiny(user)->tag == FRONT_GUARD_WORD;
+}
+
+/* unsampled allocations are not checked, only tagged */
+static inline void *tiny_alloc(struct tiny *tiny, size_t size)
+{
+    if (tiny) {
+        tiny->size = size;
+        tiny->tag = UNSAMPLED_TAG;
+        return tiny + 1;
     }
-    pthread_rwlock_unlock(&backlog_lock);
+    return NULL;
 }
 
-void* __wrap_malloc(size_t size)
+static inline void tiny_free(void *ptr)
+{
+    struct tiny *tiny = to_tiny(ptr);
+    /* a second free() sees this tag and is reported without reading a
+     * header that is not there, unless the allocator has reused the block
+     */
+    tiny->tag = UNSAMPLED_FREED_TAG;
+    __real_free(tiny);
+}
+
+/* nothing was recorded for an unsampled allocation, only where it is freed
+ * again can be told
+ */
+static void report_freed_tiny(void *ptr, const char *what)
+{
+    intptr_t bt[MAX_BACKTRACE_DEPTH];
+    int depth;
+
+    depth = heaptracker_stacktrace(bt, MAX_BACKTRACE_DEPTH);
+    if (is_freed_tiny(ptr))
+        malloc_log("+++ UNSAMPLED ALLOCATION %p SIZE %d BYTES %s!\n",
+                   ptr, to_tiny(ptr)->size, what);
+    else
+        malloc_log("+++ ALLOCATION %p IS CORRUPTED, NOT ALLOCATED VIA TRACKER "
+                   "OR UNSAMPLED AND %s!\n", ptr, what);
+    malloc_log("+++ ALLOCATION %p NOW BEING %s HERE:\n", ptr, what);
+    print_backtrace(bt, depth);
+}
+
+static inline void *tracked_malloc(size_t size, size_t weight)
 {
-//  malloc_tracker_log("%s: %s\n", __FILE__, __FUNCTION__);
     struct hdr *hdr = __real_malloc(sizeof(struct hdr) + size +
                                     sizeof(struct ftr));
     if (hdr) {
-        hdr->bt_depth = heaptracker_stacktrace(
-                            hdr->bt, MAX_BACKTRACE_DEPTH);
-        add(hdr, size);
+        hdr->bt_id = record_stack();
+        add(hdr, size, weight);
         return user(hdr);
     }
     return NULL;
 }
 
+void* __wrap_malloc(size_t size)
+{
+//  malloc_tracker_log("%s: %s\n", __FILE__, __FUNCTION__);
+    size_t weight;
+
+    if (!sample(size, &weight))
+        return tiny_alloc(__real_malloc(sizeof(struct tiny) + size), size);
+    return tracked_malloc(size, weight);
+}
+
 void __wrap_free(void *ptr)
 {
     struct hdr *hdr;
     if (!ptr) /* ignore free(NULL) */
         return;
 
+    if (is_tiny(ptr)) {
+        tiny_free(ptr);
+        return;
+    }
+    if (is_freed_tiny(ptr) || !has_hdr(ptr)) {
+        /* leak it, it may already be someone else's */
+        report_freed_tiny(ptr, "MULTIPLY FREED");
+        return;
+    }
+
     hdr = meta(ptr);
 
     if (del(hdr) < 0) {
@@ -375,11 +894,11 @@ void __wrap_free(void *ptr)
                        user(hdr), hdr->size);
             malloc_log("+++ ALLOCATION %p SIZE %d ALLOCATED HERE:\n",
                        user(hdr), hdr->size);
-            print_backtrace(hdr->bt, hdr->bt_depth);
-            /* hdr->freed_bt_depth should be nonzero here */
+            print_stack(hdr->bt_id);
+            /* hdr->freed_bt_id should be nonzero here */
             malloc_log("+++ ALLOCATION %p SIZE %d FIRST FREED HERE:\n",
                        user(hdr), hdr->size);
-            print_backtrace(hdr->freed_bt, hdr->freed_bt_depth);
+            print_stack(hdr->freed_bt_id);
             malloc_log("+++ ALLOCATION %p SIZE %d NOW BEING FREED HERE:\n",
                        user(hdr), hdr->size);
             print_backtrace(bt, depth);
@@ -393,8 +912,7 @@ void __wrap_free(void *ptr)
         }
     }
     else {
-        hdr->freed_bt_depth = heaptracker_stacktrace(hdr->freed_bt,
-                                      MAX_BACKTRACE_DEPTH);
+        hdr->freed_bt_id = record_stack();
         add_to_backlog(hdr);
     }
 }
@@ -402,6 +920,9 @@ void __wrap_free(void *ptr)
 void *__wrap_realloc(void *ptr, size_t size)
 {
     struct hdr *hdr;
+    size_t weight;
+    int sampled;
+    void *copy;
 
     if (!size) {
         __wrap_free(ptr);
@@ -411,6 +932,26 @@ void *__wrap_realloc(void *ptr, size_t size)
     if (!ptr)
         return __wrap_malloc(size);
 
+    /* a reallocation is sampled like a new allocation of the new size */
+    sampled = sample(size, &weight);
+
+    if (is_tiny(ptr)) {
+        struct tiny *tiny = to_tiny(ptr);
+        if (!sampled)
+            return tiny_alloc(__real_realloc(tiny, sizeof(struct tiny) + size), size);
+        copy = tracked_malloc(size, weight);
+        if (copy) {
+            memcpy(copy, ptr, tiny->size < size ? tiny->size : size);
+            tiny_free(ptr);
+        }
+        return copy;
+    }
+    if (is_freed_tiny(ptr) || !has_hdr(ptr)) {
+        report_freed_tiny(ptr, "REALLOCATED AFTER BEING FREED");
+        /* the old contents are gone, as for a tracked one that is corrupted */
+        return __wrap_malloc(size);
+    }
+
     hdr = meta(ptr);
 
 //  malloc_log("%s: %s\n", __FILE__, __FUNCTION__);
@@ -423,11 +964,11 @@ void *__wrap_realloc(void *ptr, size_t size)
                        user(hdr), size, hdr->size);
             malloc_log("+++ ALLOCATION %p SIZE %d ALLOCATED HERE:\n",
                        user(hdr), hdr->size);
-            print_backtrace(hdr->bt, hdr->bt_depth);
-            /* hdr->freed_bt_depth should be nonzero here */
+            print_stack(hdr->bt_id);
+            /* hdr->freed_bt_id should be nonzero here */
             malloc_log("+++ ALLOCATION %p SIZE %d FIRST FREED HERE:\n",
                        user(hdr), hdr->size);
-            print_backtrace(hdr->freed_bt, hdr->freed_bt_depth);
+            print_stack(hdr->freed_bt_id);
             malloc_log("+++ ALLOCATION %p SIZE %d NOW BEING REALLOCATED HERE:\n",
                        user(hdr), hdr->size);
             print_backtrace(bt, depth);
@@ -447,11 +988,24 @@ void *__wrap_realloc(void *ptr, size_t size)
             // return __real_realloc(user(hdr), size); // assuming it was allocated externally
         }
     }
+
+    if (!sampled) {
+        /* the old allocation goes to the backlog as if it had been freed */
+        copy = tiny_alloc(__real_malloc(sizeof(struct tiny) + size), size);
+        if (copy) {
+            memcpy(copy, user(hdr), hdr->size < size ? hdr->size : size);
+            hdr->freed_bt_id = record_stack();
+            add_to_backlog(hdr);
+        }
+        else
+            relink(hdr);
+        return copy;
+    }
  
     hdr = __real_realloc(hdr, sizeof(struct hdr) + size + sizeof(struct ftr));
     if (hdr) {
-        hdr->bt_depth = heaptracker_stacktrace(hdr->bt, MAX_BACKTRACE_DEPTH);
-        add(hdr, size);
+        hdr->bt_id = record_stack();
+        add(hdr, size, weight);
         return user(hdr);
     }
 
@@ -463,11 +1017,14 @@ void *__wrap_calloc(int nmemb, size_t size)
 //  malloc_tracker_log("%s: %s\n", __FILE__, __FUNCTION__);
     struct hdr *hdr;
     size_t __size = nmemb * size;
+    size_t weight;
+
+    if (!sample(__size, &weight))
+        return tiny_alloc(__real_calloc(1, sizeof(struct tiny) + __size), __size);
     hdr = __real_calloc(1, sizeof(struct hdr) + __size + sizeof(struct ftr));
     if (hdr) {
-        hdr->bt_depth = heaptracker_stacktrace(
-                            hdr->bt, MAX_BACKTRACE_DEPTH);
-        add(hdr, __size);
+        hdr->bt_id = record_stack();
+        add(hdr, __size, weight);
         return user(hdr);
     }
     return NULL;
@@ -476,48 +1033,71 @@ void *__wrap_calloc(int nmemb, size_t size)
 void heaptracker_free_leaked_memory(void)
 {
     struct hdr *del; int cnt;
+    unsigned i, num = 0;
 
+    for (i = 0; i < SHARDS; i++)
+        num += shards[i].num;
     if (num)
         malloc_log("+++ THERE ARE %d LEAKED ALLOCATIONS\n", num);
 
-    while (last) {
-        int safe;
-        del = last;
-        malloc_log("+++ DELETING %d BYTES OF LEAKED MEMORY AT %p (%d REMAINING)\n",
-                del->size, user(del), num);
-        if (del_leak(del, &safe)) {
-            /* safe == 1, because the allocation is valid */
-            malloc_log("+++ ALLOCATION %p SIZE %d ALLOCATED HERE:\n",
-                        user(del), del->size);
-            print_backtrace(del->bt, del->bt_depth);
+    for (i = 0; i < SHARDS; i++) {
+        struct shard *shard = &shards[i];
+
+        while (shard->last) {
+            int safe;
+            del = shard->last;
+            malloc_log("+++ DELETING %d BYTES OF LEAKED MEMORY AT %p (%d REMAINING)\n",
+                    del->size, user(del), num--);
+            if (del_leak(shard, del, &safe)) {
+                /* safe == 1, because the allocation is valid */
+                malloc_log("+++ ALLOCATION %p SIZE %d ALLOCATED HERE:\n",
+                            user(del), del->size);
+                print_stack(del->bt_id);
+            }
+            __real_free(del);
         }
-        __real_free(del);
-    }
 
-//  malloc_log("+++ DELETING %d BACKLOGGED ALLOCATIONS\n", backlog_num);
-    while (backlog_last) {
-	del = backlog_first;
-        del_from_backlog(del);
-        __real_free(del);
+        while (shard->backlog_last) {
+            del = shard->backlog_first;
+            del_from_backlog(del);
+            __real_free(del);
+        }
     }
 }
 
-static int check_list(struct hdr *list, pthread_rwlock_t *rwlock)
+/* Check the next slice of a shard, so that the lock is never held for a
+ * whole walk of a big heap.  Returns 1 if the pass over the shard is not
+ * finished yet.
+ */
+/* returns 1 until the shard is done with the pass that start began */
+static int check_shard(struct shard *shard, int start)
 {
     struct hdr *hdr;
-    int safe, num_checked;
-
-    pthread_rwlock_rdlock(rwlock);
-    num_checked = 0;
-    hdr = list;
-    while (hdr) {
-        (void)__check_allocation(hdr, &safe);
-        hdr = hdr->next;
-        num_checked++;
+    int safe, num_checked = 0;
+    int more;
+
+    pthread_mutex_lock(&shard->lock);
+    if (start) {
+        shard->scan = shard->last;
+        shard->scan_done = 0;
+        /* the backlog is short, check all of it once per pass */
+        for (hdr = shard->backlog_last; hdr; hdr = hdr->next)
+            (void)__check_allocation(hdr, &safe);
+    }
+    if (!shard->scan_done) {
+        hdr = shard->scan;
+        while (hdr && num_checked < SCANNER_SLICE) {
+            (void)__check_allocation(hdr, &safe);
+            hdr = hdr->next;
+            num_checked++;
+        }
+        shard->scan = hdr;
+        shard->scan_done = hdr == NULL;
     }
-    pthread_rwlock_unlock(rwlock);
+    more = !shard->scan_done;
+    pthread_mutex_unlock(&shard->lock);
 
-    return num_checked;
+    return more;
 }
 
 static pthread_t scanner_thread;
@@ -525,23 +1105,41 @@ static pthread_cond_t scanner_cond = PTHREAD_COND_INITIALIZER;
 static int scanner_stop;
 static pthread_mutex_t scanner_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* HEAPTRACKER_PROFILE_SIGNAL=<signo> has the scanner dump the profile */
+static volatile sig_atomic_t profile_requested;
+
+static void request_profile(int signo __attribute__((unused)))
+{
+    profile_requested = 1;
+}
+
 static void* scanner(void *data __attribute__((unused)))
 {
     struct timespec ts;
-    int num_checked, num_checked_backlog;
+    int i, more = 0;
 
     while (1) {
-        num_checked = check_list(last, &lock);
-        num_checked_backlog = check_list(backlog_last, &backlog_lock);
-
-//      malloc_log("@@@ scanned %d/%d allocs and %d/%d freed\n",
-//                 num_checked, num,
-//                 num_checked_backlog, backlog_num);
+        /* a new pass starts on all shards together, once all are done */
+        int start = !more;
+        more = 0;
+        for (i = 0; i < SHARDS; i++)
+            more |= check_shard(&shards[i], start);
+
+        if (profile_requested) {
+            profile_requested = 0;
+            heaptracker_dump_profile();
+        }
 
         pthread_mutex_lock(&scanner_lock);
         if (!scanner_stop) {
             clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_sec += SCANNER_SLEEP_S;
+            if (more) {
+                ts.tv_nsec += SCANNER_SLICE_MS * 1000000L;
+                ts.tv_sec += ts.tv_nsec / 1000000000L;
+                ts.tv_nsec %= 1000000000L;
+            }
+            else
+                ts.tv_sec += SCANNER_SLEEP_S;
             pthread_cond_timedwait(&scanner_cond, &scanner_lock, &ts);
         }
         if (scanner_stop) {
@@ -558,8 +1156,15 @@ static void* scanner(void *data __attribute__((unused)))
 static void init(void) __attribute__((constructor));
 static void init(void)
 {
+    const char *signo = getenv("HEAPTRACKER_PROFILE_SIGNAL");
+    const char *interval = getenv("HEAPTRACKER_SAMPLE_INTERVAL");
+
 //  malloc_log("@@@ start scanner thread");
     milist = init_mapinfo(getpid());
+    if (signo && atoi(signo) > 0)
+        signal(atoi(signo), request_profile);
+    if (interval && atoi(interval) > 0)
+        sample_interval = atoi(interval);
     pthread_create(&scanner_thread,
                    NULL,
                    scanner,
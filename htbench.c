@@ -0,0 +1,93 @@
+/*
+ * Multithreaded malloc/free throughput, built both with and without the
+ * heap tracker:
+ *
+ *   htbench [threads] [operations per thread] [live allocations per thread]
+ *
+ * Every thread keeps a set of live allocations and replaces a random one at
+ * each step, with sizes between 16 and 1024 bytes.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_THREADS     4
+#define DEFAULT_OPERATIONS  200000
+#define DEFAULT_LIVE        1024
+
+static int operations = DEFAULT_OPERATIONS;
+static int live = DEFAULT_LIVE;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *worker(void *arg)
+{
+    unsigned seed = (unsigned)(uintptr_t)arg;
+    char **slots;
+    int i, slot;
+    size_t size;
+
+    slots = calloc(live, sizeof(char *));
+    if (!slots)
+        return NULL;
+
+    for (i = 0; i < operations; i++) {
+        seed = seed * 1103515245 + 12345;
+        slot = (seed >> 8) % live;
+        size = 16 + ((seed >> 20) & 1007);
+        free(slots[slot]);
+        slots[slot] = malloc(size);
+        if (slots[slot])
+            slots[slot][0] = 0;
+    }
+
+    for (i = 0; i < live; i++)
+        free(slots[i]);
+    free(slots);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    pthread_t *threads;
+    long long start, elapsed;
+    int nthreads = DEFAULT_THREADS;
+    int i;
+
+    if (argc > 1)
+        nthreads = atoi(argv[1]);
+    if (argc > 2)
+        operations = atoi(argv[2]);
+    if (argc > 3)
+        live = atoi(argv[3]);
+    if (nthreads <= 0 || operations <= 0 || live <= 0) {
+        printf("usage: %s [threads] [operations per thread] [live allocations per thread]\n",
+               argv[0]);
+        return 1;
+    }
+
+    threads = calloc(nthreads, sizeof(pthread_t));
+    if (!threads)
+        return 1;
+
+    start = now_ns();
+    for (i = 0; i < nthreads; i++)
+        pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t)(i + 1));
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    elapsed = now_ns() - start;
+
+    printf("%d threads x %d operations, %d live each: %lld ns/op, %lld kops/s\n",
+           nthreads, operations, live,
+           elapsed / ((long long)nthreads * operations),
+           (long long)nthreads * operations * 1000000LL / elapsed);
+    free(threads);
+    return 0;
+}
@@ -8,7 +8,7 @@ LOCAL_PRELINK_MODULE := false
 LOCAL_ARM_MODE := arm
 LOCAL_MODULE_PATH := $(TARGET_OUT_SHARED_LIBRARIES)/../vendor/lib/hw
 LOCAL_SHARED_LIBRARIES := liblog libEGL libcutils libutils libhardware libhardware_legacy
-LOCAL_SRC_FILES := hwc.c
+LOCAL_SRC_FILES := hwc.c hwc_queue.c
 
 LOCAL_MODULE_TAGS := optional
 
@@ -19,3 +19,5 @@ LOCAL_CFLAGS := -DLOG_TAG=\"ti_hwc\"
 # LOCAL_CFLAGS += -DLOG_NDEBUG=0
 
 include $(BUILD_SHARED_LIBRARY)
+
+include $(call all-subdir-makefiles)
@@ -34,10 +34,6 @@
 
 #define ASPECT_RATIO_TOLERANCE 0.02f
 
-#ifndef FBIO_WAITFORVSYNC
-#define FBIO_WAITFORVSYNC	_IOW('F', 0x20, __u32)
-#endif
-
 #define min(a, b) ( { typeof(a) __a = (a), __b = (b); __a < __b ? __a : __b; } )
 #define max(a, b) ( { typeof(a) __a = (a), __b = (b); __a > __b ? __a : __b; } )
 #define swap(a, b) do { typeof(a) __a = (a); (a) = (b); (b) = __a; } while (0)
@@ -48,6 +44,7 @@
 #include <video/dsscomp.h>
 
 #include "hal_public.h"
+#include "hwc_queue.h"
 
 #define MAX_HW_OVERLAYS 3
 #define NUM_NONSCALING_OVERLAYS 1
@@ -105,6 +102,90 @@ enum {
     EXT_HFLIP       = (1 << 2), /* flip l-r on output (after rotation) */
 };
 
+/* maximum layer list size whose composition is remembered between frames */
+#define MAX_CACHED_LAYERS 32
+
+/*
+ * Everything in a layer that can change how it is composed.  The buffer
+ * handle itself is left out on purpose: SurfaceFlinger cycles through the
+ * buffers of a surface every frame, but as long as their geometry, format
+ * and usage stay the same the overlay setup does too.
+ */
+struct omap3_hwc_layer_key {
+    int has_handle;
+    int format;
+    int width;
+    int height;
+    int usage;
+    uint32_t flags;
+    uint32_t transform;
+    int32_t blending;
+    hwc_rect_t sourceCrop;
+    hwc_rect_t displayFrame;
+};
+
+/* composition decision of the last prepare, reused while nothing changed */
+struct omap3_hwc_layer_cache {
+    int valid;
+    unsigned int num_layers;
+    struct omap3_hwc_layer_key keys[MAX_CACHED_LAYERS];
+    int32_t composition_type[MAX_CACHED_LAYERS];
+    __u8 clear_fb[MAX_CACHED_LAYERS];
+    int ovl_layer[MAX_HW_OVERLAYS];     /* layer posted in each overlay, -1 for fb */
+    int force_sgx;
+
+    /* device state the decision was made in */
+    omap3_hwc_ext_t ext;
+    int last_ext_ovls;
+    int last_int_ovls;
+    int hdmi_enabled;
+    int tv_enabled;
+
+    /* statistics */
+    unsigned int hits;
+    unsigned int misses;
+};
+
+/* why a layer was left to SGX instead of a DSS overlay */
+enum {
+    HWC_FALLBACK_NONE = 0,
+    HWC_FALLBACK_SKIP,          /* skip layer or no buffer */
+    HWC_FALLBACK_FORMAT,        /* pixel format or RGB ordering */
+    HWC_FALLBACK_TRANSFORM,     /* 1D buffer with a transform */
+    HWC_FALLBACK_SCALING,       /* outside the DISPC scaling limits */
+    HWC_FALLBACK_FORCED,        /* UI forced to SGX, no protected layer */
+    HWC_FALLBACK_MEMORY,        /* does not fit in the TILER slot */
+    HWC_FALLBACK_BLENDING,      /* blended layer above the framebuffer */
+    HWC_FALLBACK_OVERLAYS,      /* out of overlays */
+    HWC_FALLBACK_NUM
+};
+
+/* number of frames kept for the dump histograms, must be a power of 2 */
+#define HWC_STATS_FRAMES 256
+
+/* what happened to a single frame */
+struct omap3_hwc_frame_stats {
+    __u32 seq;                          /* frame number + 1, 0 while being written */
+    __u32 prepare_us;
+    __u32 set_us;
+    __u32 post_us;                      /* Post2, which issues DSSCIOC_SETUP_DISPC */
+    __u8 dss_ovls;                      /* layers on DSS overlays */
+    __u8 sgx_layers;                    /* layers composed by SGX */
+    __u8 reused;                        /* prepare reused the previous composition */
+    __u8 fallback[HWC_FALLBACK_NUM];    /* SGX layers by reason */
+};
+
+/*
+ * Ring of the last frames.  prepare and set fill in cur under the device
+ * lock, set publishes it.  The dump hook reads the ring without the lock
+ * and drops records whose seq changed while they were copied.
+ */
+struct omap3_hwc_stats {
+    volatile __u32 frames;
+    struct omap3_hwc_frame_stats cur;
+    struct omap3_hwc_frame_stats ring[HWC_STATS_FRAMES];
+};
+
 struct omap3_hwc_module {
     hwc_module_t base;
 
@@ -143,6 +224,10 @@ struct omap3_hwc_device {
     int ovls_blending;
 
     int force_sgx;
+
+    struct omap3_hwc_layer_cache layer_cache;
+    struct omap3_hwc_stats stats;
+    struct hwc_queue queue;             /* compositions in flight */
 };
 typedef struct omap3_hwc_device omap3_hwc_device_t;
 
@@ -672,26 +757,37 @@ static int omap3_hwc_can_scale_layer(omap3_hwc_device_t *hwc_dev, hwc_layer_t *l
                                hwc_dev->fb_dis.timings.pixel_clock);
 }
 
-static int omap3_hwc_is_valid_layer(omap3_hwc_device_t *hwc_dev,
-                                    hwc_layer_t *layer,
-                                    IMG_native_handle_t *handle)
+/* returns why the layer cannot be put on an overlay, or HWC_FALLBACK_NONE */
+static int omap3_hwc_check_layer(omap3_hwc_device_t *hwc_dev,
+                                 hwc_layer_t *layer,
+                                 IMG_native_handle_t *handle)
 {
     /* Skip layers are handled by SF */
     if ((layer->flags & HWC_SKIP_LAYER) || !handle)
-        return 0;
+        return HWC_FALLBACK_SKIP;
 
     if (!omap3_hwc_is_valid_format(handle->iFormat))
-        return 0;
+        return HWC_FALLBACK_FORMAT;
 
     /* 1D buffers: no transform, must fit in TILER slot */
     if (!is_NV12(handle->iFormat)) {
         if (layer->transform)
-            return 0;
+            return HWC_FALLBACK_TRANSFORM;
         if (mem1d(handle) > MAX_TILER_SLOT)
-            return 0;
+            return HWC_FALLBACK_MEMORY;
     }
 
-    return omap3_hwc_can_scale_layer(hwc_dev, layer, handle);
+    if (!omap3_hwc_can_scale_layer(hwc_dev, layer, handle))
+        return HWC_FALLBACK_SCALING;
+
+    return HWC_FALLBACK_NONE;
+}
+
+static int omap3_hwc_is_valid_layer(omap3_hwc_device_t *hwc_dev,
+                                    hwc_layer_t *layer,
+                                    IMG_native_handle_t *handle)
+{
+    return omap3_hwc_check_layer(hwc_dev, layer, handle) == HWC_FALLBACK_NONE;
 }
 
 static int omap3_hwc_set_best_hdmi_mode(omap3_hwc_device_t *hwc_dev, __u32 xres, __u32 yres,
@@ -902,16 +998,20 @@ static inline int can_dss_render_all(omap3_hwc_device_t *hwc_dev, struct counts
             (num->BGR == 0 || (num->RGB == 0 && !on_tv) || !hwc_dev->flags_rgb_order);
 }
 
-static inline int can_dss_render_layer(omap3_hwc_device_t *hwc_dev,
+/* returns why the layer cannot be rendered by DSS, or HWC_FALLBACK_NONE */
+static inline int dss_layer_fallback(omap3_hwc_device_t *hwc_dev,
             hwc_layer_t *layer)
 {
     IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+    int fallback = omap3_hwc_check_layer(hwc_dev, layer, handle);
+
+    if (fallback != HWC_FALLBACK_NONE)
+        return fallback;
 
     int on_tv = hwc_dev->ext.on_tv;
     int tform = hwc_dev->ext.current.enabled && (hwc_dev->ext.current.rotation || hwc_dev->ext.current.hflip);
 
-    return omap3_hwc_is_valid_layer(hwc_dev, layer, handle) &&
-		!(is_RGB(handle->iFormat)) &&
+    return (!(is_RGB(handle->iFormat)) &&
 		!(is_BGR(handle->iFormat)) &&
            /* cannot rotate non-NV12 layers on external display */
            (!tform || is_NV12(handle->iFormat)) &&
@@ -921,7 +1021,36 @@ static inline int can_dss_render_layer(omap3_hwc_device_t *hwc_dev,
            (!(hwc_dev->swap_rb ? is_RGB(handle->iFormat) : is_BGR(handle->iFormat)) ||
             !hwc_dev->flags_rgb_order) &&
            /* TV can only render RGB */
-           !(on_tv && is_BGR(handle->iFormat));
+           !(on_tv && is_BGR(handle->iFormat))) ? HWC_FALLBACK_NONE : HWC_FALLBACK_FORMAT;
+}
+
+/*
+ * Returns why the layer has to be composed by SGX in the current prepare
+ * pass, or HWC_FALLBACK_NONE if it goes to the next DSS overlay.
+ */
+static int omap3_hwc_overlay_fallback(omap3_hwc_device_t *hwc_dev, hwc_layer_t *layer,
+                                      unsigned int num_ovls, unsigned int max_ovls,
+                                      unsigned int mem_used, int fb_z)
+{
+    IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+    int fallback = dss_layer_fallback(hwc_dev, layer);
+
+    if (fallback != HWC_FALLBACK_NONE)
+        return fallback;
+    if (hwc_dev->force_sgx &&
+        /* render protected and dockable layers via DSS */
+        !is_protected(layer) &&
+        !(hwc_dev->ext.current.docking && hwc_dev->ext.current.enabled && dockable(layer)))
+        return HWC_FALLBACK_FORCED;
+    if (mem_used + mem1d(handle) >= MAX_TILER_SLOT)
+        return HWC_FALLBACK_MEMORY;
+    /* can't have a transparent overlay in the middle of the framebuffer stack */
+    if (is_BLENDED(layer->blending) && fb_z >= 0)
+        return HWC_FALLBACK_BLENDING;
+    if (num_ovls >= max_ovls)
+        return HWC_FALLBACK_OVERLAYS;
+
+    return HWC_FALLBACK_NONE;
 }
 
 static inline int display_area(struct dss2_ovl_info *o)
@@ -929,15 +1058,120 @@ static inline int display_area(struct dss2_ovl_info *o)
     return o->cfg.win.w * o->cfg.win.h;
 }
 
+static void omap3_hwc_make_layer_key(struct omap3_hwc_layer_key *key, hwc_layer_t *layer)
+{
+    IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+
+    key->has_handle = handle != NULL;
+    key->format = handle ? handle->iFormat : 0;
+    key->width = handle ? handle->iWidth : 0;
+    key->height = handle ? handle->iHeight : 0;
+    key->usage = handle ? handle->usage : 0;
+    key->flags = layer->flags;
+    key->transform = layer->transform;
+    key->blending = layer->blending;
+    key->sourceCrop = layer->sourceCrop;
+    key->displayFrame = layer->displayFrame;
+}
+
+/*
+ * Records the layer list and device state of this frame and returns 1 if
+ * both match the previous prepare, in which case its composition can be
+ * reused as is.
+ */
+static int omap3_hwc_layers_unchanged(omap3_hwc_device_t *hwc_dev, hwc_layer_list_t *list)
+{
+    struct omap3_hwc_layer_cache *cache = &hwc_dev->layer_cache;
+    unsigned int num_layers = list ? list->numHwLayers : 0;
+    int unchanged = cache->valid;
+    unsigned int i;
+
+    if (num_layers > MAX_CACHED_LAYERS) {
+        cache->valid = 0;
+        return 0;
+    }
+
+    if (num_layers != cache->num_layers ||
+        hwc_dev->last_ext_ovls != cache->last_ext_ovls ||
+        hwc_dev->last_int_ovls != cache->last_int_ovls ||
+        hdmi_enabled != cache->hdmi_enabled ||
+        tv_enabled != cache->tv_enabled ||
+        memcmp(&hwc_dev->ext, &cache->ext, sizeof(cache->ext)))
+        unchanged = 0;
+
+    cache->num_layers = num_layers;
+    cache->last_ext_ovls = hwc_dev->last_ext_ovls;
+    cache->last_int_ovls = hwc_dev->last_int_ovls;
+    cache->hdmi_enabled = hdmi_enabled;
+    cache->tv_enabled = tv_enabled;
+    memcpy(&cache->ext, &hwc_dev->ext, sizeof(cache->ext));
+
+    for (i = 0; i < num_layers; i++) {
+        struct omap3_hwc_layer_key key;
+
+        omap3_hwc_make_layer_key(&key, &list->hwLayers[i]);
+        if (unchanged && !memcmp(&key, &cache->keys[i], sizeof(key)))
+            continue;
+        unchanged = 0;
+        cache->keys[i] = key;
+    }
+
+    return unchanged;
+}
+
+/* replays the cached composition decision onto the new layer list */
+static void omap3_hwc_reuse_composition(omap3_hwc_device_t *hwc_dev, hwc_layer_list_t *list)
+{
+    struct omap3_hwc_layer_cache *cache = &hwc_dev->layer_cache;
+    unsigned int i;
+
+    for (i = 0; i < cache->num_layers; i++) {
+        hwc_layer_t *layer = &list->hwLayers[i];
+
+        layer->compositionType = cache->composition_type[i];
+        if (cache->clear_fb[i])
+            layer->hints |= HWC_HINT_CLEAR_FB;
+    }
+
+    /* the overlay setup stays, only the buffers posted with it change */
+    for (i = 0; i < hwc_dev->post2_layers; i++)
+        hwc_dev->buffers[i] = cache->ovl_layer[i] < 0 ? NULL :
+                              list->hwLayers[cache->ovl_layer[i]].handle;
+
+    /* set() counts force_sgx down, prepare always starts from its own value */
+    hwc_dev->force_sgx = cache->force_sgx;
+    cache->hits++;
+}
+
 static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t* list)
 {
     omap3_hwc_device_t *hwc_dev = (omap3_hwc_device_t *)dev;
     struct dsscomp_setup_dispc_data *dsscomp = &hwc_dev->dsscomp_data;
+    struct omap3_hwc_frame_stats *stats = &hwc_dev->stats.cur;
     struct counts num = { .composited_layers = list ? list->numHwLayers : 0 };
     unsigned int i, ix;
     int num_fb = 0;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
 
     pthread_mutex_lock(&hwc_dev->lock);
+
+    /* static UI and video playback repeat the same layer list every frame */
+    if (omap3_hwc_layers_unchanged(hwc_dev, list)) {
+        omap3_hwc_reuse_composition(hwc_dev, list);
+        dsscomp->sync_id = sync_id++;
+        /* overlay counts and fallback reasons are the same as last frame */
+        stats->reused = 1;
+        stats->set_us = stats->post_us = 0;
+        stats->prepare_us = ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - start);
+        if (debug)
+            LOGD("prepare (%d) - unchanged, reusing %s\n", dsscomp->sync_id,
+                 hwc_dev->use_sgx ? "SGX+OVL" : "all-OVL");
+        pthread_mutex_unlock(&hwc_dev->lock);
+        return 0;
+    }
+    hwc_dev->layer_cache.misses++;
+    memset(stats, 0, sizeof(*stats));
+
     memset(dsscomp, 0x0, sizeof(*dsscomp));
     dsscomp->sync_id = sync_id++;
 	hwc_dev->force_sgx = 1; //Always all UI layers have to go to SGX for composition in OMAP3.
@@ -948,6 +1182,8 @@ static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t*
         IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
 
         layer->compositionType = HWC_FRAMEBUFFER;
+        if (i < MAX_CACHED_LAYERS)
+            hwc_dev->layer_cache.clear_fb[i] = 0;
 
         if (omap3_hwc_is_valid_layer(hwc_dev, layer, handle)) {
             num.possible_overlay_layers++;
@@ -1033,16 +1269,10 @@ static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t*
     for (i = 0; list && i < list->numHwLayers; i++) {
         hwc_layer_t *layer = &list->hwLayers[i];
         IMG_native_handle_t *handle = (IMG_native_handle_t *)layer->handle;
+        int fallback = omap3_hwc_overlay_fallback(hwc_dev, layer, dsscomp->num_ovls,
+                                                  num.max_hw_overlays, mem_used, fb_z);
 
-        if (dsscomp->num_ovls < num.max_hw_overlays &&
-            can_dss_render_layer(hwc_dev, layer) &&
-            (!hwc_dev->force_sgx ||
-             /* render protected and dockable layers via DSS */
-             is_protected(layer) ||
-             (hwc_dev->ext.current.docking && hwc_dev->ext.current.enabled && dockable(layer))) &&
-            mem_used + mem1d(handle) < MAX_TILER_SLOT &&
-            /* can't have a transparent overlay in the middle of the framebuffer stack */
-            !(is_BLENDED(layer->blending) && fb_z >= 0)) {
+        if (fallback == HWC_FALLBACK_NONE) {
             /* render via DSS overlay */
             mem_used += mem1d(handle);
             layer->compositionType = HWC_OVERLAY;
@@ -1051,13 +1281,17 @@ static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t*
 	    /* for OMAP3: if FB layer data comes on top of overlay area then that area
 	     * need to clear after every transaction.
 	     */
-            if (hwc_dev->use_sgx)
+            if (hwc_dev->use_sgx) {
                 layer->hints |= HWC_HINT_CLEAR_FB;
+                if (i < MAX_CACHED_LAYERS)
+                    hwc_dev->layer_cache.clear_fb[i] = 1;
+            }
             /* see if any of the (non-backmost) overlays are doing blending */
             else if (is_BLENDED(layer) && i > 0)
                 hwc_dev->ovls_blending = 1;
 
             hwc_dev->buffers[dsscomp->num_ovls] = handle;
+            hwc_dev->layer_cache.ovl_layer[dsscomp->num_ovls] = i;
 
             omap3_hwc_setup_layer(hwc_dev,
                                   &dsscomp->ovls[dsscomp->num_ovls],
@@ -1094,15 +1328,21 @@ static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t*
 
             dsscomp->num_ovls++;
             z++;
-        } else if (hwc_dev->use_sgx) {
-            if (fb_z < 0) {
-                /* NOTE: we are not handling transparent cutout for now */
-                fb_z = z;
-                z++;
-            } else {
-                /* move fb z-order up (by lowering dss layers) */
-                while (fb_z < z - 1)
-                    dsscomp->ovls[1 + fb_z++].cfg.zorder--;
+            stats->dss_ovls++;
+        } else {
+            stats->sgx_layers++;
+            stats->fallback[fallback]++;
+
+            if (hwc_dev->use_sgx) {
+                if (fb_z < 0) {
+                    /* NOTE: we are not handling transparent cutout for now */
+                    fb_z = z;
+                    z++;
+                } else {
+                    /* move fb z-order up (by lowering dss layers) */
+                    while (fb_z < z - 1)
+                        dsscomp->ovls[1 + fb_z++].cfg.zorder--;
+                }
             }
         }
     }
@@ -1120,6 +1360,7 @@ static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t*
         }
 
         hwc_dev->buffers[0] = NULL;
+        hwc_dev->layer_cache.ovl_layer[0] = -1;
         omap3_hwc_setup_layer_base(&dsscomp->ovls[0].cfg, fb_z,
                                    hwc_dev->fb_dev->base.format,
                                    1,   /* FB is always premultiplied */
@@ -1236,10 +1477,35 @@ static int omap3_hwc_prepare(struct hwc_composer_device *dev, hwc_layer_list_t*
         dsscomp->mgrs[1].ix = 1;
         dsscomp->num_mgrs++;
     }
+
+    /* remember the decision for the following frames */
+    if (list && list->numHwLayers <= MAX_CACHED_LAYERS) {
+        for (i = 0; i < list->numHwLayers; i++)
+            hwc_dev->layer_cache.composition_type[i] = list->hwLayers[i].compositionType;
+    }
+    hwc_dev->layer_cache.force_sgx = hwc_dev->force_sgx;
+    hwc_dev->layer_cache.valid = !list || list->numHwLayers <= MAX_CACHED_LAYERS;
+
+    stats->prepare_us = ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - start);
     pthread_mutex_unlock(&hwc_dev->lock);
     return 0;
 }
 
+/* single writer, called with the device lock held */
+static void omap3_hwc_publish_stats(struct omap3_hwc_stats *stats)
+{
+    __u32 frame = stats->frames;
+    struct omap3_hwc_frame_stats *rec = &stats->ring[frame & (HWC_STATS_FRAMES - 1)];
+
+    rec->seq = 0;
+    __sync_synchronize();
+    memcpy((char *)rec + sizeof(rec->seq), (char *)&stats->cur + sizeof(rec->seq),
+           sizeof(*rec) - sizeof(rec->seq));
+    __sync_synchronize();
+    rec->seq = frame + 1;
+    stats->frames = frame + 1;
+}
+
 static void omap3_hwc_reset_screen(omap3_hwc_device_t *hwc_dev)
 {
     static int first_set = 1;
@@ -1268,6 +1534,26 @@ static void omap3_hwc_reset_screen(omap3_hwc_device_t *hwc_dev)
     }
 }
 
+static int omap3_hwc_ioctl(int fd, int req, void *arg)
+{
+    return ioctl(fd, req, arg);
+}
+
+/* called by the queue with the device lock held */
+static int omap3_hwc_post(void *data, struct dsscomp_setup_dispc_data *dsscomp,
+                          buffer_handle_t *buffers, unsigned int num_buffers)
+{
+    omap3_hwc_device_t *hwc_dev = data;
+    nsecs_t post_start = systemTime(SYSTEM_TIME_MONOTONIC);
+    int err;
+
+    err = hwc_dev->fb_dev->Post2((framebuffer_device_t *)hwc_dev->fb_dev,
+                                 buffers, num_buffers,
+                                 dsscomp, sizeof(*dsscomp));
+    hwc_dev->stats.cur.post_us = ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - post_start);
+    return err;
+}
+
 static int omap3_hwc_set(struct hwc_composer_device *dev, hwc_display_t dpy,
                hwc_surface_t sur, hwc_layer_list_t* list)
 {
@@ -1276,6 +1562,7 @@ static int omap3_hwc_set(struct hwc_composer_device *dev, hwc_display_t dpy,
     int err = 0;
     unsigned int i;
     int invalidate;
+    nsecs_t start = systemTime(SYSTEM_TIME_MONOTONIC);
 
     pthread_mutex_lock(&hwc_dev->lock);
 
@@ -1363,25 +1650,19 @@ static int omap3_hwc_set(struct hwc_composer_device *dev, hwc_display_t dpy,
         if (hwc_dev->force_sgx > 0)
             hwc_dev->force_sgx--;
 
-        err = hwc_dev->fb_dev->Post2((framebuffer_device_t *)hwc_dev->fb_dev,
-                                 hwc_dev->buffers,
-                                 hwc_dev->post2_layers,
-                                 dsscomp, sizeof(*dsscomp));
-
-        if (!hwc_dev->use_sgx) {
-            __u32 crt = 0;
-            int err2 = ioctl(hwc_dev->fb_fd, FBIO_WAITFORVSYNC, &crt);
-            if (err2) {
-                ALOGE("failed to wait for vsync (%d)", errno);
-                err = err ? : -errno;
-            }
-        }
+        /* SGX frames went through eglSwapBuffers, which waited for the display */
+        err = hwc_queue_submit(&hwc_dev->queue, dsscomp,
+                               hwc_dev->buffers, hwc_dev->post2_layers,
+                               hwc_dev->use_sgx);
     }
     hwc_dev->last_ext_ovls = hwc_dev->ext_ovls;
     hwc_dev->last_int_ovls = hwc_dev->post2_layers;
     if (err)
         ALOGE("Post2 error");
 
+    hwc_dev->stats.cur.set_us = ns2us(systemTime(SYSTEM_TIME_MONOTONIC) - start);
+    omap3_hwc_publish_stats(&hwc_dev->stats);
+
 err_out:
     pthread_mutex_unlock(&hwc_dev->lock);
 
@@ -1397,6 +1678,9 @@ static int dump_printf(char *buff, int buff_len, int len, const char *fmt, ...)
 
     int print_len;
 
+    if (len >= buff_len)
+        return len;
+
     va_start(ap, fmt);
 
     print_len = vsnprintf(buff + len, buff_len - len, fmt, ap);
@@ -1406,6 +1690,97 @@ static int dump_printf(char *buff, int buff_len, int len, const char *fmt, ...)
     return len + print_len;
 }
 
+/* upper bounds of the timing histogram buckets, the last bucket is open */
+static const __u32 stats_bucket_us[] = { 250, 500, 1000, 2000, 4000, 8000, 16000, 33000 };
+#define HWC_STATS_BUCKETS (sizeof(stats_bucket_us) / sizeof(*stats_bucket_us) + 1)
+
+static const char *fallback_names[HWC_FALLBACK_NUM] = {
+    [HWC_FALLBACK_SKIP] = "skip",
+    [HWC_FALLBACK_FORMAT] = "format",
+    [HWC_FALLBACK_TRANSFORM] = "transform",
+    [HWC_FALLBACK_SCALING] = "scaling",
+    [HWC_FALLBACK_FORCED] = "forced",
+    [HWC_FALLBACK_MEMORY] = "tiler",
+    [HWC_FALLBACK_BLENDING] = "blending",
+    [HWC_FALLBACK_OVERLAYS] = "ovl-count",
+};
+
+static unsigned int stats_bucket(__u32 us)
+{
+    unsigned int i;
+
+    for (i = 0; i < HWC_STATS_BUCKETS - 1; i++)
+        if (us < stats_bucket_us[i])
+            break;
+    return i;
+}
+
+static int dump_histogram(char *buff, int buff_len, int len, const char *name,
+                          unsigned int *hist)
+{
+    unsigned int i;
+
+    len = dump_printf(buff, buff_len, len, "    %-8s", name);
+    for (i = 0; i < HWC_STATS_BUCKETS; i++)
+        len = dump_printf(buff, buff_len, len, " %6u", hist[i]);
+    return dump_printf(buff, buff_len, len, "\n");
+}
+
+static int omap3_hwc_dump_stats(struct omap3_hwc_stats *stats, char *buff, int buff_len, int len)
+{
+    unsigned int prepare[HWC_STATS_BUCKETS] = { 0 };
+    unsigned int set[HWC_STATS_BUCKETS] = { 0 };
+    unsigned int post[HWC_STATS_BUCKETS] = { 0 };
+    unsigned int dss_ovls[MAX_HW_OVERLAYS + 1] = { 0 };
+    unsigned int fallback_frames[HWC_FALLBACK_NUM] = { 0 };
+    unsigned int fallback_layers[HWC_FALLBACK_NUM] = { 0 };
+    unsigned int num = 0, reused = 0, sgx_layers = 0;
+    __u32 frames = stats->frames;
+    __u32 f = frames > HWC_STATS_FRAMES ? frames - HWC_STATS_FRAMES : 0;
+    unsigned int i;
+
+    for (; f < frames; f++) {
+        struct omap3_hwc_frame_stats *slot = &stats->ring[f & (HWC_STATS_FRAMES - 1)];
+        struct omap3_hwc_frame_stats rec = *slot;
+
+        /* skip records set() rewrote while we were copying them */
+        __sync_synchronize();
+        if (rec.seq != f + 1 || slot->seq != f + 1)
+            continue;
+
+        num++;
+        reused += rec.reused;
+        sgx_layers += rec.sgx_layers;
+        prepare[stats_bucket(rec.prepare_us)]++;
+        set[stats_bucket(rec.set_us)]++;
+        post[stats_bucket(rec.post_us)]++;
+        dss_ovls[min(rec.dss_ovls, MAX_HW_OVERLAYS)]++;
+        for (i = 1; i < HWC_FALLBACK_NUM; i++) {
+            fallback_frames[i] += rec.fallback[i] != 0;
+            fallback_layers[i] += rec.fallback[i];
+        }
+    }
+
+    len = dump_printf(buff, buff_len, len, "  last %u frames (%u reused, %u SGX layers):\n",
+                      num, reused, sgx_layers);
+    len = dump_printf(buff, buff_len, len, "    us      ");
+    for (i = 0; i < HWC_STATS_BUCKETS - 1; i++)
+        len = dump_printf(buff, buff_len, len, " <%5u", stats_bucket_us[i]);
+    len = dump_printf(buff, buff_len, len, "   more\n");
+    len = dump_histogram(buff, buff_len, len, "prepare", prepare);
+    len = dump_histogram(buff, buff_len, len, "set", set);
+    len = dump_histogram(buff, buff_len, len, "post2", post);
+
+    len = dump_printf(buff, buff_len, len, "    dss overlays:");
+    for (i = 0; i <= MAX_HW_OVERLAYS; i++)
+        len = dump_printf(buff, buff_len, len, " %u:%u", i, dss_ovls[i]);
+    len = dump_printf(buff, buff_len, len, "\n    sgx fallback (frames/layers):");
+    for (i = 1; i < HWC_FALLBACK_NUM; i++)
+        len = dump_printf(buff, buff_len, len, " %s=%u/%u", fallback_names[i],
+                          fallback_frames[i], fallback_layers[i]);
+    return dump_printf(buff, buff_len, len, "\n");
+}
+
 static void omap3_hwc_dump(struct hwc_composer_device *dev, char *buff, int buff_len)
 {
     omap3_hwc_device_t *hwc_dev = (omap3_hwc_device_t *)dev;
@@ -1415,6 +1790,19 @@ static void omap3_hwc_dump(struct hwc_composer_device *dev, char *buff, int buff
 
     len = dump_printf(buff, buff_len, len, "omap3_hwc %d:\n", dsscomp->num_ovls);
     len = dump_printf(buff, buff_len, len, "  idle timeout: %dms\n", hwc_dev->idle);
+    len = dump_printf(buff, buff_len, len, "  unchanged frames: %u of %u\n",
+                      hwc_dev->layer_cache.hits,
+                      hwc_dev->layer_cache.hits + hwc_dev->layer_cache.misses);
+    len = omap3_hwc_dump_stats(&hwc_dev->stats, buff, buff_len, len);
+    len = dump_printf(buff, buff_len, len,
+                      "  queue: %u in flight, %u posted, %u displayed, "
+                      "%u blocked, %u dropped\n",
+                      hwc_dev->queue.count,
+                      hwc_dev->queue.posted, hwc_dev->queue.displayed,
+                      hwc_dev->queue.blocked, hwc_dev->queue.dropped);
+    for (i = 0; i < (int)hwc_dev->queue.count; i++)
+        len = dump_printf(buff, buff_len, len, "     sync_id %u\n",
+                          hwc_dev->queue.entries[(hwc_dev->queue.head + i) % HWC_QUEUE_MAX].sync_id);
 
     for (i = 0; i < dsscomp->num_ovls; i++) {
         struct dss2_ovl_cfg *cfg = &dsscomp->ovls[i].cfg;
@@ -1728,6 +2116,8 @@ static int omap3_hwc_device_open(const hw_module_t* module, const char* name,
     hwc_dev->flags_nv12_only = atoi(value);
     property_get("debug.hwc.idle", value, "250");
     hwc_dev->idle = atoi(value);
+    hwc_queue_init(&hwc_dev->queue, hwc_dev->fb_fd,
+                   omap3_hwc_ioctl, omap3_hwc_post, hwc_dev);
 
     /* get the board specific clone properties */
     /* 0:0:1280:720 */
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include <cutils/log.h>
+
+#include "hwc_queue.h"
+
+void hwc_queue_init(struct hwc_queue *queue, int fb_fd, hwc_queue_ioctl_t ioctl,
+                    hwc_queue_post_t post, void *post_data)
+{
+    memset(queue, 0, sizeof(*queue));
+    queue->fb_fd = fb_fd;
+    queue->ioctl = ioctl;
+    queue->post = post;
+    queue->post_data = post_data;
+}
+
+/* the oldest composition in flight is on the screen now */
+static void hwc_queue_retire(struct hwc_queue *queue)
+{
+    queue->shown = queue->entries[queue->head];
+    queue->has_shown = 1;
+    queue->head = (queue->head + 1) % HWC_QUEUE_MAX;
+    queue->count--;
+}
+
+int hwc_queue_wait(struct hwc_queue *queue)
+{
+    __u32 crt = 0;
+    int err;
+
+    if (!queue->count)
+        return 0;
+
+    err = queue->ioctl(queue->fb_fd, FBIO_WAITFORVSYNC, &crt);
+    if (err) {
+        err = -errno;
+        /* retire it anyway, the queue has to make progress */
+        ALOGE("failed to wait for vsync (%d), dropping composition %u",
+              errno, queue->entries[queue->head].sync_id);
+        queue->dropped++;
+    } else {
+        queue->displayed++;
+    }
+    hwc_queue_retire(queue);
+    return err;
+}
+
+int hwc_queue_submit(struct hwc_queue *queue, struct dsscomp_setup_dispc_data *dsscomp,
+                     buffer_handle_t *buffers, unsigned int num_buffers, int throttled)
+{
+    int err;
+
+    if (throttled) {
+        while (queue->count) {
+            queue->displayed++;
+            hwc_queue_retire(queue);
+        }
+    }
+
+    err = queue->post(queue->post_data, dsscomp, buffers, num_buffers);
+    if (err) {
+        /* never reaches the screen, nothing to track */
+        queue->dropped++;
+        return err;
+    }
+    queue->entries[(queue->head + queue->count) % HWC_QUEUE_MAX].sync_id = dsscomp->sync_id;
+    queue->count++;
+    queue->posted++;
+
+    if (throttled)
+        return 0;
+
+    /* a throttled composition is still ahead of this one */
+    if (queue->count > 1)
+        queue->blocked++;
+    while (queue->count) {
+        int err2 = hwc_queue_wait(queue);
+        err = err ? : err2;
+    }
+    return err;
+}
+
+int hwc_queue_in_flight(struct hwc_queue *queue, __u32 sync_id)
+{
+    unsigned int i;
+
+    for (i = 0; i < queue->count; i++)
+        if (queue->entries[(queue->head + i) % HWC_QUEUE_MAX].sync_id == sync_id)
+            return 1;
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HWC_QUEUE_H
+#define HWC_QUEUE_H
+
+#include <linux/fb.h>
+#include <cutils/native_handle.h>
+#include <video/dsscomp.h>
+
+#ifndef FBIO_WAITFORVSYNC
+#define FBIO_WAITFORVSYNC	_IOW('F', 0x20, __u32)
+#endif
+
+#define HWC_QUEUE_MAX       2   /* a throttled composition and the next one */
+
+typedef int (*hwc_queue_ioctl_t)(int fd, int req, void *arg);
+typedef int (*hwc_queue_post_t)(void *data, struct dsscomp_setup_dispc_data *dsscomp,
+                                buffer_handle_t *buffers, unsigned int num_buffers);
+
+struct hwc_queue_entry {
+    __u32 sync_id;
+};
+
+/*
+ * Compositions posted to DSS and not confirmed on the screen yet, oldest
+ * first.  The display takes them in order, one per vsync, and only a vsync
+ * waited for retires the oldest one.
+ *
+ * A post returns once its composition is on the screen, as set() always
+ * did.  SurfaceFlinger hands the buffers of the previous frame back to
+ * their producers when set() returns, and nothing here could keep them from
+ * drawing into a buffer DSS still reads, so set() never runs ahead of the
+ * display.  The one exception are SGX frames: they went through
+ * eglSwapBuffers, which waited for the display, so a throttled post takes
+ * everything before it as shown and leaves its own composition in flight.
+ * The next post waits for that one first.
+ *
+ * All kernel calls go through post and ioctl, so that the queue can run
+ * against a fake device.
+ */
+struct hwc_queue {
+    int fb_fd;                          /* for FBIO_WAITFORVSYNC */
+    hwc_queue_ioctl_t ioctl;
+    hwc_queue_post_t post;              /* issues DSSCIOC_SETUP_DISPC */
+    void *post_data;
+
+    unsigned int head;                  /* oldest in flight */
+    unsigned int count;
+    struct hwc_queue_entry entries[HWC_QUEUE_MAX];
+    struct hwc_queue_entry shown;       /* on the screen */
+    int has_shown;
+
+    /* statistics */
+    unsigned int posted;
+    unsigned int displayed;
+    unsigned int blocked;               /* posts that waited for an earlier one */
+    unsigned int dropped;               /* failed posts and unconfirmed frames */
+};
+
+void hwc_queue_init(struct hwc_queue *queue, int fb_fd, hwc_queue_ioctl_t ioctl,
+                    hwc_queue_post_t post, void *post_data);
+
+/* Post a composition and wait until it is on the screen.  throttled means
+ * the caller already synchronized with the display, as eglSwapBuffers does,
+ * so everything posted before is taken as shown and the post does not wait.
+ */
+int hwc_queue_submit(struct hwc_queue *queue, struct dsscomp_setup_dispc_data *dsscomp,
+                     buffer_handle_t *buffers, unsigned int num_buffers, int throttled);
+
+/* wait for the next vsync and retire the oldest composition in flight */
+int hwc_queue_wait(struct hwc_queue *queue);
+
+/* 1 while the composition with this sync_id is posted but not shown yet */
+int hwc_queue_in_flight(struct hwc_queue *queue, __u32 sync_id);
+
+#endif
@@ -0,0 +1,18 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+        hwc_queue_test.c \
+        ../hwc_queue.c
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/..
+
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+
+LOCAL_CFLAGS := -DLOG_TAG=\"ti_hwc\"
+
+LOCAL_MODULE:= hwc_queue_test
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_EXECUTABLE)
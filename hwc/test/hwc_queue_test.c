@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Runs the in-flight composition queue against a fake dsscomp device.
+ *
+ *   hwc_queue_test
+ *
+ * DSSCIOC_SETUP_DISPC queues the composition in the fake display, and
+ * FBIO_WAITFORVSYNC shows the next queued one, like DSS taking one
+ * composition per vsync.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "hwc_queue.h"
+
+#define FAKE_DSSCOMP_FD     10
+#define FAKE_FB_FD          11
+#define FAKE_QUEUE_MAX      16
+
+static struct {
+    __u32 queued[FAKE_QUEUE_MAX];
+    unsigned int num_queued;
+    __u32 on_screen;
+    unsigned int vsyncs;
+    int fail_setup;
+    int fail_vsync;
+} fake;
+
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static int fake_ioctl(int fd, int req, void *arg)
+{
+    if (fd == FAKE_DSSCOMP_FD && req == DSSCIOC_SETUP_DISPC) {
+        struct dsscomp_setup_dispc_data *d = arg;
+        if (fake.fail_setup || fake.num_queued == FAKE_QUEUE_MAX) {
+            errno = EBUSY;
+            return -1;
+        }
+        fake.queued[fake.num_queued++] = d->sync_id;
+        return 0;
+    }
+    if (fd == FAKE_FB_FD && req == FBIO_WAITFORVSYNC) {
+        fake.vsyncs++;
+        if (fake.fail_vsync) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (fake.num_queued) {
+            fake.on_screen = fake.queued[0];
+            memmove(fake.queued, fake.queued + 1, --fake.num_queued * sizeof(__u32));
+        }
+        return 0;
+    }
+    errno = ENOTTY;
+    return -1;
+}
+
+/* stands in for Post2, which issues the ioctl in the framebuffer HAL */
+static int fake_post(void *data, struct dsscomp_setup_dispc_data *dsscomp,
+                     buffer_handle_t *buffers, unsigned int num_buffers)
+{
+    return fake_ioctl(FAKE_DSSCOMP_FD, DSSCIOC_SETUP_DISPC, dsscomp) ? -errno : 0;
+}
+
+static int submit(struct hwc_queue *queue, __u32 sync_id, int throttled)
+{
+    struct dsscomp_setup_dispc_data d;
+    buffer_handle_t buffers[2] = {
+        (buffer_handle_t)(uintptr_t)(sync_id * 16 + 1),
+        (buffer_handle_t)(uintptr_t)(sync_id * 16 + 2),
+    };
+
+    memset(&d, 0, sizeof(d));
+    d.sync_id = sync_id;
+    return hwc_queue_submit(queue, &d, buffers, 2, throttled);
+}
+
+static void reset(struct hwc_queue *queue)
+{
+    memset(&fake, 0, sizeof(fake));
+    hwc_queue_init(queue, FAKE_FB_FD, fake_ioctl, fake_post, NULL);
+}
+
+static void test_sync(void)
+{
+    struct hwc_queue queue;
+    __u32 id;
+
+    reset(&queue);
+    for (id = 1; id <= 10; id++) {
+        CHECK(submit(&queue, id, 0) == 0);
+        /* on the screen before set() returns */
+        CHECK(fake.on_screen == id && queue.count == 0);
+        CHECK(!hwc_queue_in_flight(&queue, id));
+    }
+    /* each one waited for itself only */
+    CHECK(queue.blocked == 0 && fake.vsyncs == 10);
+    CHECK(queue.shown.sync_id == 10 && queue.displayed == 10);
+    CHECK(hwc_queue_wait(&queue) == 0 && fake.vsyncs == 10);
+}
+
+static void test_throttled(void)
+{
+    struct hwc_queue queue;
+    __u32 crt = 0;
+
+    reset(&queue);
+    /* SGX frames come after eglSwapBuffers, which synchronized already */
+    CHECK(submit(&queue, 1, 1) == 0);
+    CHECK(fake.vsyncs == 0 && queue.count == 1);
+    CHECK(hwc_queue_in_flight(&queue, 1));
+    /* the next eglSwapBuffers waits for composition 1 */
+    CHECK(fake_ioctl(FAKE_FB_FD, FBIO_WAITFORVSYNC, &crt) == 0);
+    CHECK(submit(&queue, 2, 1) == 0);
+    CHECK(fake.vsyncs == 1 && queue.count == 1);
+    CHECK(queue.has_shown && queue.shown.sync_id == 1);
+    CHECK(hwc_queue_in_flight(&queue, 2));
+
+    /* the next regular frame waits for composition 2 first, then itself */
+    CHECK(submit(&queue, 3, 0) == 0);
+    CHECK(fake.vsyncs == 3 && fake.on_screen == 3);
+    CHECK(queue.blocked == 1 && queue.count == 0);
+    CHECK(queue.shown.sync_id == 3 && queue.displayed == 3);
+    CHECK(queue.posted == 3 && queue.dropped == 0);
+}
+
+static void test_errors(void)
+{
+    struct hwc_queue queue;
+
+    reset(&queue);
+    fake.fail_setup = 1;
+    CHECK(submit(&queue, 1, 0) == -EBUSY);
+    CHECK(queue.count == 0 && queue.dropped == 1);
+    fake.fail_setup = 0;
+
+    CHECK(submit(&queue, 2, 0) == 0);
+    CHECK(queue.displayed == 1 && fake.on_screen == 2);
+    fake.fail_vsync = 1;
+    /* 3 goes out but cannot be confirmed, it is dropped */
+    CHECK(submit(&queue, 3, 0) == -ETIMEDOUT);
+    CHECK(queue.dropped == 2 && queue.displayed == 1);
+    CHECK(queue.count == 0 && !hwc_queue_in_flight(&queue, 3));
+    CHECK(fake.num_queued == 1);
+}
+
+int main(void)
+{
+    test_sync();
+    test_throttled();
+    test_errors();
+
+    if (failures) {
+        printf("hwc queue test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("hwc queue test: passed\n");
+    return 0;
+}
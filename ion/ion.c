@@ -30,10 +30,36 @@
 #include <linux/ion.h>
 #include <linux/omap_ion.h>
 #include "ion.h"
+#include "ion_pool.h"
+
+static int kernel_open(const char *path, int flags)
+{
+        return open(path, flags);
+}
+
+static int kernel_ioctl(int fd, int req, void *arg)
+{
+        return ioctl(fd, req, arg);
+}
+
+static const struct ion_kernel_ops kernel_ops = {
+        .open = kernel_open,
+        .close = close,
+        .ioctl = kernel_ioctl,
+        .mmap = mmap,
+        .munmap = munmap,
+};
+
+static const struct ion_kernel_ops *ops = &kernel_ops;
+
+void ion_set_kernel_ops(const struct ion_kernel_ops *kops)
+{
+        ops = kops ? kops : &kernel_ops;
+}
 
 int ion_open()
 {
-        int fd = open("/dev/ion", O_RDWR);
+        int fd = ops->open("/dev/ion", O_RDWR);
         if (fd < 0)
                 ALOGE("open /dev/ion failed!\n");
         return fd;
@@ -41,12 +67,12 @@ int ion_open()
 
 int ion_close(int fd)
 {
-    return close(fd);
+    return ops->close(fd);
 }
 
 int ion_ioctl(int fd, int req, void *arg)
 {
-        int ret = ioctl(fd, req, arg);
+        int ret = ops->ioctl(fd, req, arg);
         if (ret < 0) {
                 ALOGE("ioctl %d failed with code %d: %s\n", req,
                        ret, strerror(errno));
@@ -119,7 +145,7 @@ int ion_map(int fd, struct ion_handle *handle, size_t length, int prot,
                 ALOGE("map ioctl returned negative fd\n");
                 return -EINVAL;
         }
-        *ptr = mmap(NULL, length, prot, flags, *map_fd, offset);
+        *ptr = ops->mmap(NULL, length, prot, flags, *map_fd, offset);
         if (*ptr == MAP_FAILED) {
                 ALOGE("mmap failed: %s\n", strerror(errno));
                 return -errno;
@@ -127,6 +153,11 @@ int ion_map(int fd, struct ion_handle *handle, size_t length, int prot,
         return ret;
 }
 
+int ion_unmap(void *ptr, size_t length)
+{
+        return ops->munmap(ptr, length);
+}
+
 int ion_share(int fd, struct ion_handle *handle, int *share_fd)
 {
         int map_fd;
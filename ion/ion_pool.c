@@ -0,0 +1,290 @@
+/*
+ *  ion_pool.c
+ *
+ * Buffer pool on top of the ion allocator functions
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+
+#define LOG_TAG "ion"
+#include <cutils/log.h>
+
+#include <linux/ion.h>
+#include "ion.h"
+#include "ion_pool.h"
+
+#define ION_POOL_PAGE   4096
+
+/*
+ * Free buffers are kept in one LIFO list per heap mask and size class, so
+ * that the buffer handed out is the one most recently used, and on one LRU
+ * list across classes, oldest first, which is the order they are trimmed in.
+ * Mappings and share fds stay with a buffer until it goes back to the kernel.
+ */
+struct ion_pool_list {
+        unsigned int flags;
+        size_t len;
+        struct ion_pool_buffer *first;
+};
+
+struct ion_pool {
+        int fd;
+        unsigned int pool_flags;
+        size_t max_cached;
+        size_t cached;
+        pthread_mutex_t lock;
+        struct ion_pool_buffer *lru_first;
+        struct ion_pool_buffer *lru_last;
+        unsigned int num_lists;
+        struct ion_pool_list lists[ION_POOL_MAX_LISTS];
+};
+
+/* round up to ION_POOL_CLASS_STEPS classes per power of two of pages */
+static size_t class_size(size_t len)
+{
+        size_t pages = (len + ION_POOL_PAGE - 1) / ION_POOL_PAGE;
+        size_t top = 1, step;
+
+        if (pages <= ION_POOL_CLASS_STEPS)
+                return (pages ? pages : 1) * ION_POOL_PAGE;
+        while (top <= pages / 2)
+                top <<= 1;
+        step = top / ION_POOL_CLASS_STEPS;
+        return (pages + step - 1) / step * step * ION_POOL_PAGE;
+}
+
+static struct ion_pool_list *find_list(struct ion_pool *pool,
+                                       unsigned int flags, size_t len,
+                                       int add)
+{
+        unsigned int i;
+
+        for (i = 0; i < pool->num_lists; i++)
+                if (pool->lists[i].flags == flags && pool->lists[i].len == len)
+                        return &pool->lists[i];
+        if (!add || pool->num_lists == ION_POOL_MAX_LISTS)
+                return NULL;
+        pool->lists[i].flags = flags;
+        pool->lists[i].len = len;
+        pool->lists[i].first = NULL;
+        pool->num_lists++;
+        return &pool->lists[i];
+}
+
+static void lru_unlink(struct ion_pool *pool, struct ion_pool_buffer *buffer)
+{
+        if (buffer->lru_prev)
+                buffer->lru_prev->lru_next = buffer->lru_next;
+        else
+                pool->lru_first = buffer->lru_next;
+        if (buffer->lru_next)
+                buffer->lru_next->lru_prev = buffer->lru_prev;
+        else
+                pool->lru_last = buffer->lru_prev;
+}
+
+static void release(struct ion_pool *pool, struct ion_pool_buffer *buffer)
+{
+        if (buffer->ptr)
+                ion_unmap(buffer->ptr, buffer->len);
+        if (buffer->map_fd >= 0)
+                ion_close(buffer->map_fd);
+        if (buffer->share_fd >= 0)
+                ion_close(buffer->share_fd);
+        ion_free(pool->fd, buffer->handle);
+        free(buffer);
+}
+
+/* take the oldest free buffers off the lists until at most keep bytes
+ * remain, and return them chained through next; called with the lock held
+ */
+static struct ion_pool_buffer *evict(struct ion_pool *pool, size_t keep)
+{
+        struct ion_pool_buffer *gone = NULL;
+
+        while (pool->cached > keep && pool->lru_first) {
+                struct ion_pool_buffer *buffer = pool->lru_first;
+                struct ion_pool_list *list;
+                struct ion_pool_buffer **link;
+
+                lru_unlink(pool, buffer);
+                list = find_list(pool, buffer->flags, buffer->len, 0);
+                for (link = &list->first; *link != buffer; link = &(*link)->next)
+                        ;
+                *link = buffer->next;
+                pool->cached -= buffer->len;
+                buffer->next = gone;
+                gone = buffer;
+        }
+        return gone;
+}
+
+static void release_all(struct ion_pool *pool, struct ion_pool_buffer *gone)
+{
+        while (gone) {
+                struct ion_pool_buffer *next = gone->next;
+                release(pool, gone);
+                gone = next;
+        }
+}
+
+int ion_pool_create(int fd, unsigned int pool_flags, size_t max_cached,
+                    struct ion_pool **pool)
+{
+        struct ion_pool *p = calloc(1, sizeof(*p));
+
+        if (!p)
+                return -ENOMEM;
+        p->fd = fd;
+        p->pool_flags = pool_flags;
+        p->max_cached = max_cached;
+        pthread_mutex_init(&p->lock, NULL);
+        *pool = p;
+        return 0;
+}
+
+void ion_pool_destroy(struct ion_pool *pool)
+{
+        ion_pool_trim(pool, 0);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+}
+
+int ion_pool_alloc(struct ion_pool *pool, size_t len, unsigned int flags,
+                   struct ion_pool_buffer **buffer)
+{
+        struct ion_pool_buffer *b = NULL;
+        struct ion_pool_list *list;
+        int ret;
+
+        len = class_size(len);
+        pthread_mutex_lock(&pool->lock);
+        list = find_list(pool, flags, len, 0);
+        if (list && list->first) {
+                b = list->first;
+                list->first = b->next;
+                lru_unlink(pool, b);
+                pool->cached -= b->len;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        if (b) {
+                /* the kernel zeroes new buffers, recycled ones are done here */
+                if (pool->pool_flags & ION_POOL_ZERO_ON_REUSE) {
+                        unsigned char *ptr;
+                        ret = ion_pool_map(pool, b, &ptr);
+                        if (ret < 0) {
+                                release(pool, b);
+                                return ret;
+                        }
+                        memset(ptr, 0, b->len);
+                }
+                *buffer = b;
+                return 0;
+        }
+
+        b = calloc(1, sizeof(*b));
+        if (!b)
+                return -ENOMEM;
+        ret = ion_alloc(pool->fd, len, 0, flags, &b->handle);
+        if (ret < 0) {
+                free(b);
+                return ret;
+        }
+        b->len = len;
+        b->flags = flags;
+        b->map_fd = -1;
+        b->share_fd = -1;
+        *buffer = b;
+        return 0;
+}
+
+int ion_pool_map(struct ion_pool *pool, struct ion_pool_buffer *buffer,
+                 unsigned char **ptr)
+{
+        int ret;
+
+        if (!buffer->ptr) {
+                ret = ion_map(pool->fd, buffer->handle, buffer->len,
+                              PROT_READ | PROT_WRITE, MAP_SHARED, 0,
+                              &buffer->ptr, &buffer->map_fd);
+                if (ret < 0) {
+                        buffer->ptr = NULL;
+                        return ret;
+                }
+        }
+        *ptr = buffer->ptr;
+        return 0;
+}
+
+int ion_pool_share(struct ion_pool *pool, struct ion_pool_buffer *buffer,
+                   int *share_fd)
+{
+        int ret;
+
+        if (buffer->share_fd < 0) {
+                ret = ion_share(pool->fd, buffer->handle, &buffer->share_fd);
+                if (ret < 0) {
+                        buffer->share_fd = -1;
+                        return ret;
+                }
+        }
+        *share_fd = buffer->share_fd;
+        return 0;
+}
+
+void ion_pool_free(struct ion_pool *pool, struct ion_pool_buffer *buffer)
+{
+        struct ion_pool_buffer *gone;
+        struct ion_pool_list *list;
+
+        pthread_mutex_lock(&pool->lock);
+        list = buffer->len <= pool->max_cached ?
+                find_list(pool, buffer->flags, buffer->len, 1) : NULL;
+        if (!list) {
+                pthread_mutex_unlock(&pool->lock);
+                release(pool, buffer);
+                return;
+        }
+        buffer->next = list->first;
+        list->first = buffer;
+        buffer->lru_prev = pool->lru_last;
+        buffer->lru_next = NULL;
+        if (pool->lru_last)
+                pool->lru_last->lru_next = buffer;
+        else
+                pool->lru_first = buffer;
+        pool->lru_last = buffer;
+        pool->cached += buffer->len;
+        gone = evict(pool, pool->max_cached);
+        pthread_mutex_unlock(&pool->lock);
+
+        /* the ioctls and munmaps are made without the lock */
+        release_all(pool, gone);
+}
+
+void ion_pool_trim(struct ion_pool *pool, size_t keep)
+{
+        struct ion_pool_buffer *gone;
+
+        pthread_mutex_lock(&pool->lock);
+        gone = evict(pool, keep);
+        pthread_mutex_unlock(&pool->lock);
+        release_all(pool, gone);
+}
@@ -0,0 +1,132 @@
+/*
+ *  ion_pool.h
+ *
+ * Buffer pool on top of the ion allocator functions
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef _ION_POOL_H
+#define _ION_POOL_H
+
+#include <sys/types.h>
+
+struct ion_handle;
+
+/**
+ * struct ion_kernel_ops - the calls ion.c makes into the kernel
+ *
+ * Every open, close, ioctl, mmap and munmap of libion goes through these, so
+ * that tests and benchmarks can run against a stub device.
+ */
+struct ion_kernel_ops {
+        int (*open)(const char *path, int flags);
+        int (*close)(int fd);
+        int (*ioctl)(int fd, int req, void *arg);
+        void *(*mmap)(void *addr, size_t length, int prot, int flags,
+                      int fd, off_t offset);
+        int (*munmap)(void *addr, size_t length);
+};
+
+/**
+ * ion_set_kernel_ops() - replace the kernel interface, NULL restores it
+ *
+ * Must be called before any other libion function of the process.
+ */
+void ion_set_kernel_ops(const struct ion_kernel_ops *ops);
+
+/* munmap through the kernel ops, for mappings made by ion_map() */
+int ion_unmap(void *ptr, size_t length);
+
+/* zero recycled buffers before they are handed out again */
+#define ION_POOL_ZERO_ON_REUSE  (1 << 0)
+
+/* sizes are rounded up to four classes per power of two of pages */
+#define ION_POOL_CLASS_STEPS    4
+#define ION_POOL_MAX_LISTS      32
+
+/**
+ * struct ion_pool_buffer - a buffer handed out by a pool
+ * @handle: the ion handle, valid until the pool frees the buffer
+ * @len: the size that was allocated, at least the requested one
+ * @flags: the heap mask it was allocated from
+ *
+ * The mapping and share fd are created on first use and kept with the
+ * buffer while it sits in the pool.
+ */
+struct ion_pool_buffer {
+        struct ion_handle *handle;
+        size_t len;
+        unsigned int flags;
+        unsigned char *ptr;
+        int map_fd;
+        int share_fd;
+        struct ion_pool_buffer *next;           /* in its free list */
+        struct ion_pool_buffer *lru_prev;       /* among all free buffers */
+        struct ion_pool_buffer *lru_next;
+};
+
+struct ion_pool;
+
+/**
+ * ion_pool_create() - create a pool of buffers allocated from an ion fd
+ * @fd: from ion_open(), stays owned by the caller
+ * @pool_flags: ION_POOL_ZERO_ON_REUSE or 0
+ * @max_cached: free buffers beyond this many bytes go back to the kernel,
+ * least recently freed first
+ */
+int ion_pool_create(int fd, unsigned int pool_flags, size_t max_cached,
+                    struct ion_pool **pool);
+
+/**
+ * ion_pool_destroy() - free all pooled buffers and the pool
+ *
+ * Buffers still allocated from the pool must have been freed to it.
+ */
+void ion_pool_destroy(struct ion_pool *pool);
+
+/**
+ * ion_pool_alloc() - get a buffer, recycled when the pool has one
+ * @len: requested size
+ * @flags: heap mask, as for ion_alloc()
+ */
+int ion_pool_alloc(struct ion_pool *pool, size_t len, unsigned int flags,
+                   struct ion_pool_buffer **buffer);
+
+/**
+ * ion_pool_map() - map a buffer read/write, shared
+ *
+ * The mapping lives as long as the buffer; do not munmap it.
+ */
+int ion_pool_map(struct ion_pool *pool, struct ion_pool_buffer *buffer,
+                 unsigned char **ptr);
+
+/**
+ * ion_pool_share() - get a share fd for a buffer
+ *
+ * The fd lives as long as the buffer; do not close it.
+ */
+int ion_pool_share(struct ion_pool *pool, struct ion_pool_buffer *buffer,
+                   int *share_fd);
+
+/**
+ * ion_pool_free() - give a buffer back to the pool
+ */
+void ion_pool_free(struct ion_pool *pool, struct ion_pool_buffer *buffer);
+
+/**
+ * ion_pool_trim() - release free buffers until at most @keep bytes remain
+ */
+void ion_pool_trim(struct ion_pool *pool, size_t keep);
+
+#endif /* _ION_POOL_H */
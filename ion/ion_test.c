@@ -9,9 +9,11 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "ion.h"
+#include "ion_pool.h"
 #include <linux/ion.h>
 #include <linux/omap_ion.h>
 
@@ -24,6 +26,7 @@ size_t width = 1024*1024, height = 1024*1024;
 int fmt = TILER_PIXEL_FMT_32BIT;
 int tiler_test = 0;
 size_t stride;
+int iterations = 10000;
 
 int _ion_alloc_test(int *fd, struct ion_handle **handle)
 {
@@ -224,10 +227,146 @@ void ion_share_test()
 	}
 }
 
+/*
+ * A stub /dev/ion for the benchmark: handles are heap blocks, map and share
+ * fds are dups of /dev/null and mappings are anonymous, so what is measured
+ * is libion and the pool plus real fd and mmap costs.
+ */
+static int stub_open(const char *path, int flags)
+{
+	return open("/dev/null", O_RDWR);
+}
+
+static int stub_ioctl(int fd, int req, void *arg)
+{
+	struct ion_allocation_data *alloc_data = arg;
+	struct ion_handle_data *handle_data = arg;
+	struct ion_fd_data *fd_data = arg;
+
+	switch (req) {
+	case ION_IOC_ALLOC:
+		alloc_data->handle = malloc(sizeof(size_t));
+		if (!alloc_data->handle) {
+			errno = ENOMEM;
+			return -1;
+		}
+		*(size_t *)alloc_data->handle = alloc_data->len;
+		return 0;
+	case ION_IOC_FREE:
+		free(handle_data->handle);
+		return 0;
+	case ION_IOC_MAP:
+	case ION_IOC_SHARE:
+		fd_data->fd = dup(fd);
+		return fd_data->fd < 0 ? -1 : 0;
+	default:
+		errno = ENOTTY;
+		return -1;
+	}
+}
+
+static void *stub_mmap(void *addr, size_t length, int prot, int flags,
+		       int fd, off_t offset)
+{
+	return mmap(addr, length, prot, flags | MAP_ANONYMOUS, -1, 0);
+}
+
+static const struct ion_kernel_ops stub_ops = {
+	.open = stub_open,
+	.close = close,
+	.ioctl = stub_ioctl,
+	.mmap = stub_mmap,
+	.munmap = munmap,
+};
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* allocate, map, touch and free, cycling through four sizes */
+void ion_bench_test()
+{
+	struct ion_handle *handle;
+	struct ion_pool_buffer *buffer;
+	struct ion_pool *pool;
+	unsigned char *ptr;
+	long long start, raw_ns, pool_ns;
+	int fd, map_fd, i, ret = 0;
+	size_t size;
+
+	if (iterations <= 0) {
+		printf("%s: the number of iterations must be positive\n",
+		       __func__);
+		return;
+	}
+
+	fd = ion_open();
+	if (fd < 0)
+		return;
+
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		size = len >> (i % 4);
+		ret = ion_alloc(fd, size, align, alloc_flags, &handle);
+		if (ret)
+			break;
+		ret = ion_map(fd, handle, size, prot, map_flags, 0, &ptr, &map_fd);
+		if (ret) {
+			ion_free(fd, handle);
+			break;
+		}
+		ptr[0] = (unsigned char)i;
+		ion_unmap(ptr, size);
+		close(map_fd);
+		ion_free(fd, handle);
+	}
+	raw_ns = now_ns() - start;
+	if (ret) {
+		printf("%s failed: %s\n", __func__, strerror(-ret));
+		ion_close(fd);
+		return;
+	}
+
+	ret = ion_pool_create(fd, 0, 4 * len, &pool);
+	if (ret) {
+		printf("%s failed: %s\n", __func__, strerror(-ret));
+		ion_close(fd);
+		return;
+	}
+	start = now_ns();
+	for (i = 0; i < iterations; i++) {
+		size = len >> (i % 4);
+		ret = ion_pool_alloc(pool, size, alloc_flags, &buffer);
+		if (ret)
+			break;
+		ret = ion_pool_map(pool, buffer, &ptr);
+		if (ret) {
+			ion_pool_free(pool, buffer);
+			break;
+		}
+		ptr[0] = (unsigned char)i;
+		ion_pool_free(pool, buffer);
+	}
+	pool_ns = now_ns() - start;
+	ion_pool_destroy(pool);
+	ion_close(fd);
+	if (ret) {
+		printf("%s failed: %s\n", __func__, strerror(-ret));
+		return;
+	}
+
+	printf("ion bench test: %d cycles, raw %lld ns, pooled %lld ns per "
+	       "allocate/map/free\n", iterations, raw_ns / iterations,
+	       pool_ns / iterations);
+}
+
 int main(int argc, char* argv[]) {
 	int c;
 	enum tests {
-		ALLOC_TEST = 0, MAP_TEST, SHARE_TEST,
+		ALLOC_TEST = 0, MAP_TEST, SHARE_TEST, BENCH_TEST,
 	};
 
 	while (1) {
@@ -244,9 +383,13 @@ int main(int argc, char* argv[]) {
 			{"width", required_argument, 0, 'w'},
 			{"height", required_argument, 0, 'h'},
 			{"fmt", required_argument, 0, 'r'},
+			{"bench", no_argument, 0, 'b'},
+			{"iterations", required_argument, 0, 'n'},
+			{"stub", no_argument, 0, 'u'},
+			{0, 0, 0, 0},
 		};
 		int i = 0;
-		c = getopt_long(argc, argv, "af:h:l:mr:stw:", opts, &i);
+		c = getopt_long(argc, argv, "abf:h:l:mn:r:stuw:", opts, &i);
 		if (c == -1)
 			break;
 
@@ -299,6 +442,15 @@ int main(int argc, char* argv[]) {
 		case 't':
 			tiler_test = 1;
 			break;
+		case 'b':
+			test = BENCH_TEST;
+			break;
+		case 'n':
+			iterations = atoi(optarg);
+			break;
+		case 'u':
+			ion_set_kernel_ops(&stub_ops);
+			break;
 		}
 	}
 	printf("test %d, len %u, width %u, height %u fmt %u align %u, "
@@ -314,8 +466,11 @@ int main(int argc, char* argv[]) {
 		case SHARE_TEST:
 			ion_share_test();
 			break;
+		case BENCH_TEST:
+			ion_bench_test();
+			break;
 		default:
-			printf("must specify a test (alloc, map, share)\n");
+			printf("must specify a test (alloc, map, share, bench)\n");
 	}
 	return 0;
 }
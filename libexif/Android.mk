@@ -38,3 +38,55 @@ LOCAL_MODULE:= libexifgnu
 LOCAL_MODULE_TAGS:= optional
 
 include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := ./test/bench-load.c
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := libexifgnu
+
+LOCAL_MODULE:= exif-bench-load
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := ./test/test-filter.c
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := libexifgnu
+
+LOCAL_MODULE:= exif-test-filter
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := ./test/test-borrow.c
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := libexifgnu
+
+LOCAL_MODULE:= exif-test-borrow
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := ./test/test-save-buf.c
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)
+
+LOCAL_STATIC_LIBRARIES := libexifgnu
+
+LOCAL_MODULE:= exif-test-save-buf
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_EXECUTABLE)
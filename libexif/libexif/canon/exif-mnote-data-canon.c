@@ -244,9 +244,10 @@ exif_mnote_data_canon_load (ExifMnoteData *ne,
 		n->entries[tcount].components = exif_get_long (buf + o + 4, n->order);
 		n->entries[tcount].order      = n->order;
 
-		exif_log (ne->log, EXIF_LOG_CODE_DEBUG, "ExifMnoteCanon",
-			"Loading entry 0x%x ('%s')...", n->entries[tcount].tag,
-			 mnote_canon_tag_get_name (n->entries[tcount].tag));
+		if (exif_log_enabled (ne->log))
+			exif_log (ne->log, EXIF_LOG_CODE_DEBUG, "ExifMnoteCanon",
+				"Loading entry 0x%x ('%s')...", n->entries[tcount].tag,
+				 mnote_canon_tag_get_name (n->entries[tcount].tag));
 
 		/*
 		 * Size? If bigger than 4 bytes, the actual data is not
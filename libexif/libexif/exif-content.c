@@ -37,6 +37,8 @@ struct _ExifContentPrivate
 
 	ExifMem *mem;
 	ExifLog *log;
+
+	unsigned int size;	/* Number of entries there is room for */
 };
 
 ExifContent *
@@ -129,10 +131,28 @@ exif_content_dump (ExifContent *content, unsigned int indent)
 		exif_entry_dump (content->entries[i], indent + 1);
 }
 
+/*! Make room for n entries in total, so that adding them does not
+ *  reallocate. This function is used by exif-data.c only.
+ */
+int
+exif_content_reserve (ExifContent *c, unsigned int n)
+{
+	ExifEntry **entries;
+
+	if (!c || !c->priv) return 0;
+	if (n <= c->priv->size) return 1;
+
+	entries = exif_mem_realloc (c->priv->mem,
+		c->entries, sizeof (ExifEntry*) * n);
+	if (!entries) return 0;
+	c->entries = entries;
+	c->priv->size = n;
+	return 1;
+}
+
 void
 exif_content_add_entry (ExifContent *c, ExifEntry *entry)
 {
-	ExifEntry **entries;
 	if (!c || !c->priv || !entry || entry->parent) return;
 
 	/* One tag can only be added once to an IFD. */
@@ -144,12 +164,11 @@ exif_content_add_entry (ExifContent *c, ExifEntry *entry)
 		return;
 	}
 
-	entries = exif_mem_realloc (c->priv->mem,
-		c->entries, sizeof (ExifEntry*) * (c->count + 1));
-	if (!entries) return;
+	if (c->count == c->priv->size &&
+	    !exif_content_reserve (c, c->count ? 2 * c->count : 4))
+		return;
 	entry->parent = c;
-	entries[c->count++] = entry;
-	c->entries = entries;
+	c->entries[c->count++] = entry;
 	exif_entry_ref (entry);
 }
 
@@ -179,6 +198,7 @@ exif_content_remove_entry (ExifContent *c, ExifEntry *e)
 		}
 		c->entries = t;
 		c->count--;
+		c->priv->size = c->count;
 		if (i != c->count) { /* we deallocated the last slot already */ 
 			memmove (&t[i], &t[i + 1], sizeof (ExifEntry*) * (c->count - i - 1));
 			t[c->count-1] = temp;
@@ -187,6 +207,7 @@ exif_content_remove_entry (ExifContent *c, ExifEntry *e)
 		exif_mem_free (c->priv->mem, c->entries);
 		c->entries = NULL;
 		c->count = 0;
+		c->priv->size = 0;
 	}
 	e->parent = NULL;
 	exif_entry_unref (e);
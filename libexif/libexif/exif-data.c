@@ -39,6 +39,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#define EXIF_DATA_LOAD_ALL ((1 << EXIF_IFD_COUNT) - 1)
+
 #if defined(__WATCOMC__) || defined(_MSC_VER)
 #      define strncasecmp strnicmp
 #endif
@@ -66,10 +68,37 @@ struct _ExifDataPrivate
 	/* Temporarily used while loading data */
 	unsigned int offset_mnote;
 
+	/* data->data when it points into the loaded buffer */
+	unsigned char *borrowed;
+
+	/* Set by exif_data_set_load_filter */
+	unsigned int load_ifds;		/* to be loaded in full */
+	unsigned int scan_ifds;		/* may hold one of load_tags */
+	ExifTag *load_tags;
+	unsigned int num_load_tags;
+
+	/* Where the EXIF header is in the loaded buffer, and the IFDs
+	 * that were not loaded in full, 0 for the others */
+	unsigned int offset_exif;
+	ExifLong offset_ifd[EXIF_IFD_COUNT];
+
 	ExifDataOption options;
 	ExifDataType data_type;
 };
 
+/* This function is hidden in exif-content.c */
+int exif_content_reserve (ExifContent *, unsigned int);
+
+/* These functions are hidden in exif-entry.c */
+void exif_entry_borrow_data (ExifEntry *, const unsigned char *, unsigned int);
+int exif_entry_own_data (ExifEntry *);
+void exif_entry_free_data (ExifEntry *);
+
+static void exif_data_load_data_mnote (ExifData *data, const unsigned char *d,
+				       unsigned int ds);
+static void fix_loaded_func (ExifContent *c, void *data);
+static void fix_entry_func (ExifEntry *e, void *data);
+
 static void *
 exif_data_alloc (ExifData *data, unsigned int i)
 {
@@ -125,6 +154,8 @@ exif_data_new_mem (ExifMem *mem)
 	data->priv->mem = mem;
 	exif_mem_ref (mem);
 
+	data->priv->load_ifds = EXIF_DATA_LOAD_ALL;
+
 	for (i = 0; i < EXIF_IFD_COUNT; i++) {
 		data->ifd[i] = exif_content_new_mem (data->priv->mem);
 		if (!data->ifd[i]) {
@@ -174,9 +205,10 @@ exif_data_load_data_entry (ExifData *data, ExifEntry *entry,
 	/* FIXME: should use exif_tag_get_name_in_ifd here but entry->parent 
 	 * has not been set yet
 	 */
-	exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
-		  "Loading entry 0x%x ('%s')...", entry->tag,
-		  exif_tag_get_name (entry->tag));
+	if (exif_log_enabled (data->priv->log))
+		exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
+			  "Loading entry 0x%x ('%s')...", entry->tag,
+			  exif_tag_get_name (entry->tag));
 
 	/* {0,1,2,4,8} x { 0x00000000 .. 0xffffffff } 
 	 *   -> { 0x000000000 .. 0x7fffffff8 } */
@@ -201,8 +233,9 @@ exif_data_load_data_entry (ExifData *data, ExifEntry *entry,
 		return 0;
 	}
 
-	entry->data = exif_data_alloc (data, s);
-	if (entry->data) {
+	if (data->priv->options & EXIF_DATA_OPTION_BORROW_DATA) {
+		exif_entry_borrow_data (entry, d + doff, s);
+	} else if ((entry->data = exif_data_alloc (data, s))) {
 		entry->size = s;
 		memcpy (entry->data, d + doff, s);
 	} else {
@@ -229,81 +262,93 @@ exif_data_load_data_entry (ExifData *data, ExifEntry *entry,
 	return 1;
 }
 
-static void
-exif_data_save_data_entry (ExifData *data, ExifEntry *e,
-			   unsigned char **d, unsigned int *ds,
-			   unsigned int offset)
+/*! Add n bytes to *ds, the size of the data being saved.
+ * \return 0 if it would overflow, 1 otherwise
+ */
+static int
+exif_data_save_grow (unsigned int *ds, unsigned int n)
 {
-	unsigned int doff, s;
-	unsigned char *t;
-	unsigned int ts;
-
-	if (!data || !data->priv) 
-		return;
+	if (*ds + n < *ds)
+		return 0;
+	*ds += n;
+	return 1;
+}
 
-	/*
-	 * Each entry is 12 bytes long. The memory for the entry has
-	 * already been allocated.
-	 */
-	exif_set_short (*d + 6 + offset + 0,
-			data->priv->order, (ExifShort) e->tag);
-	exif_set_short (*d + 6 + offset + 2,
-			data->priv->order, (ExifShort) e->format);
+/*! First pass over an entry: count the data that does not fit into its 12
+ * bytes. The MakerNote is regenerated here, because it may refer to the
+ * offset it is saved at.
+ */
+static int
+exif_data_save_size_entry (ExifData *data, ExifEntry *e, unsigned int *ds)
+{
+	unsigned int s;
 
 	if (!(data->priv->options & EXIF_DATA_OPTION_DONT_CHANGE_MAKER_NOTE)) {
 		/* If this is the maker note tag, update it. */
 		if ((e->tag == EXIF_TAG_MAKER_NOTE) && data->priv->md) {
-			exif_mem_free (data->priv->mem, e->data);
-			e->data = NULL;
-			e->size = 0;
+			exif_entry_free_data (e);
 			exif_mnote_data_set_offset (data->priv->md, *ds - 6);
 			exif_mnote_data_save (data->priv->md, &e->data, &e->size);
 			e->components = e->size;
 		}
 	}
 
-	exif_set_long  (*d + 6 + offset + 4,
-			data->priv->order, e->components);
-
 	/*
 	 * Size? If bigger than 4 bytes, the actual data is not in
-	 * the entry but somewhere else.
+	 * the entry but somewhere else. According to the TIFF
+	 * specification, the offset must be an even number.
 	 */
 	s = exif_format_get_size (e->format) * e->components;
+	if (e->components && (s / e->components != exif_format_get_size (e->format)))
+		return 0;
+	if (s > 4)
+		return exif_data_save_grow (ds, s) &&
+			exif_data_save_grow (ds, s & 1);
+	return 1;
+}
+
+static void
+exif_data_save_data_entry (ExifData *data, ExifEntry *e,
+			   unsigned char *d, unsigned int *ds,
+			   unsigned int offset)
+{
+	unsigned int doff, s;
+
+	if (!data || !data->priv) 
+		return;
+
+	/*
+	 * Each entry is 12 bytes long. The room for the entry and its data
+	 * has been counted by exif_data_save_size_entry.
+	 */
+	exif_set_short (d + 6 + offset + 0,
+			data->priv->order, (ExifShort) e->tag);
+	exif_set_short (d + 6 + offset + 2,
+			data->priv->order, (ExifShort) e->format);
+	exif_set_long  (d + 6 + offset + 4,
+			data->priv->order, e->components);
+
+	s = exif_format_get_size (e->format) * e->components;
 	if (s > 4) {
 		doff = *ds - 6;
-		ts = *ds + s;
+		*ds += s;
+		exif_set_long (d + 6 + offset + 8, data->priv->order, doff);
 
-		/*
-		 * According to the TIFF specification,
-		 * the offset must be an even number. If we need to introduce
-		 * a padding byte, we set it to 0.
-		 */
-		if (s & 1)
-			ts++;
-		t = exif_mem_realloc (data->priv->mem, *d, ts);
-		if (!t) {
-			EXIF_LOG_NO_MEMORY (data->priv->log, "ExifData", ts);
-		  	return;
-		}
-		*d = t;
-		*ds = ts;
-		exif_set_long (*d + 6 + offset + 8, data->priv->order, doff);
+		/* The padding byte for an even offset is 0 */
 		if (s & 1) 
-			*(*d + *ds - 1) = '\0';
-
+			d[(*ds)++] = '\0';
 	} else
 		doff = offset + 8;
 
 	/* Write the data. Fill unneeded bytes with 0. Do not crash with
 	 * e->data is NULL */
 	if (e->data) {
-		memcpy (*d + 6 + doff, e->data, s);
+		memcpy (d + 6 + doff, e->data, s);
 	} else {
-		memset (*d + 6 + doff, 0, s);
+		memset (d + 6 + doff, 0, s);
 	}
 	if (s < 4) 
-		memset (*d + 6 + doff + s, 0, (4 - s));
+		memset (d + 6 + doff + s, 0, (4 - s));
 }
 
 static void
@@ -318,8 +363,13 @@ exif_data_load_data_thumbnail (ExifData *data, const unsigned char *d,
 		return;
 	}
 
-	if (data->data) 
+	if (data->data && data->data != data->priv->borrowed)
 		exif_mem_free (data->priv->mem, data->data);
+	if (data->priv->options & EXIF_DATA_OPTION_BORROW_DATA) {
+		data->data = data->priv->borrowed = (unsigned char *) d + o;
+		data->size = s;
+		return;
+	}
 	if (!(data->data = exif_data_alloc (data, s))) {
 		EXIF_LOG_NO_MEMORY (data->priv->log, "ExifData", s);
 		data->size = 0;
@@ -329,6 +379,52 @@ exif_data_load_data_thumbnail (ExifData *data, const unsigned char *d,
 	memcpy (data->data, d + o, s);
 }
 
+/*! Whether a filter has been set with exif_data_set_load_filter. */
+static int
+exif_data_load_filtered (ExifData *data)
+{
+	return (data->priv->load_ifds != EXIF_DATA_LOAD_ALL) ||
+		data->priv->num_load_tags;
+}
+
+/*! Whether entries with the given tag are loaded from the given IFD. */
+static int
+exif_data_load_wanted (ExifData *data, ExifIfd ifd, ExifTag tag)
+{
+	unsigned int i;
+
+	if (data->priv->load_ifds & EXIF_DATA_LOAD_IFD (ifd))
+		return 1;
+	for (i = 0; i < data->priv->num_load_tags; i++)
+		if (data->priv->load_tags[i] == tag)
+			return 1;
+	return 0;
+}
+
+static void
+exif_data_load_data_content (ExifData *data, ExifIfd ifd,
+			     const unsigned char *d,
+			     unsigned int ds, unsigned int offset, unsigned int recursion_depth);
+
+/*! Load an IFD that a pointer tag refers to, unless nothing in it or in
+ * the IFDs below it is wanted.
+ */
+static void
+exif_data_load_data_sub_ifd (ExifData *data, ExifIfd ifd,
+			     const unsigned char *d,
+			     unsigned int ds, unsigned int offset, unsigned int recursion_depth)
+{
+	unsigned int ifds = EXIF_DATA_LOAD_IFD (ifd);
+
+	if (ifd == EXIF_IFD_EXIF)
+		ifds |= EXIF_DATA_LOAD_IFD (EXIF_IFD_INTEROPERABILITY);
+	if (!((data->priv->load_ifds | data->priv->scan_ifds) & ifds)) {
+		data->priv->offset_ifd[ifd] = offset;
+		return;
+	}
+	exif_data_load_data_content (data, ifd, d, ds, offset, recursion_depth);
+}
+
 #undef CHECK_REC
 #define CHECK_REC(i) 					\
 if ((i) == ifd) {				\
@@ -387,6 +483,8 @@ exif_data_load_data_content (ExifData *data, ExifIfd ifd,
 			  "Tag data past end of buffer (%u > %u)", offset+2, ds);
 		return;
 	}
+	data->priv->offset_ifd[ifd] =
+		(data->priv->load_ifds & EXIF_DATA_LOAD_IFD (ifd)) ? 0 : offset;
 	n = exif_get_short (d + offset, data->priv->order);
 	exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
 	          "Loading %hu entries...", n);
@@ -399,6 +497,10 @@ exif_data_load_data_content (ExifData *data, ExifIfd ifd,
 				  "Short data; only loading %hu entries...", n);
 	}
 
+	/* Room for all of them at once, n counts the sub-IFD pointers too */
+	if (data->priv->load_ifds & EXIF_DATA_LOAD_IFD (ifd))
+		exif_content_reserve (data->ifd[ifd], data->ifd[ifd]->count + n);
+
 	for (i = 0; i < n; i++) {
 
 		tag = exif_get_short (d + offset + 12 * i, data->priv->order);
@@ -413,23 +515,26 @@ exif_data_load_data_content (ExifData *data, ExifIfd ifd,
 			/* FIXME: IFD_POINTER tags aren't marked as being in a
 			 * specific IFD, so exif_tag_get_name_in_ifd won't work
 			 */
-			exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
-				  "Sub-IFD entry 0x%x ('%s') at %u.", tag,
-				  exif_tag_get_name(tag), o);
+			if (exif_log_enabled (data->priv->log))
+				exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
+					  "Sub-IFD entry 0x%x ('%s') at %u.", tag,
+					  exif_tag_get_name(tag), o);
 			switch (tag) {
 			case EXIF_TAG_EXIF_IFD_POINTER:
 				CHECK_REC (EXIF_IFD_EXIF);
-				exif_data_load_data_content (data, EXIF_IFD_EXIF, d, ds, o, recursion_depth + 1);
+				exif_data_load_data_sub_ifd (data, EXIF_IFD_EXIF, d, ds, o, recursion_depth + 1);
 				break;
 			case EXIF_TAG_GPS_INFO_IFD_POINTER:
 				CHECK_REC (EXIF_IFD_GPS);
-				exif_data_load_data_content (data, EXIF_IFD_GPS, d, ds, o, recursion_depth + 1);
+				exif_data_load_data_sub_ifd (data, EXIF_IFD_GPS, d, ds, o, recursion_depth + 1);
 				break;
 			case EXIF_TAG_INTEROPERABILITY_IFD_POINTER:
 				CHECK_REC (EXIF_IFD_INTEROPERABILITY);
-				exif_data_load_data_content (data, EXIF_IFD_INTEROPERABILITY, d, ds, o, recursion_depth + 1);
+				exif_data_load_data_sub_ifd (data, EXIF_IFD_INTEROPERABILITY, d, ds, o, recursion_depth + 1);
 				break;
 			case EXIF_TAG_JPEG_INTERCHANGE_FORMAT:
+				if (!(data->priv->load_ifds & EXIF_DATA_LOAD_IFD (EXIF_IFD_1)))
+					break;
 				thumbnail_offset = o;
 				if (thumbnail_offset && thumbnail_length)
 					exif_data_load_data_thumbnail (data, d,
@@ -437,6 +542,8 @@ exif_data_load_data_content (ExifData *data, ExifIfd ifd,
 								       thumbnail_length);
 				break;
 			case EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LENGTH:
+				if (!(data->priv->load_ifds & EXIF_DATA_LOAD_IFD (EXIF_IFD_1)))
+					break;
 				thumbnail_length = o;
 				if (thumbnail_offset && thumbnail_length)
 					exif_data_load_data_thumbnail (data, d,
@@ -448,6 +555,8 @@ exif_data_load_data_content (ExifData *data, ExifIfd ifd,
 			}
 			break;
 		default:
+			if (!exif_data_load_wanted (data, ifd, tag))
+				break;
 
 			/*
 			 * If we don't know the tag, don't fail. It could be that new 
@@ -483,6 +592,112 @@ exif_data_load_data_content (ExifData *data, ExifIfd ifd,
 	}
 }
 
+/*! Number of entries that are not in ifd but are saved with it: the
+ * pointers to other IFDs and those to the thumbnail.
+ */
+static unsigned int
+exif_data_save_extra (ExifData *data, ExifIfd ifd)
+{
+	unsigned int n = 0;
+
+	switch (ifd) {
+	case EXIF_IFD_0:
+
+		/*
+		 * The pointer to IFD_EXIF is in IFD_0. The pointer to
+		 * IFD_INTEROPERABILITY is in IFD_EXIF.
+		 */
+		if (data->ifd[EXIF_IFD_EXIF]->count ||
+		    data->ifd[EXIF_IFD_INTEROPERABILITY]->count)
+			n++;
+
+		/* The pointer to IFD_GPS is in IFD_0. */
+		if (data->ifd[EXIF_IFD_GPS]->count)
+			n++;
+
+		break;
+	case EXIF_IFD_1:
+		if (data->size)
+			n = 2;
+		break;
+	case EXIF_IFD_EXIF:
+		if (data->ifd[EXIF_IFD_INTEROPERABILITY]->count)
+			n++;
+	default:
+		break;
+	}
+	return n;
+}
+
+/*! First pass over an IFD and those saved after it: add their size to
+ * *ds, in the order exif_data_save_data_content lays them out.
+ * \return 0 if the size does not fit into an unsigned int, 1 otherwise
+ */
+static int
+exif_data_save_size_content (ExifData *data, ExifIfd i, unsigned int *ds)
+{
+	ExifContent *ifd = data->ifd[i];
+	unsigned int j;
+
+	if (!exif_data_save_grow (ds, 2 + (ifd->count +
+				  exif_data_save_extra (data, i)) * 12 + 4))
+		return 0;
+	for (j = 0; j < ifd->count; j++)
+		if (ifd->entries[j] &&
+		    !exif_data_save_size_entry (data, ifd->entries[j], ds))
+			return 0;
+
+	switch (i) {
+	case EXIF_IFD_0:
+		if ((data->ifd[EXIF_IFD_EXIF]->count ||
+		     data->ifd[EXIF_IFD_INTEROPERABILITY]->count) &&
+		    !exif_data_save_size_content (data, EXIF_IFD_EXIF, ds))
+			return 0;
+		if (data->ifd[EXIF_IFD_GPS]->count &&
+		    !exif_data_save_size_content (data, EXIF_IFD_GPS, ds))
+			return 0;
+		if (data->ifd[EXIF_IFD_1]->count || data->size)
+			return exif_data_save_size_content (data, EXIF_IFD_1, ds);
+		break;
+	case EXIF_IFD_EXIF:
+		if (data->ifd[EXIF_IFD_INTEROPERABILITY]->count)
+			return exif_data_save_size_content (data,
+					EXIF_IFD_INTEROPERABILITY, ds);
+		break;
+	case EXIF_IFD_1:
+		return exif_data_save_grow (ds, data->size);
+	default:
+		break;
+	}
+	return 1;
+}
+
+/*! Write a pointer to another IFD or to the thumbnail at offset. */
+static void
+exif_data_save_data_pointer (ExifData *data, unsigned char *d,
+			     unsigned int offset, ExifTag tag, ExifLong value)
+{
+	exif_set_short (d + 6 + offset + 0, data->priv->order, tag);
+	exif_set_short (d + 6 + offset + 2, data->priv->order,
+			EXIF_FORMAT_LONG);
+	exif_set_long  (d + 6 + offset + 4, data->priv->order, 1);
+	exif_set_long  (d + 6 + offset + 8, data->priv->order, value);
+}
+
+/*! Whether the 12 byte entries at d are in tag order already. */
+static int
+exif_data_save_data_sorted (ExifData *data, const unsigned char *d,
+			    unsigned int n)
+{
+	unsigned int j;
+
+	for (j = 1; j < n; j++)
+		if (exif_get_short (d + 12 * (j - 1), data->priv->order) >
+		    exif_get_short (d + 12 * j, data->priv->order))
+			return 0;
+	return 1;
+}
+
 static int
 cmp_func (const unsigned char *p1, const unsigned char *p2, ExifByteOrder o)
 {
@@ -506,72 +721,30 @@ cmp_func_motorola (const void *elem1, const void *elem2)
 			 (const unsigned char *) elem2, EXIF_BYTE_ORDER_MOTOROLA);
 }
 
+/*! Second pass: write an IFD at offset, with its data from *ds on, and
+ * the IFDs saved after it. The room has been counted by
+ * exif_data_save_size_content.
+ */
 static void
-exif_data_save_data_content (ExifData *data, ExifContent *ifd,
-			     unsigned char **d, unsigned int *ds,
+exif_data_save_data_content (ExifData *data, ExifIfd i,
+			     unsigned char *d, unsigned int *ds,
 			     unsigned int offset)
 {
-	unsigned int j, n_ptr = 0, n_thumb = 0;
-	ExifIfd i;
-	unsigned char *t;
-	unsigned int ts;
-
-	if (!data || !data->priv || !ifd || !d || !ds) 
-		return;
-
-	for (i = 0; i < EXIF_IFD_COUNT; i++)
-		if (ifd == data->ifd[i])
-			break;
-	if (i == EXIF_IFD_COUNT)
-		return;	/* error */
+	ExifContent *ifd = data->ifd[i];
+	unsigned int j, n;
+	unsigned char *dir;
 
 	/*
-	 * Check if we need some extra entries for pointers or the thumbnail.
-	 */
-	switch (i) {
-	case EXIF_IFD_0:
-
-		/*
-		 * The pointer to IFD_EXIF is in IFD_0. The pointer to
-		 * IFD_INTEROPERABILITY is in IFD_EXIF.
-		 */
-		if (data->ifd[EXIF_IFD_EXIF]->count ||
-		    data->ifd[EXIF_IFD_INTEROPERABILITY]->count)
-			n_ptr++;
-
-		/* The pointer to IFD_GPS is in IFD_0. */
-		if (data->ifd[EXIF_IFD_GPS]->count)
-			n_ptr++;
-
-		break;
-	case EXIF_IFD_1:
-		if (data->size)
-			n_thumb = 2;
-		break;
-	case EXIF_IFD_EXIF:
-		if (data->ifd[EXIF_IFD_INTEROPERABILITY]->count)
-			n_ptr++;
-	default:
-		break;
-	}
-
-	/*
-	 * Allocate enough memory for all entries
+	 * Claim the room for all entries
 	 * and the number of entries.
 	 */
-	ts = *ds + (2 + (ifd->count + n_ptr + n_thumb) * 12 + 4);
-	t = exif_mem_realloc (data->priv->mem, *d, ts);
-	if (!t) {
-		EXIF_LOG_NO_MEMORY (data->priv->log, "ExifData", ts);
-	  	return;
-	}
-	*d = t;
-	*ds = ts;
+	n = ifd->count + exif_data_save_extra (data, i);
+	*ds += 2 + n * 12 + 4;
 
 	/* Save the number of entries */
-	exif_set_short (*d + 6 + offset, data->priv->order,
-			(ExifShort) (ifd->count + n_ptr + n_thumb));
+	exif_set_short (d + 6 + offset, data->priv->order, (ExifShort) n);
 	offset += 2;
+	dir = d + 6 + offset;
 
 	/*
 	 * Save each entry. Make sure that no memcpys from NULL pointers are
@@ -584,7 +757,8 @@ exif_data_save_data_content (ExifData *data, ExifContent *ifd,
 		if (ifd->entries[j]) {
 			exif_data_save_data_entry (data, ifd->entries[j], d, ds,
 				offset + 12 * j);
-		}
+		} else
+			memset (d + 6 + offset + 12 * j, 0, 12);
 	}
 
 	offset += 12 * ifd->count;
@@ -601,31 +775,19 @@ exif_data_save_data_content (ExifData *data, ExifContent *ifd,
 		 */
 		if (data->ifd[EXIF_IFD_EXIF]->count ||
 		    data->ifd[EXIF_IFD_INTEROPERABILITY]->count) {
-			exif_set_short (*d + 6 + offset + 0, data->priv->order,
-					EXIF_TAG_EXIF_IFD_POINTER);
-			exif_set_short (*d + 6 + offset + 2, data->priv->order,
-					EXIF_FORMAT_LONG);
-			exif_set_long  (*d + 6 + offset + 4, data->priv->order,
-					1);
-			exif_set_long  (*d + 6 + offset + 8, data->priv->order,
-					*ds - 6);
-			exif_data_save_data_content (data,
-						     data->ifd[EXIF_IFD_EXIF], d, ds, *ds - 6);
+			exif_data_save_data_pointer (data, d, offset,
+					EXIF_TAG_EXIF_IFD_POINTER, *ds - 6);
+			exif_data_save_data_content (data, EXIF_IFD_EXIF,
+						     d, ds, *ds - 6);
 			offset += 12;
 		}
 
 		/* The pointer to IFD_GPS is in IFD_0, too. */
 		if (data->ifd[EXIF_IFD_GPS]->count) {
-			exif_set_short (*d + 6 + offset + 0, data->priv->order,
-					EXIF_TAG_GPS_INFO_IFD_POINTER);
-			exif_set_short (*d + 6 + offset + 2, data->priv->order,
-					EXIF_FORMAT_LONG);
-			exif_set_long  (*d + 6 + offset + 4, data->priv->order,
-					1);
-			exif_set_long  (*d + 6 + offset + 8, data->priv->order,
-					*ds - 6);
-			exif_data_save_data_content (data,
-						     data->ifd[EXIF_IFD_GPS], d, ds, *ds - 6);
+			exif_data_save_data_pointer (data, d, offset,
+					EXIF_TAG_GPS_INFO_IFD_POINTER, *ds - 6);
+			exif_data_save_data_content (data, EXIF_IFD_GPS,
+						     d, ds, *ds - 6);
 			offset += 12;
 		}
 
@@ -637,16 +799,10 @@ exif_data_save_data_content (ExifData *data, ExifContent *ifd,
 		 * See note above.
 		 */
 		if (data->ifd[EXIF_IFD_INTEROPERABILITY]->count) {
-			exif_set_short (*d + 6 + offset + 0, data->priv->order,
-					EXIF_TAG_INTEROPERABILITY_IFD_POINTER);
-			exif_set_short (*d + 6 + offset + 2, data->priv->order,
-					EXIF_FORMAT_LONG);
-			exif_set_long  (*d + 6 + offset + 4, data->priv->order,
-					1);
-			exif_set_long  (*d + 6 + offset + 8, data->priv->order,
-					*ds - 6);
+			exif_data_save_data_pointer (data, d, offset,
+					EXIF_TAG_INTEROPERABILITY_IFD_POINTER, *ds - 6);
 			exif_data_save_data_content (data,
-						     data->ifd[EXIF_IFD_INTEROPERABILITY], d, ds,
+						     EXIF_IFD_INTEROPERABILITY, d, ds,
 						     *ds - 6);
 			offset += 12;
 		}
@@ -659,36 +815,13 @@ exif_data_save_data_content (ExifData *data, ExifContent *ifd,
 		 * IFD_1.
 		 */
 		if (data->size) {
-
-			/* EXIF_TAG_JPEG_INTERCHANGE_FORMAT */
-			exif_set_short (*d + 6 + offset + 0, data->priv->order,
-					EXIF_TAG_JPEG_INTERCHANGE_FORMAT);
-			exif_set_short (*d + 6 + offset + 2, data->priv->order,
-					EXIF_FORMAT_LONG);
-			exif_set_long  (*d + 6 + offset + 4, data->priv->order,
-					1);
-			exif_set_long  (*d + 6 + offset + 8, data->priv->order,
-					*ds - 6);
-			ts = *ds + data->size;
-			t = exif_mem_realloc (data->priv->mem, *d, ts);
-			if (!t) {
-				EXIF_LOG_NO_MEMORY (data->priv->log, "ExifData",
-						    ts);
-			  	return;
-			}
-			*d = t;
-			*ds = ts;
-			memcpy (*d + *ds - data->size, data->data, data->size);
+			exif_data_save_data_pointer (data, d, offset,
+					EXIF_TAG_JPEG_INTERCHANGE_FORMAT, *ds - 6);
+			memcpy (d + *ds, data->data, data->size);
+			*ds += data->size;
 			offset += 12;
-
-			/* EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LENGTH */
-			exif_set_short (*d + 6 + offset + 0, data->priv->order,
-					EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LENGTH);
-			exif_set_short (*d + 6 + offset + 2, data->priv->order,
-					EXIF_FORMAT_LONG);
-			exif_set_long  (*d + 6 + offset + 4, data->priv->order,
-					1);
-			exif_set_long  (*d + 6 + offset + 8, data->priv->order,
+			exif_data_save_data_pointer (data, d, offset,
+					EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LENGTH,
 					data->size);
 			offset += 12;
 		}
@@ -698,10 +831,13 @@ exif_data_save_data_content (ExifData *data, ExifContent *ifd,
 		break;
 	}
 
-	/* Sort the directory according to TIFF specification */
-	qsort (*d + 6 + offset - (ifd->count + n_ptr + n_thumb) * 12,
-	       (ifd->count + n_ptr + n_thumb), 12,
-	       (data->priv->order == EXIF_BYTE_ORDER_INTEL) ? cmp_func_intel : cmp_func_motorola);
+	/*
+	 * Sort the directory according to TIFF specification. Usually only
+	 * the pointers appended last are out of order, if any.
+	 */
+	if (!exif_data_save_data_sorted (data, dir, n))
+		qsort (dir, n, 12, (data->priv->order == EXIF_BYTE_ORDER_INTEL) ?
+		       cmp_func_intel : cmp_func_motorola);
 
 	/* Correctly terminate the directory */
 	if (i == EXIF_IFD_0 && (data->ifd[EXIF_IFD_1]->count ||
@@ -711,11 +847,11 @@ exif_data_save_data_content (ExifData *data, ExifContent *ifd,
 		 * We are saving IFD 0. Tell where IFD 1 starts and save
 		 * IFD 1.
 		 */
-		exif_set_long (*d + 6 + offset, data->priv->order, *ds - 6);
-		exif_data_save_data_content (data, data->ifd[EXIF_IFD_1], d, ds,
+		exif_set_long (d + 6 + offset, data->priv->order, *ds - 6);
+		exif_data_save_data_content (data, EXIF_IFD_1, d, ds,
 					     *ds - 6);
 	} else
-		exif_set_long (*d + 6 + offset, data->priv->order, 0);
+		exif_set_long (d + 6 + offset, data->priv->order, 0);
 }
 
 typedef enum {
@@ -898,6 +1034,10 @@ exif_data_load_data (ExifData *data, const unsigned char *d_orig,
 	exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData", 
 		  "IFD 0 at %i.", (int) offset);
 
+	/* Remembered for exif_data_load_ifd */
+	data->priv->offset_exif = d - d_orig;
+	memset (data->priv->offset_ifd, 0, sizeof (data->priv->offset_ifd));
+
 	/* Parse the actual exif data (usually offset 14 from start) */
 	exif_data_load_data_content (data, EXIF_IFD_0, d + 6, ds - 6, offset, 0);
 
@@ -919,10 +1059,33 @@ exif_data_load_data (ExifData *data, const unsigned char *d_orig,
 			exif_log (data->priv->log, EXIF_LOG_CODE_CORRUPT_DATA,
 				  "ExifData", "Bogus offset of IFD1.");
 		} else {
-		   exif_data_load_data_content (data, EXIF_IFD_1, d + 6, ds - 6, offset, 0);
+		   exif_data_load_data_sub_ifd (data, EXIF_IFD_1, d + 6, ds - 6, offset, 0);
 		}
 	}
 
+	exif_data_load_data_mnote (data, d, ds);
+
+	if (data->priv->options & EXIF_DATA_OPTION_FOLLOW_SPECIFICATION) {
+		if (exif_data_load_filtered (data))
+			exif_data_foreach_content (data, fix_loaded_func, NULL);
+		else
+			exif_data_fix (data);
+	}
+}
+
+/*! Interpret the MakerNote, if it has been loaded and not done yet.
+ *
+ * \param[in,out] data EXIF data
+ * \param[in] d pointer to the EXIF header in the loaded buffer
+ * \param[in] ds number of bytes at d
+ */
+static void
+exif_data_load_data_mnote (ExifData *data, const unsigned char *d,
+			   unsigned int ds)
+{
+	if (data->priv->md)
+		return;
+
 	/*
 	 * If we got an EXIF_TAG_MAKER_NOTE, try to interpret it. Some
 	 * cameras use pointers in the maker note tag that point to the
@@ -959,38 +1122,121 @@ exif_data_load_data (ExifData *data, const unsigned char *d_orig,
 					    data->priv->offset_mnote);
 		exif_mnote_data_load (data->priv->md, d, ds);
 	}
+}
+
+void
+exif_data_load_ifd (ExifData *data, ExifIfd ifd, const unsigned char *d,
+		    unsigned int size)
+{
+	ExifDataPrivate *priv;
+	unsigned int load_ifds, scan_ifds, num_load_tags;
+	ExifIfd from = ifd;
+
+	if (!data || !data->priv || !d)
+		return;
+	if ((((int)ifd) < 0) || ( ((int)ifd) >= EXIF_IFD_COUNT))
+		return;
+	priv = data->priv;
 
-	if (data->priv->options & EXIF_DATA_OPTION_FOLLOW_SPECIFICATION)
-		exif_data_fix (data);
+	/* The Interoperability IFD can only be found through the EXIF IFD */
+	if (!priv->offset_ifd[ifd] && (ifd == EXIF_IFD_INTEROPERABILITY))
+		from = EXIF_IFD_EXIF;
+	if (!priv->offset_ifd[from] || (priv->offset_exif + 6 > size))
+		return;
+
+	load_ifds = priv->load_ifds;
+	scan_ifds = priv->scan_ifds;
+	num_load_tags = priv->num_load_tags;
+	priv->load_ifds = EXIF_DATA_LOAD_IFD (ifd);
+	priv->scan_ifds = EXIF_DATA_LOAD_IFD (from);
+	priv->num_load_tags = 0;
+	exif_data_load_data_content (data, from, d + priv->offset_exif + 6,
+				     size - priv->offset_exif - 6,
+				     priv->offset_ifd[from], 0);
+	priv->load_ifds = load_ifds;
+	priv->scan_ifds = scan_ifds;
+	priv->num_load_tags = num_load_tags;
+	priv->offset_ifd[ifd] = 0;
+
+	exif_data_load_data_mnote (data, d + priv->offset_exif,
+				   size - priv->offset_exif);
+	if (priv->options & EXIF_DATA_OPTION_FOLLOW_SPECIFICATION)
+		exif_content_foreach_entry (data->ifd[ifd], fix_entry_func, NULL);
 }
 
 void
-exif_data_save_data (ExifData *data, unsigned char **d, unsigned int *ds)
+exif_data_set_load_filter (ExifData *data, unsigned int ifds,
+			   const ExifTag *tags, unsigned int num_tags)
 {
-	if (ds)
-		*ds = 0;	/* This means something went wrong */
+	ExifDataPrivate *priv;
+	unsigned int i, j;
 
-	if (!data || !d || !ds)
+	if (!data || !data->priv)
+		return;
+	priv = data->priv;
+
+	exif_mem_free (priv->mem, priv->load_tags);
+	priv->load_tags = NULL;
+	priv->num_load_tags = 0;
+	priv->load_ifds = ifds & EXIF_DATA_LOAD_ALL;
+	priv->scan_ifds = 0;
+	if (!tags || !num_tags)
 		return;
 
-	/* Header */
-	*ds = 14;
-	*d = exif_data_alloc (data, *ds);
-	if (!*d)  {
-		*ds = 0;
+	priv->load_tags = exif_data_alloc (data, sizeof (ExifTag) * num_tags);
+	if (!priv->load_tags) {
+		priv->load_ifds = EXIF_DATA_LOAD_ALL;
 		return;
 	}
-	memcpy (*d, ExifHeader, 6);
+	memcpy (priv->load_tags, tags, sizeof (ExifTag) * num_tags);
+	priv->num_load_tags = num_tags;
+
+	/* Only look into the IFDs the tags are recorded in */
+	for (i = 0; i < num_tags; i++) {
+		unsigned int ifds_of_tag = 0;
+
+		for (j = 0; j < EXIF_IFD_COUNT; j++)
+			if (exif_tag_get_name_in_ifd (tags[i], j))
+				ifds_of_tag |= EXIF_DATA_LOAD_IFD (j);
+		priv->scan_ifds |= ifds_of_tag ? ifds_of_tag : EXIF_DATA_LOAD_ALL;
+	}
+}
+
+/*! First pass of saving: the number of bytes the EXIF data takes, 0 if
+ * it cannot be saved.
+ */
+static unsigned int
+exif_data_save_size (ExifData *data)
+{
+	unsigned int ds = 14;	/* Header */
+
+	if (!exif_data_save_size_content (data, EXIF_IFD_0, &ds)) {
+		exif_log (data->priv->log, EXIF_LOG_CODE_CORRUPT_DATA, "ExifData",
+			  "EXIF data too large to be saved.");
+		return 0;
+	}
+	return ds;
+}
+
+/*! Second pass of saving: write the EXIF data into d, which has room for
+ * the number of bytes given by exif_data_save_size.
+ */
+static void
+exif_data_save_write (ExifData *data, unsigned char *d)
+{
+	unsigned int ds = 14;
+
+	memcpy (d, ExifHeader, 6);
 
 	/* Order (offset 6) */
 	if (data->priv->order == EXIF_BYTE_ORDER_INTEL) {
-		memcpy (*d + 6, "II", 2);
+		memcpy (d + 6, "II", 2);
 	} else {
-		memcpy (*d + 6, "MM", 2);
+		memcpy (d + 6, "MM", 2);
 	}
 
 	/* Fixed value (2 bytes, offset 8) */
-	exif_set_short (*d + 8, data->priv->order, 0x002a);
+	exif_set_short (d + 8, data->priv->order, 0x002a);
 
 	/*
 	 * IFD 0 offset (4 bytes, offset 10).
@@ -998,15 +1244,49 @@ exif_data_save_data (ExifData *data, unsigned char **d, unsigned int *ds)
 	 * EXIF header (2 bytes for order, another 2 for the test, and
 	 * 4 bytes for the IFD 0 offset make 8 bytes together).
 	 */
-	exif_set_long (*d + 10, data->priv->order, 8);
+	exif_set_long (d + 10, data->priv->order, 8);
 
 	/* Now save IFD 0. IFD 1 will be saved automatically. */
 	exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
 		  "Saving IFDs...");
-	exif_data_save_data_content (data, data->ifd[EXIF_IFD_0], d, ds,
-				     *ds - 6);
+	exif_data_save_data_content (data, EXIF_IFD_0, d, &ds, ds - 6);
 	exif_log (data->priv->log, EXIF_LOG_CODE_DEBUG, "ExifData",
-		  "Saved %i byte(s) EXIF data.", *ds);
+		  "Saved %i byte(s) EXIF data.", ds);
+}
+
+void
+exif_data_save_data (ExifData *data, unsigned char **d, unsigned int *ds)
+{
+	if (ds)
+		*ds = 0;	/* This means something went wrong */
+
+	if (!data || !data->priv || !d || !ds)
+		return;
+
+	/* Size it all first, so that it takes a single allocation */
+	*ds = exif_data_save_size (data);
+	if (!*ds)
+		return;
+	*d = exif_data_alloc (data, *ds);
+	if (!*d)  {
+		*ds = 0;
+		return;
+	}
+	exif_data_save_write (data, *d);
+}
+
+unsigned int
+exif_data_save_data_buf (ExifData *data, unsigned char *d, unsigned int size)
+{
+	unsigned int ds;
+
+	if (!data || !data->priv)
+		return 0;
+
+	ds = exif_data_save_size (data);
+	if (d && ds && (ds <= size))
+		exif_data_save_write (data, d);
+	return ds;
 }
 
 ExifData *
@@ -1060,7 +1340,8 @@ exif_data_free (ExifData *data)
 	}
 
 	if (data->data) {
-		exif_mem_free (mem, data->data);
+		if (!data->priv || data->data != data->priv->borrowed)
+			exif_mem_free (mem, data->data);
 		data->data = NULL;
 	}
 
@@ -1073,6 +1354,7 @@ exif_data_free (ExifData *data)
 			exif_mnote_data_unref (data->priv->md);
 			data->priv->md = NULL;
 		}
+		exif_mem_free (mem, data->priv->load_tags);
 		exif_mem_free (mem, data->priv);
 		exif_mem_free (mem, data);
 	}
@@ -1139,7 +1421,7 @@ entry_set_byte_order (ExifEntry *e, void *data)
 {
 	ByteOrderChangeData *d = data;
 
-	if (!e)
+	if (!e || !exif_entry_own_data (e))
 		return;
 
 	exif_array_set_byte_order (e->format, e->data, e->components, d->old, d->new);
@@ -1205,6 +1487,9 @@ static const struct {
 	{EXIF_DATA_OPTION_DONT_CHANGE_MAKER_NOTE, N_("Do not change maker note"),
 	 N_("When loading and resaving Exif data, save the maker note unmodified."
 	    " Be aware that the maker note can get corrupted.")},
+	{EXIF_DATA_OPTION_BORROW_DATA, N_("Borrow data"),
+	 N_("Refer to tag data and the thumbnail in the loaded buffer instead "
+	    "of copying them. The buffer must outlive the EXIF data.")},
 	{0, NULL, NULL}
 };
 
@@ -1276,6 +1561,19 @@ fix_func (ExifContent *c, void *UNUSED(data))
 	}
 }
 
+static void
+fix_entry_func (ExifEntry *e, void *UNUSED(data))
+{
+	exif_entry_fix (e);
+}
+
+/*! Fix the entries of a filtered load without adding or removing any */
+static void
+fix_loaded_func (ExifContent *c, void *UNUSED(data))
+{
+	exif_content_foreach_entry (c, fix_entry_func, NULL);
+}
+
 void
 exif_data_fix (ExifData *d)
 {
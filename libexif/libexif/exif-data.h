@@ -105,9 +105,42 @@ ExifData *exif_data_new_from_data (const unsigned char *data,
 void      exif_data_load_data (ExifData *data, const unsigned char *d, 
 			       unsigned int size);
 
+/*! Bit of an #ExifIfd in the mask given to #exif_data_set_load_filter */
+#define EXIF_DATA_LOAD_IFD(ifd) (1 << (ifd))
+
+/*! Restrict what #exif_data_load_data loads to the IFDs in \c ifds and,
+ * from any IFD, the given tags. IFDs that hold neither are not read at
+ * all, and nothing is allocated for the entries that are left out. The
+ * thumbnail is loaded only with IFD 1, and the MakerNote is interpreted
+ * only if #EXIF_TAG_MAKER_NOTE is loaded (for Canon and Pentax it needs
+ * #EXIF_TAG_MAKE too). #EXIF_DATA_OPTION_FOLLOW_SPECIFICATION only fixes
+ * the entries that were loaded, it does not add or remove any. An \c ifds
+ * of ~0 without tags loads everything again, which is the default.
+ *
+ * \param[in,out] data EXIF data
+ * \param[in] ifds #EXIF_DATA_LOAD_IFD bits of the IFDs to load in full
+ * \param[in] tags further tags to load, or NULL
+ * \param[in] num_tags number of tags at \c tags
+ */
+void      exif_data_set_load_filter (ExifData *data, unsigned int ifds,
+				     const ExifTag *tags, unsigned int num_tags);
+
+/*! Load in full an IFD that was left out by the filter set with
+ * #exif_data_set_load_filter when the data was loaded.
+ *
+ * \param[in,out] data EXIF data
+ * \param[in] ifd IFD to load
+ * \param[in] d the buffer given to #exif_data_load_data
+ * \param[in] size number of bytes of data at d
+ */
+void      exif_data_load_ifd (ExifData *data, ExifIfd ifd,
+			      const unsigned char *d, unsigned int size);
+
 /*! Store raw EXIF data representing the #ExifData structure into a memory
- * buffer. The buffer is allocated by this function and must subsequently be
- * freed by the caller.
+ * buffer. The buffer is allocated by this function from the #ExifMem of
+ * the data and must subsequently be freed by the caller, unless that is
+ * an arena (see exif_mem_new_arena()): then the buffer must not be freed
+ * and is only valid as long as the arena.
  *
  * \param[in] data EXIF data
  * \param[out] d pointer to buffer pointer containing raw EXIF data on return
@@ -117,6 +150,19 @@ void      exif_data_load_data (ExifData *data, const unsigned char *d,
 void      exif_data_save_data (ExifData *data, unsigned char **d,
 			       unsigned int *ds);
 
+/*! Store raw EXIF data representing the #ExifData structure into a buffer
+ * provided by the caller, for instance right after the APP1 marker in the
+ * output of a JPEG encoder. Nothing is written unless all of it fits.
+ * Pass a NULL buffer to only find out the size.
+ *
+ * \param[in] data EXIF data
+ * \param[out] d buffer to hold the raw EXIF data, or NULL
+ * \param[in] size number of bytes available at d
+ * \return number of bytes the raw EXIF data takes, 0 on error
+ */
+unsigned int exif_data_save_data_buf (ExifData *data, unsigned char *d,
+				      unsigned int size);
+
 void      exif_data_ref   (ExifData *data);
 void      exif_data_unref (ExifData *data);
 void      exif_data_free  (ExifData *data);
@@ -177,7 +223,15 @@ typedef enum {
 	EXIF_DATA_OPTION_FOLLOW_SPECIFICATION = 1 << 1,
 
 	/*! Leave the MakerNote alone, which could cause it to be corrupted */
-	EXIF_DATA_OPTION_DONT_CHANGE_MAKER_NOTE = 1 << 2
+	EXIF_DATA_OPTION_DONT_CHANGE_MAKER_NOTE = 1 << 2,
+
+	/*! Let #exif_data_load_data point entry data and the thumbnail into
+	 * the loaded buffer instead of copying them. The buffer must stay
+	 * unchanged until the #ExifData and every entry taken from it are
+	 * freed. libexif copies an entry before it changes it, but callers
+	 * must do the same before writing to \c entry->data or \c data->data
+	 * themselves, and must not free them. */
+	EXIF_DATA_OPTION_BORROW_DATA = 1 << 3
 } ExifDataOption;
 
 /*! Return a short textual description of the given #ExifDataOption.
@@ -41,6 +41,9 @@ struct _ExifEntryPrivate
 	unsigned int ref_count;
 
 	ExifMem *mem;
+
+	/* data when it points into a loaded buffer rather than being ours */
+	unsigned char *borrowed;
 };
 
 /* This function is hidden in exif-data.c */
@@ -86,6 +89,52 @@ exif_entry_alloc (ExifEntry *e, unsigned int i)
 	return NULL;
 }
 
+/*
+ * exif-data.c shares the following three functions, which deal with
+ * entry data loaded with EXIF_DATA_OPTION_BORROW_DATA.
+ */
+
+/*! Point the entry at data it does not own. */
+void
+exif_entry_borrow_data (ExifEntry *e, const unsigned char *d, unsigned int size)
+{
+	if (!e || !e->priv) return;
+
+	e->data = e->priv->borrowed = (unsigned char *) d;
+	e->size = size;
+}
+
+/*! Copy borrowed data before it gets modified.
+ * \return 0 if that was not possible
+ */
+int
+exif_entry_own_data (ExifEntry *e)
+{
+	unsigned char *d;
+
+	if (!e || !e->priv) return 0;
+	if (!e->data || e->data != e->priv->borrowed) return 1;
+
+	d = exif_entry_alloc (e, e->size);
+	if (!d) return 0;
+	memcpy (d, e->data, e->size);
+	e->data = d;
+	e->priv->borrowed = NULL;
+	return 1;
+}
+
+/*! Drop the data of an entry, freeing it unless it is borrowed. */
+void
+exif_entry_free_data (ExifEntry *e)
+{
+	if (!e || !e->priv) return;
+
+	if (e->data && e->data != e->priv->borrowed)
+		exif_mem_free (e->priv->mem, e->data);
+	e->data = NULL;
+	e->size = 0;
+}
+
 static void *
 exif_entry_realloc (ExifEntry *e, void *d_orig, unsigned int i)
 {
@@ -94,7 +143,16 @@ exif_entry_realloc (ExifEntry *e, void *d_orig, unsigned int i)
 
 	if (!e || !e->priv) return NULL;
 
-	if (!i) { exif_mem_free (e->priv->mem, d_orig); return NULL; }
+	if (!i) {
+		if (d_orig != e->priv->borrowed)
+			exif_mem_free (e->priv->mem, d_orig);
+		return NULL;
+	}
+	if (d_orig && d_orig == e->priv->borrowed) {
+		/* Only ever called with e->data */
+		if (!exif_entry_own_data (e)) return NULL;
+		d_orig = e->data;
+	}
 
 	d = exif_mem_realloc (e->priv->mem, d_orig, i);
 	if (d) return d;
@@ -121,10 +179,10 @@ exif_entry_new_mem (ExifMem *mem)
 {
 	ExifEntry *e = NULL;
 
-	e = exif_mem_alloc (mem, sizeof (ExifEntry));
+	/* The private part lives right behind the entry */
+	e = exif_mem_alloc (mem, sizeof (ExifEntry) + sizeof (ExifEntryPrivate));
 	if (!e) return NULL;
-	e->priv = exif_mem_alloc (mem, sizeof (ExifEntryPrivate));
-	if (!e->priv) { exif_mem_free (mem, e); return NULL; }
+	e->priv = (ExifEntryPrivate *) (e + 1);
 	e->priv->ref_count = 1;
 
 	e->priv->mem = mem;
@@ -158,9 +216,7 @@ exif_entry_free (ExifEntry *e)
 
 	if (e->priv) {
 		ExifMem *mem = e->priv->mem;
-		if (e->data)
-			exif_mem_free (mem, e->data);
-		exif_mem_free (mem, e->priv);
+		exif_entry_free_data (e);
 		exif_mem_free (mem, e);
 		exif_mem_unref (mem);
 	}
@@ -258,7 +314,7 @@ exif_entry_fix (ExifEntry *e)
 					  exif_format_get_size (e->format),
 					  e->format, o));
 
-			exif_mem_free (e->priv->mem, e->data);
+			exif_entry_free_data (e);
 			e->data = newdata;
 			e->size = newsize;
 			e->format = EXIF_FORMAT_SHORT;
@@ -287,6 +343,7 @@ exif_entry_fix (ExifEntry *e)
 		switch (e->format) {
 		case EXIF_FORMAT_SRATIONAL:
 			if (!e->parent || !e->parent->parent) break;
+			if (!exif_entry_own_data (e)) break;
 			o = exif_data_get_byte_order (e->parent->parent);
 			for (i = 0; i < e->components; i++) {
 				sr = exif_get_srational (e->data + i * 
@@ -320,6 +377,7 @@ exif_entry_fix (ExifEntry *e)
 		switch (e->format) {
 		case EXIF_FORMAT_RATIONAL:
 			if (!e->parent || !e->parent->parent) break;
+			if (!exif_entry_own_data (e)) break;
 			o = exif_data_get_byte_order (e->parent->parent);
 			for (i = 0; i < e->components; i++) {
 				r = exif_get_rational (e->data + i * 
@@ -359,7 +417,9 @@ exif_entry_fix (ExifEntry *e)
 
 		/* Some packages like Canon ZoomBrowser EX 4.5 store
 		   only one zero byte followed by 7 bytes of rubbish */
-		if ((e->size >= 8) && (e->data[0] == 0)) {
+		if ((e->size >= 8) && (e->data[0] == 0) &&
+		    memcmp (e->data, "\0\0\0\0\0\0\0\0", 8) &&
+		    exif_entry_own_data (e)) {
 			memcpy(e->data, "\0\0\0\0\0\0\0\0", 8);
 		}
 
@@ -392,6 +452,7 @@ exif_entry_fix (ExifEntry *e)
 		for (i = 0; (i < e->size) && !e->data[i]; i++);
 		if (!i) for ( ; (i < e->size) && (e->data[i] == ' '); i++);
 		if ((i >= 8) && (i < e->size)) {
+			if (!exif_entry_own_data (e)) break;
 			exif_entry_log (e, EXIF_LOG_CODE_DEBUG,
 				_("Tag 'UserComment' is not empty but does not "
 				"start with a format identifier. "
@@ -127,6 +127,12 @@ exif_log_set_func (ExifLog *log, ExifLogFunc func, void *data)
 	log->data = data;
 }
 
+int
+exif_log_enabled (ExifLog *log)
+{
+	return log && log->func;
+}
+
 #ifdef NO_VERBOSE_TAG_STRINGS
 /* exif_log forms part of the API and can't be commented away */
 #undef exif_log
@@ -86,6 +86,14 @@ typedef void (* ExifLogFunc) (ExifLog *log, ExifLogCode, const char *domain,
  */
 void     exif_log_set_func (ExifLog *log, ExifLogFunc func, void *data);
 
+/*! Whether messages given to the log reach a callback function. Callers
+ * can check this before working out costly arguments to #exif_log.
+ *
+ * \param[in] log logging state variable, or NULL
+ * \return 1 if a callback function is registered, 0 otherwise
+ */
+int      exif_log_enabled (ExifLog *log);
+
 #ifndef NO_VERBOSE_TAG_STRINGS
 void     exif_log  (ExifLog *log, ExifLogCode, const char *domain,
 		    const char *format, ...)
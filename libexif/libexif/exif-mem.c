@@ -1,12 +1,35 @@
 #include <libexif/exif-mem.h>
 
 #include <stdlib.h>
+#include <string.h>
+
+/* Allocations in an arena are aligned to and preceded by this much */
+#define EXIF_MEM_ALIGN 8
+#define EXIF_MEM_ROUND(s) (((s) + EXIF_MEM_ALIGN - 1) & ~(size_t) (EXIF_MEM_ALIGN - 1))
+
+/* Allocations larger than this fraction of the block size get their own */
+#define EXIF_MEM_ARENA_LARGE(m) ((m)->block_size / 4)
+
+typedef struct _ExifMemBlock ExifMemBlock;
+struct _ExifMemBlock {
+	ExifMemBlock *next;
+	size_t size;
+	size_t used;
+};
+
+#define EXIF_MEM_BLOCK_HEADER EXIF_MEM_ROUND (sizeof (ExifMemBlock))
 
 struct _ExifMem {
 	unsigned int ref_count;
 	ExifMemAllocFunc alloc_func;
 	ExifMemReallocFunc realloc_func;
 	ExifMemFreeFunc free_func;
+
+	/* Only for arenas: blocks come from parent, the one being filled first */
+	ExifMem *parent;
+	size_t block_size;
+	ExifMemBlock *blocks;
+	unsigned char *last;	/* most recent allocation, may grow in place */
 };
 
 /*! Default memory allocation function. */
@@ -36,7 +59,7 @@ exif_mem_new (ExifMemAllocFunc alloc_func, ExifMemReallocFunc realloc_func,
 {
 	ExifMem *mem;
 
-	if (!alloc_func && !realloc_func) 
+	if (!alloc_func && !realloc_func)
 		return NULL;
 	mem = alloc_func ? alloc_func (sizeof (ExifMem)) :
 		           realloc_func (NULL, sizeof (ExifMem));
@@ -47,6 +70,11 @@ exif_mem_new (ExifMemAllocFunc alloc_func, ExifMemReallocFunc realloc_func,
 	mem->realloc_func = realloc_func;
 	mem->free_func    = free_func;
 
+	mem->parent = NULL;
+	mem->block_size = 0;
+	mem->blocks = NULL;
+	mem->last = NULL;
+
 	return mem;
 }
 
@@ -57,18 +85,129 @@ exif_mem_ref (ExifMem *mem)
 	mem->ref_count++;
 }
 
+static void
+exif_mem_arena_free_blocks (ExifMem *mem)
+{
+	ExifMemBlock *b, *next;
+
+	for (b = mem->blocks; b; b = next) {
+		next = b->next;
+		exif_mem_free (mem->parent, b);
+	}
+}
+
 void
 exif_mem_unref (ExifMem *mem)
 {
+	ExifMem *parent;
+
 	if (!mem) return;
-	if (!--mem->ref_count)
+	if (--mem->ref_count)
+		return;
+	if (!mem->parent) {
 		exif_mem_free (mem, mem);
+		return;
+	}
+	parent = mem->parent;
+	exif_mem_arena_free_blocks (mem);
+	exif_mem_free (parent, mem);
+	exif_mem_unref (parent);
+}
+
+/*! Size asked for when ptr was allocated from an arena */
+#define EXIF_MEM_ARENA_SIZE(ptr) (*(size_t *) ((ptr) - EXIF_MEM_ALIGN))
+
+static void *
+exif_mem_arena_alloc (ExifMem *mem, size_t ds)
+{
+	ExifMemBlock *b = mem->blocks;
+	size_t need = EXIF_MEM_ALIGN + EXIF_MEM_ROUND (ds);
+	unsigned char *p;
+
+	if (ds > EXIF_MEM_ARENA_LARGE (mem)) {
+		size_t total = EXIF_MEM_BLOCK_HEADER + need;
+
+		if (need < ds || total < need || (ExifLong) total != total)
+			return NULL;
+		/* Behind the current block, which keeps being filled */
+		b = exif_mem_alloc (mem->parent, total);
+		if (!b)
+			return NULL;
+		b->size = b->used = need;
+		if (mem->blocks) {
+			b->next = mem->blocks->next;
+			mem->blocks->next = b;
+		} else {
+			b->next = NULL;
+			mem->blocks = b;
+		}
+		p = (unsigned char *) b + EXIF_MEM_BLOCK_HEADER;
+		*(size_t *) p = ds;
+		return p + EXIF_MEM_ALIGN;
+	}
+	if (!b || b->size - b->used < need) {
+		b = exif_mem_alloc (mem->parent,
+				    EXIF_MEM_BLOCK_HEADER + mem->block_size);
+		if (!b)
+			return NULL;
+		b->size = mem->block_size;
+		b->used = 0;
+		b->next = mem->blocks;
+		mem->blocks = b;
+	}
+	p = (unsigned char *) b + EXIF_MEM_BLOCK_HEADER + b->used;
+	b->used += need;
+	*(size_t *) p = ds;
+	mem->last = p + EXIF_MEM_ALIGN;
+	return mem->last;
+}
+
+static void *
+exif_mem_arena_realloc (ExifMem *mem, unsigned char *d, size_t ds)
+{
+	ExifMemBlock *b = mem->blocks;
+	size_t os, start;
+	void *n;
+
+	if (!d)
+		return exif_mem_arena_alloc (mem, ds);
+	os = EXIF_MEM_ARENA_SIZE (d);
+	if (d == mem->last) {
+		/* At the end of the current block, resize it there */
+		start = d - ((unsigned char *) b + EXIF_MEM_BLOCK_HEADER);
+		if (ds <= b->size - start &&
+		    EXIF_MEM_ROUND (ds) <= b->size - start) {
+			b->used = start + EXIF_MEM_ROUND (ds);
+			EXIF_MEM_ARENA_SIZE (d) = ds;
+			return d;
+		}
+	}
+	if (ds <= os)
+		return d;
+	n = exif_mem_arena_alloc (mem, ds);
+	if (n)
+		memcpy (n, d, os);
+	return n;
+}
+
+static void
+exif_mem_arena_free (ExifMem *mem, unsigned char *d)
+{
+	if (!d || d != mem->last)
+		return;
+	mem->blocks->used = d - EXIF_MEM_ALIGN -
+		((unsigned char *) mem->blocks + EXIF_MEM_BLOCK_HEADER);
+	mem->last = NULL;
 }
 
 void
 exif_mem_free (ExifMem *mem, void *d)
 {
 	if (!mem) return;
+	if (mem->parent) {
+		exif_mem_arena_free (mem, d);
+		return;
+	}
 	if (mem->free_func) {
 		mem->free_func (d);
 		return;
@@ -78,7 +217,15 @@ exif_mem_free (ExifMem *mem, void *d)
 void *
 exif_mem_alloc (ExifMem *mem, ExifLong ds)
 {
+	void *d;
+
 	if (!mem) return NULL;
+	if (mem->parent) {
+		d = exif_mem_arena_alloc (mem, ds);
+		if (d)
+			memset (d, 0, ds);
+		return d;
+	}
 	if (mem->alloc_func || mem->realloc_func)
 		return mem->alloc_func ? mem->alloc_func (ds) :
 					 mem->realloc_func (NULL, ds);
@@ -88,6 +235,8 @@ exif_mem_alloc (ExifMem *mem, ExifLong ds)
 void *
 exif_mem_realloc (ExifMem *mem, void *d, ExifLong ds)
 {
+	if (mem && mem->parent)
+		return exif_mem_arena_realloc (mem, d, ds);
 	return (mem && mem->realloc_func) ? mem->realloc_func (d, ds) : NULL;
 }
 
@@ -97,3 +246,29 @@ exif_mem_new_default (void)
 	return exif_mem_new (exif_mem_alloc_func, exif_mem_realloc_func,
 			     exif_mem_free_func);
 }
+
+ExifMem *
+exif_mem_new_arena (ExifMem *parent, ExifLong block_size)
+{
+	ExifMem *mem;
+
+	if (parent)
+		exif_mem_ref (parent);
+	else if (!(parent = exif_mem_new_default ()))
+		return NULL;
+	mem = exif_mem_alloc (parent, sizeof (ExifMem));
+	if (!mem) {
+		exif_mem_unref (parent);
+		return NULL;
+	}
+	mem->ref_count = 1;
+	mem->alloc_func = NULL;
+	mem->realloc_func = NULL;
+	mem->free_func = NULL;
+	mem->parent = parent;
+	mem->blocks = NULL;
+	mem->last = NULL;
+	mem->block_size = EXIF_MEM_ROUND (block_size ? block_size :
+					  EXIF_MEM_ARENA_BLOCK_SIZE);
+	return mem;
+}
@@ -83,6 +83,28 @@ void  exif_mem_free    (ExifMem *m, void *p);
  */
 ExifMem *exif_mem_new_default (void);
 
+/*! Default size of the blocks of an arena ExifMem */
+#define EXIF_MEM_ARENA_BLOCK_SIZE 8192
+
+/*! Create a new ExifMem that hands out memory from large blocks.
+ * Freeing is a no-op except for the most recent allocation; all blocks
+ * are given back at once when the last reference to the arena goes
+ * away. Meant for short lived data such as an #ExifData loaded only to
+ * be read: pass it to exif_data_new_mem() and the parse makes a few
+ * block allocations instead of several per tag. Not thread safe.
+ *
+ * Everything an #ExifData allocates from the arena lives in its blocks,
+ * including the buffer exif_data_save_data() returns: it must not be
+ * given to free(), and it goes away with the arena. Use
+ * exif_data_save_data_buf() to save into memory of your own.
+ *
+ * \param[in] mem the ExifMem the blocks come from, NULL for the default
+ * \param[in] block_size size of the blocks, 0 for #EXIF_MEM_ARENA_BLOCK_SIZE.
+ *            Larger allocations get blocks of their own.
+ * \return a new arena ExifMem
+ */
+ExifMem *exif_mem_new_arena (ExifMem *mem, ExifLong block_size);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -889,79 +889,116 @@ exif_tag_table_get_name (unsigned int n)
 	return (n < exif_tag_table_count ()) ? ExifTagTable[n].name : NULL;
 }
 
+#define RECORDED \
+((ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_UNCOMPRESSED_CHUNKY] != EXIF_SUPPORT_LEVEL_NOT_RECORDED) || \
+ (ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_UNCOMPRESSED_PLANAR] != EXIF_SUPPORT_LEVEL_NOT_RECORDED) || \
+ (ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_UNCOMPRESSED_YCC] != EXIF_SUPPORT_LEVEL_NOT_RECORDED) || \
+ (ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_COMPRESSED] != EXIF_SUPPORT_LEVEL_NOT_RECORDED))
+
 /*!
- * Compares the tag with that in entry.
- * \param[in] tag pointer to integer tag value
- * \param[in] entry pointer to a struct TagEntry
- * \return 0 if tags are equal, <0 if tag < entry, >0 if tag > entry
+ * Number of slots in the (tag, IFD) index. A power of two, and more than
+ * twice the number of tags recorded in any IFD so that probes stay short.
  */
-static int
-match_tag(const void *tag, const void *entry)
+#define EXIF_TAG_INDEX_SIZE 1024
+
+#define EXIF_TAG_INDEX_HASH(tag,ifd) \
+	((((unsigned int) (tag) * 0x9E3779B1u) ^ ((unsigned int) (ifd) << 29)) >> 22)
+
+/*!
+ * Open addressing index of the table, giving for a (tag, IFD) the first
+ * entry recorded in that IFD. The table is constant, so the index is
+ * built once, on first use. Each thread that races to build it fills its
+ * own copy and then stores the same bytes, and the index is only
+ * published once it is complete.
+ */
+typedef struct {
+	ExifTag tag;
+	unsigned char ifd;
+	unsigned short entry;	/* index into ExifTagTable + 1, 0 when free */
+} ExifTagIndexSlot;
+static ExifTagIndexSlot exif_tag_index[EXIF_TAG_INDEX_SIZE];
+static volatile int exif_tag_index_built;
+
+#if defined(__ATOMIC_ACQUIRE)
+#  define EXIF_TAG_INDEX_BUILT() __atomic_load_n (&exif_tag_index_built, __ATOMIC_ACQUIRE)
+#  define EXIF_TAG_INDEX_PUBLISH() __atomic_store_n (&exif_tag_index_built, 1, __ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+#  define EXIF_TAG_INDEX_BUILT() (__sync_synchronize (), exif_tag_index_built)
+#  define EXIF_TAG_INDEX_PUBLISH() (__sync_synchronize (), exif_tag_index_built = 1)
+#else
+#  define EXIF_TAG_INDEX_BUILT() exif_tag_index_built
+#  define EXIF_TAG_INDEX_PUBLISH() (exif_tag_index_built = 1)
+#endif
+
+static void
+exif_tag_index_build (void)
 {
-	return *(int*)tag - ((struct TagEntry *)entry)->tag;
-}
+	ExifTagIndexSlot index[EXIF_TAG_INDEX_SIZE];
+	unsigned int i, h;
+	ExifIfd ifd;
 
+	memset (index, 0, sizeof (index));
+	for (i = 0; ExifTagTable[i].name; i++) {
+		for (ifd = 0; ifd < EXIF_IFD_COUNT; ifd++) {
+			if (!RECORDED)
+				continue;
+			h = EXIF_TAG_INDEX_HASH (ExifTagTable[i].tag, ifd);
+			while (index[h].entry &&
+			       ((index[h].tag != ExifTagTable[i].tag) ||
+				(index[h].ifd != ifd)))
+				h = (h + 1) & (EXIF_TAG_INDEX_SIZE - 1);
+			if (index[h].entry)
+				continue;	/* An earlier entry has it */
+			index[h].tag = ExifTagTable[i].tag;
+			index[h].ifd = ifd;
+			index[h].entry = i + 1;
+		}
+	}
+	memcpy (exif_tag_index, index, sizeof (index));
+}
 
 /*!
  * Finds the first entry in the EXIF tag table with the given tag number
- * using a binary search.
+ * that is recorded in the given IFD.
  * \param[in] tag to find
+ * \param[in] ifd a valid IFD (not EXIF_IFD_COUNT)
  * \return index into table, or -1 if not found
  */
 static int
-exif_tag_table_first(ExifTag tag)
+exif_tag_table_find (ExifTag tag, ExifIfd ifd)
 {
-	int i;
-	struct TagEntry *entry = bsearch(&tag, ExifTagTable,
-		exif_tag_table_count()-1, sizeof(struct TagEntry), match_tag);
-	if (!entry)
-		return -1;	/* Not found */
+	unsigned int h;
 
-	/* Calculate index of found entry */
-	i = entry - ExifTagTable;
-
-	/* There may be other entries with the same tag number, so search
-	 * backwards to find the first
-	 */
-	while ((i > 0) && (ExifTagTable[i-1].tag == tag)) {
-		--i;
+	if (!EXIF_TAG_INDEX_BUILT ()) {
+		exif_tag_index_build ();
+		EXIF_TAG_INDEX_PUBLISH ();
 	}
-	return i;
-}
 
-#define RECORDED \
-((ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_UNCOMPRESSED_CHUNKY] != EXIF_SUPPORT_LEVEL_NOT_RECORDED) || \
- (ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_UNCOMPRESSED_PLANAR] != EXIF_SUPPORT_LEVEL_NOT_RECORDED) || \
- (ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_UNCOMPRESSED_YCC] != EXIF_SUPPORT_LEVEL_NOT_RECORDED) || \
- (ExifTagTable[i].esl[ifd][EXIF_DATA_TYPE_COMPRESSED] != EXIF_SUPPORT_LEVEL_NOT_RECORDED))
+	for (h = EXIF_TAG_INDEX_HASH (tag, ifd); exif_tag_index[h].entry;
+	     h = (h + 1) & (EXIF_TAG_INDEX_SIZE - 1))
+		if ((exif_tag_index[h].tag == tag) &&
+		    (exif_tag_index[h].ifd == ifd))
+			return exif_tag_index[h].entry - 1;
+	return -1;
+}
 
 const char *
 exif_tag_get_name_in_ifd (ExifTag tag, ExifIfd ifd)
 {
-	unsigned int i;
-	int first;
+	int i;
 
 	if (ifd >= EXIF_IFD_COUNT)
 		return NULL;
-	first = exif_tag_table_first(tag);
-	if (first < 0)
-		return NULL;
-
-	for (i = first; ExifTagTable[i].name; i++) {
-		if (ExifTagTable[i].tag == tag) {
-		   if (RECORDED)
-			   break;
-		} else
-			return NULL; /* Recorded tag not found in the table */
-	}
+	i = exif_tag_table_find (tag, ifd);
+	if (i < 0)
+		return NULL; /* Recorded tag not found in the table */
 	return ExifTagTable[i].name;
 }
 
 const char *
 exif_tag_get_title_in_ifd (ExifTag tag, ExifIfd ifd)
 {
-	unsigned int i;
-	int first;
+	int i;
 
 	/* FIXME: This belongs to somewhere else. */
 	/* libexif should use the default system locale.
@@ -973,25 +1010,16 @@ exif_tag_get_title_in_ifd (ExifTag tag, ExifIfd ifd)
 	bindtextdomain (GETTEXT_PACKAGE, LOCALEDIR);
 	if (ifd >= EXIF_IFD_COUNT)
 		return NULL;
-	first = exif_tag_table_first(tag);
-	if (first < 0)
-		return NULL;
-
-	for (i = first; ExifTagTable[i].name; i++) {
-		if (ExifTagTable[i].tag == tag) {
-		   if (RECORDED)
-			   break;
-		} else
-			return NULL; /* Recorded tag not found in the table */
-	}
+	i = exif_tag_table_find (tag, ifd);
+	if (i < 0)
+		return NULL; /* Recorded tag not found in the table */
 	return _(ExifTagTable[i].title);
 }
 
 const char *
 exif_tag_get_description_in_ifd (ExifTag tag, ExifIfd ifd)
 {
-	unsigned int i;
-	int first;
+	int i;
 
 	/* libexif should use the default system locale.
 	 * If an application specifically requires UTF-8, then we
@@ -1003,17 +1031,9 @@ exif_tag_get_description_in_ifd (ExifTag tag, ExifIfd ifd)
 
 	if (ifd >= EXIF_IFD_COUNT)
 		return NULL;
-	first = exif_tag_table_first(tag);
-	if (first < 0)
-		return NULL;
-
-	for (i = first; ExifTagTable[i].name; i++) {
-		if (ExifTagTable[i].tag == tag) {
-			if (RECORDED)
-				break;
-		} else
-			return NULL; /* Recorded tag not found in the table */
-	}
+	i = exif_tag_table_find (tag, ifd);
+	if (i < 0)
+		return NULL; /* Recorded tag not found in the table */
 
 	/* GNU gettext acts strangely when given an empty string */
 	if (!ExifTagTable[i].description || !*ExifTagTable[i].description)
@@ -1100,7 +1120,8 @@ static inline ExifSupportLevel
 get_support_level_in_ifd (ExifTag tag, ExifIfd ifd, ExifDataType t)
 {
 	unsigned int i;
-	int first = exif_tag_table_first(tag);
+	/* Entries before the one recorded in this IFD have nothing for it */
+	int first = exif_tag_table_find (tag, ifd);
 	if (first < 0)
 		return EXIF_SUPPORT_LEVEL_NOT_RECORDED;
 
@@ -1130,7 +1151,8 @@ static inline ExifSupportLevel
 get_support_level_any_type (ExifTag tag, ExifIfd ifd)
 {
 	unsigned int i;
-	int first = exif_tag_table_first(tag);
+	/* Entries before the one recorded in this IFD have nothing for it */
+	int first = exif_tag_table_find (tag, ifd);
 	if (first < 0)
 		return EXIF_SUPPORT_LEVEL_UNKNOWN;
 
@@ -420,9 +420,10 @@ exif_mnote_data_olympus_load (ExifMnoteData *en,
 	    n->entries[tcount].components = exif_get_long (buf + o + 4, n->order);
 	    n->entries[tcount].order      = n->order;
 
-	    exif_log (en->log, EXIF_LOG_CODE_DEBUG, "ExifMnoteOlympus",
-		      "Loading entry 0x%x ('%s')...", n->entries[tcount].tag,
-		      mnote_olympus_tag_get_name (n->entries[tcount].tag));
+	    if (exif_log_enabled (en->log))
+		    exif_log (en->log, EXIF_LOG_CODE_DEBUG, "ExifMnoteOlympus",
+			      "Loading entry 0x%x ('%s')...", n->entries[tcount].tag,
+			      mnote_olympus_tag_get_name (n->entries[tcount].tag));
 /*	    exif_log (en->log, EXIF_LOG_CODE_DEBUG, "ExifMnoteOlympus",
 			    "0x%x %d %ld*(%d)",
 		    n->entries[tcount].tag,
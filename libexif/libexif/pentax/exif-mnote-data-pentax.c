@@ -288,9 +288,10 @@ exif_mnote_data_pentax_load (ExifMnoteData *en,
 		n->entries[tcount].components = exif_get_long  (buf + o + 4, n->order);
 		n->entries[tcount].order      = n->order;
 
-		exif_log (en->log, EXIF_LOG_CODE_DEBUG, "ExifMnotePentax",
-			  "Loading entry 0x%x ('%s')...", n->entries[tcount].tag,
-			  mnote_pentax_tag_get_name (n->entries[tcount].tag));
+		if (exif_log_enabled (en->log))
+			exif_log (en->log, EXIF_LOG_CODE_DEBUG, "ExifMnotePentax",
+				  "Loading entry 0x%x ('%s')...", n->entries[tcount].tag,
+				  mnote_pentax_tag_get_name (n->entries[tcount].tag));
 
 		/*
 		 * Size? If bigger than 4 bytes, the actual data is not
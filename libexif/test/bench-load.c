@@ -0,0 +1,301 @@
+/* bench-load.c
+ *
+ * Measures the allocations made and the time taken by
+ * exif_data_load_data, with the default ExifMem, with an arena, with an
+ * arena and borrowed data, and with those and a load filter keeping only
+ * what a gallery index needs. The cost of looking up tags in the tag
+ * table, which is done for every entry loaded, is measured on its own, and
+ * so is saving the data again, into a new buffer and into one given.
+ *
+ *   bench-load [-n iterations] [file...]
+ *
+ * Files are taken from the command line and from $TEST_IMAGES. Without
+ * any, a sample with the mandatory tags, some camera tags and a
+ * thumbnail is built and measured.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA.
+ */
+
+#include <libexif/exif-data.h>
+#include <libexif/exif-mem.h>
+#include <libexif/exif-tag.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static unsigned long allocs;
+
+static void *
+count_alloc (ExifLong s)
+{
+	allocs++;
+	return calloc (s, 1);
+}
+
+static void *
+count_realloc (void *p, ExifLong s)
+{
+	allocs++;
+	return realloc (p, s);
+}
+
+static void
+count_free (void *p)
+{
+	free (p);
+}
+
+static double
+now_ns (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void
+count_entries (ExifContent *c, void *data)
+{
+	*(unsigned int *) data += c->count;
+}
+
+/* Build an APP1 payload like the ones cameras write */
+static unsigned char *
+make_sample (unsigned int *size)
+{
+	static const ExifTag tags[] = {
+		EXIF_TAG_MAKE, EXIF_TAG_MODEL, EXIF_TAG_ORIENTATION,
+		EXIF_TAG_DATE_TIME, EXIF_TAG_IMAGE_DESCRIPTION,
+		EXIF_TAG_SOFTWARE, EXIF_TAG_ARTIST, EXIF_TAG_COPYRIGHT
+	};
+	static const ExifTag exif_tags[] = {
+		EXIF_TAG_EXPOSURE_TIME, EXIF_TAG_FNUMBER,
+		EXIF_TAG_EXPOSURE_PROGRAM, EXIF_TAG_ISO_SPEED_RATINGS,
+		EXIF_TAG_DATE_TIME_ORIGINAL, EXIF_TAG_DATE_TIME_DIGITIZED,
+		EXIF_TAG_SHUTTER_SPEED_VALUE, EXIF_TAG_APERTURE_VALUE,
+		EXIF_TAG_EXPOSURE_BIAS_VALUE, EXIF_TAG_MAX_APERTURE_VALUE,
+		EXIF_TAG_METERING_MODE, EXIF_TAG_LIGHT_SOURCE, EXIF_TAG_FLASH,
+		EXIF_TAG_FOCAL_LENGTH, EXIF_TAG_USER_COMMENT,
+		EXIF_TAG_SUB_SEC_TIME, EXIF_TAG_FILE_SOURCE,
+		EXIF_TAG_SCENE_TYPE, EXIF_TAG_WHITE_BALANCE
+	};
+	ExifData *d = exif_data_new ();
+	ExifEntry *e;
+	unsigned char *buf;
+	unsigned int i;
+
+	exif_data_set_data_type (d, EXIF_DATA_TYPE_COMPRESSED);
+	exif_data_fix (d);
+	for (i = 0; i < sizeof (tags) / sizeof (tags[0]); i++) {
+		e = exif_entry_new ();
+		exif_content_add_entry (d->ifd[EXIF_IFD_0], e);
+		exif_entry_initialize (e, tags[i]);
+		exif_entry_unref (e);
+	}
+	for (i = 0; i < sizeof (exif_tags) / sizeof (exif_tags[0]); i++) {
+		e = exif_entry_new ();
+		exif_content_add_entry (d->ifd[EXIF_IFD_EXIF], e);
+		exif_entry_initialize (e, exif_tags[i]);
+		exif_entry_unref (e);
+	}
+	d->size = 6000;
+	d->data = calloc (d->size, 1);
+	exif_data_save_data (d, &buf, size);
+	exif_data_unref (d);
+	return buf;
+}
+
+static const ExifTag index_tags[] = {
+	EXIF_TAG_ORIENTATION, EXIF_TAG_DATE_TIME, EXIF_TAG_DATE_TIME_ORIGINAL
+};
+
+static const struct {
+	const char *name;
+	int arena;
+	ExifDataOption options;
+	int filter;
+} modes[] = {
+	{ "default", 0, 0, 0 },
+	{ "arena", 1, 0, 0 },
+	{ "arena, borrowed", 1, EXIF_DATA_OPTION_BORROW_DATA, 0 },
+	{ "arena, borrowed, filtered", 1, EXIF_DATA_OPTION_BORROW_DATA, 1 }
+};
+
+static void
+bench (const char *name, const unsigned char *buf, unsigned int size,
+       unsigned int n)
+{
+	ExifMem *counting = exif_mem_new (count_alloc, count_realloc,
+					  count_free);
+	unsigned int m, i, entries;
+	double elapsed;
+
+	for (m = 0; m < sizeof (modes) / sizeof (modes[0]); m++) {
+		unsigned long start_allocs = allocs;
+		double start = now_ns ();
+
+		for (i = 0; i < n; i++) {
+			ExifMem *mem = modes[m].arena ?
+				exif_mem_new_arena (counting, 0) : counting;
+			ExifData *d = exif_data_new_mem (mem);
+
+			if (modes[m].options)
+				exif_data_set_option (d, modes[m].options);
+			if (modes[m].filter)
+				exif_data_set_load_filter (d,
+					EXIF_DATA_LOAD_IFD (EXIF_IFD_1) |
+					EXIF_DATA_LOAD_IFD (EXIF_IFD_GPS), index_tags,
+					sizeof (index_tags) / sizeof (index_tags[0]));
+			exif_data_load_data (d, buf, size);
+			if (!i) {
+				entries = 0;
+				exif_data_foreach_content (d, count_entries,
+							   &entries);
+			}
+			exif_data_unref (d);
+			if (modes[m].arena)
+				exif_mem_unref (mem);
+		}
+		elapsed = (now_ns () - start) / n;
+		printf ("%s: %s: %u entries, %.1f allocations, %.0f ns per parse, "
+			"%.0f ns per entry\n", name, modes[m].name, entries,
+			(double) (allocs - start_allocs) / n, elapsed,
+			entries ? elapsed / entries : 0);
+	}
+	exif_mem_unref (counting);
+}
+
+static void
+bench_tags (unsigned int n)
+{
+	unsigned int i, t, lookups = 0, found = 0;
+	ExifIfd ifd;
+	double start = now_ns ();
+
+	for (i = 0; i < n; i++) {
+		for (t = 0; t < exif_tag_table_count (); t++) {
+			for (ifd = 0; ifd < EXIF_IFD_COUNT; ifd++) {
+				if (exif_tag_get_name_in_ifd (
+					exif_tag_table_get_tag (t), ifd))
+					found++;
+				lookups++;
+			}
+		}
+	}
+	printf ("tag table: %u lookups, %u found, %.1f ns per lookup\n",
+		lookups, found, (now_ns () - start) / lookups);
+}
+
+static void
+bench_save (const char *name, const unsigned char *buf, unsigned int size,
+	    unsigned int n)
+{
+	ExifMem *counting = exif_mem_new (count_alloc, count_realloc,
+					  count_free);
+	ExifData *d = exif_data_new_mem (counting);
+	unsigned long start_allocs;
+	unsigned char *out, *given;
+	unsigned int i, out_size;
+	double start;
+
+	exif_data_load_data (d, buf, size);
+
+	start_allocs = allocs;
+	start = now_ns ();
+	for (i = 0; i < n; i++) {
+		exif_data_save_data (d, &out, &out_size);
+		exif_mem_free (counting, out);
+	}
+	printf ("%s: save: %u bytes, %.1f allocations, %.0f ns per save\n",
+		name, out_size, (double) (allocs - start_allocs) / n,
+		(now_ns () - start) / n);
+
+	given = malloc (out_size);
+	start_allocs = allocs;
+	start = now_ns ();
+	for (i = 0; i < n && given; i++)
+		exif_data_save_data_buf (d, given, out_size);
+	printf ("%s: save into a given buffer: %.1f allocations, %.0f ns per save\n",
+		name, (double) (allocs - start_allocs) / n,
+		(now_ns () - start) / n);
+	free (given);
+
+	exif_data_unref (d);
+	exif_mem_unref (counting);
+}
+
+static void
+bench_file (const char *path, unsigned int n)
+{
+	FILE *f = fopen (path, "rb");
+	unsigned char *buf;
+	long size;
+
+	if (!f) {
+		perror (path);
+		return;
+	}
+	fseek (f, 0, SEEK_END);
+	size = ftell (f);
+	fseek (f, 0, SEEK_SET);
+	buf = malloc (size);
+	if (buf && fread (buf, 1, size, f) == (size_t) size) {
+		bench (path, buf, size, n);
+		bench_save (path, buf, size, n);
+	}
+	free (buf);
+	fclose (f);
+}
+
+int
+main (int argc, char **argv)
+{
+	unsigned int n = 10000, size, files = 0;
+	unsigned char *buf;
+	const char *envar = getenv ("TEST_IMAGES");
+	char *images, *path;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-n") && i + 1 < argc) {
+			n = atoi (argv[++i]);
+			if (!n)
+				n = 1;
+			continue;
+		}
+		bench_file (argv[i], n);
+		files++;
+	}
+	if (envar && (images = strdup (envar))) {
+		for (path = strtok (images, " \t\r\n"); path;
+		     path = strtok (NULL, " \t\r\n")) {
+			bench_file (path, n);
+			files++;
+		}
+		free (images);
+	}
+	if (!files) {
+		buf = make_sample (&size);
+		bench ("sample", buf, size, n);
+		bench_save ("sample", buf, size, n);
+		free (buf);
+	}
+	bench_tags (n / 10 ? n / 10 : 1);
+	return 0;
+}
@@ -0,0 +1,157 @@
+/* test-borrow.c
+ *
+ * Loads EXIF data with EXIF_DATA_OPTION_BORROW_DATA, changes its byte
+ * order and saves it again. The loaded buffer must be left untouched, and
+ * the data saved must read back the same as the original.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA.
+ */
+
+#include <libexif/exif-data.h>
+#include <libexif/exif-utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THUMBNAIL_SIZE 600
+
+static int rc = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf ("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		rc = 1; \
+	} \
+} while (0)
+
+static void
+add_entry (ExifData *d, ExifIfd ifd, ExifTag tag)
+{
+	ExifEntry *e = exif_entry_new ();
+
+	exif_content_add_entry (d->ifd[ifd], e);
+	exif_entry_initialize (e, tag);
+	exif_entry_unref (e);
+}
+
+/* Motorola byte order, with a thumbnail */
+static unsigned char *
+make_sample (unsigned int *size)
+{
+	ExifData *d = exif_data_new ();
+	unsigned char *buf;
+
+	d->size = THUMBNAIL_SIZE;
+	d->data = malloc (d->size);
+	memset (d->data, 0x5a, d->size);
+	exif_data_set_data_type (d, EXIF_DATA_TYPE_COMPRESSED);
+	exif_data_fix (d);
+	add_entry (d, EXIF_IFD_0, EXIF_TAG_ORIENTATION);
+	add_entry (d, EXIF_IFD_0, EXIF_TAG_DATE_TIME);
+	add_entry (d, EXIF_IFD_EXIF, EXIF_TAG_EXPOSURE_TIME);
+	exif_set_short (exif_content_get_entry (d->ifd[EXIF_IFD_0],
+			EXIF_TAG_ORIENTATION)->data, EXIF_BYTE_ORDER_MOTOROLA, 6);
+	exif_data_save_data (d, &buf, size);
+	exif_data_unref (d);
+	return buf;
+}
+
+static int
+borrowed (const void *p, const unsigned char *buf, unsigned int size)
+{
+	return (const unsigned char *) p >= buf &&
+	       (const unsigned char *) p < buf + size;
+}
+
+/* Same entries with the same values, whatever the byte order */
+static void
+compare_content (ExifContent *a, ExifContent *b)
+{
+	char va[1024], vb[1024];
+	unsigned int i;
+	ExifEntry *e;
+
+	CHECK (a->count == b->count);
+	for (i = 0; i < a->count; i++) {
+		e = exif_content_get_entry (b, a->entries[i]->tag);
+		CHECK (e != NULL);
+		if (!e)
+			continue;
+		exif_entry_get_value (a->entries[i], va, sizeof (va));
+		exif_entry_get_value (e, vb, sizeof (vb));
+		if (strcmp (va, vb)) {
+			printf ("%s: '%s' became '%s'\n",
+				exif_tag_get_name (e->tag), va, vb);
+			rc = 1;
+		}
+	}
+}
+
+int
+main (void)
+{
+	ExifData *orig, *d, *saved;
+	ExifEntry *e;
+	unsigned char *buf, *copy, *out;
+	unsigned int size, out_size, i;
+
+	buf = make_sample (&size);
+	if (!buf || !size) {
+		printf ("Error saving the sample\n");
+		return 13;
+	}
+	copy = malloc (size);
+	memcpy (copy, buf, size);
+	orig = exif_data_new_from_data (buf, size);
+
+	printf ("Loading %u byte(s) without copying...\n", size);
+	d = exif_data_new ();
+	exif_data_set_option (d, EXIF_DATA_OPTION_BORROW_DATA);
+	exif_data_load_data (d, buf, size);
+	e = exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_DATE_TIME);
+	CHECK (e && borrowed (e->data, buf, size));
+	CHECK (d->size == THUMBNAIL_SIZE && borrowed (d->data, buf, size));
+
+	printf ("Changing the byte order...\n");
+	exif_data_set_byte_order (d, EXIF_BYTE_ORDER_INTEL);
+	CHECK (!memcmp (buf, copy, size));
+	e = exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_ORIENTATION);
+	CHECK (e && !borrowed (e->data, buf, size));
+	CHECK (e && exif_get_short (e->data, EXIF_BYTE_ORDER_INTEL) == 6);
+
+	printf ("Saving and loading again...\n");
+	exif_data_save_data (d, &out, &out_size);
+	CHECK (out && out_size);
+	saved = exif_data_new_from_data (out, out_size);
+	CHECK (exif_data_get_byte_order (saved) == EXIF_BYTE_ORDER_INTEL);
+	for (i = 0; i < EXIF_IFD_COUNT; i++)
+		compare_content (orig->ifd[i], saved->ifd[i]);
+	CHECK (saved->size == THUMBNAIL_SIZE &&
+	       !memcmp (saved->data, orig->data, THUMBNAIL_SIZE));
+
+	/* nothing borrowed may be freed, and the buffer still is as loaded */
+	exif_data_unref (d);
+	CHECK (!memcmp (buf, copy, size));
+
+	exif_data_unref (saved);
+	exif_data_unref (orig);
+	free (out);
+	free (copy);
+	free (buf);
+
+	return rc;
+}
@@ -0,0 +1,161 @@
+/* test-filter.c
+ *
+ * Loads EXIF data through a load filter and checks that exactly the
+ * entries asked for are loaded, and that the IFDs left out can be loaded
+ * in full later with exif_data_load_ifd.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA.
+ */
+
+#include <libexif/exif-data.h>
+#include <libexif/exif-utils.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THUMBNAIL_SIZE 600
+
+static int rc = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf ("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		rc = 1; \
+	} \
+} while (0)
+
+static void
+add_entry (ExifData *d, ExifIfd ifd, ExifTag tag)
+{
+	ExifEntry *e = exif_entry_new ();
+
+	exif_content_add_entry (d->ifd[ifd], e);
+	exif_entry_initialize (e, tag);
+	exif_entry_unref (e);
+}
+
+/* exif_entry_initialize leaves the Interoperability tags empty */
+static void
+add_index (ExifData *d)
+{
+	ExifEntry *e = exif_entry_new ();
+
+	e->tag = EXIF_TAG_INTEROPERABILITY_INDEX;
+	e->format = EXIF_FORMAT_ASCII;
+	e->components = e->size = 4;
+	e->data = malloc (e->size);
+	memcpy (e->data, "R98", 4);
+	exif_content_add_entry (d->ifd[EXIF_IFD_INTEROPERABILITY], e);
+	exif_entry_unref (e);
+}
+
+/* IFD 0, EXIF, Interoperability and IFD 1 with the mandatory tags, a few
+ * more, and a thumbnail */
+static unsigned char *
+make_sample (unsigned int *size)
+{
+	ExifData *d = exif_data_new ();
+	unsigned char *buf;
+
+	d->size = THUMBNAIL_SIZE;
+	d->data = malloc (d->size);
+	memset (d->data, 0x5a, d->size);
+	exif_data_set_data_type (d, EXIF_DATA_TYPE_COMPRESSED);
+	exif_data_fix (d);
+	add_entry (d, EXIF_IFD_0, EXIF_TAG_MAKE);
+	add_entry (d, EXIF_IFD_0, EXIF_TAG_ORIENTATION);
+	add_entry (d, EXIF_IFD_0, EXIF_TAG_DATE_TIME);
+	add_entry (d, EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL);
+	add_entry (d, EXIF_IFD_EXIF, EXIF_TAG_FLASH);
+	add_index (d);
+	exif_set_short (exif_content_get_entry (d->ifd[EXIF_IFD_0],
+			EXIF_TAG_ORIENTATION)->data,
+			exif_data_get_byte_order (d), 6);
+	exif_data_save_data (d, &buf, size);
+	exif_data_unref (d);
+	return buf;
+}
+
+int
+main (void)
+{
+	static const ExifTag tags[] = {
+		EXIF_TAG_ORIENTATION, EXIF_TAG_DATE_TIME_ORIGINAL
+	};
+	ExifData *full, *d;
+	ExifEntry *e;
+	unsigned char *buf;
+	unsigned int size, i;
+
+	buf = make_sample (&size);
+	if (!buf || !size) {
+		printf ("Error saving the sample\n");
+		return 13;
+	}
+	full = exif_data_new_from_data (buf, size);
+	for (i = 0; i < EXIF_IFD_COUNT; i++)
+		CHECK ((i == EXIF_IFD_GPS) == !full->ifd[i]->count);
+
+	printf ("Loading IFD 1, Orientation and DateTimeOriginal...\n");
+	d = exif_data_new ();
+	exif_data_set_load_filter (d, EXIF_DATA_LOAD_IFD (EXIF_IFD_1),
+				   tags, sizeof (tags) / sizeof (tags[0]));
+	exif_data_load_data (d, buf, size);
+
+	CHECK (d->ifd[EXIF_IFD_0]->count == 1);
+	e = exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_ORIENTATION);
+	CHECK (e && exif_get_short (e->data, exif_data_get_byte_order (d)) == 6);
+	CHECK (!exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_MAKE));
+	CHECK (!exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_DATE_TIME));
+
+	CHECK (d->ifd[EXIF_IFD_EXIF]->count == 1);
+	CHECK (exif_content_get_entry (d->ifd[EXIF_IFD_EXIF],
+				       EXIF_TAG_DATE_TIME_ORIGINAL));
+	CHECK (!exif_content_get_entry (d->ifd[EXIF_IFD_EXIF], EXIF_TAG_FLASH));
+	CHECK (d->ifd[EXIF_IFD_INTEROPERABILITY]->count == 0);
+
+	/* IFD 1 was asked for in full, with the thumbnail */
+	CHECK (d->ifd[EXIF_IFD_1]->count == full->ifd[EXIF_IFD_1]->count);
+	CHECK (d->size == THUMBNAIL_SIZE && d->data && d->data[0] == 0x5a);
+
+	printf ("Loading the skipped IFDs...\n");
+	exif_data_load_ifd (d, EXIF_IFD_0, buf, size);
+	CHECK (d->ifd[EXIF_IFD_0]->count == full->ifd[EXIF_IFD_0]->count);
+	CHECK (exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_MAKE));
+	CHECK (exif_content_get_entry (d->ifd[EXIF_IFD_0], EXIF_TAG_DATE_TIME));
+	/* only IFD 0 itself */
+	CHECK (d->ifd[EXIF_IFD_EXIF]->count == 1);
+
+	exif_data_load_ifd (d, EXIF_IFD_EXIF, buf, size);
+	CHECK (d->ifd[EXIF_IFD_EXIF]->count == full->ifd[EXIF_IFD_EXIF]->count);
+	CHECK (exif_content_get_entry (d->ifd[EXIF_IFD_EXIF], EXIF_TAG_FLASH));
+	CHECK (d->ifd[EXIF_IFD_INTEROPERABILITY]->count == 0);
+
+	exif_data_load_ifd (d, EXIF_IFD_INTEROPERABILITY, buf, size);
+	CHECK (d->ifd[EXIF_IFD_INTEROPERABILITY]->count ==
+	       full->ifd[EXIF_IFD_INTEROPERABILITY]->count);
+
+	/* loading an IFD again adds nothing */
+	exif_data_load_ifd (d, EXIF_IFD_0, buf, size);
+	CHECK (d->ifd[EXIF_IFD_0]->count == full->ifd[EXIF_IFD_0]->count);
+
+	exif_data_unref (d);
+	exif_data_unref (full);
+	free (buf);
+
+	return rc;
+}
@@ -0,0 +1,95 @@
+/* test-save-buf.c
+ *
+ * Saves EXIF data with exif_data_save_data_buf into no buffer, a buffer
+ * one byte too small and one of the exact size, and checks it against
+ * what exif_data_save_data gives.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA  02110-1301  USA.
+ */
+
+#include <libexif/exif-data.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int rc = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf ("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		rc = 1; \
+	} \
+} while (0)
+
+static int
+untouched (const unsigned char *buf, unsigned int size)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		if (buf[i] != 0xa5)
+			return 0;
+	return 1;
+}
+
+int
+main (void)
+{
+	ExifData *d;
+	unsigned char *eb, *buf;
+	unsigned int ebs, size;
+
+	d = exif_data_new ();
+	exif_data_set_data_type (d, EXIF_DATA_TYPE_COMPRESSED);
+	d->size = 300;
+	d->data = malloc (d->size);
+	memset (d->data, 0x5a, d->size);
+	exif_data_fix (d);
+
+	exif_data_save_data (d, &eb, &ebs);
+	if (!eb || !ebs) {
+		printf ("Error running exif_data_save_data()\n");
+		exit (13);
+	}
+	printf ("exif_data_save_data gives %u byte(s)\n", ebs);
+
+	/* the size only */
+	size = exif_data_save_data_buf (d, NULL, 0);
+	CHECK (size == ebs);
+	CHECK (exif_data_save_data_buf (d, NULL, 2 * ebs) == ebs);
+
+	/* one byte short: the size, and nothing written */
+	buf = malloc (ebs - 1);
+	memset (buf, 0xa5, ebs - 1);
+	CHECK (exif_data_save_data_buf (d, buf, ebs - 1) == ebs);
+	CHECK (untouched (buf, ebs - 1));
+	free (buf);
+
+	/* exactly right */
+	buf = malloc (ebs);
+	memset (buf, 0xa5, ebs);
+	CHECK (exif_data_save_data_buf (d, buf, ebs) == ebs);
+	CHECK (!memcmp (buf, eb, ebs));
+	free (buf);
+
+	CHECK (exif_data_save_data_buf (NULL, NULL, 0) == 0);
+
+	free (eb);
+	exif_data_unref (d);
+
+	return rc;
+}
@@ -19,6 +19,9 @@
 #include <string.h>
 #include <sys/types.h>
 #include <sys/poll.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sched.h>
 #include <unistd.h>
 #include <Errors.h>
 
@@ -29,6 +32,15 @@
 
 #include "MessageQueue.h"
 
+///Number of polls of an empty ring before the consumer goes to sleep on the eventfd
+#define MSGQ_RING_SPIN_COUNT 512
+
+///Size hint for the epoll instance of a MessageQueueWaiter
+#define MSGQ_WAITER_SIZE_HINT 16
+
+///Maximum number of pipe queues reported by a single MessageQueueWaiter::wait()
+#define MSGQ_WAITER_MAX_EVENTS 32
+
 namespace TIUTILS {
 
 /**
@@ -41,9 +53,53 @@ MessageQueue::MessageQueue()
 {
     LOG_FUNCTION_NAME;
 
+    initPipe();
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+/**
+   @brief Constructor for the message queue class with an explicit transport
+
+   @param backend Transport used to move the messages
+   @param capacity Number of message slots of a BACKEND_RING queue, rounded up to a power of two
+   @return none
+ */
+MessageQueue::MessageQueue(Backend backend, unsigned int capacity)
+{
+    LOG_FUNCTION_NAME;
+
+    if ( BACKEND_RING == backend )
+        {
+        initRing(capacity);
+        }
+    else
+        {
+        initPipe();
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+/**
+   @brief Creates the pipe used by a BACKEND_PIPE queue
+
+   @param none
+   @return none
+ */
+void MessageQueue::initPipe()
+{
     int fds[2] = {-1,-1};
     android::status_t stat;
 
+    mBackend = BACKEND_PIPE;
+    mRing = NULL;
+    mRingMask = 0;
+    mRingHead = 0;
+    mRingTail = 0;
+    mRingWaiting = 0;
+    mRingSpin = 0;
+
     stat = pipe(fds);
 
     if ( 0 > stat )
@@ -60,8 +116,43 @@ MessageQueue::MessageQueue()
 
         mHasMsg = false;
         }
+}
 
-    LOG_FUNCTION_NAME_EXIT;
+/**
+   @brief Allocates the ring and the wakeup eventfd used by a BACKEND_RING queue
+
+   The eventfd is the queue input descriptor, so waitForMsg() and external
+   poll loops keep working. It is only written while the consumer waits on it.
+
+   @param capacity Number of message slots, rounded up to a power of two
+   @return none
+ */
+void MessageQueue::initRing(unsigned int capacity)
+{
+    uint32_t slots = 1;
+
+    mBackend = BACKEND_RING;
+    mRingHead = 0;
+    mRingTail = 0;
+    mRingWaiting = 0;
+    mHasMsg = false;
+    this->fd_write = -1;
+
+    while ( ( slots < capacity ) && ( slots < 0x80000000U ) )
+        {
+        slots <<= 1;
+        }
+
+    mRingMask = slots - 1;
+    mRing = new Message[slots];
+    mRingSpin = ( sysconf(_SC_NPROCESSORS_CONF) > 1 ) ? MSGQ_RING_SPIN_COUNT : 0;
+
+    this->fd_read = eventfd(0, EFD_NONBLOCK);
+    if ( 0 > this->fd_read )
+        {
+        MSGQ_LOGEB("Error while creating eventfd: %s", strerror(errno) );
+        this->fd_read = 0;
+        }
 }
 
 /**
@@ -84,6 +175,12 @@ MessageQueue::~MessageQueue()
         close(this->fd_write);
         }
 
+    if(mRing)
+        {
+        delete [] mRing;
+        mRing = NULL;
+        }
+
     LOG_FUNCTION_NAME_EXIT;
 }
 
@@ -114,6 +211,14 @@ android::status_t MessageQueue::get(Message* msg)
         return android::NO_INIT;
         }
 
+    if ( BACKEND_RING == mBackend )
+        {
+        unsigned int count;
+        android::status_t ret = ringGet(msg, 1, &count);
+        LOG_FUNCTION_NAME_EXIT;
+        return ret;
+        }
+
     char* p = (char*) msg;
     size_t read_bytes = 0;
 
@@ -164,6 +269,13 @@ void MessageQueue::setInFd(int fd)
 {
     LOG_FUNCTION_NAME;
 
+    if ( BACKEND_RING == mBackend )
+        {
+        MSGQ_LOGEA("input descriptor of a ring backed message queue cannot be replaced");
+        LOG_FUNCTION_NAME_EXIT;
+        return;
+        }
+
     if ( -1 != this->fd_read )
         {
         close(this->fd_read);
@@ -198,6 +310,13 @@ android::status_t MessageQueue::put(Message* msg)
         return android::BAD_VALUE;
         }
 
+    if ( BACKEND_RING == mBackend )
+        {
+        android::status_t ret = ringPut(msg, 1);
+        LOG_FUNCTION_NAME_EXIT;
+        return ret;
+        }
+
     if(!this->fd_write)
         {
         MSGQ_LOGEA("write descriptor not initialized for message queue");
@@ -231,6 +350,146 @@ android::status_t MessageQueue::put(Message* msg)
 }
 
 
+/**
+   @brief Get a batch of messages from the queue
+
+   Blocks until at least one message is available, then returns every queued
+   message up to maxCount without blocking again.
+
+   @param msgs Message array to hold the retrieved messages
+   @param maxCount Number of entries of msgs
+   @param count Number of messages retrieved
+   @return android::NO_ERROR On success
+   @return android::BAD_VALUE if msgs or count is NULL, or maxCount is 0
+   @return android::NO_INIT If the file read descriptor is not set
+   @return android::UNKNOWN_ERROR if the read operation from the file read descriptor fails
+ */
+android::status_t MessageQueue::getBatch(Message* msgs, unsigned int maxCount, unsigned int *count)
+{
+    LOG_FUNCTION_NAME;
+
+    if( !msgs || !count || ( 0 == maxCount ) )
+        {
+        MSGQ_LOGEA("invalid batch");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::BAD_VALUE;
+        }
+
+    *count = 0;
+
+    if(!this->fd_read)
+        {
+        MSGQ_LOGEA("read descriptor not initialized for message queue");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::NO_INIT;
+        }
+
+    if ( BACKEND_RING == mBackend )
+        {
+        android::status_t ret = ringGet(msgs, maxCount, count);
+        LOG_FUNCTION_NAME_EXIT;
+        return ret;
+        }
+
+    char* p = (char*) msgs;
+    size_t read_bytes = 0;
+
+    ///One read() takes whatever is in the pipe, only a trailing partial message is waited for
+    while( ( 0 == read_bytes ) || ( 0 != ( read_bytes % sizeof(*msgs) ) ) )
+        {
+        size_t want = ( 0 == read_bytes ) ?
+                      ( maxCount * sizeof(*msgs) ) :
+                      ( sizeof(*msgs) - ( read_bytes % sizeof(*msgs) ) );
+        int err = read(this->fd_read, p + read_bytes, want);
+
+        if( err < 0 )
+            {
+            MSGQ_LOGEB("read() error: %s", strerror(errno));
+            LOG_FUNCTION_NAME_EXIT;
+            return android::UNKNOWN_ERROR;
+            }
+        else
+            {
+            read_bytes += err;
+            }
+        }
+
+    *count = read_bytes / sizeof(*msgs);
+
+    MSGQ_LOGDB("MQ.getBatch(%u)", *count);
+
+    mHasMsg = false;
+
+    LOG_FUNCTION_NAME_EXIT;
+
+    return android::NO_ERROR;
+}
+
+/**
+   @brief Queue a batch of messages
+
+   On a pipe backed queue the batch is a single write(). Batches larger than
+   PIPE_BUF bytes may interleave with messages of other producers.
+
+   @param msgs Messages to be queued
+   @param count Number of messages in msgs
+   @return android::NO_ERROR On success
+   @return android::BAD_VALUE if msgs is NULL
+   @return android::NO_INIT If the file write descriptor is not set
+   @return android::UNKNOWN_ERROR if the write operation to the file write descriptor fails
+ */
+android::status_t MessageQueue::putBatch(Message* msgs, unsigned int count)
+{
+    LOG_FUNCTION_NAME;
+
+    if(!msgs)
+        {
+        MSGQ_LOGEA("msgs is NULL");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::BAD_VALUE;
+        }
+
+    if ( BACKEND_RING == mBackend )
+        {
+        android::status_t ret = ringPut(msgs, count);
+        LOG_FUNCTION_NAME_EXIT;
+        return ret;
+        }
+
+    if(!this->fd_write)
+        {
+        MSGQ_LOGEA("write descriptor not initialized for message queue");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::NO_INIT;
+        }
+
+    MSGQ_LOGDB("MQ.putBatch(%u)", count);
+
+    char* p = (char*) msgs;
+    size_t bytes = 0;
+    size_t total = count * sizeof(*msgs);
+
+    while( bytes < total )
+        {
+        int err = write(this->fd_write, p + bytes, total - bytes);
+
+        if( err < 0 )
+            {
+            MSGQ_LOGEB("write() error: %s", strerror(errno));
+            LOG_FUNCTION_NAME_EXIT;
+            return android::UNKNOWN_ERROR;
+            }
+        else
+            {
+            bytes += err;
+            }
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+    return android::NO_ERROR;
+}
+
+
 /**
    @brief Returns if the message queue is empty or not
 
@@ -255,6 +514,12 @@ bool MessageQueue::isEmpty()
         return android::NO_INIT;
         }
 
+    if ( BACKEND_RING == mBackend )
+        {
+        mHasMsg = !ringEmpty();
+        LOG_FUNCTION_NAME_EXIT;
+        return !mHasMsg;
+        }
 
     if( -1 == poll(&pfd,1,0) )
         {
@@ -355,7 +620,38 @@ android::status_t MessageQueue::waitForMsg(MessageQueue *queue1, MessageQueue *q
         }
 
 
-    int ret = poll(pfd, n, timeout);
+    ///Ring backed queues only signal their eventfd while the consumer is marked
+    ///as waiting, so arm them first and skip the poll if one already has a message
+    MessageQueue *queues[3] = { queue1, queue2, queue3 };
+    bool armed[3] = { false, false, false };
+    int ready = 0;
+
+    for ( int i = 0 ; i < 3 ; i++ )
+        {
+        if ( ( NULL != queues[i] ) && ( BACKEND_RING == queues[i]->mBackend ) )
+            {
+            armed[i] = queues[i]->ringPrepareWait();
+            if ( !armed[i] )
+                {
+                ready++;
+                }
+            }
+        }
+
+    int ret = ready;
+    if ( 0 == ready )
+        {
+        ret = poll(pfd, n, timeout);
+        }
+
+    for ( int i = 0 ; i < 3 ; i++ )
+        {
+        if ( armed[i] )
+            {
+            queues[i]->ringFinishWait();
+            }
+        }
+
     if(ret==0)
         {
         LOG_FUNCTION_NAME_EXIT;
@@ -390,8 +686,424 @@ android::status_t MessageQueue::waitForMsg(MessageQueue *queue1, MessageQueue *q
             }
         }
 
+    ///A ring eventfd can carry a stale wakeup, report what the ring really holds
+    for ( int i = 0 ; i < 3 ; i++ )
+        {
+        if ( ( NULL != queues[i] ) && ( BACKEND_RING == queues[i]->mBackend ) )
+            {
+            queues[i]->setMsg(!queues[i]->ringEmpty());
+            }
+        }
+
     LOG_FUNCTION_NAME_EXIT;
     return ret;
     }
 
+/**
+   @brief Queue messages into the ring of a BACKEND_RING queue
+
+   Only one thread may put into a ring backed queue. The eventfd is written
+   only when the consumer announced that it is about to block on it, so a
+   batch costs at most one wakeup.
+
+   @param msgs Messages to be queued
+   @param count Number of messages in msgs
+   @return android::NO_ERROR On success
+   @return android::UNKNOWN_ERROR if the consumer wakeup could not be signalled
+ */
+android::status_t MessageQueue::ringPut(Message* msgs, unsigned int count)
+{
+    uint32_t head = mRingHead;
+    unsigned int done = 0;
+
+    while ( done < count )
+        {
+        uint32_t space = mRingMask + 1 - ( head - mRingTail );
+
+        ///Ring full, the consumer releases slots without any syscall so just yield to it
+        if ( 0 == space )
+            {
+            sched_yield();
+            continue;
+            }
+
+        ///Do not overwrite the slots before the consumer is done reading them
+        __sync_synchronize();
+
+        for ( ; ( space > 0 ) && ( done < count ) ; space--, done++, head++ )
+            {
+            MSGQ_LOGDB("MQ.put(%d,%p,%p,%p,%p)", msgs[done].command, msgs[done].arg1,msgs[done].arg2,msgs[done].arg3,msgs[done].arg4);
+            mRing[head & mRingMask] = msgs[done];
+            }
+
+        ///Publish the slot contents before the new head
+        __sync_synchronize();
+        mRingHead = head;
+
+        ///Pairs with ringPrepareWait(): either the consumer sees the new head, or we see it waiting
+        __sync_synchronize();
+
+        ///Only the first put after the consumer went to sleep pays for the wakeup
+        if ( mRingWaiting && __sync_bool_compare_and_swap(&mRingWaiting, 1, 0) )
+            {
+            uint64_t one = 1;
+
+            if ( sizeof(one) != write(this->fd_read, &one, sizeof(one)) )
+                {
+                MSGQ_LOGEB("eventfd write() error: %s", strerror(errno));
+                return android::UNKNOWN_ERROR;
+                }
+            }
+        }
+
+    return android::NO_ERROR;
+}
+
+/**
+   @brief Get messages from the ring of a BACKEND_RING queue, blocking while it is empty
+
+   @param msgs Message array to hold the retrieved messages
+   @param maxCount Number of entries of msgs
+   @param count Number of messages retrieved, at least one on success
+   @return android::NO_ERROR On success
+   @return android::UNKNOWN_ERROR if waiting on the eventfd fails
+ */
+android::status_t MessageQueue::ringGet(Message* msgs, unsigned int maxCount, unsigned int *count)
+{
+    uint32_t tail = mRingTail;
+    uint32_t avail;
+    unsigned int done;
+
+    ///A producer that is already running usually publishes within a few hundred
+    ///cycles, spinning that long is much cheaper than a sleep/wakeup pair.
+    ///There is nobody to wait for on a single core, see initRing()
+    for ( int spin = 0 ; ( spin < mRingSpin ) && ringEmpty() ; spin++ )
+        {
+        __sync_synchronize();
+        }
+
+    while ( ringPrepareWait() )
+        {
+        struct pollfd pfd;
+
+        pfd.fd = this->fd_read;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int err = poll(&pfd, 1, -1);
+
+        ringFinishWait();
+
+        if ( ( 0 > err ) && ( EINTR != errno ) )
+            {
+            MSGQ_LOGEB("poll() error: %s", strerror(errno));
+            return android::UNKNOWN_ERROR;
+            }
+        }
+
+    avail = mRingHead - tail;
+
+    ///Do not read the slots before the producer published them
+    __sync_synchronize();
+
+    for ( done = 0 ; ( done < avail ) && ( done < maxCount ) ; done++, tail++ )
+        {
+        msgs[done] = mRing[tail & mRingMask];
+        MSGQ_LOGDB("MQ.get(%d,%p,%p,%p,%p)", msgs[done].command, msgs[done].arg1,msgs[done].arg2,msgs[done].arg3,msgs[done].arg4);
+        }
+
+    ///Release the slots only once they have been copied out
+    __sync_synchronize();
+    mRingTail = tail;
+
+    mHasMsg = !ringEmpty();
+    *count = done;
+
+    return android::NO_ERROR;
+}
+
+/**
+   @brief Returns if the ring of a BACKEND_RING queue is empty, without any syscall
+
+   @param none
+   @return true If the ring is empty
+ */
+bool MessageQueue::ringEmpty()
+{
+    return ( mRingHead == mRingTail );
+}
+
+/**
+   @brief Marks the consumer as waiting on the eventfd of a BACKEND_RING queue
+
+   @param none
+   @return true If the ring is empty and the consumer may block on the eventfd
+   @return false If a message is already available, the consumer is not marked as waiting
+ */
+bool MessageQueue::ringPrepareWait()
+{
+    if ( !ringEmpty() )
+        {
+        return false;
+        }
+
+    mRingWaiting = 1;
+
+    ///Pairs with ringPut(): publish the flag before checking the head again
+    __sync_synchronize();
+
+    if ( !ringEmpty() )
+        {
+        mRingWaiting = 0;
+        return false;
+        }
+
+    return true;
+}
+
+/**
+   @brief Clears the waiting state of a BACKEND_RING queue and consumes any pending wakeup
+
+   @param none
+   @return none
+ */
+void MessageQueue::ringFinishWait()
+{
+    uint64_t count;
+
+    mRingWaiting = 0;
+
+    ///The eventfd is non-blocking, this fails with EAGAIN when nothing was signalled
+    read(this->fd_read, &count, sizeof(count));
+}
+
+/**
+   @brief Constructor for the message queue waiter class
+
+   @param none
+   @return none
+ */
+MessageQueueWaiter::MessageQueueWaiter()
+{
+    LOG_FUNCTION_NAME;
+
+    mEpollFd = epoll_create(MSGQ_WAITER_SIZE_HINT);
+    if ( 0 > mEpollFd )
+        {
+        MSGQ_LOGEB("Error while creating epoll instance: %s", strerror(errno) );
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+/**
+   @brief Destructor for the message queue waiter class
+
+   The registered queues are not owned by the waiter and are left untouched.
+
+   @param none
+   @return none
+ */
+MessageQueueWaiter::~MessageQueueWaiter()
+{
+    LOG_FUNCTION_NAME;
+
+    if ( 0 <= mEpollFd )
+        {
+        close(mEpollFd);
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+}
+
+/**
+   @brief Register a queue with the waiter
+
+   @param queue Queue to register, it must outlive its registration
+   @return android::NO_ERROR On success
+   @return android::BAD_VALUE If queue is NULL
+   @return android::NO_INIT If the waiter or the queue descriptor is not initialized
+   @return android::ALREADY_EXISTS If the queue is already registered
+ */
+android::status_t MessageQueueWaiter::add(MessageQueue *queue)
+{
+    LOG_FUNCTION_NAME;
+
+    struct epoll_event ev;
+
+    if ( !queue )
+        {
+        MSGQ_LOGEA("queue pointer is NULL");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::BAD_VALUE;
+        }
+
+    if ( ( 0 > mEpollFd ) || !queue->getInFd() )
+        {
+        MSGQ_LOGEA("waiter or message queue not initialized");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::NO_INIT;
+        }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = queue;
+
+    if ( 0 > epoll_ctl(mEpollFd, EPOLL_CTL_ADD, queue->getInFd(), &ev) )
+        {
+        MSGQ_LOGEB("epoll_ctl(ADD) error: %s", strerror(errno));
+        LOG_FUNCTION_NAME_EXIT;
+        return ( EEXIST == errno ) ? android::ALREADY_EXISTS : android::UNKNOWN_ERROR;
+        }
+
+    mQueues.add(queue);
+    if ( MessageQueue::BACKEND_RING == queue->mBackend )
+        {
+        mRingQueues.add(queue);
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+    return android::NO_ERROR;
+}
+
+/**
+   @brief Unregister a queue from the waiter
+
+   @param queue Queue to unregister
+   @return android::NO_ERROR On success
+   @return android::NAME_NOT_FOUND If the queue is not registered
+ */
+android::status_t MessageQueueWaiter::remove(MessageQueue *queue)
+{
+    LOG_FUNCTION_NAME;
+
+    struct epoll_event ev;
+    bool found = false;
+
+    for ( size_t i = 0 ; i < mQueues.size() ; i++ )
+        {
+        if ( mQueues[i] == queue )
+            {
+            mQueues.removeAt(i);
+            found = true;
+            break;
+            }
+        }
+
+    if ( !found )
+        {
+        LOG_FUNCTION_NAME_EXIT;
+        return android::NAME_NOT_FOUND;
+        }
+
+    for ( size_t i = 0 ; i < mRingQueues.size() ; i++ )
+        {
+        if ( mRingQueues[i] == queue )
+            {
+            mRingQueues.removeAt(i);
+            break;
+            }
+        }
+
+    ///Kernels before 2.6.9 require a non-NULL event for EPOLL_CTL_DEL
+    memset(&ev, 0, sizeof(ev));
+    if ( 0 > epoll_ctl(mEpollFd, EPOLL_CTL_DEL, queue->getInFd(), &ev) )
+        {
+        MSGQ_LOGEB("epoll_ctl(DEL) error: %s", strerror(errno));
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+    return android::NO_ERROR;
+}
+
+/**
+   @brief Wait until at least one registered queue has a message
+
+   Every queue returned in ready has its message flag set, see hasMsg().
+
+   @param ready Array receiving the queues that have at least one message
+   @param maxReady Number of entries of ready
+   @param timeout The timeout value (in milli secs), -1 waits forever
+   @return Number of queues stored in ready, 0 on timeout
+   @return android::BAD_VALUE If ready is NULL or maxReady is 0
+   @return android::NO_INIT If the waiter is not initialized
+   @return android::UNKNOWN_ERROR If epoll_wait() fails
+ */
+int MessageQueueWaiter::wait(MessageQueue **ready, unsigned int maxReady, int timeout)
+{
+    LOG_FUNCTION_NAME;
+
+    struct epoll_event events[MSGQ_WAITER_MAX_EVENTS];
+    unsigned int nready = 0;
+    bool ringReady = false;
+    int ret;
+
+    if ( !ready || ( 0 == maxReady ) )
+        {
+        MSGQ_LOGEA("invalid ready array");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::BAD_VALUE;
+        }
+
+    if ( 0 > mEpollFd )
+        {
+        MSGQ_LOGEA("waiter not initialized");
+        LOG_FUNCTION_NAME_EXIT;
+        return android::NO_INIT;
+        }
+
+    ///Ring queues only signal while armed, a ring that already holds a
+    ///message turns the wait into a non-blocking sweep of the pipe queues
+    mArmed.clear();
+    for ( size_t i = 0 ; i < mRingQueues.size() ; i++ )
+        {
+        mArmed.add(mRingQueues[i]->ringPrepareWait());
+        if ( !mArmed[i] )
+            {
+            ringReady = true;
+            }
+        }
+
+    ret = epoll_wait(mEpollFd, events, MSGQ_WAITER_MAX_EVENTS, ringReady ? 0 : timeout);
+
+    for ( size_t i = 0 ; i < mRingQueues.size() ; i++ )
+        {
+        if ( mArmed[i] )
+            {
+            mRingQueues[i]->ringFinishWait();
+            }
+        }
+
+    if ( ( 0 > ret ) && ( EINTR != errno ) )
+        {
+        MSGQ_LOGEB("epoll_wait() error: %s", strerror(errno));
+        LOG_FUNCTION_NAME_EXIT;
+        return android::UNKNOWN_ERROR;
+        }
+
+    for ( int i = 0 ; ( i < ret ) && ( nready < maxReady ) ; i++ )
+        {
+        MessageQueue *queue = (MessageQueue *) events[i].data.ptr;
+
+        ///Ring readiness is read from the ring itself below
+        if ( MessageQueue::BACKEND_PIPE == queue->mBackend )
+            {
+            queue->setMsg(true);
+            ready[nready++] = queue;
+            }
+        }
+
+    for ( size_t i = 0 ; ( i < mRingQueues.size() ) && ( nready < maxReady ) ; i++ )
+        {
+        if ( !mRingQueues[i]->ringEmpty() )
+            {
+            mRingQueues[i]->setMsg(true);
+            ready[nready++] = mRingQueues[i];
+            }
+        }
+
+    LOG_FUNCTION_NAME_EXIT;
+    return nready;
+}
+
 };
@@ -21,6 +21,7 @@
 
 #include "DebugUtils.h"
 #include <stdint.h>
+#include <utils/Vector.h>
 
 ///Uncomment this macro to debug the message queue implementation
 //#define DEBUG_LOG
@@ -60,12 +61,26 @@ struct Message
     int64_t     id;
 };
 
+///Default number of slots of a ring backed message queue (must be a power of two)
+#define MSGQ_RING_DEFAULT_CAPACITY 256
+
 ///Message queue implementation
 class MessageQueue
 {
 public:
 
+    ///Transport used to move messages from the producer to the consumer
+    enum Backend
+        {
+        ///pipe() with a write()/read() pair per message, any number of producers
+        BACKEND_PIPE = 0,
+        ///Lock-free ring for a single producer and a single consumer, the eventfd
+        ///returned by getInFd() is only signalled while the consumer is waiting
+        BACKEND_RING
+        };
+
     MessageQueue();
+    MessageQueue(Backend backend, unsigned int capacity = MSGQ_RING_DEFAULT_CAPACITY);
     ~MessageQueue();
 
     ///Get a message from the queue
@@ -80,6 +95,12 @@ public:
     ///Queue a message
     android::status_t put(Message*);
 
+    ///Get between one and maxCount messages, blocking until at least one is available
+    android::status_t getBatch(Message* msgs, unsigned int maxCount, unsigned int *count);
+
+    ///Queue count messages in one operation
+    android::status_t putBatch(Message* msgs, unsigned int count);
+
     ///Returns if the message queue is empty or not
     bool isEmpty();
 
@@ -94,10 +115,68 @@ public:
       return mHasMsg;
     }
 
+    ///Returns the transport used by this queue
+    Backend getBackend()
+    {
+      return mBackend;
+    }
+
 private:
+    friend class MessageQueueWaiter;
+
+    void initPipe();
+    void initRing(unsigned int capacity);
+
+    android::status_t ringPut(Message* msgs, unsigned int count);
+    android::status_t ringGet(Message* msgs, unsigned int maxCount, unsigned int *count);
+    bool ringEmpty();
+    bool ringPrepareWait();
+    void ringFinishWait();
+
     int fd_read;
     int fd_write;
     bool mHasMsg;
+
+    Backend mBackend;
+
+    ///Ring storage, only used by BACKEND_RING
+    Message *mRing;
+    uint32_t mRingMask;
+    ///Next slot to write, only modified by the producer
+    volatile uint32_t mRingHead;
+    ///Next slot to read, only modified by the consumer
+    volatile uint32_t mRingTail;
+    ///Set by the consumer before it blocks on the eventfd
+    volatile int32_t mRingWaiting;
+    ///Number of polls of an empty ring before the consumer blocks
+    int mRingSpin;
+};
+
+///Waits on any number of message queues registered once through epoll
+class MessageQueueWaiter
+{
+public:
+
+    MessageQueueWaiter();
+    ~MessageQueueWaiter();
+
+    ///Register a queue with the waiter
+    android::status_t add(MessageQueue *queue);
+
+    ///Unregister a queue from the waiter
+    android::status_t remove(MessageQueue *queue);
+
+    ///Wait with a timeout (in milli secs) until at least one registered queue has a message
+    int wait(MessageQueue **ready, unsigned int maxReady, int timeout = -1);
+
+private:
+    int mEpollFd;
+    ///All registered queues
+    android::Vector<MessageQueue *> mQueues;
+    ///Registered ring queues, armed before every wait
+    android::Vector<MessageQueue *> mRingQueues;
+    ///Which ring queues were armed by the current wait()
+    android::Vector<bool> mArmed;
 };
 
 };
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Micro-benchmark comparing the pipe and ring transports of TIUTILS::MessageQueue.
+ *
+ *   msgqbench [messages] [round trips]
+ *
+ * Throughput: one thread puts <messages> messages while another gets them.
+ * Wakeup latency: a message is bounced between two threads through two queues,
+ * the receiving side always sleeping in waitForMsg() before it arrives.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <Errors.h>
+
+#define LOG_TAG "MessageQueueBenchmark"
+#include <utils/Log.h>
+
+#include "MessageQueue.h"
+
+using namespace TIUTILS;
+
+#define BENCH_DEFAULT_MESSAGES      1000000
+#define BENCH_DEFAULT_ROUNDTRIPS    10000
+#define BENCH_CMD_PING              1
+#define BENCH_CMD_EXIT              2
+
+struct BenchContext
+{
+    MessageQueue *request;
+    MessageQueue *reply;
+    int count;
+};
+
+static int64_t bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *bench_producer(void *arg)
+{
+    BenchContext *ctx = (BenchContext *) arg;
+    Message msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.command = BENCH_CMD_PING;
+
+    for ( int i = 0 ; i < ctx->count ; i++ )
+        {
+        msg.id = i;
+        ctx->request->put(&msg);
+        }
+
+    return NULL;
+}
+
+static void *bench_echo(void *arg)
+{
+    BenchContext *ctx = (BenchContext *) arg;
+    Message msg;
+
+    for ( ;; )
+        {
+        MessageQueue::waitForMsg(ctx->request, NULL, NULL, -1);
+        if ( ctx->request->isEmpty() )
+            {
+            continue;
+            }
+
+        ctx->request->get(&msg);
+        if ( BENCH_CMD_EXIT == msg.command )
+            {
+            break;
+            }
+
+        ctx->reply->put(&msg);
+        }
+
+    return NULL;
+}
+
+static double bench_throughput(MessageQueue::Backend backend, int count)
+{
+    MessageQueue queue(backend);
+    BenchContext ctx;
+    pthread_t producer;
+    Message msg;
+    int64_t start, end;
+
+    ctx.request = &queue;
+    ctx.reply = NULL;
+    ctx.count = count;
+
+    start = bench_now_ns();
+    pthread_create(&producer, NULL, bench_producer, &ctx);
+
+    for ( int i = 0 ; i < count ; i++ )
+        {
+        queue.get(&msg);
+        if ( msg.id != i )
+            {
+            fprintf(stderr, "out of order message %lld, expected %d\n", (long long) msg.id, i);
+            }
+        }
+
+    end = bench_now_ns();
+    pthread_join(producer, NULL);
+
+    return (double) count * 1000000000.0 / (double) (end - start);
+}
+
+static double bench_latency(MessageQueue::Backend backend, int count)
+{
+    MessageQueue request(backend);
+    MessageQueue reply(backend);
+    BenchContext ctx;
+    pthread_t echo;
+    Message msg;
+    struct timespec pause;
+    int64_t total = 0;
+
+    ctx.request = &request;
+    ctx.reply = &reply;
+    ctx.count = count;
+
+    memset(&msg, 0, sizeof(msg));
+    pthread_create(&echo, NULL, bench_echo, &ctx);
+
+    ///Give the echo thread time to fall asleep so every send measures a real wakeup
+    pause.tv_sec = 0;
+    pause.tv_nsec = 50000;
+
+    for ( int i = 0 ; i < count ; i++ )
+        {
+        int64_t start;
+
+        nanosleep(&pause, NULL);
+
+        msg.command = BENCH_CMD_PING;
+        msg.id = i;
+        start = bench_now_ns();
+        request.put(&msg);
+
+        MessageQueue::waitForMsg(&reply, NULL, NULL, -1);
+        reply.get(&msg);
+        total += bench_now_ns() - start;
+        }
+
+    msg.command = BENCH_CMD_EXIT;
+    request.put(&msg);
+    pthread_join(echo, NULL);
+
+    ///One round trip is two wakeups
+    return (double) total / (double) count / 2000.0;
+}
+
+int main(int argc, char **argv)
+{
+    int messages = BENCH_DEFAULT_MESSAGES;
+    int roundtrips = BENCH_DEFAULT_ROUNDTRIPS;
+    static const struct
+        {
+        MessageQueue::Backend backend;
+        const char *name;
+        } backends[] =
+        {
+            { MessageQueue::BACKEND_PIPE, "pipe" },
+            { MessageQueue::BACKEND_RING, "ring" },
+        };
+
+    if ( argc > 1 )
+        {
+        messages = atoi(argv[1]);
+        }
+
+    if ( argc > 2 )
+        {
+        roundtrips = atoi(argv[2]);
+        }
+
+    if ( ( messages <= 0 ) || ( roundtrips <= 0 ) )
+        {
+        fprintf(stderr, "usage: %s [messages] [round trips]\n", argv[0]);
+        return 1;
+        }
+
+    printf("%-8s %16s %20s\n", "backend", "messages/s", "wakeup latency (us)");
+
+    for ( unsigned int i = 0 ; i < sizeof(backends) / sizeof(backends[0]) ; i++ )
+        {
+        double rate = bench_throughput(backends[i].backend, messages);
+        double latency = bench_latency(backends[i].backend, roundtrips);
+
+        printf("%-8s %16.0f %20.2f\n", backends[i].name, rate, latency);
+        }
+
+    return 0;
+}
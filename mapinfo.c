@@ -5,6 +5,7 @@
 #include "mapinfo.h"
 
 extern void *__real_malloc(size_t size);
+extern void *__real_realloc(void *ptr, size_t size);
 extern void __real_free(void *ptr);
 
 #if 0
@@ -42,65 +43,161 @@ static mapinfo *parse_maps_line(char *line)
      */
     mi->next = 0;
     strcpy(mi->name, line + 49);
+    // Only calculate the relative offset for shared libraries
+    mi->rel_base = strstr(mi->name, ".so") ? mi->start : 0;
 
     return mi;
 }
 
-mapinfo *init_mapinfo(int pid)
+static int compare_start(const void *a, const void *b)
 {
-    struct mapinfo *milist = NULL;
+    const mapinfo *x = *(const mapinfo * const *)a;
+    const mapinfo *y = *(const mapinfo * const *)b;
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+/* Binary search of the current maps, which do not overlap */
+static const mapinfo *search(mapindex *index, unsigned pc)
+{
+    unsigned lo = 0, hi = index->num;
+    while(lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        const mapinfo *mi = index->sorted[mid];
+        if(pc < mi->start)
+            hi = mid;
+        else if(pc >= mi->end)
+            lo = mid + 1;
+        else
+            return mi;
+    }
+    return NULL;
+}
+
+/* Read the maps again.  Maps that did not change keep their mapinfo, new
+ * ones are added to the list of all maps; none are freed, callers may hold
+ * on to them.
+ */
+static void read_maps(mapindex *index)
+{
+    const mapinfo **sorted = NULL;
+    unsigned num = 0, size = 0;
     char data[1024];
-    sprintf(data, "/proc/%d/maps", pid);
-    FILE *fp = fopen(data, "r");
-    if(fp) {
-        while(fgets(data, sizeof(data), fp)) {
-            mapinfo *mi = parse_maps_line(data);
-            if(mi) {
-                mi->next = milist;
-                milist = mi;
-            }
+    FILE *fp;
+
+    clock_gettime(CLOCK_MONOTONIC, &index->read_time);
+    sprintf(data, "/proc/%d/maps", index->pid);
+    fp = fopen(data, "r");
+    if(!fp) return;
+
+    while(fgets(data, sizeof(data), fp)) {
+        mapinfo *mi = parse_maps_line(data);
+        const mapinfo *old;
+        if(!mi) continue;
+
+        old = search(index, mi->start);
+        if(old && old->start == mi->start && old->end == mi->end &&
+           !strcmp(old->name, mi->name)) {
+            __real_free(mi);
+        } else {
+            mi->next = index->all;
+            index->all = mi;
+            old = mi;
+        }
+
+        if(num == size) {
+            const mapinfo **grown;
+            size = size ? size * 2 : 64;
+            grown = __real_realloc(sorted, size * sizeof(*sorted));
+            if(!grown) break;
+            sorted = grown;
         }
-        fclose(fp);
+        sorted[num++] = old;
+    }
+    fclose(fp);
+
+    qsort(sorted, num, sizeof(*sorted), compare_start);
+    __real_free(index->sorted);
+    index->sorted = sorted;
+    index->num = num;
+    /* forget the pcs that were not found as well */
+    index->generation++;
+}
+
+mapindex *init_mapinfo(int pid)
+{
+    mapindex *index = __real_malloc(sizeof(mapindex));
+    if(index) {
+        memset(index, 0, sizeof(*index));
+        index->pid = pid;
+        pthread_mutex_init(&index->lock, NULL);
+        read_maps(index);
     }
 
-    return milist;
+    return index;
 }
 
-void deinit_mapinfo(mapinfo *mi)
+void deinit_mapinfo(mapindex *index)
 {
-   mapinfo *del;
+   mapinfo *del, *mi;
+   if(!index) return;
+   mi = index->all;
    while(mi) {
        del = mi;
        mi = mi->next;
        __real_free(del);
    }
+   __real_free(index->sorted);
+   pthread_mutex_destroy(&index->lock);
+   __real_free(index);
 }
 
-/* Map a pc address to the name of the containing ELF file */
-const char *map_to_name(mapinfo *mi, unsigned pc, const char* def)
+static int may_reread(mapindex *index)
+{
+    struct timespec now;
+    long ms;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ms = (now.tv_sec - index->read_time.tv_sec) * 1000 +
+         (now.tv_nsec - index->read_time.tv_nsec) / 1000000;
+    return ms >= MAPINFO_REREAD_MS;
+}
+
+static const mapinfo *lookup(mapindex *index, unsigned pc)
 {
-    while(mi) {
-        if((pc >= mi->start) && (pc < mi->end)){
-            return mi->name;
+    unsigned slot = (pc ^ (pc >> 12)) & (MAPINFO_CACHE - 1);
+    const mapinfo *mi;
+
+    if(!index) return NULL;
+
+    pthread_mutex_lock(&index->lock);
+    if(index->cache[slot].generation == index->generation &&
+       index->cache[slot].pc == pc) {
+        mi = index->cache[slot].mi;
+    } else {
+        mi = search(index, pc);
+        if(!mi && may_reread(index)) {
+            read_maps(index);
+            mi = search(index, pc);
         }
-        mi = mi->next;
+        index->cache[slot].pc = pc;
+        index->cache[slot].generation = index->generation;
+        index->cache[slot].mi = mi;
     }
-    return def;
+    pthread_mutex_unlock(&index->lock);
+
+    return mi;
+}
+
+/* Map a pc address to the name of the containing ELF file */
+const char *map_to_name(mapindex *index, unsigned pc, const char* def)
+{
+    const mapinfo *mi = lookup(index, pc);
+    return mi ? mi->name : def;
 }
 
 /* Find the containing map info for the pc */
-const mapinfo *pc_to_mapinfo(mapinfo *mi, unsigned pc, unsigned *rel_pc)
+const mapinfo *pc_to_mapinfo(mapindex *index, unsigned pc, unsigned *rel_pc)
 {
-    *rel_pc = pc;
-    while(mi) {
-        if((pc >= mi->start) && (pc < mi->end)){
-            // Only calculate the relative offset for shared libraries
-            if (strstr(mi->name, ".so")) {
-                *rel_pc -= mi->start;
-            }
-            return mi;
-        }
-        mi = mi->next;
-    }
-    return NULL;
+    const mapinfo *mi = lookup(index, pc);
+    *rel_pc = mi ? pc - mi->rel_base : pc;
+    return mi;
 }
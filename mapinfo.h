@@ -1,16 +1,43 @@
 #ifndef MAPINFO_H
 #define MAPINFO_H
 
+#include <pthread.h>
+#include <time.h>
+
+#define MAPINFO_CACHE       1024    /* resolved pcs, power of two */
+#define MAPINFO_REREAD_MS   100     /* at least this long between rereads */
+
 typedef struct mapinfo {
     struct mapinfo *next;
     unsigned start;
     unsigned end;
+    unsigned rel_base;  /* subtracted from pcs, the start for shared libraries */
     char name[];
 } mapinfo;
 
-mapinfo *init_mapinfo(int pid);
-void deinit_mapinfo(mapinfo *mi);
-const char *map_to_name(mapinfo *mi, unsigned pc, const char* def);
-const mapinfo *pc_to_mapinfo(mapinfo *mi, unsigned pc, unsigned *rel_pc);
+/* The executable maps of a process, sorted by address.  Maps are read again
+ * when a pc is not in any of them, since libraries get dlopen()ed after the
+ * index is built.  A mapinfo stays valid until deinit_mapinfo(), even if the
+ * library is unloaded.
+ */
+typedef struct mapindex {
+    int pid;
+    pthread_mutex_t lock;
+    mapinfo *all;               /* every map ever read */
+    const mapinfo **sorted;     /* the current ones */
+    unsigned num;
+    unsigned generation;        /* of the cache entries that are valid */
+    struct timespec read_time;
+    struct {
+        unsigned pc;
+        unsigned generation;
+        const mapinfo *mi;      /* NULL if the pc is in no map */
+    } cache[MAPINFO_CACHE];
+} mapindex;
+
+mapindex *init_mapinfo(int pid);
+void deinit_mapinfo(mapindex *index);
+const char *map_to_name(mapindex *index, unsigned pc, const char* def);
+const mapinfo *pc_to_mapinfo(mapindex *index, unsigned pc, unsigned *rel_pc);
 
 #endif
@@ -137,7 +137,7 @@ include $(TI_OMX_AUDIO)/ilbc_enc/tests/Android.mk
 
 #call to video
 include $(TI_OMX_VIDEO)/video_decode/Android.mk
-#include $(TI_OMX_VIDEO)/video_decode/test/Android.mk
+include $(TI_OMX_VIDEO)/video_decode/test/Android.mk
 #include $(TI_OMX_VIDEO)/video_encode/Android.mk
 #include $(TI_OMX_VIDEO)/video_encode/test/Android.mk
 #include $(TI_OMX_VIDEO)/prepost_processor/Android.mk
@@ -3643,34 +3643,7 @@ OMX_ERRORTYPE AACDECFill_LCMLInitParamsEx(OMX_HANDLETYPE pComponent,OMX_U32 inde
 /*  =========================================================================*/
 OMX_U32 AACDEC_GetBits(OMX_U32* nPosition, OMX_U8 nBits, OMX_U8* pBuffer, OMX_BOOL bIcreasePosition)
 {
-    OMX_U32 nOutput;
-    OMX_U32 nNumBitsRead = 0;
-    OMX_U32 nBytePosition = 0;
-    OMX_U8  nBitPosition =  0;
-    nBytePosition = *nPosition / 8;
-    nBitPosition =  *nPosition % 8;
-
-    if (bIcreasePosition)
-        *nPosition += nBits;
-    nOutput = ((OMX_U32)pBuffer[nBytePosition] << (24+nBitPosition) );
-    nNumBitsRead = nNumBitsRead + (8 - nBitPosition);
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 1] << (16+nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 2] << (8+nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 3] << (nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    nOutput = nOutput >> (32 - nBits) ;
-    return nOutput;
+    return omx_bits_get(nPosition, nBits, pBuffer, bIcreasePosition);
 }
 /* ========================================================================== */
 /**
@@ -44,6 +44,7 @@
 #include <OMX_Component.h>
 #include "OMX_TI_Common.h"
 #include <OMX_TI_Debug.h>
+#include "OMX_TI_BitReader.h"
 #include "LCML_DspCodec.h"
 #include "usn.h"
 #include <pthread.h>
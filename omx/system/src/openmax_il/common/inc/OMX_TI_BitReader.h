@@ -0,0 +1,295 @@
+
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/* =============================================================================
+*             Texas Instruments OMAP(TM) Platform Software
+*  (c) Copyright Texas Instruments, Incorporated.  All Rights Reserved.
+*
+*  Use of this software is controlled by the terms and conditions found
+*  in the license agreement under which this software has been supplied.
+* =========================================================================== */
+/** OMX_TI_BitReader.h
+  *  Bitstream helpers shared by the header parsers of the audio and video
+  *  components: a big-endian bit reader that keeps a 64-bit window of the
+  *  stream so most reads are a shift and a mask, Exp-Golomb decoding and a
+  *  start code finder that skips a word (or a NEON register) at a time.
+ */
+
+#ifndef __OMX_TI_BITREADER_H__
+#define __OMX_TI_BITREADER_H__
+
+#include <string.h>
+#include <stdint.h>
+#include "OMX_Types.h"
+
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BITREADER  Sequential reader over a bounded buffer. Bits past the
+ *                   end of the buffer read as zero and are never loaded.
+ *
+ * @param pBuffer      Start of the stream
+ * @param nSize        Size of the stream in bytes
+ * @param nBytePos     Next byte to be loaded into the window
+ * @param nWindow      Cached bits, left aligned: bit 63 is the next bit
+ * @param nWindowBits  Number of valid bits in nWindow
+ */
+/* ======================================================================= */
+typedef struct OMX_TI_BITREADER {
+    const OMX_U8 *pBuffer;
+    OMX_U32 nSize;
+    OMX_U32 nBytePos;
+    OMX_U64 nWindow;
+    OMX_U32 nWindowBits;
+} OMX_TI_BITREADER;
+
+/**
+ *@omx_bits_load_be32 inline function to load 4 bytes as a big-endian word
+ *@param const OMX_U8 *p any alignment
+ */
+static inline uint32_t omx_bits_load_be32(const OMX_U8 *p)
+{
+    uint32_t nWord;
+
+    memcpy(&nWord, p, sizeof(nWord));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    return nWord;
+#else
+    return __builtin_bswap32(nWord);
+#endif
+}
+
+/**
+ *@omx_bits_refill inline function to top the window up to more than 32 bits
+ *@param OMX_TI_BITREADER *pReader
+ */
+static inline void omx_bits_refill(OMX_TI_BITREADER *pReader)
+{
+    if (pReader->nWindowBits > 32) {
+        return;
+    }
+    if (pReader->nBytePos + 4 <= pReader->nSize) {
+        pReader->nWindow |= (OMX_U64)omx_bits_load_be32(pReader->pBuffer + pReader->nBytePos)
+                            << (32 - pReader->nWindowBits);
+        pReader->nWindowBits += 32;
+        pReader->nBytePos += 4;
+        return;
+    }
+    /* tail of the buffer, pad with zero bytes */
+    while (pReader->nWindowBits <= 56) {
+        OMX_U64 nByte = 0;
+        if (pReader->nBytePos < pReader->nSize) {
+            nByte = pReader->pBuffer[pReader->nBytePos];
+        }
+        pReader->nWindow |= nByte << (56 - pReader->nWindowBits);
+        pReader->nWindowBits += 8;
+        pReader->nBytePos++;
+    }
+}
+
+/**
+ *@omx_bits_init inline function to start reading a buffer
+ *@param OMX_TI_BITREADER *pReader
+ *@param const OMX_U8 *pBuffer
+ *@param OMX_U32 nSize bytes available in pBuffer
+ *@param OMX_U32 nBitOffset first bit to read
+ */
+static inline void omx_bits_init(OMX_TI_BITREADER *pReader, const OMX_U8 *pBuffer,
+                                 OMX_U32 nSize, OMX_U32 nBitOffset)
+{
+    pReader->pBuffer = pBuffer;
+    pReader->nSize = nSize;
+    pReader->nBytePos = nBitOffset >> 3;
+    pReader->nWindow = 0;
+    pReader->nWindowBits = 0;
+    omx_bits_refill(pReader);
+    pReader->nWindow <<= (nBitOffset & 7);
+    pReader->nWindowBits -= (nBitOffset & 7);
+}
+
+/**
+ *@omx_bits_tell inline function to get the position of the next bit
+ *@param const OMX_TI_BITREADER *pReader
+ */
+static inline OMX_U32 omx_bits_tell(const OMX_TI_BITREADER *pReader)
+{
+    return pReader->nBytePos * 8 - pReader->nWindowBits;
+}
+
+/**
+ *@omx_bits_peek inline function to get the next nBits without consuming them
+ *@param OMX_TI_BITREADER *pReader
+ *@param OMX_U32 nBits 0 to 32
+ */
+static inline OMX_U32 omx_bits_peek(OMX_TI_BITREADER *pReader, OMX_U32 nBits)
+{
+    if (nBits == 0) {
+        return 0;
+    }
+    omx_bits_refill(pReader);
+    return (OMX_U32)(pReader->nWindow >> (64 - nBits));
+}
+
+/**
+ *@omx_bits_skip inline function to consume nBits, any count is allowed
+ *@param OMX_TI_BITREADER *pReader
+ *@param OMX_U32 nBits
+ */
+static inline void omx_bits_skip(OMX_TI_BITREADER *pReader, OMX_U32 nBits)
+{
+    if (nBits > pReader->nWindowBits) {
+        /* drop the window and jump straight to the byte holding the target */
+        omx_bits_init(pReader, pReader->pBuffer, pReader->nSize,
+                      omx_bits_tell(pReader) + nBits);
+        return;
+    }
+    pReader->nWindow = (nBits == 64) ? 0 : pReader->nWindow << nBits;
+    pReader->nWindowBits -= nBits;
+}
+
+/**
+ *@omx_bits_read inline function to get and consume the next nBits
+ *@param OMX_TI_BITREADER *pReader
+ *@param OMX_U32 nBits 0 to 32
+ */
+static inline OMX_U32 omx_bits_read(OMX_TI_BITREADER *pReader, OMX_U32 nBits)
+{
+    OMX_U32 nValue = omx_bits_peek(pReader, nBits);
+    omx_bits_skip(pReader, nBits);
+    return nValue;
+}
+
+/**
+ *@omx_bits_ue inline function to decode an unsigned Exp-Golomb code ue(v).
+ *              Codes with more than 31 leading zeros are corrupt and read as 0.
+ *@param OMX_TI_BITREADER *pReader
+ */
+static inline OMX_U32 omx_bits_ue(OMX_TI_BITREADER *pReader)
+{
+    OMX_U32 nLeadingZeros;
+
+    omx_bits_refill(pReader);
+    nLeadingZeros = pReader->nWindow ? (OMX_U32)__builtin_clzll(pReader->nWindow) : 64;
+    if (nLeadingZeros > 31) {
+        omx_bits_skip(pReader, 32);
+        return 0;
+    }
+    omx_bits_skip(pReader, nLeadingZeros);
+    return omx_bits_read(pReader, nLeadingZeros + 1) - 1;
+}
+
+/**
+ *@omx_bits_se inline function to decode a signed Exp-Golomb code se(v)
+ *@param OMX_TI_BITREADER *pReader
+ */
+static inline OMX_S32 omx_bits_se(OMX_TI_BITREADER *pReader)
+{
+    OMX_U32 nCode = omx_bits_ue(pReader);
+
+    return (nCode & 1) ? (OMX_S32)((nCode + 1) >> 1) : -(OMX_S32)(nCode >> 1);
+}
+
+/**
+ *@omx_bits_get inline function for parsers that track a bare bit position.
+ *              Reads nBits at *nPosition touching only the bytes the field
+ *              covers, so it is safe on buffers without a known size.
+ *@param OMX_U32 *nPosition bit position, advanced when bIncreasePosition is set
+ *@param OMX_U8 nBits 0 to 32
+ *@param const OMX_U8 *pBuffer
+ *@param OMX_BOOL bIncreasePosition
+ */
+static inline OMX_U32 omx_bits_get(OMX_U32 *nPosition, OMX_U8 nBits,
+                                   const OMX_U8 *pBuffer, OMX_BOOL bIncreasePosition)
+{
+    OMX_TI_BITREADER sReader;
+    OMX_U32 nValue;
+
+    /* bound the reader to the last byte of the field */
+    omx_bits_init(&sReader, pBuffer, (*nPosition + nBits + 7) >> 3, *nPosition);
+    nValue = omx_bits_peek(&sReader, nBits);
+    if (bIncreasePosition) {
+        *nPosition += nBits;
+    }
+    return nValue;
+}
+
+/**
+ *@omx_bits_find_prefix inline function to find the next 0x00 0x00 nCode
+ *                      sequence. Words without a zero byte cannot start
+ *                      one and are skipped whole.
+ *@param const OMX_U8 *pBuffer
+ *@param OMX_U32 nSize bytes available in pBuffer
+ *@param OMX_U32 nOffset first byte to look at
+ *@param OMX_U8 nCode third byte, 0x01 for a start code, 0x03 for H.264
+ *                    emulation prevention
+ *@return byte offset of the first 0x00, or nSize if there is none
+ */
+static inline OMX_U32 omx_bits_find_prefix(const OMX_U8 *pBuffer, OMX_U32 nSize,
+                                           OMX_U32 nOffset, OMX_U8 nCode)
+{
+    uint32_t nWord;
+
+    while (nOffset + 3 <= nSize) {
+#ifdef __ARM_NEON__
+        while (nOffset + 16 <= nSize) {
+            uint8x16_t vZero = vceqq_u8(vld1q_u8(pBuffer + nOffset), vdupq_n_u8(0));
+            uint8x8_t vAny = vorr_u8(vget_low_u8(vZero), vget_high_u8(vZero));
+            if (vget_lane_u64(vreinterpret_u64_u8(vAny), 0) != 0) {
+                break;
+            }
+            nOffset += 16;
+        }
+#endif
+        while (nOffset + 4 <= nSize) {
+            memcpy(&nWord, pBuffer + nOffset, sizeof(nWord));
+            if (((nWord - 0x01010101u) & ~nWord & 0x80808080u) != 0) {
+                break;
+            }
+            nOffset += 4;
+        }
+        if (nOffset + 3 > nSize) {
+            break;
+        }
+        if (pBuffer[nOffset] == 0 && pBuffer[nOffset + 1] == 0 &&
+            pBuffer[nOffset + 2] == nCode) {
+            return nOffset;
+        }
+        nOffset++;
+    }
+    return nSize;
+}
+
+/**
+ *@omx_bits_find_startcode inline function to find the next 0x000001 start code
+ *@param const OMX_U8 *pBuffer
+ *@param OMX_U32 nSize bytes available in pBuffer
+ *@param OMX_U32 nOffset first byte to look at
+ *@return byte offset of the start code, or nSize if there is none
+ */
+static inline OMX_U32 omx_bits_find_startcode(const OMX_U8 *pBuffer, OMX_U32 nSize,
+                                              OMX_U32 nOffset)
+{
+    return omx_bits_find_prefix(pBuffer, nSize, nOffset, 0x01);
+}
+
+#endif /* __OMX_TI_BITREADER_H__ */
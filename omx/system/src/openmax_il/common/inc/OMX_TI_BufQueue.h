@@ -0,0 +1,317 @@
+
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+/* =============================================================================
+*             Texas Instruments OMAP(TM) Platform Software
+*  (c) Copyright Texas Instruments, Incorporated.  All Rights Reserved.
+*
+*  Use of this software is controlled by the terms and conditions found
+*  in the license agreement under which this software has been supplied.
+* =========================================================================== */
+/** OMX_TI_BufQueue.h
+  *  In-process queues used by the component threads to exchange buffer
+  *  headers and commands. Every queue of a component shares one wakeup
+  *  descriptor, so a push is a copy under a mutex and the eventfd is only
+  *  written when the component thread is actually asleep.
+ */
+
+#ifndef __OMX_TI_BUFQUEUE_H__
+#define __OMX_TI_BUFQUEUE_H__
+
+#include <pthread.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include "OMX_Types.h"
+#include "OMX_Core.h"
+
+/* ======================================================================= */
+/**
+ * @def    OMX_BUFQ_MAX_QUEUES   Queues that can share one wakeup object,
+ *                               each one owns a bit of the ready mask
+ */
+/* ======================================================================= */
+#define OMX_BUFQ_MAX_QUEUES 16
+
+extern int pselect(int  n, fd_set*  readfds, fd_set*  writefds, fd_set*  errfds,
+        const struct timespec*  timeout, const sigset_t*  sigmask);
+
+struct OMX_TI_BUFQUEUE;
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BUFQWAKE  Wakeup object shared by all the queues of a component.
+ *
+ * @param nEventFd   Descriptor the component thread sleeps on
+ * @param nWaiting   Set by the consumer before it sleeps, cleared by the
+ *                   producer that signals the eventfd
+ * @param nQueues    Number of registered queues
+ * @param pQueues    Registered queues, indexed by their ready mask bit
+ */
+/* ======================================================================= */
+typedef struct OMX_TI_BUFQWAKE {
+    int nEventFd;
+    volatile int nWaiting;
+    OMX_U32 nQueues;
+    struct OMX_TI_BUFQUEUE *pQueues[OMX_BUFQ_MAX_QUEUES];
+} OMX_TI_BUFQWAKE;
+
+/* ======================================================================= */
+/**
+ * OMX_TI_BUFQUEUE  FIFO of fixed size elements, grown on demand so a push
+ *                  never fails while memory is available, like a pipe.
+ *
+ * @param mutex      Protects the ring, producers may be any thread
+ * @param pData      nCapacity elements of nElemSize bytes
+ * @param nRead      Index of the oldest element
+ * @param nCount     Number of queued elements
+ * @param nMask      Ready mask bit of this queue
+ * @param pWake      Wakeup object this queue is registered with
+ */
+/* ======================================================================= */
+typedef struct OMX_TI_BUFQUEUE {
+    pthread_mutex_t mutex;
+    OMX_U8 *pData;
+    OMX_U32 nElemSize;
+    OMX_U32 nCapacity;
+    OMX_U32 nRead;
+    volatile OMX_U32 nCount;
+    OMX_U32 nMask;
+    OMX_TI_BUFQWAKE *pWake;
+} OMX_TI_BUFQUEUE;
+
+/**
+ *@omx_bufq_wake_init inline function to create the wakeup descriptor
+ *@param OMX_TI_BUFQWAKE *pWake
+ *@return OMX_ErrorInsufficientResources if the eventfd cannot be created
+ */
+static inline OMX_ERRORTYPE omx_bufq_wake_init(OMX_TI_BUFQWAKE *pWake)
+{
+    memset(pWake, 0, sizeof(*pWake));
+    pWake->nEventFd = eventfd(0, EFD_NONBLOCK);
+    if (pWake->nEventFd < 0) {
+        return OMX_ErrorInsufficientResources;
+    }
+    return OMX_ErrorNone;
+}
+
+/**
+ *@omx_bufq_wake_deinit inline function to close the wakeup descriptor,
+ *                      the queues have to be deinitialized first
+ *@param OMX_TI_BUFQWAKE *pWake
+ */
+static inline void omx_bufq_wake_deinit(OMX_TI_BUFQWAKE *pWake)
+{
+    if (pWake->nEventFd >= 0) {
+        close(pWake->nEventFd);
+    }
+    pWake->nEventFd = -1;
+    pWake->nQueues = 0;
+}
+
+/**
+ *@omx_bufq_init inline function to create a queue and register it with
+ *               the wakeup object of the component
+ *@param OMX_TI_BUFQUEUE *pQueue
+ *@param OMX_TI_BUFQWAKE *pWake
+ *@param OMX_U32 nElemSize size of one element, e.g. sizeof(OMX_BUFFERHEADERTYPE*)
+ *@param OMX_U32 nCapacity initial number of elements
+ *@return OMX_ErrorInsufficientResources on allocation failure or when
+ *        OMX_BUFQ_MAX_QUEUES queues are already registered
+ */
+static inline OMX_ERRORTYPE omx_bufq_init(OMX_TI_BUFQUEUE *pQueue,
+                                          OMX_TI_BUFQWAKE *pWake,
+                                          OMX_U32 nElemSize,
+                                          OMX_U32 nCapacity)
+{
+    memset(pQueue, 0, sizeof(*pQueue));
+    if (pWake->nQueues >= OMX_BUFQ_MAX_QUEUES || nElemSize == 0) {
+        return OMX_ErrorInsufficientResources;
+    }
+    if (nCapacity == 0) {
+        nCapacity = 1;
+    }
+    pQueue->pData = (OMX_U8 *)malloc(nElemSize * nCapacity);
+    if (pQueue->pData == NULL) {
+        return OMX_ErrorInsufficientResources;
+    }
+    pthread_mutex_init(&pQueue->mutex, NULL);
+    pQueue->nElemSize = nElemSize;
+    pQueue->nCapacity = nCapacity;
+    pQueue->nMask = 1 << pWake->nQueues;
+    pQueue->pWake = pWake;
+    pWake->pQueues[pWake->nQueues++] = pQueue;
+    return OMX_ErrorNone;
+}
+
+/**
+ *@omx_bufq_deinit inline function to release a queue, queued elements are dropped
+ *@param OMX_TI_BUFQUEUE *pQueue
+ */
+static inline void omx_bufq_deinit(OMX_TI_BUFQUEUE *pQueue)
+{
+    if (pQueue->pData != NULL) {
+        pthread_mutex_destroy(&pQueue->mutex);
+        free(pQueue->pData);
+        pQueue->pData = NULL;
+    }
+    pQueue->nCount = 0;
+}
+
+/**
+ *@omx_bufq_push inline function to queue one element and wake up the
+ *               component thread if it is sleeping
+ *@param OMX_TI_BUFQUEUE *pQueue
+ *@param const void *pElem nElemSize bytes copied into the queue
+ *@return OMX_ErrorInsufficientResources if the queue cannot grow,
+ *        OMX_ErrorHardware if the wakeup cannot be signalled
+ */
+static inline OMX_ERRORTYPE omx_bufq_push(OMX_TI_BUFQUEUE *pQueue, const void *pElem)
+{
+    OMX_TI_BUFQWAKE *pWake = pQueue->pWake;
+    OMX_U32 nWrite;
+    uint64_t nSignal = 1;
+
+    pthread_mutex_lock(&pQueue->mutex);
+    if (pQueue->nCount == pQueue->nCapacity) {
+        OMX_U8 *pData = (OMX_U8 *)malloc(pQueue->nElemSize * pQueue->nCapacity * 2);
+        OMX_U32 nFirst = pQueue->nCapacity - pQueue->nRead;
+        if (pData == NULL) {
+            pthread_mutex_unlock(&pQueue->mutex);
+            return OMX_ErrorInsufficientResources;
+        }
+        /* unwrap the ring so the oldest element lands at index 0 */
+        memcpy(pData, pQueue->pData + pQueue->nRead * pQueue->nElemSize,
+               nFirst * pQueue->nElemSize);
+        memcpy(pData + nFirst * pQueue->nElemSize, pQueue->pData,
+               pQueue->nRead * pQueue->nElemSize);
+        free(pQueue->pData);
+        pQueue->pData = pData;
+        pQueue->nRead = 0;
+        pQueue->nCapacity *= 2;
+    }
+    nWrite = (pQueue->nRead + pQueue->nCount) % pQueue->nCapacity;
+    memcpy(pQueue->pData + nWrite * pQueue->nElemSize, pElem, pQueue->nElemSize);
+    pQueue->nCount++;
+    pthread_mutex_unlock(&pQueue->mutex);
+
+    /* pairs with the barrier in omx_bufq_wait: either the consumer sees the
+       element on its recheck or we see it waiting and signal the eventfd */
+    __sync_synchronize();
+    if (pWake->nWaiting && __sync_bool_compare_and_swap(&pWake->nWaiting, 1, 0)) {
+        if (write(pWake->nEventFd, &nSignal, sizeof(nSignal)) != sizeof(nSignal)) {
+            return OMX_ErrorHardware;
+        }
+    }
+    return OMX_ErrorNone;
+}
+
+/**
+ *@omx_bufq_pop inline function to dequeue the oldest element
+ *@param OMX_TI_BUFQUEUE *pQueue
+ *@param void *pElem receives nElemSize bytes
+ *@return OMX_FALSE if the queue was empty
+ */
+static inline OMX_BOOL omx_bufq_pop(OMX_TI_BUFQUEUE *pQueue, void *pElem)
+{
+    OMX_BOOL bPopped = OMX_FALSE;
+
+    pthread_mutex_lock(&pQueue->mutex);
+    if (pQueue->nCount != 0) {
+        memcpy(pElem, pQueue->pData + pQueue->nRead * pQueue->nElemSize, pQueue->nElemSize);
+        pQueue->nRead = (pQueue->nRead + 1) % pQueue->nCapacity;
+        pQueue->nCount--;
+        bPopped = OMX_TRUE;
+    }
+    pthread_mutex_unlock(&pQueue->mutex);
+    return bPopped;
+}
+
+/**
+ *@omx_bufq_ready inline function to get the queues holding elements
+ *@param OMX_TI_BUFQWAKE *pWake
+ *@param OMX_U32 nMask queues of interest
+ *@return the subset of nMask whose queues are not empty
+ */
+static inline OMX_U32 omx_bufq_ready(OMX_TI_BUFQWAKE *pWake, OMX_U32 nMask)
+{
+    OMX_U32 nReady = 0;
+    OMX_U32 i;
+
+    for (i = 0; i < pWake->nQueues; i++) {
+        if ((pWake->pQueues[i]->nMask & nMask) && pWake->pQueues[i]->nCount != 0) {
+            nReady |= pWake->pQueues[i]->nMask;
+        }
+    }
+    return nReady;
+}
+
+/**
+ *@omx_bufq_wait inline function to sleep until one of the queues in nMask
+ *               holds an element. Only the component thread may wait.
+ *@param OMX_TI_BUFQWAKE *pWake
+ *@param OMX_U32 nMask queues of interest
+ *@param const struct timespec *pTimeout NULL to wait forever
+ *@param const sigset_t *pSigMask signals blocked while sleeping, as pselect
+ *@return the ready subset of nMask, 0 on timeout or -1 if pselect failed
+ */
+static inline int omx_bufq_wait(OMX_TI_BUFQWAKE *pWake, OMX_U32 nMask,
+                                const struct timespec *pTimeout,
+                                const sigset_t *pSigMask)
+{
+    OMX_U32 nReady;
+    uint64_t nSignal;
+    fd_set rfds;
+    int status;
+
+    nReady = omx_bufq_ready(pWake, nMask);
+    if (nReady != 0) {
+        return (int)nReady;
+    }
+
+    pWake->nWaiting = 1;
+    __sync_synchronize();
+    nReady = omx_bufq_ready(pWake, nMask);
+    if (nReady != 0) {
+        pWake->nWaiting = 0;
+        return (int)nReady;
+    }
+
+    FD_ZERO(&rfds);
+    FD_SET(pWake->nEventFd, &rfds);
+    status = pselect(pWake->nEventFd + 1, &rfds, NULL, NULL, pTimeout, pSigMask);
+    pWake->nWaiting = 0;
+    if (status == -1 && errno != EINTR) {
+        return -1;
+    }
+    /* the eventfd is non-blocking, a stale signal only costs one extra pass */
+    if (status > 0) {
+        read(pWake->nEventFd, &nSignal, sizeof(nSignal));
+    }
+    __sync_synchronize();
+    return (int)omx_bufq_ready(pWake, nMask);
+}
+
+#endif /* __OMX_TI_BUFQUEUE_H__ */
@@ -48,7 +48,10 @@ typedef enum
     EMMCodecControlDestroy,
     EMMCodecControlAlgCtrl,
     EMMCodecControlStrmCtrl,
-    EMMCodecControlUsnEos
+    EMMCodecControlUsnEos,
+    EMMCodecControlGetPoolMisses,  /* args[0]: OMX_U32* receiving the USN structure pool misses */
+    EMMCodecControlGetDmmCacheStats,  /* args[0..2]: OMX_U32* receiving DMM mapping cache hits, misses and evictions */
+    EMMCodecControlEventDrivenWait  /* args[0]: OMX_TRUE to wait for DSP events instead of polling, see LCML_EVENT_WAIT_TIMEOUT */
 }TControlCmd;
 
 
@@ -39,7 +39,11 @@
 #define MAX_STREAMS             10
 
 /* Reuse implementation */
-#define MAX_DMM_BUFFERS 20
+/* capacity of the DMM mapping cache, kept above the 2 * QUEUE_SIZE buffers
+ * that can be in flight so that an unused mapping can always be evicted */
+#define MAX_DMM_BUFFERS 48
+/* buckets of the DMM mapping cache hash, must be a power of two */
+#define DMM_MAP_HASH_SIZE 64
 /* If buffer size being mapped is large than this threshold,
    bridge will be asked to writeback and invalidate entire cache */
 #define INVALIDATE_TRESHOLD 512*1024
@@ -52,6 +56,10 @@
 #define LCML_DATA_SIZE          42
 #define DMM_PAGE_SIZE           4096
 #define QUEUE_SIZE              20
+/* ms, bounds the event driven wait when no node state change wakes it */
+#define LCML_EVENT_WAIT_TIMEOUT 1000
+/* at most QUEUE_SIZE input and QUEUE_SIZE output USN structures are in flight */
+#define COMM_STRUCT_POOL_SIZE   (2 * QUEUE_SIZE)
 #define ROUND_TO_PAGESIZE(n)    ((((n)+4095)/DMM_PAGE_SIZE)*DMM_PAGE_SIZE)
 
 #define __ERROR_PROPAGATION__
@@ -155,6 +163,39 @@ typedef struct
     OMX_U32 iStreamID;
 } TArmDspCommunicationStruct;
 
+/**
+ * DMM mapping cache entry, used when buffers are queued with ReUseMap
+ */
+typedef struct LCML_DMM_MAP_ENTRY
+{
+    DMM_BUFFER_OBJ dmmBuf;  /* dmmBuf.pAllocated is NULL for a free entry */
+    OMX_U32 nLen;           /* mapped length, part of the key with pAllocated */
+    OMX_U32 nRefCount;      /* queued buffers currently using the mapping */
+    OMX_S32 nHashNext;      /* next entry of the bucket or of the free list, -1 ends */
+    OMX_S32 nLruPrev;       /* LRU list, nLruHead is the most recently used */
+    OMX_S32 nLruNext;
+} LCML_DMM_MAP_ENTRY;
+
+/**
+ * Hash indexed, LRU bounded cache of DMM mappings shared by input and output
+ */
+typedef struct LCML_DMM_MAP_CACHE
+{
+    LCML_DMM_MAP_ENTRY entries[MAX_DMM_BUFFERS];
+    OMX_S32 buckets[DMM_MAP_HASH_SIZE];
+    OMX_S32 nLruHead;
+    OMX_S32 nLruTail;
+    OMX_S32 nFree;
+    /* entry held by the buffer queued in each Arminputstorage and
+       Armoutputstorage slot, -1 for none; kept here rather than in the USN
+       structure, whose layout is shared with the DSP */
+    OMX_S32 nInputSlotEntry[QUEUE_SIZE];
+    OMX_S32 nOutputSlotEntry[QUEUE_SIZE];
+    OMX_U32 nHits;
+    OMX_U32 nMisses;
+    OMX_U32 nEvictions;
+} LCML_DMM_MAP_CACHE;
+
 
 
 /*API needs to be exposed to application*/
@@ -313,6 +354,9 @@ typedef struct LCML_DSP_INTERFACE
 #else
     struct DSP_NOTIFICATION * g_aNotificationObjects[1];
 #endif
+    struct DSP_NOTIFICATION * wakeNotification; /* node state change, breaks the messaging thread wait */
+    OMX_BOOL bEventDrivenWait;                  /* messaging thread waits for events, see LCML_EVENT_WAIT_TIMEOUT */
+    OMX_BOOL bNodeTerminated;                   /* Destroy terminated the node already */
     pthread_t g_tidMessageThread;
     OMX_U32 algcntlmapped[QUEUE_SIZE];
     DMM_BUFFER_OBJ *pAlgcntlDmmBuf[QUEUE_SIZE];
@@ -325,12 +369,16 @@ typedef struct LCML_DSP_INTERFACE
 #ifdef __PERF_INSTRUMENTATION__
     PERF_OBJHANDLE pPERF, pPERFcomp;
 #endif
-    DMM_BUFFER_OBJ mapped_dmm_buffers[MAX_DMM_BUFFERS];
-    OMX_U32 mapped_buffer_count;
+    LCML_DMM_MAP_CACHE dmmMapCache;
     OMX_BOOL ReUseMap;
     pthread_mutex_t m_isStopped_mutex;
     OMX_BOOL buf_invalidate_flag;
     OMX_BOOL buf_flush_flag;
+    /* preallocated USN structures, protected by mutex */
+    TArmDspCommunicationStruct* commStructPool[COMM_STRUCT_POOL_SIZE];
+    OMX_U32 commStructPoolCount;   /* free structures in commStructPool */
+    OMX_U32 commStructPoolSize;    /* structures kept by the pool */
+    OMX_U32 commStructPoolMisses;  /* QueueBuffer calls that had to allocate */
 
 }LCML_DSP_INTERFACE;
 
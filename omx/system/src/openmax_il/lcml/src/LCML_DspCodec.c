@@ -136,6 +136,17 @@ static OMX_ERRORTYPE DmmUnMap(DSP_HPROCESSOR ProcHandle,
                               struct OMX_TI_Debug dbg);
 static OMX_ERRORTYPE DeleteDspResource(LCML_DSP_INTERFACE *hInterface);
 static OMX_ERRORTYPE FreeResources(LCML_DSP_INTERFACE *hInterface);
+static void CommStructPoolInit(LCML_DSP_INTERFACE *phandle);
+static void CommStructPoolDeinit(LCML_DSP_INTERFACE *phandle);
+static TArmDspCommunicationStruct* CommStructGet(LCML_DSP_INTERFACE *phandle);
+static void CommStructPut(LCML_DSP_INTERFACE *phandle, TArmDspCommunicationStruct *pStruct);
+static void DmmMapCacheInit(LCML_DMM_MAP_CACHE *pCache);
+static OMX_S32 DmmMapCacheLookup(LCML_DSP_INTERFACE *phandle, void *pArmPtr, OMX_U32 nLen);
+static OMX_S32 DmmMapCacheInsert(LCML_DSP_INTERFACE *phandle, DMM_BUFFER_OBJ *pDmmBuf, OMX_U32 nLen);
+static void DmmMapCacheRelease(LCML_DSP_INTERFACE *phandle, OMX_S32 idx);
+static void DmmMapCacheFlush(LCML_DSP_INTERFACE *phandle);
+static OMX_S32 *DmmMapCacheSlotEntry(LCML_DSP_INTERFACE *phandle, TArmDspCommunicationStruct *pStruct);
+static void RegisterWakeNotification(LCML_DSP_INTERFACE *phandle);
 
 void* MessagingThread(void *arg);
 
@@ -288,7 +299,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
         /* Reuse implementation */
         {
             pthread_mutex_init(&phandle->m_isStopped_mutex, NULL);
-            phandle->mapped_buffer_count = 0;
+            DmmMapCacheInit(&phandle->dmmMapCache);
         }
         /* INIT DSP RESOURCE */
         if(pCallbacks)
@@ -521,6 +532,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             DSP_ERROR_EXIT(status, "DSP node register notify DSP_SYSERROR", ERROR, hInt);
             phandle->g_aNotificationObjects[2] =  notification_syserror;
 #endif
+            RegisterWakeNotification(phandle);
         }
 
         /* Listener thread */
@@ -556,6 +568,7 @@ static OMX_ERRORTYPE InitMMCodecEx(OMX_HANDLETYPE hInt,
             phandle->algcntlmapped[i] = 0;
             phandle->strmcntlmapped[i] = 0;
         }
+        CommStructPoolInit(phandle);
 #ifdef __PERF_INSTRUMENTATION__
         PERF_Boundary(phandle->pPERF,
                       PERF_BoundaryComplete | PERF_BoundarySetup);
@@ -632,7 +645,7 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
     /* Reuse implementation */
     {
         pthread_mutex_init(&phandle->m_isStopped_mutex, NULL);
-        phandle->mapped_buffer_count = 0;
+        DmmMapCacheInit(&phandle->dmmMapCache);
     }
 
     /* INIT DSP RESOURCE */
@@ -861,6 +874,7 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         DSP_ERROR_EXIT(status, "DSP node register notify DSP_SYSERROR", ERROR, hInt);
         phandle->g_aNotificationObjects[2] =  notification_syserror;
 #endif
+        RegisterWakeNotification(phandle);
     }
 
     /* Listener thread */
@@ -896,6 +910,7 @@ static OMX_ERRORTYPE InitMMCodec(OMX_HANDLETYPE hInt,
         phandle->algcntlmapped[i] = 0;
         phandle->strmcntlmapped[i] = 0;
     }
+    CommStructPoolInit(phandle);
 
 #ifdef __PERF_INSTRUMENTATION__
     PERF_Boundary(phandle->pPERF,
@@ -967,6 +982,7 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
     struct DSP_MSG msg;
     OMX_U32 MapBufLen=0;
     OMX_BOOL mappedBufferFound = false;
+    OMX_S32 nCacheIndex = -1;
 
     if (hComponent == NULL )
     {
@@ -986,13 +1002,13 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
                        PERF_ModuleSocketNode);
 #endif
     pthread_mutex_lock(&phandle->mutex);
-    LCML_MEMALIGN(tmp2,sizeof(TArmDspCommunicationStruct),char, eError);
-    if (eError)
+    tmp2 = (char *)CommStructGet(phandle);
+    if (tmp2 == NULL)
     {
+        eError = OMX_ErrorInsufficientResources;
         goto MUTEX_UNLOCK;
     }
 
-    memset(tmp2,0,sizeof(TArmDspCommunicationStruct));
     phandle->commStruct = (TArmDspCommunicationStruct *)(tmp2);
     phandle->commStruct->iBufferPtr = (OMX_U32) buffer;
     phandle->commStruct->iBufferSize = bufferLen;
@@ -1067,11 +1083,13 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
         eError = OMX_ErrorBadParameter;
         if(tmp2)
         {
-            free(tmp2);
+            CommStructPut(phandle, (TArmDspCommunicationStruct *)tmp2);
             phandle->commStruct = NULL;
         }
         goto MUTEX_UNLOCK;
     }
+    /* nothing cached is held for this slot yet */
+    *DmmMapCacheSlotEntry(phandle, phandle->commStruct) = -1;
     commandId = USN_GPPMSG_SET_BUFF|streamId;
     OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Sending command ID 0x%x",commandId);
     if( pDmmBuf == NULL)
@@ -1085,69 +1103,65 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
     phandle->commStruct->iArmbufferArg = (OMX_U32)buffer;
     if ((buffer != NULL) && (bufferLen != 0))
     {
-        OMX_U32 i;
         int status;
 
         if (phandle->ReUseMap)
         {
             mappedBufferFound = false;
-            for(i = 0; i <= phandle->mapped_buffer_count; i++)
+            nCacheIndex = DmmMapCacheLookup(phandle, buffer, bufferLen);
+            if(nCacheIndex >= 0)
             {
-                if(phandle->mapped_dmm_buffers[i].pAllocated == buffer)
-                {
-                    mappedBufferFound = true;
-                    *pDmmBuf = phandle->mapped_dmm_buffers[i];
-                     OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Re-using pDmmBuf %p mapped %p type %d\n", pDmmBuf, pDmmBuf->pMapped, bufType);
+                mappedBufferFound = true;
+                *DmmMapCacheSlotEntry(phandle, phandle->commStruct) = nCacheIndex;
+                *pDmmBuf = phandle->dmmMapCache.entries[nCacheIndex].dmmBuf;
+                OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "Re-using pDmmBuf %p mapped %p type %d\n", pDmmBuf, pDmmBuf->pMapped, bufType);
 
-                    if(bufType == EMMCodecInputBuffer)
+                if(bufType == EMMCodecInputBuffer)
+                {
+                    if(bufferSizeUsed && (OMX_TRUE == phandle->buf_flush_flag))
                     {
-                        if(bufferSizeUsed && (OMX_TRUE == phandle->buf_flush_flag))
+                        /* Issue a memory flush for input buffer to ensure cache coherency
+                         *  INVALIDATE_TRESHOLD is set to invalidate and write back only the bufferSizeUsed (DSPMSG_WRBK_INVALIDATE_MEM)
+                         *  or the entire cache (DSPMSG_WRBK_INV_ALL). DSP will read the data in this buffer   */
+                        status = DSPProcessor_FlushMemory(phandle->dspCodec->hProc,
+                                pDmmBuf->pAllocated, bufferSizeUsed,
+                                (bufferSizeUsed > INVALIDATE_TRESHOLD) ? DSPMSG_WRBK_INV_ALL : DSPMSG_WRBK_INVALIDATE_MEM);
+                        if(DSP_FAILED(status))
                         {
-                            /* Issue a memory flush for input buffer to ensure cache coherency
-                             *  INVALIDATE_TRESHOLD is set to invalidate and write back only the bufferSizeUsed (DSPMSG_WRBK_INVALIDATE_MEM)
-                             *  or the entire cache (DSPMSG_WRBK_INV_ALL). DSP will read the data in this buffer   */
-                            status = DSPProcessor_FlushMemory(phandle->dspCodec->hProc,
-                                    pDmmBuf->pAllocated, bufferSizeUsed,
-                                    (bufferSizeUsed > INVALIDATE_TRESHOLD) ? DSPMSG_WRBK_INV_ALL : DSPMSG_WRBK_INVALIDATE_MEM);
-                            if(DSP_FAILED(status))
-                            {
-                                eError = OMX_ErrorHardware;
-                                goto MUTEX_UNLOCK;
-                            }
+                            eError = OMX_ErrorHardware;
+                            goto MUTEX_UNLOCK;
                         }
-
                     }
 
-                    else if ((bufType == EMMCodecOuputBuffer) && (OMX_TRUE == phandle->buf_invalidate_flag))
+                }
+
+                else if ((bufType == EMMCodecOuputBuffer) && (OMX_TRUE == phandle->buf_invalidate_flag))
+                {
+                    /* Issue an memory invalidate for output buffer */
+                    if (bufferLen > INVALIDATE_TRESHOLD)
                     {
-                        /* Issue an memory invalidate for output buffer */
-                        if (bufferLen > INVALIDATE_TRESHOLD)
-                        {
 
-                            status = DSPProcessor_FlushMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferLen, DSPMSG_WRBK_INV_ALL);
-                            if(DSP_FAILED(status))
-                            {
-                                eError = OMX_ErrorHardware;
-                                goto MUTEX_UNLOCK;
-                            }
-                        }
-                        else
+                        status = DSPProcessor_FlushMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferLen, DSPMSG_WRBK_INV_ALL);
+                        if(DSP_FAILED(status))
                         {
-                            /*This call is the same as DSPProcessor_FlushMemory
-                             * with the last parameter set to DSPMSG_IVALIDATE_MEM.  In this case the write
-                             * back is not necessary as dsp will write out this buffer without using
-                             * pre-existing information */
-
-                            status = DSPProcessor_InvalidateMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferLen);
-                            if(DSP_FAILED(status))
-                            {
-                                eError = OMX_ErrorHardware;
-                                goto MUTEX_UNLOCK;
-                            }
+                            eError = OMX_ErrorHardware;
+                            goto MUTEX_UNLOCK;
                         }
                     }
+                    else
+                    {
+                        /*This call is the same as DSPProcessor_FlushMemory
+                         * with the last parameter set to DSPMSG_IVALIDATE_MEM.  In this case the write
+                         * back is not necessary as dsp will write out this buffer without using
+                         * pre-existing information */
 
-                    break;
+                        status = DSPProcessor_InvalidateMemory(phandle->dspCodec->hProc, pDmmBuf->pAllocated, bufferLen);
+                        if(DSP_FAILED(status))
+                        {
+                            eError = OMX_ErrorHardware;
+                            goto MUTEX_UNLOCK;
+                        }
+                    }
                 }
             }
 
@@ -1171,10 +1185,9 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
                 phandle->commStruct->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
                 /* storing reserve address for buffer */
                 pDmmBuf->bufReserved = pDmmBuf->pReserved;
-                if(phandle->mapped_buffer_count < MAX_DMM_BUFFERS)
-                {
-                    phandle->mapped_dmm_buffers[phandle->mapped_buffer_count++] = *pDmmBuf;
-                }
+                /* when it is not cached the messaging thread unmaps it */
+                nCacheIndex = DmmMapCacheInsert(phandle, pDmmBuf, bufferLen);
+                *DmmMapCacheSlotEntry(phandle, phandle->commStruct) = nCacheIndex;
             }
         phandle->commStruct->iBufferPtr = (OMX_U32) pDmmBuf->pMapped;
         }
@@ -1239,6 +1252,12 @@ static OMX_ERRORTYPE QueueBuffer (OMX_HANDLETYPE hComponent,
     OMX_PRINT2 (((LCML_CODEC_INTERFACE *)hComponent)->dbg, "after SETBUFF \n");
     DSP_ERROR_EXIT (status, "Send message to node", MUTEX_UNLOCK, hComponent);
 MUTEX_UNLOCK:
+    /* the buffer never reached the DSP, give back the cached mapping */
+    if (eError != OMX_ErrorNone && nCacheIndex >= 0)
+    {
+        DmmMapCacheRelease(phandle, nCacheIndex);
+        *DmmMapCacheSlotEntry(phandle, phandle->commStruct) = -1;
+    }
     pthread_mutex_unlock(&phandle->mutex);
 EXIT:
     return eError;
@@ -1335,6 +1354,37 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
                                 -1, 0, PERF_ModuleComponent);
 #endif
             phandle->pshutdownFlag = 1;
+            if (phandle->bEventDrivenWait)
+            {
+                /* terminating a running node signals its state change
+                 * notification and ends the messaging thread wait at once,
+                 * otherwise the wait runs out after LCML_EVENT_WAIT_TIMEOUT */
+                struct DSP_NODEATTR nodeAttr;
+                int nExit;
+#ifdef CAM_FIX
+                pthread_mutex_lock(AVOID_DSPMMU_mutex);
+#endif
+                status = DSPNode_GetAttr(phandle->dspCodec->hNode, &nodeAttr, sizeof(nodeAttr));
+                if (DSP_SUCCEEDED(status) &&
+                    (nodeAttr.iNodeInfo.nsExecutionState == NODE_RUNNING ||
+                     nodeAttr.iNodeInfo.nsExecutionState == NODE_PAUSED))
+                {
+                    status = DSPNode_Terminate(phandle->dspCodec->hNode, &nExit);
+                    if (DSP_SUCCEEDED(status))
+                    {
+                        phandle->bNodeTerminated = OMX_TRUE;
+                    }
+                    else
+                    {
+                        OMX_ERROR4 (((LCML_CODEC_INTERFACE *)hComponent)->dbg,
+                                    "%d :: node terminate failed 0x%x, waiting for the messaging thread to time out\n",
+                                    __LINE__, status);
+                    }
+                }
+#ifdef CAM_FIX
+                pthread_mutex_unlock(AVOID_DSPMMU_mutex);
+#endif
+            }
             pthreadError = pthread_join(phandle->g_tidMessageThread, NULL);
             if (0 != pthreadError)
             {
@@ -1353,26 +1403,8 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
 
             if (phandle->ReUseMap)
             {
-                OMX_U32 i;
-
                 /* Unmap buffers */
-                for(i=0; i< phandle->mapped_buffer_count; i++)
-                {
-                    DmmUnMap(phandle->dspCodec->hProc,(void*)phandle->mapped_dmm_buffers[i].pMapped,
-                            phandle->mapped_dmm_buffers[i].bufReserved, ((LCML_CODEC_INTERFACE *)hComponent)->dbg);
-                }
-
-                for(i = 0; i <= phandle->mapped_buffer_count; i++)
-                {
-                    phandle->mapped_dmm_buffers[i].pAllocated = 0;
-                    phandle->mapped_dmm_buffers[i].pReserved = 0;
-                    phandle->mapped_dmm_buffers[i].pMapped = 0;
-                    phandle->mapped_dmm_buffers[i].bufReserved = 0;
-                    phandle->mapped_dmm_buffers[i].paramReserved = 0;
-                    phandle->mapped_dmm_buffers[i].nSize = 0;
-                }
-
-                phandle->mapped_buffer_count = 0;
+                DmmMapCacheFlush(phandle);
             }
 
             DeleteDspResource (phandle);
@@ -1546,6 +1578,42 @@ static OMX_ERRORTYPE ControlCodec(OMX_HANDLETYPE hComponent,
             phandle->bUsnEos = OMX_TRUE;
             break;
         }
+        case EMMCodecControlGetPoolMisses:
+        {
+            if (args == NULL || args[0] == NULL)
+            {
+                eError = OMX_ErrorBadParameter;
+                goto EXIT;
+            }
+            pthread_mutex_lock(&phandle->mutex);
+            *((OMX_U32 *)args[0]) = phandle->commStructPoolMisses;
+            pthread_mutex_unlock(&phandle->mutex);
+            break;
+        }
+        case EMMCodecControlEventDrivenWait:
+        {
+            if ((OMX_BOOL)args[0] && phandle->wakeNotification == NULL)
+            {
+                eError = OMX_ErrorUnsupportedSetting;
+                goto EXIT;
+            }
+            phandle->bEventDrivenWait = (OMX_BOOL)args[0];
+            break;
+        }
+        case EMMCodecControlGetDmmCacheStats:
+        {
+            if (args == NULL || args[0] == NULL || args[1] == NULL || args[2] == NULL)
+            {
+                eError = OMX_ErrorBadParameter;
+                goto EXIT;
+            }
+            pthread_mutex_lock(&phandle->mutex);
+            *((OMX_U32 *)args[0]) = phandle->dmmMapCache.nHits;
+            *((OMX_U32 *)args[1]) = phandle->dmmMapCache.nMisses;
+            *((OMX_U32 *)args[2]) = phandle->dmmMapCache.nEvictions;
+            pthread_mutex_unlock(&phandle->mutex);
+            break;
+        }
 
     }
 
@@ -1673,6 +1741,408 @@ EXIT:
     return eError;
 }
 
+/** ========================================================================
+* CommStructPoolInit () preallocates the USN structures handed to the DSP by
+* QueueBuffer, so that the steady-state queue path does no heap work. The pool
+* is sized from the port buffer counts, bounded by QUEUE_SIZE per direction.
+*
+* @param phandle  - LCML handle
+** ==========================================================================*/
+static void CommStructPoolInit(LCML_DSP_INTERFACE *phandle)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    OMX_U32 nIn = phandle->dspCodec->In_BufInfo.nBuffers;
+    OMX_U32 nOut = phandle->dspCodec->Out_BufInfo.nBuffers;
+    char *tmp = NULL;
+
+    if (nIn == 0 || nIn > QUEUE_SIZE)
+    {
+        nIn = QUEUE_SIZE;
+    }
+    if (nOut == 0 || nOut > QUEUE_SIZE)
+    {
+        nOut = QUEUE_SIZE;
+    }
+
+    phandle->commStructPoolCount = 0;
+    phandle->commStructPoolMisses = 0;
+    phandle->commStructPoolSize = nIn + nOut;
+
+    while (phandle->commStructPoolCount < phandle->commStructPoolSize)
+    {
+        LCML_MEMALIGN(tmp, sizeof(TArmDspCommunicationStruct), char, eError);
+        if (eError)
+        {
+            /* not fatal, QueueBuffer falls back to allocating */
+            break;
+        }
+        phandle->commStructPool[phandle->commStructPoolCount++] = (TArmDspCommunicationStruct *)tmp;
+    }
+    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)phandle->pCodecinterfacehandle)->dbg,
+                "USN structure pool: %lu of %lu preallocated\n", phandle->commStructPoolCount, phandle->commStructPoolSize);
+}
+
+/** ========================================================================
+* CommStructPoolDeinit () frees the structures held by the pool. Must be
+* called with phandle->mutex held.
+*
+* @param phandle  - LCML handle
+** ==========================================================================*/
+static void CommStructPoolDeinit(LCML_DSP_INTERFACE *phandle)
+{
+    char *tmp = NULL;
+
+    while (phandle->commStructPoolCount > 0)
+    {
+        tmp = (char *)phandle->commStructPool[--phandle->commStructPoolCount];
+        phandle->commStructPool[phandle->commStructPoolCount] = NULL;
+        LCML_MEMFREE(tmp, NULL);
+    }
+    phandle->commStructPoolSize = 0;
+}
+
+/** ========================================================================
+* CommStructGet () returns a zeroed USN structure, taken from the pool when
+* one is free. Must be called with phandle->mutex held.
+*
+* @param phandle  - LCML handle
+*
+* @retval NULL if the pool is empty and the allocation failed
+** ==========================================================================*/
+static TArmDspCommunicationStruct* CommStructGet(LCML_DSP_INTERFACE *phandle)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    char *tmp = NULL;
+
+    if (phandle->commStructPoolCount > 0)
+    {
+        tmp = (char *)phandle->commStructPool[--phandle->commStructPoolCount];
+    }
+    else
+    {
+        phandle->commStructPoolMisses++;
+        LCML_MEMALIGN(tmp, sizeof(TArmDspCommunicationStruct), char, eError);
+        if (eError)
+        {
+            return NULL;
+        }
+    }
+
+    memset(tmp, 0, sizeof(TArmDspCommunicationStruct));
+    return (TArmDspCommunicationStruct *)tmp;
+}
+
+/** ========================================================================
+* CommStructPut () returns a USN structure to the pool, or frees it when the
+* pool is already full. Must be called with phandle->mutex held.
+*
+* @param phandle  - LCML handle
+* @param pStruct  - structure obtained from CommStructGet
+** ==========================================================================*/
+static void CommStructPut(LCML_DSP_INTERFACE *phandle, TArmDspCommunicationStruct *pStruct)
+{
+    char *tmp = (char *)pStruct;
+    OMX_S32 *pEntry;
+
+    if (tmp == NULL)
+    {
+        return;
+    }
+
+    /* the buffer described by the structure is back from the DSP */
+    pEntry = DmmMapCacheSlotEntry(phandle, pStruct);
+    if (*pEntry >= 0)
+    {
+        DmmMapCacheRelease(phandle, *pEntry);
+        *pEntry = -1;
+    }
+
+    if (phandle->commStructPoolCount < phandle->commStructPoolSize)
+    {
+        phandle->commStructPool[phandle->commStructPoolCount++] = pStruct;
+    }
+    else
+    {
+        LCML_MEMFREE(tmp, NULL);
+    }
+}
+
+/** ========================================================================
+* DmmMapCacheInit () empties the DMM mapping cache used with ReUseMap.
+*
+* @param pCache  - cache to initialize
+** ==========================================================================*/
+static void DmmMapCacheInit(LCML_DMM_MAP_CACHE *pCache)
+{
+    OMX_S32 i;
+
+    memset(pCache, 0, sizeof(LCML_DMM_MAP_CACHE));
+    for (i = 0; i < DMM_MAP_HASH_SIZE; i++)
+    {
+        pCache->buckets[i] = -1;
+    }
+    for (i = 0; i < QUEUE_SIZE; i++)
+    {
+        pCache->nInputSlotEntry[i] = -1;
+        pCache->nOutputSlotEntry[i] = -1;
+    }
+    for (i = 0; i < MAX_DMM_BUFFERS; i++)
+    {
+        pCache->entries[i].nHashNext = (i + 1 < MAX_DMM_BUFFERS) ? i + 1 : -1;
+        pCache->entries[i].nLruPrev = -1;
+        pCache->entries[i].nLruNext = -1;
+    }
+    pCache->nFree = 0;
+    pCache->nLruHead = -1;
+    pCache->nLruTail = -1;
+}
+
+/* buffers are at least cache line aligned, fold the page number in as well */
+#define DMM_MAP_HASH(p) \
+    (((((OMX_U32)(p)) >> 7) ^ (((OMX_U32)(p)) >> 12)) & (DMM_MAP_HASH_SIZE - 1))
+
+static void DmmMapCacheLruUnlink(LCML_DMM_MAP_CACHE *pCache, OMX_S32 idx)
+{
+    LCML_DMM_MAP_ENTRY *pEntry = &pCache->entries[idx];
+
+    if (pEntry->nLruPrev >= 0)
+        pCache->entries[pEntry->nLruPrev].nLruNext = pEntry->nLruNext;
+    else
+        pCache->nLruHead = pEntry->nLruNext;
+
+    if (pEntry->nLruNext >= 0)
+        pCache->entries[pEntry->nLruNext].nLruPrev = pEntry->nLruPrev;
+    else
+        pCache->nLruTail = pEntry->nLruPrev;
+
+    pEntry->nLruPrev = -1;
+    pEntry->nLruNext = -1;
+}
+
+static void DmmMapCacheLruPushHead(LCML_DMM_MAP_CACHE *pCache, OMX_S32 idx)
+{
+    LCML_DMM_MAP_ENTRY *pEntry = &pCache->entries[idx];
+
+    pEntry->nLruPrev = -1;
+    pEntry->nLruNext = pCache->nLruHead;
+    if (pCache->nLruHead >= 0)
+        pCache->entries[pCache->nLruHead].nLruPrev = idx;
+    else
+        pCache->nLruTail = idx;
+    pCache->nLruHead = idx;
+}
+
+/** ========================================================================
+* DmmMapCacheLookup () looks up the mapping of a buffer queued with ReUseMap.
+* A hit takes a reference on the mapping and makes it the most recently
+* used one. Must be called with phandle->mutex held.
+*
+* @param phandle  - LCML handle
+* @param pArmPtr  - ARM address of the buffer
+* @param nLen     - length of the buffer
+*
+* @retval index of the cached mapping, -1 on a miss
+** ==========================================================================*/
+static OMX_S32 DmmMapCacheLookup(LCML_DSP_INTERFACE *phandle, void *pArmPtr, OMX_U32 nLen)
+{
+    LCML_DMM_MAP_CACHE *pCache = &phandle->dmmMapCache;
+    OMX_S32 idx = pCache->buckets[DMM_MAP_HASH(pArmPtr)];
+
+    while (idx >= 0)
+    {
+        LCML_DMM_MAP_ENTRY *pEntry = &pCache->entries[idx];
+
+        if (pEntry->dmmBuf.pAllocated == pArmPtr && pEntry->nLen == nLen)
+        {
+            pEntry->nRefCount++;
+            if (pCache->nLruHead != idx)
+            {
+                DmmMapCacheLruUnlink(pCache, idx);
+                DmmMapCacheLruPushHead(pCache, idx);
+            }
+            pCache->nHits++;
+            return idx;
+        }
+        idx = pEntry->nHashNext;
+    }
+
+    pCache->nMisses++;
+    return -1;
+}
+
+/** ========================================================================
+* DmmMapCacheRemove () unlinks an entry from its bucket and the LRU list and
+* puts it back on the free list. The mapping itself is left untouched.
+** ==========================================================================*/
+static void DmmMapCacheRemove(LCML_DMM_MAP_CACHE *pCache, OMX_S32 idx)
+{
+    LCML_DMM_MAP_ENTRY *pEntry = &pCache->entries[idx];
+    OMX_S32 *pLink = &pCache->buckets[DMM_MAP_HASH(pEntry->dmmBuf.pAllocated)];
+
+    while (*pLink != idx)
+    {
+        pLink = &pCache->entries[*pLink].nHashNext;
+    }
+    *pLink = pEntry->nHashNext;
+
+    DmmMapCacheLruUnlink(pCache, idx);
+    memset(&pEntry->dmmBuf, 0, sizeof(DMM_BUFFER_OBJ));
+    pEntry->nLen = 0;
+    pEntry->nRefCount = 0;
+    pEntry->nHashNext = pCache->nFree;
+    pCache->nFree = idx;
+}
+
+/** ========================================================================
+* DmmMapCacheInsert () adds a fresh mapping, referenced once by the buffer
+* being queued. When the cache is full the least recently used mapping that
+* no queued buffer is using is unmapped. Must be called with phandle->mutex
+* held.
+*
+* @param phandle  - LCML handle
+* @param pDmmBuf  - mapping returned by DmmMap
+* @param nLen     - length of the buffer
+*
+* @retval index of the new entry, -1 when every mapping is in use; the
+*         caller then owns the mapping and unmaps it when the buffer returns
+** ==========================================================================*/
+static OMX_S32 DmmMapCacheInsert(LCML_DSP_INTERFACE *phandle, DMM_BUFFER_OBJ *pDmmBuf, OMX_U32 nLen)
+{
+    LCML_DMM_MAP_CACHE *pCache = &phandle->dmmMapCache;
+    LCML_DMM_MAP_ENTRY *pEntry;
+    OMX_S32 idx;
+    OMX_U32 hash;
+
+    if (pCache->nFree < 0)
+    {
+        idx = pCache->nLruTail;
+        while (idx >= 0 && pCache->entries[idx].nRefCount != 0)
+        {
+            idx = pCache->entries[idx].nLruPrev;
+        }
+        if (idx < 0)
+        {
+            /* every mapping is in use, the new one is not cached */
+            OMX_ERROR4 (((LCML_CODEC_INTERFACE *)phandle->pCodecinterfacehandle)->dbg,
+                        "DMM mapping cache full, buffer %p is not cached\n", pDmmBuf->pAllocated);
+            return -1;
+        }
+        pEntry = &pCache->entries[idx];
+        OMX_PRBUFFER1 (((LCML_CODEC_INTERFACE *)phandle->pCodecinterfacehandle)->dbg,
+                       "Evicting DMM mapping %p of buffer %p\n", pEntry->dmmBuf.pMapped, pEntry->dmmBuf.pAllocated);
+        DmmUnMap(phandle->dspCodec->hProc, pEntry->dmmBuf.pMapped, pEntry->dmmBuf.bufReserved,
+                 ((LCML_CODEC_INTERFACE *)phandle->pCodecinterfacehandle)->dbg);
+        DmmMapCacheRemove(pCache, idx);
+        pCache->nEvictions++;
+    }
+
+    idx = pCache->nFree;
+    pEntry = &pCache->entries[idx];
+    pCache->nFree = pEntry->nHashNext;
+
+    hash = DMM_MAP_HASH(pDmmBuf->pAllocated);
+    pEntry->dmmBuf = *pDmmBuf;
+    pEntry->nLen = nLen;
+    pEntry->nRefCount = 1;
+    pEntry->nHashNext = pCache->buckets[hash];
+    pCache->buckets[hash] = idx;
+    DmmMapCacheLruPushHead(pCache, idx);
+    return idx;
+}
+
+/** ========================================================================
+* DmmMapCacheRelease () drops the reference taken on an entry when a buffer
+* was queued, once the DSP gave the buffer back or the queueing failed. The
+* entry is the one recorded for that buffer, so that another mapping of the
+* same address with a different length keeps its reference. Must be called
+* with phandle->mutex held.
+*
+* @param phandle  - LCML handle
+* @param idx      - entry returned by DmmMapCacheLookup or DmmMapCacheInsert
+** ==========================================================================*/
+static void DmmMapCacheRelease(LCML_DSP_INTERFACE *phandle, OMX_S32 idx)
+{
+    LCML_DMM_MAP_CACHE *pCache = &phandle->dmmMapCache;
+
+    if (idx >= 0 && idx < MAX_DMM_BUFFERS && pCache->entries[idx].nRefCount > 0)
+    {
+        pCache->entries[idx].nRefCount--;
+    }
+}
+
+/** ========================================================================
+* DmmMapCacheSlotEntry () gives the cache entry held by the buffer a USN
+* structure describes, recorded for the queue slot the structure went in.
+*
+* @param phandle  - LCML handle
+* @param pStruct  - structure queued by QueueBuffer
+** ==========================================================================*/
+static OMX_S32 *DmmMapCacheSlotEntry(LCML_DSP_INTERFACE *phandle, TArmDspCommunicationStruct *pStruct)
+{
+    LCML_DMM_MAP_CACHE *pCache = &phandle->dmmMapCache;
+
+    /* same choice of storage as QueueBuffer */
+    if (pStruct->iStreamID % 2)
+    {
+        return &pCache->nOutputSlotEntry[pStruct->Bufoutindex % QUEUE_SIZE];
+    }
+    return &pCache->nInputSlotEntry[pStruct->BufInindex % QUEUE_SIZE];
+}
+
+/** ========================================================================
+* DmmMapCacheFlush () unmaps every cached mapping, used on codec destroy once
+* the messaging thread has exited.
+*
+* @param phandle  - LCML handle
+** ==========================================================================*/
+static void DmmMapCacheFlush(LCML_DSP_INTERFACE *phandle)
+{
+    LCML_DMM_MAP_CACHE *pCache = &phandle->dmmMapCache;
+
+    while (pCache->nLruHead >= 0)
+    {
+        LCML_DMM_MAP_ENTRY *pEntry = &pCache->entries[pCache->nLruHead];
+
+        DmmUnMap(phandle->dspCodec->hProc, pEntry->dmmBuf.pMapped, pEntry->dmmBuf.bufReserved,
+                 ((LCML_CODEC_INTERFACE *)phandle->pCodecinterfacehandle)->dbg);
+        DmmMapCacheRemove(pCache, pCache->nLruHead);
+    }
+}
+
+/** ========================================================================
+* RegisterWakeNotification () registers a node state change notification
+* that lets the messaging thread wait without a timeout, see
+* EMMCodecControlEventDrivenWait. Failure only disables that mode.
+*
+* @param phandle  - LCML handle
+** ==========================================================================*/
+static void RegisterWakeNotification(LCML_DSP_INTERFACE *phandle)
+{
+    OMX_ERRORTYPE eError = OMX_ErrorNone;
+    struct DSP_NOTIFICATION* notification;
+    int status;
+
+    phandle->wakeNotification = NULL;
+    phandle->bEventDrivenWait = OMX_FALSE;
+
+    LCML_MALLOC(notification,sizeof(struct DSP_NOTIFICATION),struct DSP_NOTIFICATION, eError);
+    if(eError)
+    {
+        return;
+    }
+    memset(notification,0,sizeof(struct DSP_NOTIFICATION));
+
+    status = DSPNode_RegisterNotify(phandle->dspCodec->hNode, DSP_NODESTATECHANGE, DSP_SIGNALEVENT, notification);
+    if (DSP_FAILED(status))
+    {
+        OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)phandle->pCodecinterfacehandle)->dbg,
+                    "%d :: node state change notify not available: 0x%x\n", __LINE__, status);
+        LCML_FREE(notification);
+        return;
+    }
+    phandle->wakeNotification = notification;
+}
+
 /** ========================================================================
 * FreeResources () method is used to allocate the memory using DMM.
 *
@@ -1700,6 +2170,8 @@ OMX_ERRORTYPE FreeResources (LCML_DSP_INTERFACE *hInterface)
         pthread_mutex_destroy(&codec->m_isStopped_mutex);
         pthread_mutex_lock(&codec->mutex);
 
+        CommStructPoolDeinit(codec);
+
         if(codec->g_aNotificationObjects[0]!= NULL)
         {
             LCML_FREE(codec->g_aNotificationObjects[0]);
@@ -1716,6 +2188,11 @@ OMX_ERRORTYPE FreeResources (LCML_DSP_INTERFACE *hInterface)
                 codec->g_aNotificationObjects[2] = NULL;
             }
  #endif
+            if(codec->wakeNotification != NULL)
+            {
+                LCML_FREE(codec->wakeNotification);
+                codec->wakeNotification = NULL;
+            }
 //            OMX_DBG_CLOSE((struct OMX_TI_Debug )(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->dbg));
             LCML_FREE(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle));
             hInterface->pCodecinterfacehandle = NULL;
@@ -1755,8 +2232,11 @@ OMX_ERRORTYPE DeleteDspResource(LCML_DSP_INTERFACE *hInterface)
     status = DSPNode_GetAttr(hInterface->dspCodec->hNode, &nodeAttr, sizeof(nodeAttr));
     DSP_ERROR_EXIT (status, "DeInit: Error in Node GetAtt ", EXIT, hInterface->pCodecinterfacehandle);
 
-    status = DSPNode_Terminate(hInterface->dspCodec->hNode, &nExit);
-    OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: LCML:: Node Has Been Terminated --1\n",__LINE__);
+    if (!hInterface->bNodeTerminated)
+    {
+        status = DSPNode_Terminate(hInterface->dspCodec->hNode, &nExit);
+        OMX_PRINT1 (((LCML_CODEC_INTERFACE *)hInterface->pCodecinterfacehandle)->dbg, "%d :: LCML:: Node Has Been Terminated --1\n",__LINE__);
+    }
     codec = (LCML_DSP_INTERFACE *)(((LCML_CODEC_INTERFACE*)hInterface->pCodecinterfacehandle)->pCodec);
     if(codec->g_aNotificationObjects[0]!= NULL)
     {
@@ -1833,6 +2313,13 @@ void* MessagingThread(void* arg)
     unsigned int index=0;
     LCML_MESSAGINGTHREAD_STATE threadState = EMessagingThreadCodecStopped;
     int waitForEventsTimeout = 1000;
+#ifdef __ERROR_PROPAGATION__
+    struct DSP_NOTIFICATION *aWaitObjects[4];
+    UINT nWaitObjects = 3;
+#else
+    struct DSP_NOTIFICATION *aWaitObjects[2];
+    UINT nWaitObjects = 1;
+#endif
 
     /* we should not need to wait to retrieve a message, but keep this
        in case we need to test with other values */
@@ -1854,6 +2341,13 @@ void* MessagingThread(void* arg)
         pthread_mutex_lock(&((LCML_DSP_INTERFACE *)arg)->m_isStopped_mutex);
     }
 
+    /* the wake notification comes last so that the message and error indexes do not move */
+    memcpy(aWaitObjects, ((LCML_DSP_INTERFACE *)arg)->g_aNotificationObjects, nWaitObjects * sizeof(aWaitObjects[0]));
+    if (((LCML_DSP_INTERFACE *)arg)->wakeNotification != NULL)
+    {
+        aWaitObjects[nWaitObjects++] = ((LCML_DSP_INTERFACE *)arg)->wakeNotification;
+    }
+
     /* get message from DSP */
     while (1)
     {
@@ -1863,7 +2357,11 @@ void* MessagingThread(void* arg)
             break;
         }
 
-        if (threadState == EMessagingThreadCodecRunning) {
+        if (((LCML_DSP_INTERFACE *)arg)->bEventDrivenWait) {
+            /* shutdown wakes the wait through the node state change notification */
+            waitForEventsTimeout = LCML_EVENT_WAIT_TIMEOUT;
+        }
+        else if (threadState == EMessagingThreadCodecRunning) {
             waitForEventsTimeout = 10000;
         }
         /* set the timeouts lower when the codec is stopped so that thread deletion response will be faster */
@@ -1871,11 +2369,7 @@ void* MessagingThread(void* arg)
             waitForEventsTimeout = 10;
         }
 
-#ifdef __ERROR_PROPAGATION__
-        status = DSPManager_WaitForEvents(((LCML_DSP_INTERFACE *)arg)->g_aNotificationObjects, 3, &index, waitForEventsTimeout);
-#else
-        status = DSPManager_WaitForEvents(((LCML_DSP_INTERFACE *)arg)->g_aNotificationObjects, 1, &index, waitForEventsTimeout);
-#endif
+        status = DSPManager_WaitForEvents(aWaitObjects, nWaitObjects, &index, waitForEventsTimeout);
         if (DSP_SUCCEEDED(status))
         {
             OMX_PRDSP2 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, "GOT notofication FROM DSP HANDLE IT \n");
@@ -2033,7 +2527,7 @@ void* MessagingThread(void* arg)
                                         "GOT MESSAGE EMMCodecBufferProcessed and now unmapping buufer %lx\n size=%ld",
                                              tmpDspStructAddress ->iBufferPtr, tmpDspStructAddress ->iBufferSize);
                                 /* Reuse implementation */
-                                if (!hDSPInterface->ReUseMap)
+                                if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                 {
                                     DmmUnMap(hDSPInterface->dspCodec->hProc,
                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2070,7 +2564,7 @@ void* MessagingThread(void* arg)
                             DmmUnMap(hDSPInterface->dspCodec->hProc, pDmmBuf->pMapped, pDmmBuf->pReserved, ((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg);
                             pDmmBuf->pMapped = 0;
                             tmp2 = (char *)tmpDspStructAddress;
-                            LCML_MEMFREE(tmp2, NULL);
+                            CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
 
                             /* free(tmpDspStructAddress); */
                             tmpDspStructAddress = NULL;
@@ -2134,7 +2628,7 @@ void* MessagingThread(void* arg)
                                             (void *)msg.dwArg1);
                                     if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
                                     {
-                                        if (!hDSPInterface->ReUseMap)
+                                        if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                         {
                                             DmmUnMap(hDSPInterface->dspCodec->hProc,
                                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2169,7 +2663,7 @@ void* MessagingThread(void* arg)
                                     {
                                         tmp2 = (char *) tmpDspStructAddress;
                                     }
-                                    LCML_MEMFREE(tmp2, NULL);
+                                    CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
 
                                     hDSPInterface->Arminputstorage[i] = NULL;
                                     tmpDspStructAddress     = NULL;
@@ -2213,7 +2707,7 @@ void* MessagingThread(void* arg)
                                     {
                                         OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
                                                 "tmpDspStructAddress ->iBufferPtr is not NULL\n");
-                                        if (!hDSPInterface->ReUseMap)
+                                        if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                         {
                                             DmmUnMap(hDSPInterface->dspCodec->hProc,
                                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2250,7 +2744,7 @@ void* MessagingThread(void* arg)
 
                                     tmpDspStructAddress->iBufSizeUsed = 0;
                                     args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
-                                    LCML_MEMFREE(tmp2, NULL);
+                                    CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
 
                                     hDSPInterface->Armoutputstorage[k] = NULL;
                                     tmpDspStructAddress = NULL;
@@ -2370,7 +2864,7 @@ void* MessagingThread(void* arg)
                                     if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
                                     {
                                         /* Reuse implementation */
-                                        if (!hDSPInterface->ReUseMap)
+                                        if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                         {
                                             DmmUnMap(hDSPInterface->dspCodec->hProc,
                                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2409,7 +2903,7 @@ void* MessagingThread(void* arg)
                                         tmp2 = (char*)tmpDspStructAddress;
                                     }
                                     hDSPInterface->Arminputstorage[i] = NULL;
-                                    LCML_MEMFREE(tmp2, NULL);
+                                    CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
                                     tmpDspStructAddress     = NULL;
 #ifdef __PERF_INSTRUMENTATION__
                                     PERF_XferingBuffer(hDSPInterface->pPERFcomp,
@@ -2480,7 +2974,7 @@ void* MessagingThread(void* arg)
                                         /* Reuse implementation */
                                         OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
                                                 "tmpDspStructAddress ->iBufferPtr is not NULL\n");
-                                        if (!hDSPInterface->ReUseMap)
+                                        if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                         {
                                             DmmUnMap(hDSPInterface->dspCodec->hProc,
                                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2521,7 +3015,7 @@ void* MessagingThread(void* arg)
                                     args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
 
                                     hDSPInterface->Armoutputstorage[i] = NULL;
-                                    LCML_MEMFREE(tmp2, NULL);
+                                    CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
                                     tmpDspStructAddress = NULL;
 #ifdef __PERF_INSTRUMENTATION__
                                     PERF_XferingBuffer(hDSPInterface->pPERFcomp,
@@ -2593,7 +3087,7 @@ void* MessagingThread(void* arg)
                                     if (tmpDspStructAddress->iBufferPtr != (OMX_U32)NULL)
                                     {
                                         /* Reuse implementation */
-                                        if (!hDSPInterface->ReUseMap)
+                                        if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                         {
                                             DmmUnMap(hDSPInterface->dspCodec->hProc,
                                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2627,7 +3121,7 @@ void* MessagingThread(void* arg)
 
                                     tmp2 = (char*)tmpDspStructAddress;
                                     hDSPInterface->Arminputstorage[i] = NULL;
-                                    LCML_MEMFREE(tmp2, NULL);
+                                    CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
                                     tmpDspStructAddress     = NULL;
 #ifdef __PERF_INSTRUMENTATION__
                                     PERF_XferingBuffer(hDSPInterface->pPERFcomp,
@@ -2682,7 +3176,7 @@ void* MessagingThread(void* arg)
                                         /* Reuse implementation */
                                         OMX_PRINT1 (((LCML_CODEC_INTERFACE *)((LCML_DSP_INTERFACE *)arg)->pCodecinterfacehandle)->dbg, 
                                                 "tmpDspStructAddress ->iBufferPtr is not NULL\n");
-                                        if (!hDSPInterface->ReUseMap)
+                                        if (!hDSPInterface->ReUseMap || *DmmMapCacheSlotEntry(hDSPInterface, tmpDspStructAddress) < 0)
                                         {
                                             DmmUnMap(hDSPInterface->dspCodec->hProc,
                                                     (void*)tmpDspStructAddress->iBufferPtr,
@@ -2723,7 +3217,7 @@ void* MessagingThread(void* arg)
                                     args[8] = (void *) tmpDspStructAddress->iBufSizeUsed ;
 
                                     hDSPInterface->Armoutputstorage[i] = NULL;
-                                    LCML_MEMFREE(tmp2, NULL);
+                                    CommStructPut(hDSPInterface, (TArmDspCommunicationStruct *)tmp2);
                                     tmpDspStructAddress = NULL;
 #ifdef __PERF_INSTRUMENTATION__
                                     PERF_XferingBuffer(hDSPInterface->pPERFcomp,
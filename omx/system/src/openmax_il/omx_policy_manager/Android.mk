@@ -31,3 +31,4 @@ LOCAL_MODULE_TAGS := optional
 
 include $(BUILD_EXECUTABLE)
 
+include $(call all-subdir-makefiles)
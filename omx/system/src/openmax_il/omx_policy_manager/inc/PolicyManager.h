@@ -83,6 +83,13 @@
 #define PM_NUM_COMPONENTS 47
 #define OMX_POLICY_MAX_COMBINATION_LENGTH 50
 #define OMX_POLICY_MAX_COMBINATIONS 111
+#define OMX_POLICY_COMBINATION_WORDS ((OMX_POLICY_MAX_COMBINATIONS + 31) / 32)
+
+/* compiled policy table cache, "PMTC" */
+#define PM_CACHE_MAGIC 0x43544d50
+#define PM_CACHE_VERSION 1
+#define PM_CACHE_SUFFIX ".cache"
+#define PM_CACHE_DIR "/data/misc/omx"    /* created by SavePolicyCache */
 
 char *PM_ComponentTable[PM_NUM_COMPONENTS]= {
 	/* audio component*/
@@ -154,10 +161,29 @@ typedef struct OMX_POLICY_COMBINATION {
 } OMX_POLICY_COMBINATION;
 
 
-typedef struct OMX_POLICY_COMBINATION_LIST {
-    OMX_U8 numCombinations;
-    OMX_U8 combinationList[OMX_POLICY_MAX_COMBINATIONS];
-}OMX_POLICY_COMBINATION_LIST;
+/* A set of combinations, bit n set for combination n of the table */
+typedef struct OMX_POLICY_COMBINATION_SET {
+    OMX_U32 bits[OMX_POLICY_COMBINATION_WORDS];
+} OMX_POLICY_COMBINATION_SET;
+
+/* The policy table compiled for lookups: which combinations support each
+   component, and the priority of each component within each combination
+   (-1 if the combination does not support it) */
+typedef struct OMX_POLICY_INDEX {
+    OMX_U32 numCombinations;
+    OMX_POLICY_COMBINATION_SET supportingCombinations[PM_NUM_COMPONENTS];
+    OMX_S16 priority[OMX_POLICY_MAX_COMBINATIONS][PM_NUM_COMPONENTS];
+} OMX_POLICY_INDEX;
+
+/* Header of the cache file, the index follows it. The size and mtime of the
+   text table tell whether the cache is still valid. */
+typedef struct OMX_POLICY_CACHE_HEADER {
+    OMX_U32 nMagic;
+    OMX_U32 nVersion;
+    OMX_U32 nIndexSize;
+    OMX_U32 nTableSize;
+    OMX_U32 nTableTime;
+} OMX_POLICY_CACHE_HEADER;
 
 typedef struct OMX_POLICY_MANAGER_COMPONENTS_TYPE {
     OMX_HANDLETYPE componentHandle;
@@ -181,10 +207,16 @@ void RM_reverse(char s[]);
 void GrantPolicy(OMX_HANDLETYPE hComponent, OMX_U8 aComponentIndex, OMX_U8 aPriority, OMX_U32 aPid);
 void RemoveComponentFromList(OMX_HANDLETYPE hComponent, OMX_U32 aPid, OMX_U32 cComponentIndex);
 int PopulatePolicyTable();
+void CompilePolicyTable();
+void PolicyCachePath(const char *tablefile, char *cachefile, size_t size);
+int LoadPolicyCache(const char *tablefile);
+void SavePolicyCache(const char *tablefile);
 OMX_COMPONENTINDEXTYPE PolicyStringToIndex(char* aString) ;
 OMX_BOOL CheckActiveCombination(OMX_COMPONENTINDEXTYPE componentRequestingPolicy, int *priority);
 OMX_BOOL CheckAllCombinations(OMX_COMPONENTINDEXTYPE componentRequestingPolicy, int *combination, int *priority);
-OMX_POLICY_COMBINATION_LIST GetSupportingCombinations(OMX_COMPONENTINDEXTYPE componentRequestingPolicy);
+OMX_BOOL GetSupportingCombinations(OMX_COMPONENTINDEXTYPE componentRequestingPolicy, OMX_POLICY_COMBINATION_SET *combinations);
+int FirstCombination(const OMX_POLICY_COMBINATION_SET *combinations);
+int LastCombination(const OMX_POLICY_COMBINATION_SET *combinations);
 OMX_BOOL CanAllComponentsCoexist(OMX_COMPONENTINDEXTYPE componentRequestingPolicy,int *combination);
 int GetPriority(OMX_COMPONENTINDEXTYPE component, int combination);
 
@@ -54,6 +54,7 @@
 #include <fcntl.h>      // for opening files.
 #include <errno.h>      // for error handling support
 #include <linux/soundcard.h>
+#include <limits.h>     // for PATH_MAX
 
 #ifdef __PERF_INSTRUMENTATION__
 #include "perf.h"
@@ -79,6 +80,9 @@ OMX_POLICY_COMPONENT_PRIORITY activeComponentList[100];
 OMX_POLICY_COMPONENT_PRIORITY pendingComponentList[100];
 
 OMX_POLICY_COMBINATION policyCombinationTable[OMX_POLICY_MAX_COMBINATIONS];
+/* what the request path looks at, built from policyCombinationTable or
+   loaded from the cache (in which case policyCombinationTable stays empty) */
+OMX_POLICY_INDEX compiledPolicyIndex;
 
 OMX_U8 activePolicyCombination;
 OMX_U8 numCombinations;
@@ -221,15 +225,13 @@ void HandleRequestPolicy(POLICYMANAGER_COMMANDDATATYPE cmd)
     int combination;
     int priority;
     int returnValue;
-    OMX_POLICY_COMBINATION_LIST combinationList;
+    OMX_POLICY_COMBINATION_SET combinations;
 
     /* if this is the first request make sure that there's a combination that supports it */
     if (registeredComponents == 0) {
-        combinationList = GetSupportingCombinations(cmd.param1);
-
-        if (combinationList.numCombinations > 0) {
+        if (GetSupportingCombinations(cmd.param1, &combinations)) {
             /* if it is supported, arbitrarily choose the first combination table entry that supports it */
-            activePolicyCombination = combinationList.combinationList[0];
+            activePolicyCombination = FirstCombination(&combinations);
             /* and grant policy */
             priority = GetPriority(cmd.param1, activePolicyCombination);
             
@@ -470,6 +472,11 @@ int PopulatePolicyTable()
         ret = -1;
         goto EXIT;
     }
+    else if (LoadPolicyCache(tablefile) == 0)
+    {
+        fprintf (stderr, "[Policy Manager] Loaded compiled Policy Table for: %s\n", tablefile);
+        goto EXIT;
+    }
     else
     {
 
@@ -547,10 +554,148 @@ int PopulatePolicyTable()
     }
 
     numCombinations = combinationIndex;    
+    CompilePolicyTable();
+    SavePolicyCache(tablefile);
 EXIT:    
     return(ret);
 }
 
+/*
+   Build compiledPolicyIndex from policyCombinationTable
+*/
+void CompilePolicyTable()
+{
+    int i,j;
+    int component;
+
+    memset(&compiledPolicyIndex, 0, sizeof(compiledPolicyIndex));
+    memset(compiledPolicyIndex.priority, 0xff, sizeof(compiledPolicyIndex.priority));
+    compiledPolicyIndex.numCombinations = numCombinations;
+
+    for (i=0; i < numCombinations; i++) {
+        for (j=0; j < policyCombinationTable[i].numComponentsInCombination; j++) {
+            component = policyCombinationTable[i].component[j].component;
+            if (component < 0 || component >= PM_NUM_COMPONENTS) {
+                continue;
+            }
+            /* a component listed twice keeps its first priority */
+            if (compiledPolicyIndex.priority[i][component] == -1) {
+                compiledPolicyIndex.priority[i][component] = policyCombinationTable[i].component[j].priority;
+            }
+            compiledPolicyIndex.supportingCombinations[component].bits[i / 32] |= 1U << (i % 32);
+        }
+    }
+}
+
+/*
+   The cache goes to PM_TBLCACHE if set, else to PM_CACHE_DIR under the
+   name of the text table: the table itself sits on read-only /system.
+*/
+void PolicyCachePath(const char *tablefile, char *cachefile, size_t size)
+{
+    char *cacheenv = getenv("PM_TBLCACHE");
+    const char *name = strrchr(tablefile, '/');
+
+    if (cacheenv != NULL) {
+        strncpy(cachefile, cacheenv, size - 1);
+        cachefile[size - 1] = '\0';
+    }
+    else {
+        snprintf(cachefile, size, "%s/%s%s", PM_CACHE_DIR,
+                 name ? name + 1 : tablefile, PM_CACHE_SUFFIX);
+    }
+}
+
+/*
+   Load compiledPolicyIndex from the cache. Returns 0 if the cache exists
+   and matches the table.
+*/
+int LoadPolicyCache(const char *tablefile)
+{
+    char cachefile[PATH_MAX];
+    OMX_POLICY_CACHE_HEADER header;
+    struct stat sb;
+    int fd;
+    int ret = -1;
+
+    if (stat(tablefile, &sb) < 0) {
+        return -1;
+    }
+    PolicyCachePath(tablefile, cachefile, sizeof(cachefile));
+
+    fd = open(cachefile, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (read(fd, &header, sizeof(header)) == sizeof(header) &&
+        header.nMagic == PM_CACHE_MAGIC &&
+        header.nVersion == PM_CACHE_VERSION &&
+        header.nIndexSize == sizeof(compiledPolicyIndex) &&
+        header.nTableSize == (OMX_U32)sb.st_size &&
+        header.nTableTime == (OMX_U32)sb.st_mtime &&
+        read(fd, &compiledPolicyIndex, sizeof(compiledPolicyIndex)) == sizeof(compiledPolicyIndex) &&
+        compiledPolicyIndex.numCombinations > 0 &&
+        compiledPolicyIndex.numCombinations <= OMX_POLICY_MAX_COMBINATIONS) {
+        numCombinations = compiledPolicyIndex.numCombinations;
+        ret = 0;
+    }
+    else {
+        PM_DPRINT("[Policy Manager] Policy table cache is stale\n");
+    }
+    close(fd);
+    return ret;
+}
+
+/*
+   Write compiledPolicyIndex to the cache. PM_CACHE_DIR is created on the
+   first run, owned by the policy manager. If it cannot be created or
+   written the next start parses the text again.
+*/
+void SavePolicyCache(const char *tablefile)
+{
+    char cachefile[PATH_MAX];
+    char tmpfile[PATH_MAX];
+    OMX_POLICY_CACHE_HEADER header;
+    struct stat sb;
+    int fd;
+
+    if (stat(tablefile, &sb) < 0) {
+        return;
+    }
+    PolicyCachePath(tablefile, cachefile, sizeof(cachefile));
+    snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", cachefile);
+
+    if (getenv("PM_TBLCACHE") == NULL &&
+        mkdir(PM_CACHE_DIR, 0770) < 0 && errno != EEXIST) {
+        PM_DPRINT("[Policy Manager] Cannot create %s: %s\n", PM_CACHE_DIR, strerror(errno));
+        return;
+    }
+
+    header.nMagic = PM_CACHE_MAGIC;
+    header.nVersion = PM_CACHE_VERSION;
+    header.nIndexSize = sizeof(compiledPolicyIndex);
+    header.nTableSize = sb.st_size;
+    header.nTableTime = sb.st_mtime;
+
+    fd = open(tmpfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        PM_DPRINT("[Policy Manager] Cannot write policy table cache %s\n", tmpfile);
+        return;
+    }
+    /* readers only ever see a complete cache */
+    if (write(fd, &header, sizeof(header)) != sizeof(header) ||
+        write(fd, &compiledPolicyIndex, sizeof(compiledPolicyIndex)) != sizeof(compiledPolicyIndex) ||
+        fsync(fd) < 0) {
+        close(fd);
+        unlink(tmpfile);
+        return;
+    }
+    close(fd);
+    if (rename(tmpfile, cachefile) < 0) {
+        unlink(tmpfile);
+    }
+}
+
 
 OMX_COMPONENTINDEXTYPE PolicyStringToIndex(char* aString) 
 {
@@ -565,104 +710,100 @@ OMX_COMPONENTINDEXTYPE PolicyStringToIndex(char* aString)
 
 OMX_BOOL CheckActiveCombination(OMX_COMPONENTINDEXTYPE componentRequestingPolicy, int *priority)
 {
-    int i;
-    OMX_BOOL returnValue = OMX_FALSE;
+    int componentPriority = GetPriority(componentRequestingPolicy, activePolicyCombination);
 
-    for (i=0; i < policyCombinationTable[activePolicyCombination].numComponentsInCombination; i++) {
-        if (policyCombinationTable[activePolicyCombination].component[i].component == componentRequestingPolicy) {
-            returnValue = OMX_TRUE;
-            *priority = policyCombinationTable[activePolicyCombination].component[i].priority;
-            break;
-        }
+    if (componentPriority == -1) {
+        return OMX_FALSE;
     }
-    return returnValue;
+    *priority = componentPriority;
+    return OMX_TRUE;
 }
 
+/* the last (lowest priority) combination that supports the component */
 OMX_BOOL CheckAllCombinations(OMX_COMPONENTINDEXTYPE componentRequestingPolicy, int *combination, int *priority)
 {
-    int i,j;
-    OMX_BOOL returnValue = OMX_FALSE;
+    OMX_POLICY_COMBINATION_SET combinations;
 
-    for (i=0; i < numCombinations; i++) {
-        for (j=0; j < policyCombinationTable[i].numComponentsInCombination; j++) {
-            if (policyCombinationTable[i].component[j].component == componentRequestingPolicy) {
-                returnValue = OMX_TRUE;
-                *priority = policyCombinationTable[i].component[j].priority;
-                *combination = i;
-                break;
-            }
-        }
+    if (!GetSupportingCombinations(componentRequestingPolicy, &combinations)) {
+        return OMX_FALSE;
     }
-    return returnValue;
+    *combination = LastCombination(&combinations);
+    *priority = GetPriority(componentRequestingPolicy, *combination);
+    return OMX_TRUE;
 }
 
-OMX_BOOL IsComponentSupported(OMX_COMPONENTINDEXTYPE component, int combination)
+OMX_BOOL GetSupportingCombinations(OMX_COMPONENTINDEXTYPE componentRequestingPolicy, OMX_POLICY_COMBINATION_SET *combinations)
 {
     int i;
-    OMX_BOOL bFound = OMX_FALSE;
+    OMX_U32 any = 0;
 
-    for (i=0; i < policyCombinationTable[combination].numComponentsInCombination; i++) {
-        if (policyCombinationTable[combination].component[i].component == component) {
-            bFound = OMX_TRUE;
-            break;
-        }
+    if ((int)componentRequestingPolicy < 0 || componentRequestingPolicy >= PM_NUM_COMPONENTS) {
+        memset(combinations, 0, sizeof(*combinations));
+        return OMX_FALSE;
     }
-    return bFound;
+    *combinations = compiledPolicyIndex.supportingCombinations[componentRequestingPolicy];
+    for (i=0; i < OMX_POLICY_COMBINATION_WORDS; i++) {
+        any |= combinations->bits[i];
+    }
+    return any ? OMX_TRUE : OMX_FALSE;
 }
 
+int FirstCombination(const OMX_POLICY_COMBINATION_SET *combinations)
+{
+    int i;
+
+    for (i=0; i < OMX_POLICY_COMBINATION_WORDS; i++) {
+        if (combinations->bits[i]) {
+            return i * 32 + __builtin_ctz(combinations->bits[i]);
+        }
+    }
+    return -1;
+}
 
-OMX_POLICY_COMBINATION_LIST GetSupportingCombinations(OMX_COMPONENTINDEXTYPE componentRequestingPolicy)
+int LastCombination(const OMX_POLICY_COMBINATION_SET *combinations)
 {
-    int i,j;
-    OMX_BOOL bThisCombinationSupports = OMX_FALSE;
-    OMX_POLICY_COMBINATION_LIST returnValue = {0};
+    int i;
 
-    returnValue.numCombinations = 0;
-    for (i=0; i < numCombinations; i++) {
-        bThisCombinationSupports = OMX_FALSE;
-        for (j=0; j < policyCombinationTable[i].numComponentsInCombination; j++) {
-            if (policyCombinationTable[i].component[j].component == componentRequestingPolicy) {
-                returnValue.combinationList[returnValue.numCombinations++] = i;
-            }
+    for (i=OMX_POLICY_COMBINATION_WORDS-1; i >= 0; i--) {
+        if (combinations->bits[i]) {
+            return i * 32 + 31 - __builtin_clz(combinations->bits[i]);
         }
     }
-    return returnValue;
+    return -1;
 }
 
+/* the first combination that supports the requester and every registered component */
 OMX_BOOL CanAllComponentsCoexist(OMX_COMPONENTINDEXTYPE componentRequestingPolicy,int *combination)
 {
     int i,j;
-    OMX_POLICY_COMBINATION_LIST combinationList;
-    OMX_BOOL returnValue = OMX_FALSE;
-
-    /* First get a list of all the combinations that support the one requesting policy */
-    combinationList = GetSupportingCombinations(componentRequestingPolicy);
-
-    /* Then loop through the list and see if the other active components are also supported by any of the policies */
-    for (i=0; i < combinationList.numCombinations; i++) {
-        for (j=0; j < registeredComponents; j++) {
-            returnValue = IsComponentSupported(activeComponentList[j].component,combinationList.combinationList[i]);
-            if (returnValue == OMX_FALSE){
-                break;
-            }
-        }
+    OMX_POLICY_COMBINATION_SET combinations;
+    OMX_POLICY_COMBINATION_SET *supported;
 
-        /* if the value is true after looping through all registered components this combination supports all existing components */
-        if (returnValue == OMX_TRUE) {
-            *combination = combinationList.combinationList[i];
-            break;
+    if (registeredComponents == 0 ||
+        !GetSupportingCombinations(componentRequestingPolicy, &combinations)) {
+        return OMX_FALSE;
+    }
+
+    for (j=0; j < registeredComponents; j++) {
+        if ((int)activeComponentList[j].component < 0 ||
+            activeComponentList[j].component >= PM_NUM_COMPONENTS) {
+            return OMX_FALSE;
+        }
+        supported = &compiledPolicyIndex.supportingCombinations[activeComponentList[j].component];
+        for (i=0; i < OMX_POLICY_COMBINATION_WORDS; i++) {
+            combinations.bits[i] &= supported->bits[i];
         }
     }
-    return returnValue;
+
+    *combination = FirstCombination(&combinations);
+    return (*combination != -1) ? OMX_TRUE : OMX_FALSE;
 }
 
 int GetPriority(OMX_COMPONENTINDEXTYPE component, int combination)
 {
-    int i;
-    for (i=0; i < policyCombinationTable[combination].numComponentsInCombination; i++) {
-        if (policyCombinationTable[combination].component[i].component == component) {
-            return policyCombinationTable[combination].component[i].priority;
-        }
+    if ((int)component < 0 || component >= PM_NUM_COMPONENTS ||
+        combination < 0 || combination >= (int)compiledPolicyIndex.numCombinations) {
+        return -1;
     }
-    return -1;
+    return compiledPolicyIndex.priority[combination][component];
 }
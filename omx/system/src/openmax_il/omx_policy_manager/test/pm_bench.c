@@ -0,0 +1,196 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Replays grant/preempt sequences through the Policy Manager decision code.
+ *
+ *   PM_TBLFILE=policytable.tbl pm_bench [operations] [seed] [max components]
+ *
+ * Startup: the time to load the table from text and from the compiled cache,
+ * which is written to PM_TBLCACHE, or to PM_CACHE_DIR if that is not set.
+ * Replay: a seeded random mix of policy requests and frees, as the resource
+ * manager would send them. Replies come back through a pipe; a preempted
+ * component frees its policy like a real client would, so the sequence
+ * exercises grants, denies, preemption and combination switches.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* the policy manager is a single translation unit, run it in-process */
+#define main PolicyManager_main
+#include "../src/PolicyManager.c"
+#undef main
+
+#define BENCH_DEFAULT_OPERATIONS    1000000
+#define BENCH_DEFAULT_SEED          1
+#define BENCH_DEFAULT_COMPONENTS    8
+#define BENCH_STARTUP_LOOPS         200
+
+typedef struct BenchComponent
+{
+    int live;
+    int component;
+} BenchComponent;
+
+static BenchComponent bench_components[RM_MAXCOMPONENTS];
+static unsigned int bench_seed;
+
+static long long bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static unsigned int bench_rand()
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return (bench_seed >> 16) & 0x7fff;
+}
+
+static void bench_free(int slot)
+{
+    POLICYMANAGER_COMMANDDATATYPE cmd;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.PM_Cmd = PM_FreePolicy;
+    cmd.hComponent = (OMX_HANDLETYPE) &bench_components[slot];
+    cmd.param1 = bench_components[slot].component;
+    HandleFreePolicy(cmd);
+    bench_components[slot].live = 0;
+}
+
+/* act on the replies like the resource manager and its clients */
+static void bench_drain(int fd, long long *grants, long long *denies, long long *preempts)
+{
+    POLICYMANAGER_RESPONSEDATATYPE response;
+    int slot;
+
+    while (read(fd, &response, sizeof(response)) == sizeof(response)) {
+        slot = (BenchComponent *) response.hComponent - bench_components;
+        switch (response.PM_Cmd) {
+            case PM_GRANTPOLICY:
+                (*grants)++;
+                bench_components[slot].live = 1;
+                break;
+            case PM_DENYPOLICY:
+                (*denies)++;
+                break;
+            case PM_PREEMPTED:
+                (*preempts)++;
+                if (bench_components[slot].live) {
+                    bench_free(slot);
+                }
+                break;
+        }
+    }
+}
+
+static long long bench_startup(int useCache)
+{
+    long long start;
+    int i;
+
+    if (useCache) {
+        /* the first load writes the cache */
+        if (PopulatePolicyTable() != 0) {
+            return -1;
+        }
+    }
+    else {
+        /* a cache that can be neither read nor written */
+        setenv("PM_TBLCACHE", "/nonexistent/policytable" PM_CACHE_SUFFIX, 1);
+    }
+
+    start = bench_now_ns();
+    for (i = 0; i < BENCH_STARTUP_LOOPS; i++) {
+        if (PopulatePolicyTable() != 0) {
+            return -1;
+        }
+    }
+    return (bench_now_ns() - start) / BENCH_STARTUP_LOOPS;
+}
+
+int main(int argc, char *argv[])
+{
+    POLICYMANAGER_COMMANDDATATYPE cmd;
+    char *tablefile = getenv("PM_TBLFILE");
+    long long operations = BENCH_DEFAULT_OPERATIONS;
+    long long grants = 0, denies = 0, preempts = 0;
+    long long textNs, cacheNs, start, elapsed;
+    long long n;
+    int maxComponents = BENCH_DEFAULT_COMPONENTS;
+    int replies[2];
+    int slot;
+
+    bench_seed = BENCH_DEFAULT_SEED;
+    if (argc > 1) {
+        operations = atoll(argv[1]);
+    }
+    if (argc > 2) {
+        bench_seed = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        maxComponents = atoi(argv[3]);
+    }
+    if (tablefile == NULL || operations <= 0 ||
+        maxComponents <= 0 || maxComponents > RM_MAXCOMPONENTS) {
+        printf("usage: PM_TBLFILE=<table> %s [operations] [seed] [max components]\n", argv[0]);
+        return 1;
+    }
+
+    /* the cached load first, the text load replaces PM_TBLCACHE */
+    cacheNs = bench_startup(1);
+    textNs = bench_startup(0);
+    if (textNs < 0 || cacheNs < 0) {
+        printf("cannot load %s\n", tablefile);
+        return 1;
+    }
+    printf("%u combinations: text load %lld us, cached load %lld us\n",
+           (unsigned int) numCombinations, textNs / 1000, cacheNs / 1000);
+
+    if (pipe(replies) < 0) {
+        return 1;
+    }
+    fcntl(replies[0], F_SETFL, O_NONBLOCK);
+    fdwrite = replies[1];
+
+    start = bench_now_ns();
+    for (n = 0; n < operations; n++) {
+        slot = bench_rand() % maxComponents;
+        memset(&cmd, 0, sizeof(cmd));
+        if (bench_components[slot].live) {
+            bench_free(slot);
+        }
+        else {
+            bench_components[slot].component = bench_rand() % PM_NUM_COMPONENTS;
+            cmd.PM_Cmd = PM_RequestPolicy;
+            cmd.hComponent = (OMX_HANDLETYPE) &bench_components[slot];
+            cmd.param1 = bench_components[slot].component;
+            HandleRequestPolicy(cmd);
+        }
+        bench_drain(replies[0], &grants, &denies, &preempts);
+    }
+    elapsed = bench_now_ns() - start;
+
+    printf("%lld operations: %lld grants, %lld denies, %lld preemptions\n",
+           operations, grants, denies, preempts);
+    printf("%lld ns per operation\n", elapsed / operations);
+    return 0;
+}
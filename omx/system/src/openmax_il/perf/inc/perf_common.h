@@ -64,6 +64,10 @@
     #include <sys/time.h>
     #include <sys/types.h>
     #include <unistd.h>
+    #include <pthread.h>
+
+    /* log buffers are written by a background thread */
+    #define __PERF_LOG_THREAD__
 
 /* time and process ID routines */
 
@@ -54,6 +54,10 @@ typedef struct PERF_Config
     unsigned long  delayed_open;   /* open trace file only when first block
                                       is written */
     char          *trace_file;     /* file base to save trace */
+    unsigned long  flush_thread;   /* write full log buffers from a background
+                                      thread instead of the logging thread */
+    unsigned long  compact_log;    /* save the trace with delta time stamps
+                                      and varint fields */
 
     /* debug interface */
     unsigned long  csv;            /* comma-separated value output */
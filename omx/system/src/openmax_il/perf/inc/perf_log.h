@@ -172,8 +172,38 @@ typedef struct PERF_LOG_Private
     unsigned long  *puPtr;        /* current buffer pointer */
     FILE *fOut;                   /* output file */
     char *fOutFile;               /* output file name */
+
+    unsigned long  *puBuffers[2]; /* log buffers, filled in turns */
+    unsigned char  *pucCompact;   /* compact encoding of a buffer, or NULL if
+                                     the log is saved raw */
+    unsigned long   ulAddress;    /* last buffer address in compact log */
+    int             bHeader;      /* next buffer saved starts with header */
+#ifdef __PERF_LOG_THREAD__
+    /* background writer */
+    int             bThread;      /* writer thread is running */
+    int             bStop;        /* writer thread should exit */
+    unsigned long  *puPending;    /* buffer handed to the writer */
+    unsigned long   uPendingLen;  /* number of words in pending buffer */
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;         /* pending buffer was handed or written */
+#endif
 } PERF_LOG_Private;
 
+/* A compact log starts with this word instead of the module type.  Its
+   header and records are then saved as unsigned LEB128 varints, with the
+   flags of the log stamp rotated into the low bits and buffer addresses
+   saved as zig-zag deltas from the previous address.  The log goes back to
+   raw words after the PERF_LOG_Done record. */
+#define PERF_LOG_CompactMagic 0x50524643UL
+
+/* move the 6 flag bits of a log stamp to the bottom, so that stamps with
+   small values encode into few bytes */
+#define PERF_LOG_StampToCompact(stamp) \
+    (((((stamp) & 0x03FFFFFFUL) << 6) | (((stamp) >> 26) & 0x3F)))
+#define PERF_LOG_StampFromCompact(code) \
+    (((((code) >> 6) & 0x03FFFFFFUL) | (((code) & 0x3F) << 26)))
+
 /* log flags used */
 enum PERF_LogStamps
 {
@@ -255,6 +285,10 @@ enum PERF_LogStamps
 
 extern void __PERF_LOG_log_common(PERF_Private *perf, unsigned long *time_loc);
 
+/* number of words in the log record with this log stamp, not counting the
+   second address of multiple buffer logs */
+extern unsigned long __PERF_LOG_record_length(unsigned long ulStamp);
+
 /* ============================================================================
    PERF LOG Inline methods
 ============================================================================ */
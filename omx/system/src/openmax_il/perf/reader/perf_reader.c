@@ -49,10 +49,94 @@ typedef unsigned long U32;
     GLOBALS    
 =============================================================================*/
 
-static U32 read_U32(FILE *fLog)
+/* log input - raw logs are read word by word, compact logs are decoded a
+   record at a time */
+typedef struct PERF_LOG_Input
 {
-    U32 data;
-    fread(&data, sizeof(U32), 1, fLog);
+    FILE *fLog;
+    int   eof;          /* reached end of the log file */
+    int   compact;      /* reading a compact log */
+    int   header;       /* number of compact header words left */
+    U32   address;      /* last buffer address in compact log */
+    U32   words[9];     /* decoded record */
+    int   count, pos;
+} PERF_LOG_Input;
+
+static U32 read_varint(PERF_LOG_Input *in)
+{
+    U32 data = 0;
+    int shift = 0, c;
+
+    do
+    {
+        c = fgetc(in->fLog);
+        if (c == EOF)
+        {
+            in->eof = 1;
+            return(0);
+        }
+        if (shift < (int) sizeof(U32) * 8) data |= ((U32) (c & 0x7f)) << shift;
+        shift += 7;
+    }
+    while (c & 0x80);
+
+    return(data);
+}
+
+/* decodes the next record of a compact log into in->words */
+static void read_compact_record(PERF_LOG_Input *in)
+{
+    U32 length, delta, code;
+    int i;
+
+    in->words[0] = read_varint(in);
+    code = read_varint(in);
+    in->words[1] = PERF_LOG_StampFromCompact(code);
+    length = __PERF_LOG_record_length(in->words[1]);
+
+    for (i = 2; i < (int) length && !in->eof; i++)
+    {
+        if (in->words[1] & PERF_LOG_Buffer)
+        {
+            /* zig-zag delta from the previous address */
+            delta = read_varint(in);
+            in->address += (delta >> 1) ^ -(delta & 1);
+            in->words[i] = in->address;
+            if (i == 2 && (in->address & PERF_LOG_Multiple)) length++;
+        }
+        else
+        {
+            in->words[i] = read_varint(in);
+        }
+    }
+
+    /* the log after PERF_LOG_Done may be a raw log */
+    if (in->words[1] == PERF_LOG_Done) in->compact = 0;
+
+    in->count = length;
+    in->pos = 0;
+}
+
+static U32 read_U32(PERF_LOG_Input *in)
+{
+    U32 data = 0;
+
+    if (in->pos < in->count) return(in->words[in->pos++]);
+
+    if (!in->compact)
+    {
+        if (fread(&data, sizeof(U32), 1, in->fLog) != 1) in->eof = 1;
+    }
+    else if (in->header)
+    {
+        in->header--;
+        data = read_varint(in);
+    }
+    else
+    {
+        read_compact_record(in);
+        data = in->words[in->pos++];
+    }
     return(data);
 }
 
@@ -65,6 +149,7 @@ void __PERF_CUSTOM_create(PERF_OBJHANDLE hObject,
 
 void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
 {
+    PERF_LOG_Input in = { .fLog = fLog };
     U32 ulData0, ulData1, ulData2, ulData3, ulData4, ulData5, ulData6, ulData7, operation;
     char szFile[21], szFunc[21];
     U32 sending, multiple, frame, size;
@@ -87,15 +172,24 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
     /* we support having multiple log files concatenated into one log file */
     /* read through each log file */
     /* we have to pre-read to detect end of file */
-    while ((ulData0 = read_U32(fLog)), !feof(fLog))
+    while ((ulData0 = read_U32(&in)), !in.eof)
     {
 
         /* if there is no object, create one */
         if (!hObject)
         {
+            /* compact logs are marked before the header */
+            if (ulData0 == PERF_LOG_CompactMagic)
+            {
+                in.compact = 1;
+                in.header = 5;
+                in.address = 0;
+                ulData0 = read_U32(&in);
+            }
+
             /* create PERF replay object */
             /* pre-read word is the eModuleType */
-            ulData1 = read_U32(fLog);    /* ID */
+            ulData1 = read_U32(&in);    /* ID */
 
             hObject = __PERF_common_Create(pConfig, ulData1, ulData0);
             if (!hObject)
@@ -107,9 +201,9 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
             me = get_Private(hObject);
 
             /* set up initial state */
-            me->ulPID = read_U32(fLog);  /* PID */
-            ulData1 = read_U32(fLog);    /* startTime.sec */
-            ulData2 = read_U32(fLog);    /* startTime.usec */
+            me->ulPID = read_U32(&in);  /* PID */
+            ulData1 = read_U32(&in);    /* startTime.sec */
+            ulData2 = read_U32(&in);    /* startTime.usec */
             TIME_SET(me->time, ulData1, ulData2);
             time_correction = 0;
 
@@ -125,7 +219,7 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
         {
             /* pre-read word is replay time difference, except for PERF_LOG_Location logs */
             /* get operation */
-            ulData1 = read_U32(fLog);
+            ulData1 = read_U32(&in);
             operation = ulData1 & PERF_LOG_Mask;
 
             if (operation != PERF_LOG_Location)
@@ -167,12 +261,12 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
                 }
 
                 /* read address */
-                ulData1 = read_U32(fLog);
+                ulData1 = read_U32(&in);
                 multiple = (ulData1 & PERF_LOG_Multiple) ? PERF_FlagMultiple : PERF_FlagSingle;
                 frame    = (ulData1 & PERF_LOG_Frame)    ? PERF_FlagFrame    : PERF_FlagBuffer;
 
                 /* read 2nd address if logged multiple buffers */
-                ulData2 = PERF_IsMultiple(multiple) ? read_U32(fLog) : 0;
+                ulData2 = PERF_IsMultiple(multiple) ? read_U32(&in) : 0;
 
                 __PERF_CUSTOM_Buffer(hObject,
                                      sending,
@@ -187,8 +281,8 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
             /* Check for command operations */
             else if (operation & PERF_LOG_Command)
             {
-                ulData1 = read_U32(fLog);
-                ulData2 = read_U32(fLog);
+                ulData1 = read_U32(&in);
+                ulData2 = read_U32(&in);
                 __PERF_CUSTOM_Command(hObject,
                                       operation & PERF_LOG_Sending,
                                       ulData1,
@@ -199,8 +293,8 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
             {
                 /* Log operation */
             case PERF_LOG_Log:
-                ulData1 = read_U32(fLog);
-                ulData2 = read_U32(fLog);
+                ulData1 = read_U32(&in);
+                ulData2 = read_U32(&in);
 
                 __PERF_CUSTOM_Log(hObject,
                                   ulData0 & PERF_LOG_NotMask,
@@ -210,8 +304,8 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
 
                 /* SyncAV operation */
             case PERF_LOG_Sync:
-                uA.l = read_U32(fLog);
-                uV.l = read_U32(fLog);
+                uA.l = read_U32(&in);
+                uV.l = read_U32(&in);
 
                 __PERF_CUSTOM_SyncAV(hObject, uA.f, uV.f,
                                      ulData0 & PERF_LOG_NotMask);
@@ -224,7 +318,7 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
                 {
                     /* Thread Creation operation */
                 case PERF_LOG_Thread:
-                    ulData1 = read_U32(fLog);
+                    ulData1 = read_U32(&in);
     
                     __PERF_CUSTOM_ThreadCreated(hObject,
                                                 ulData0 & PERF_LOG_NotMask2,
@@ -246,12 +340,12 @@ void PERF_Replay(FILE *fLog, PERF_Config *pConfig)
 
                 /* location log */
             case PERF_LOG_Location:
-                ulData2 = read_U32(fLog);
-                ulData3 = read_U32(fLog);
-                ulData4 = read_U32(fLog);
-                ulData5 = read_U32(fLog);
-                ulData6 = read_U32(fLog);
-                ulData7 = read_U32(fLog);
+                ulData2 = read_U32(&in);
+                ulData3 = read_U32(&in);
+                ulData4 = read_U32(&in);
+                ulData5 = read_U32(&in);
+                ulData6 = read_U32(&in);
+                ulData7 = read_U32(&in);
 
                 /* decode szFile */
                 szFile[19] = __DECODE(ulData2 & 0x3f);
@@ -51,6 +51,8 @@ void PERF_Config_Init(PERF_Config *sConfig)
     sConfig->trace_file     = NULL;
     sConfig->delayed_open   = 0;
     sConfig->buffer_size    = 65536;
+    sConfig->flush_thread   = 1;
+    sConfig->compact_log    = 0;
 
     /* debug interface */
     sConfig->debug          = FALSE;
@@ -144,6 +146,8 @@ void read_line(PERF_Config *cfg, char const *line, char const *tag)
           assign_string_if_matches(line, "trace_file",  &cfg->trace_file) ||
           assign_long_if_matches(line, "delayed_open",  &cfg->delayed_open) || 
           assign_long_if_matches(line, "buffer_size",   &cfg->buffer_size) ||
+          assign_long_if_matches(line, "flush_thread",  &cfg->flush_thread) ||
+          assign_long_if_matches(line, "compact_log",   &cfg->compact_log) ||
           /* debug configuration */
           assign_string_if_matches(line, "log_file",    &cfg->log_file) ||
           assign_long_if_matches(line, "debug",         &cfg->debug) ||
@@ -23,28 +23,205 @@
 
 #define PERF_MAX_LOG_LENGTH (sizeof(unsigned long) * 8)
 
+/* longest LEB128 encoding of an unsigned long */
+#define PERF_MAX_VARINT_LENGTH ((sizeof(unsigned long) * 8 + 6) / 7)
+
+/* ============================================================================
+   PERF LOG Compact encoding
+============================================================================ */
+
+/* Effects: returns the number of words in the log record with ulStamp */
+unsigned long __PERF_LOG_record_length(unsigned long ulStamp)
+{
+    unsigned long operation = ulStamp & PERF_LOG_Mask;
+
+    /* time stamp and log stamp are always present */
+    if (operation & PERF_LOG_Buffer) return 3;
+    if (operation & PERF_LOG_Command) return 4;
+
+    switch (operation)
+    {
+    case PERF_LOG_Log:
+    case PERF_LOG_Sync:
+        return 4;
+#ifdef __PERF_LOG_LOCATION__
+    case PERF_LOG_Location:
+        return 8;
+#endif
+    case PERF_LOG_Done:
+        return ((ulStamp & PERF_LOG_Mask2) == PERF_LOG_Thread) ? 3 : 2;
+    }
+
+    return 2;
+}
+
+/* Effects: saves ulData as an unsigned LEB128 varint, returns the next byte */
+static unsigned char *__PERF_LOG_put_varint(unsigned char *pucOut,
+                                            unsigned long ulData)
+{
+    while (ulData >= 0x80)
+    {
+        *pucOut++ = (unsigned char) (ulData | 0x80);
+        ulData >>= 7;
+    }
+    *pucOut++ = (unsigned char) ulData;
+    return(pucOut);
+}
+
+/* Effects: encodes uLen words of a raw log buffer into me->pucCompact,
+   returns the number of bytes produced */
+static unsigned long __PERF_LOG_compact(PERF_LOG_Private *me,
+                                        unsigned long *puData,
+                                        unsigned long uLen)
+{
+    unsigned char *pucOut = me->pucCompact;
+    unsigned long *puEnd = puData + uLen;
+    unsigned long i, uWords, ulDelta;
+
+    /* the first buffer starts with module, ID, PID and start time */
+    if (me->bHeader)
+    {
+        unsigned long ulMagic = PERF_LOG_CompactMagic;
+
+        memcpy(pucOut, &ulMagic, sizeof(ulMagic));
+        pucOut += sizeof(ulMagic);
+        for (i = 0; i < 5 && puData < puEnd; i++)
+        {
+            pucOut = __PERF_LOG_put_varint(pucOut, *puData++);
+        }
+        me->bHeader = 0;
+    }
+
+    while (puData + 1 < puEnd)
+    {
+        uWords = __PERF_LOG_record_length(puData[1]);
+
+        /* time stamp (or last location word) and log stamp */
+        pucOut = __PERF_LOG_put_varint(pucOut, puData[0]);
+        pucOut = __PERF_LOG_put_varint(pucOut,
+                                       PERF_LOG_StampToCompact(puData[1]));
+
+        if (puData[1] & PERF_LOG_Buffer)
+        {
+            /* buffer addresses are saved as zig-zag deltas */
+            if (puData[2] & PERF_LOG_Multiple) uWords++;
+            for (i = 2; i < uWords; i++)
+            {
+                ulDelta = puData[i] - me->ulAddress;
+                me->ulAddress = puData[i];
+                pucOut = __PERF_LOG_put_varint(pucOut,
+                            (ulDelta << 1) ^ -(ulDelta >> (sizeof(ulDelta) * 8 - 1)));
+            }
+        }
+        else
+        {
+            for (i = 2; i < uWords; i++)
+            {
+                pucOut = __PERF_LOG_put_varint(pucOut, puData[i]);
+            }
+        }
+        puData += uWords;
+    }
+
+    return(pucOut - me->pucCompact);
+}
+
 /* ============================================================================
    PERF LOG Methods
 ============================================================================ */
 
+/* Effects: saves uLen words of log buffer into the log file */
+static void __PERF_LOG_write(PERF_LOG_Private *me, unsigned long *puData,
+                             unsigned long uLen)
+{
+    /* open file if we have not yet opened it */
+    if (!me->fOut) me->fOut = fopen(me->fOutFile, "wb");
+
+    if (me->fOut)
+    {
+        if (me->pucCompact)
+        {
+            fwrite(me->pucCompact, 1, __PERF_LOG_compact(me, puData, uLen),
+                   me->fOut);
+        }
+        else
+        {
+            fwrite(puData, uLen, sizeof(*puData), me->fOut);
+        }
+        me->uBufferCount++;
+    }
+    me->bHeader = 0;
+}
+
+#ifdef __PERF_LOG_THREAD__
+/* Effects: saves the buffers handed over by __PERF_LOG_flush until the log
+   is closed */
+static void *__PERF_LOG_writer(void *pArg)
+{
+    PERF_LOG_Private *me = (PERF_LOG_Private *) pArg;
+    unsigned long *puData;
+    unsigned long uLen;
+
+    pthread_mutex_lock(&me->mutex);
+    for (;;)
+    {
+        while (!me->puPending && !me->bStop)
+        {
+            pthread_cond_wait(&me->cond, &me->mutex);
+        }
+
+        /* the last buffer is handed over before we are stopped */
+        if (!me->puPending) break;
+
+        puData = me->puPending;
+        uLen = me->uPendingLen;
+        pthread_mutex_unlock(&me->mutex);
+
+        __PERF_LOG_write(me, puData, uLen);
+
+        pthread_mutex_lock(&me->mutex);
+        me->puPending = NULL;
+        pthread_cond_broadcast(&me->cond);
+    }
+    pthread_mutex_unlock(&me->mutex);
+
+    return(NULL);
+}
+#endif
+
 /* Effects: flush log */
 void __PERF_LOG_flush(PERF_LOG_Private *me)
 {
     /* only flush if we collected data */
     if (me->puPtr > me->puBuffer)
     {
-		/* open file if we have not yet opened it */
-		if (!me->fOut) me->fOut = fopen(me->fOutFile, "wb");
-		
-		if (me->fOut)
-		{
-			fwrite(me->puBuffer, me->puPtr - me->puBuffer, sizeof(*me->puPtr),
-				   me->fOut);
-			me->uBufferCount++;
-		}
-		
-		/* reset pointer to start of buffer */
-		me->puPtr = me->puBuffer;
+#ifdef __PERF_LOG_THREAD__
+        if (me->bThread)
+        {
+            /* hand the buffer to the writer, we only wait if it has not yet
+               saved the other buffer */
+            pthread_mutex_lock(&me->mutex);
+            while (me->puPending)
+            {
+                pthread_cond_wait(&me->cond, &me->mutex);
+            }
+            me->puPending = me->puBuffer;
+            me->uPendingLen = me->puPtr - me->puBuffer;
+            pthread_cond_broadcast(&me->cond);
+            pthread_mutex_unlock(&me->mutex);
+
+            /* continue logging into the other buffer */
+            me->puBuffer = (me->puBuffer == me->puBuffers[0]) ?
+                           me->puBuffers[1] : me->puBuffers[0];
+            me->puEnd = me->puBuffer + me->uBufSize - PERF_MAX_LOG_LENGTH;
+            me->puPtr = me->puBuffer;
+            return;
+        }
+#endif
+        __PERF_LOG_write(me, me->puBuffer, me->puPtr - me->puBuffer);
+
+        /* reset pointer to start of buffer */
+        me->puPtr = me->puBuffer;
     }
 }
 
@@ -69,9 +246,28 @@ void __PERF_LOG_done(PERF_Private *perf)
             __PERF_LOG_flush(me);   /* flush log */
         }
 
-        /* free buffer */
-        if (me->puBuffer) free(me->puBuffer);
-        me->puBuffer = NULL;
+#ifdef __PERF_LOG_THREAD__
+        /* let the writer save the last buffer and exit */
+        if (me->bThread)
+        {
+            pthread_mutex_lock(&me->mutex);
+            me->bStop = 1;
+            pthread_cond_broadcast(&me->cond);
+            pthread_mutex_unlock(&me->mutex);
+
+            pthread_join(me->thread, NULL);
+            pthread_cond_destroy(&me->cond);
+            pthread_mutex_destroy(&me->mutex);
+            me->bThread = 0;
+        }
+#endif
+
+        /* free buffers */
+        if (me->puBuffers[0]) free(me->puBuffers[0]);
+        if (me->puBuffers[1]) free(me->puBuffers[1]);
+        me->puBuffer = me->puBuffers[0] = me->puBuffers[1] = NULL;
+        if (me->pucCompact) free(me->pucCompact);
+        me->pucCompact = NULL;
 
         /* free file name string */
         if (me->fOutFile) free(me->fOutFile);
@@ -107,6 +303,15 @@ PERF_LOG_Private *__PERF_LOG_create(PERF_Private *perf,
         me->fOut = NULL;
         me->uBufferCount = 0;
         me->uBufSize = config->buffer_size;
+        me->puBuffers[1] = NULL;
+        me->pucCompact = NULL;
+        me->ulAddress = 0;
+        me->bHeader = 1;
+#ifdef __PERF_LOG_THREAD__
+        me->bThread = 0;
+        me->bStop = 0;
+        me->puPending = NULL;
+#endif
 
         /* limit buffer size to allow at least one log creation */
         if (me->uBufSize < PERF_MAX_LOG_LENGTH)
@@ -114,10 +319,20 @@ PERF_LOG_Private *__PERF_LOG_create(PERF_Private *perf,
             me->uBufSize = PERF_MAX_LOG_LENGTH;
         }
 
-        me->puBuffer =
+        me->puBuffer = me->puBuffers[0] =
         (unsigned long *) malloc (sizeof (unsigned long) * me->uBufSize);
         me->fOutFile = (char *) malloc (strlen(config->trace_file) + 34);
-        if (me->puBuffer && me->fOutFile)
+
+        /* every word takes at most PERF_MAX_VARINT_LENGTH bytes, and the
+           compact log starts with a magic word */
+        if (config->compact_log)
+        {
+            me->pucCompact = (unsigned char *)
+                malloc (PERF_MAX_VARINT_LENGTH * me->uBufSize + sizeof(unsigned long));
+        }
+
+        if (me->puBuffer && me->fOutFile &&
+            (me->pucCompact || !config->compact_log))
         {
             perf->uMode |= PERF_Mode_Log; /* we are logging */
 
@@ -147,10 +362,38 @@ PERF_LOG_Private *__PERF_LOG_create(PERF_Private *perf,
             /* original tempTime stamp */
             *me->puPtr++ = TIME_SECONDS(perf->time);
             *me->puPtr++ = TIME_MICROSECONDS(perf->time);
+
+#ifdef __PERF_LOG_THREAD__
+            /* save full buffers from a writer thread while we log into the
+               other buffer.  If we cannot, buffers are saved synchronously */
+            if (config->flush_thread)
+            {
+                me->puBuffers[1] =
+                (unsigned long *) malloc (sizeof (unsigned long) * me->uBufSize);
+            }
+            if (me->puBuffers[1] &&
+                !pthread_mutex_init(&me->mutex, NULL))
+            {
+                if (pthread_cond_init(&me->cond, NULL))
+                {
+                    pthread_mutex_destroy(&me->mutex);
+                }
+                else if (pthread_create(&me->thread, NULL, __PERF_LOG_writer, me))
+                {
+                    pthread_cond_destroy(&me->cond);
+                    pthread_mutex_destroy(&me->mutex);
+                }
+                else
+                {
+                    me->bThread = 1;
+                }
+            }
+#endif
         }
 
 		/* if some allocation or opening failed, delete object */
-		if (!me->puBuffer || !me->fOutFile || (!config->delayed_open && !me->fOut))
+		if (!me->puBuffer || !me->fOutFile || (config->compact_log && !me->pucCompact) ||
+            (!config->delayed_open && !me->fOut))
         {
 			perf->uMode &= ~PERF_Mode_Log; /* delete logging flag */
             __PERF_LOG_done(perf);
@@ -46,6 +46,7 @@
 #ifndef RESOURCEMANAGER_H__
 #define RESOURCEMANAGER_H__
 
+#include <sys/types.h>
 #include <ResourceManagerAPI.h>
 
 #define RM_DEBUG
@@ -79,6 +80,8 @@
 #define MAXSTREAMCOUNT	10
 #define RESOURCEMANAGERID 7
 #define RM_MAXCOMPONENTS 100
+#define RM_MAXCLIENTS 32
+#define RM_MAXEVENTS 16
 #define MAX_TRIES 10
 
 #define RM_IMAGE 1
@@ -112,12 +115,22 @@ typedef struct RM_RegisteredComponentData
     OMX_HANDLETYPE componentHandle;
     OMX_U32 nPid;
     OMX_STATETYPE componentState;
+    OMX_U32 componentId;        /* param1 of the last request */
     unsigned int componentCPU;
-    int componentPipe;
+    OMX_U32 componentMemory;    /* param3 of the last request, DSP heap bytes */
+    int componentPipe;          /* socket of the owning client */
     RM_COMPONENTSTATUS status;
     RM_DENYREASON reason;
 } RM_RegisteredComponentData;
 
+/* a connected client process, credentials come from SO_PEERCRED */
+typedef struct RM_Client
+{
+    int fd;
+    pid_t pid;
+    uid_t uid;
+} RM_Client;
+
 
 typedef struct RM_ComponentList
 { 
@@ -125,6 +138,15 @@ typedef struct RM_ComponentList
     RM_RegisteredComponentData component[RM_MAXCOMPONENTS];
 }RM_ComponentList;
 
+/* a state change of trigger that is known to be followed by a burst of follower */
+typedef struct RM_BurstHint
+{
+    OMX_U32 trigger;
+    OMX_STATETYPE previousState;
+    OMX_STATETYPE newState;
+    OMX_U32 follower;
+} RM_BurstHint;
+
 typedef struct RM_CPULoadStruct
 { 
     int averageCpuLoad;
@@ -159,20 +181,24 @@ RM_CPULoadStruct cpuStruct;
 void FreeQos();
 void RegisterQos(); 
 OMX_ERRORTYPE InitializeQos();
-int RM_GetQos();
+int RM_GetQos(unsigned int cycles, OMX_U32 memory);
 
 void HandleRequestResource(RESOURCEMANAGER_COMMANDDATATYPE cmd);
 void HandleWaitForResource(RESOURCEMANAGER_COMMANDDATATYPE cmd);
 void HandleFreeResource(RESOURCEMANAGER_COMMANDDATATYPE cmd);
 void HandleCancelWaitForResource(RESOURCEMANAGER_COMMANDDATATYPE cmd);
 void HandleStateSet(RESOURCEMANAGER_COMMANDDATATYPE cmd);
+void RM_SetDspConstraint(unsigned int cpu);
+void RM_ExpectBurst(OMX_U32 componentId, OMX_STATETYPE previousState, OMX_STATETYPE newState);
 void RM_AddPipe(RESOURCEMANAGER_COMMANDDATATYPE cmd, int aPipe);
-void RM_ClosePipe(RESOURCEMANAGER_COMMANDDATATYPE cmd_data);
-void RM_CreatePipe(RESOURCEMANAGER_COMMANDDATATYPE cmd_data, char rmsideNamedPipeName[],char rmsideHandleString[]);
 int RM_RemoveComponentFromList(OMX_HANDLETYPE hComponent, OMX_U32 aPid);
 int RM_GetPipe(OMX_HANDLETYPE hComponent,OMX_U32 aPid);
-void RM_itoa(int n, char s[]);
-void RM_reverse(char s[]);
+void RM_SendStatus(int index, RESOURCEMANAGER_ERRORTYPE status);
+int RM_OpenServerSocket();
+void RM_AcceptClient(int epollfd, int listenfd);
+void RM_CloseClient(int epollfd, int fd);
+int RM_GetClient(int fd);
+void RM_WaitForPolicyManager();
 int RM_SetStatus(OMX_HANDLETYPE hComponent, OMX_U32 aPid,RM_COMPONENTSTATUS status);
 int RM_GetListIndex(OMX_HANDLETYPE hComponent,OMX_U32 aPid);
 int RM_SetReason(OMX_HANDLETYPE hComponent, RM_DENYREASON reason);
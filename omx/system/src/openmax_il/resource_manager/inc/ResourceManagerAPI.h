@@ -50,8 +50,9 @@
 #include <OMX_Types.h>
 #include <OMX_Core.h>
 
-#define RM_SERVER_IN "/dev/rm_server_in"
-#define RM_SERVER_OUT "/dev/rm_server_out"   
+/* SOCK_SEQPACKET socket of the resource manager: one connection per client
+   process, one RESOURCEMANAGER_COMMANDDATATYPE per packet in each direction */
+#define RM_SERVER_SOCKET "/dev/rm_server"
 #define PM_SERVER_IN "/dev/pm_server_in"
 #define PM_SERVER_OUT "/dev/pm_server_out"   
 
@@ -14,7 +14,8 @@ LOCAL_C_INCLUDES += \
 
 LOCAL_SHARED_LIBRARIES := \
         libdl \
-        libcutils
+        libcutils \
+        liblog
 
 
 LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
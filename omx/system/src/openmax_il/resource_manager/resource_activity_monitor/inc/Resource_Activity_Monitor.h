@@ -51,6 +51,23 @@
 /* for 3440 */
 #define OPERATING_POINT_6 5
 
+/* sysfs nodes, looked up under the root set by rm_set_sysfs_root() or
+   RAM_SYSFS_ROOT so that they can be pointed at a fake tree */
+#define RAM_SYSFS_DSP_OPP           "/sys/power/dsp_opp"
+#define RAM_SYSFS_MAX_DSP_FREQ      "/sys/power/max_dsp_frequency"
+#define RAM_SYSFS_CPUIDLE_MAX_STATE "/sys/devices/system/cpu/cpu0/cpuidle/max_state"
+#define RAM_SYSFS_CPU_CUR_FREQ      "/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_cur_freq"
+#define RAM_SYSFS_SCALING_MIN_FREQ  "/sys/devices/system/cpu/cpu0/cpufreq/scaling_min_freq"
+
+/* governor mode, see rm_governor_sample() */
+#define RAM_GOVERNOR_INTERVAL_MS    100     /* period of the ticks while the OPP may still drop */
+#define RAM_GOVERNOR_HISTORY        8       /* measured loads the trend is taken from */
+#define RAM_GOVERNOR_UP_PERCENT     85      /* step up once the demand needs more of an OPP */
+#define RAM_GOVERNOR_DOWN_PERCENT   60      /* step down only if the lower OPP stays under this */
+#define RAM_GOVERNOR_DOWN_SAMPLES   3       /* consecutive samples needed to step down */
+#define RAM_GOVERNOR_BURST_MS       1000    /* how long a pre-boost for a burst is held */
+#define RAM_LOAD_UNKNOWN            (-1)
+
 #if 0
 typedef enum _OPP_LEVEL
 {
@@ -115,6 +132,7 @@ int rm_set_vdd1_constraint(int MHz);
 int rm_get_vdd1_constraint();
 
 int dsp_mhz_to_vdd1_opp(int MHz);
+int vdd1_opp_to_dsp_mhz(int vdd1_opp);
 
 /*new for frequency based constraints */
 int rm_set_min_scaling_freq(int MHz);
@@ -129,5 +147,16 @@ int get_dsp_max_freq();
 void rm_request_boost(int level);
 void rm_release_boost();
 
+/* governor mode: the OPP follows a prediction of the next interval instead of
+   the MHz requested by the components. Enabled by RAM_GOVERNOR=1 */
+void rm_governor_enable(int enable);
+int rm_governor_enabled();
+int rm_governor_sample(int requestedMHz, int measuredMHz);
+void rm_governor_burst(int MHz, int holdMs);
+int rm_governor_timeout();
+void rm_governor_tick();
+
+void rm_set_sysfs_root(const char *root);
+
 char * ram_itoa(int a);
 
@@ -21,11 +21,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
 
 #include "Resource_Activity_Monitor.h"
 
 #undef LOG_TAG
 #define LOG_TAG "OMXRM DVFS MONITOR"
+#include <utils/Log.h>
 
 
 /* global to keep the current constraint across requests
@@ -33,22 +36,121 @@
 int currentMHzConstraint = 0;
 int bBoostOn = 0;
 
+/* prefix of every sysfs node, "" for the real tree */
+static char ramSysfsRoot[PATH_MAX];
+static int bSysfsRootSet = 0;
+
 /*
-   Description : This function will determine the correct opp 
-                 and write it to the vdd1_opp sysfs
+   Description : This function will build the path of a sysfs node under
+                 the configured root
    
-   Parameter   : MHz is the sum of MM requested MHz
+   Parameter   : path buffer, its size and the node, e.g. RAM_SYSFS_DSP_OPP
+   
+   Return      : n/a
+   
+*/
+static void ram_sysfs_path(char *path, size_t size, const char *node)
+{
+    char *root;
+
+    if (!bSysfsRootSet) {
+        root = getenv("RAM_SYSFS_ROOT");
+        if (root != NULL) {
+            strncpy(ramSysfsRoot, root, sizeof(ramSysfsRoot) - 1);
+        }
+        bSysfsRootSet = 1;
+    }
+    snprintf(path, size, "%s%s", ramSysfsRoot, node);
+}
+
+/*
+   Description : This function will read an integer from a sysfs node
+   
+   Parameter   : node, where to store the value
+   
+   Return      : 0 on success, -1 if the node cannot be read
+   
+*/
+static int ram_read_sysfs(const char *node, int *value)
+{
+    char path[PATH_MAX];
+    FILE *fp;
+    int ret = -1;
+
+    ram_sysfs_path(path, sizeof(path), node);
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        RAM_DPRINT("open %s failed\n", path);
+        return -1;
+    }
+    if (fscanf(fp, "%d", value) == 1) {
+        ret = 0;
+    }
+    fclose(fp);
+    return ret;
+}
+
+/*
+   Description : This function will write an integer to a sysfs node
+   
+   Parameter   : node, value to write
+   
+   Return      : 0 on success, -1 if the node cannot be written
+   
+*/
+static int ram_write_sysfs(const char *node, int value)
+{
+    char path[PATH_MAX];
+    FILE *fp;
+    int ret = 0;
+
+    ram_sysfs_path(path, sizeof(path), node);
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        RAM_DPRINT("open %s for writing failed\n", path);
+        return -1;
+    }
+    if (fprintf(fp, "%d\n", value) < 0) {
+        ret = -1;
+    }
+    if (fclose(fp) != 0) {
+        ret = -1;
+    }
+    return ret;
+}
+
+/*
+   Description : This function will make sysfs nodes be looked up under root
+                 instead of the real tree
+   
+   Parameter   : root, or NULL for the real tree
+   
+   Return      : n/a
+   
+*/
+void rm_set_sysfs_root(const char *root)
+{
+    ramSysfsRoot[0] = '\0';
+    if (root != NULL) {
+        strncpy(ramSysfsRoot, root, sizeof(ramSysfsRoot) - 1);
+    }
+    bSysfsRootSet = 1;
+}
+
+/*
+   Description : This function will write an opp, and the c-state that goes
+                 with it, to sysfs unless a boost holds a higher opp
+   
+   Parameter   : MHz the opp was chosen for, 0 when no MM is active;
+                 zero based vdd1_opp
    
    Return      : the integer value of the opp that was set
    
 */
-int rm_set_vdd1_constraint(int MHz)
+static int ram_set_vdd1_opp(int MHz, int vdd1_opp)
 {
-    int vdd1_opp = OPERATING_POINT_1;
-    
 #ifdef DVFS_ENABLED
     
-    char command[100];
     /* for any MM case, set c-state to 3, unless no mm is active */
     int c_state = C_STATE_2;
     
@@ -69,10 +171,6 @@ int rm_set_vdd1_constraint(int MHz)
             c_state = C_STATE_6;
         }
     }
-    else
-    {
-        vdd1_opp = dsp_mhz_to_vdd1_opp(MHz);
-    }
 
     /* plus one to convert zero based array indeces above */
     vdd1_opp++;
@@ -81,17 +179,11 @@ int rm_set_vdd1_constraint(int MHz)
     {
         /* actually set the sysfs for vdd1 */
         RAM_DPRINT("[setting operating point] MHz = %d vdd1_dsp = %d\n",MHz,vdd1_opp);
-        strcpy(command,"echo ");
-        strcat(command,ram_itoa(vdd1_opp));
-        strcat(command," > /sys/power/dsp_opp");
-        system(command);
+        ram_write_sysfs(RAM_SYSFS_DSP_OPP, vdd1_opp);
 
         /* actually set the sysfs for cpuidle/max_state */
         RAM_DPRINT("[setting c-state] c-state %d\n",c_state);
-        strcpy(command,"echo ");
-        strcat(command,ram_itoa(c_state));
-        strcat(command," > /sys/devices/system/cpu/cpu0/cpuidle/max_state");
-        system(command);
+        ram_write_sysfs(RAM_SYSFS_CPUIDLE_MAX_STATE, c_state);
     }
     else {
         RAM_DPRINT("BOOST is enabled, ignoring current request\n");
@@ -102,6 +194,28 @@ int rm_set_vdd1_constraint(int MHz)
     return vdd1_opp;
 }
 
+/*
+   Description : This function will determine the correct opp 
+                 and write it to the vdd1_opp sysfs
+   
+   Parameter   : MHz is the sum of MM requested MHz
+   
+   Return      : the integer value of the opp that was set
+   
+*/
+int rm_set_vdd1_constraint(int MHz)
+{
+    int vdd1_opp = OPERATING_POINT_1;
+
+#ifdef DVFS_ENABLED
+    if (MHz != 0) {
+        vdd1_opp = dsp_mhz_to_vdd1_opp(MHz);
+    }
+#endif
+
+    return ram_set_vdd1_opp(MHz, vdd1_opp);
+}
+
 /*
    Description : This function will convert a MHz value to an opp value
    
@@ -191,6 +305,54 @@ int dsp_mhz_to_vdd1_opp(int MHz)
     return vdd1_opp;
 }
 
+/*
+   Description : This function will convert an opp value to the DSP MHz
+                 it runs at
+   
+   Parameter   : zero based vdd1_opp
+   
+   Return      : DSP MHz of the opp, 0 if this omap does not have it
+   
+*/
+int vdd1_opp_to_dsp_mhz(int vdd1_opp)
+{
+    int MHz = 0;
+
+    if (vdd1_opp < 0) {
+        return 0;
+    }
+    switch (get_omap_version()) {
+        case OMAP3420_CPU:
+            if (vdd1_opp < (int)(sizeof(vdd1_dsp_mhz_3420)/sizeof(vdd1_dsp_mhz_3420[0]))) {
+                MHz = vdd1_dsp_mhz_3420[vdd1_opp];
+            }
+            break;
+
+        case OMAP3430_CPU:
+            if (vdd1_opp < (int)(sizeof(vdd1_dsp_mhz_3430)/sizeof(vdd1_dsp_mhz_3430[0]))) {
+                MHz = vdd1_dsp_mhz_3430[vdd1_opp];
+            }
+            break;
+
+        case OMAP3440_CPU:
+            if (vdd1_opp < (int)(sizeof(vdd1_dsp_mhz_3440)/sizeof(vdd1_dsp_mhz_3440[0]))) {
+                MHz = vdd1_dsp_mhz_3440[vdd1_opp];
+            }
+            break;
+
+        case OMAP3630_CPU:
+            if (vdd1_opp < (int)(sizeof(vdd1_dsp_mhz_3630)/sizeof(vdd1_dsp_mhz_3630[0]))) {
+                MHz = vdd1_dsp_mhz_3630[vdd1_opp];
+            }
+            break;
+
+        default:
+            RAM_DPRINT("this omap is not currently supported\n");
+            break;
+    }
+    return MHz;
+}
+
 /*
    Description : This function will determine the current OMAP that is
                  running
@@ -243,14 +405,8 @@ int get_dsp_max_freq()
 {
     int dsp_max_freq = 0;
 
-    FILE *fp = fopen("/sys/power/max_dsp_frequency","r");
     /* what to do if the kernel does not have this sysfs? */
-    if (fp == NULL) {
-        RAM_DPRINT("open file failed\n");
-    }
-    else {
-        fscanf(fp, "%d",&dsp_max_freq);
-        fclose(fp);
+    if (ram_read_sysfs(RAM_SYSFS_MAX_DSP_FREQ, &dsp_max_freq) == 0) {
         dsp_max_freq /= 1000000;
     }
 
@@ -275,13 +431,10 @@ int get_curr_cpu_mhz(int omapVersion){
 #ifdef DVFS_ENABLED
 
     cpu_variant = get_omap_version();
-    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_cur_freq","r");
-    if (fp == NULL) {
+    if (ram_read_sysfs(RAM_SYSFS_CPU_CUR_FREQ, &cur_freq) < 0) {
        RAM_DPRINT("open file cpuinfo_cur_freq failed\n");
        return -1;
     }
-    fscanf(fp, "%d",&cur_freq);
-    fclose(fp);
     cur_freq /= 1000;
 
     if (cpu_variant == OMAP3420_CPU){
@@ -397,12 +550,7 @@ int get_curr_cpu_mhz(int omapVersion){
 int rm_get_vdd1_constraint()
 {
     int vdd1_opp = 0;
-    FILE *fp = fopen("/sys/power/dsp_opp","r");
-    if (fp == NULL) {
-        RAM_DPRINT("open file failed\n");
-    } else {
-        fscanf(fp, "%d",&vdd1_opp);
-        fclose(fp);
+    if (ram_read_sysfs(RAM_SYSFS_DSP_OPP, &vdd1_opp) == 0) {
         RAM_DPRINT("[rm_get_vdd1_constraint] vdd1 OPP = %d \n",vdd1_opp);
     }
     return vdd1_opp;
@@ -496,6 +644,289 @@ void rm_release_boost()
     rm_set_vdd1_constraint(currentMHzConstraint);
 }
 
+/* governor mode
+
+   The components only tell the RM how many MHz they asked for, and only on
+   state changes, so following them either lags a burst or keeps a high OPP
+   long after the load is gone. The governor instead looks at the requested
+   MHz and at the DSP load the RM measures, extrapolates the rising trend of
+   the load to the next interval, and takes the larger of the two:
+
+   - it steps up as soon as the demand needs more than RAM_GOVERNOR_UP_PERCENT
+     of the current OPP,
+   - it steps down only after RAM_GOVERNOR_DOWN_SAMPLES samples in a row fit
+     in RAM_GOVERNOR_DOWN_PERCENT of the lower OPP,
+   - rm_governor_burst() holds a higher demand for a while, so that the OPP is
+     raised before a burst that is known to come, e.g. the JPEG encode after a
+     still capture.
+
+   Every decision is logged. The state is only touched from the RM main loop.
+*/
+static struct {
+    int bInitialized;
+    int bEnabled;
+    int level;                  /* 1 based vdd1 OPP that was set, 0 for idle, -1 before the first */
+    int downSamples;            /* consecutive samples that fit in a lower OPP */
+    int requestedMHz;           /* last MHz requested by the components */
+    int burstMHz;
+    long long burstEndMs;
+    int bTicking;               /* a later sample may change the OPP on its own */
+    long long nextTickMs;       /* when rm_governor_tick() is due while ticking */
+    int numLoads;
+    int nextLoad;
+    int loadMHz[RAM_GOVERNOR_HISTORY];
+    long long loadTimeMs[RAM_GOVERNOR_HISTORY];
+} ramGovernor;
+
+static long long ram_now_ms()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+   Description : This function will predict the DSP load of the next interval
+                 from the loads measured in the last RAM_GOVERNOR_HISTORY
+                 intervals
+   
+   Parameter   : current time
+   
+   Return      : predicted load in MHz, 0 if nothing recent was measured
+   
+*/
+static int ram_governor_predict_load(long long now)
+{
+    int newest = 0, oldest = 0;
+    long long newestTime = 0, oldestTime = 0;
+    int count = 0;
+    int i, slot;
+
+    for (i = 0; i < ramGovernor.numLoads; i++) {
+        slot = (ramGovernor.nextLoad - 1 - i + RAM_GOVERNOR_HISTORY) % RAM_GOVERNOR_HISTORY;
+        if (now - ramGovernor.loadTimeMs[slot] > RAM_GOVERNOR_HISTORY * RAM_GOVERNOR_INTERVAL_MS) {
+            break;
+        }
+        if (count++ == 0) {
+            newest = ramGovernor.loadMHz[slot];
+            newestTime = ramGovernor.loadTimeMs[slot];
+        }
+        oldest = ramGovernor.loadMHz[slot];
+        oldestTime = ramGovernor.loadTimeMs[slot];
+    }
+    /* only a rising load is extrapolated, and by no more than it has now */
+    if (count > 1 && newest > oldest && newestTime > oldestTime) {
+        long long rise = (long long)(newest - oldest) * RAM_GOVERNOR_INTERVAL_MS /
+                         (newestTime - oldestTime);
+        return newest + (rise < newest ? (int)rise : newest);
+    }
+    return newest;
+}
+
+/*
+   Description : This function will find the OPP that runs MHz using at most
+                 percent of it
+   
+   Parameter   : MHz, percent
+   
+   Return      : 1 based vdd1 OPP, 0 for idle
+   
+*/
+static int ram_governor_level(int MHz, int percent)
+{
+    if (MHz <= 0) {
+        return 0;
+    }
+    return dsp_mhz_to_vdd1_opp(MHz * 100 / percent) + 1;
+}
+
+/*
+   Description : This function will turn the governor mode on or off. By
+                 default it is on if RAM_GOVERNOR is set to a non zero value
+   
+   Parameter   : enable
+   
+   Return      : n/a
+   
+*/
+void rm_governor_enable(int enable)
+{
+    memset(&ramGovernor, 0, sizeof(ramGovernor));
+    ramGovernor.level = -1;
+    ramGovernor.bEnabled = enable;
+    ramGovernor.bInitialized = 1;
+}
+
+int rm_governor_enabled()
+{
+    char *env;
+
+    if (!ramGovernor.bInitialized) {
+        env = getenv("RAM_GOVERNOR");
+        rm_governor_enable(env != NULL && atoi(env) != 0);
+    }
+    return ramGovernor.bEnabled;
+}
+
+/*
+   Description : This function will feed a sample to the governor and set
+                 the OPP it predicts for the next interval
+   
+   Parameter   : requestedMHz, the sum of MM requested MHz;
+                 measuredMHz, the DSP load, or RAM_LOAD_UNKNOWN
+   
+   Return      : the 1 based vdd1 OPP, 0 for idle, -1 if not supported
+   
+*/
+int rm_governor_sample(int requestedMHz, int measuredMHz)
+{
+    long long now = ram_now_ms();
+    int predictedMHz, burstMHz = 0, demandMHz;
+    int upLevel, downLevel, newLevel;
+    const char *decision;
+    int wasTicking = ramGovernor.bTicking;
+
+    if (!rm_governor_enabled()) {
+        return -1;
+    }
+    if (get_omap_version() == OMAP_NOT_SUPPORTED) {
+        LOGI("governor: this omap is not supported\n");
+        return -1;
+    }
+
+    ramGovernor.requestedMHz = requestedMHz;
+    if (measuredMHz != RAM_LOAD_UNKNOWN) {
+        ramGovernor.loadMHz[ramGovernor.nextLoad] = measuredMHz;
+        ramGovernor.loadTimeMs[ramGovernor.nextLoad] = now;
+        ramGovernor.nextLoad = (ramGovernor.nextLoad + 1) % RAM_GOVERNOR_HISTORY;
+        if (ramGovernor.numLoads < RAM_GOVERNOR_HISTORY) {
+            ramGovernor.numLoads++;
+        }
+    }
+    predictedMHz = ram_governor_predict_load(now);
+    if (ramGovernor.burstEndMs > now) {
+        burstMHz = ramGovernor.burstMHz;
+    }
+
+    demandMHz = requestedMHz > predictedMHz ? requestedMHz : predictedMHz;
+    if (burstMHz > demandMHz) {
+        demandMHz = burstMHz;
+    }
+    upLevel = ram_governor_level(demandMHz, RAM_GOVERNOR_UP_PERCENT);
+    downLevel = ram_governor_level(demandMHz, RAM_GOVERNOR_DOWN_PERCENT);
+
+    newLevel = ramGovernor.level;
+    if (ramGovernor.level < 0) {
+        newLevel = upLevel;
+        decision = "set";
+    }
+    else if (upLevel > ramGovernor.level) {
+        newLevel = upLevel;
+        decision = burstMHz > 0 && demandMHz == burstMHz ? "pre-boost" : "up";
+    }
+    else if (downLevel < ramGovernor.level) {
+        if (++ramGovernor.downSamples >= RAM_GOVERNOR_DOWN_SAMPLES) {
+            newLevel = downLevel;
+            decision = "down";
+        }
+        else {
+            decision = "hold";
+        }
+    }
+    else {
+        decision = "keep";
+    }
+    if (newLevel != ramGovernor.level || downLevel >= ramGovernor.level) {
+        ramGovernor.downSamples = 0;
+    }
+
+    LOGI("governor %s: requested %d measured %d predicted %d burst %d demand %d MHz, OPP %d -> %d\n",
+         decision, requestedMHz, measuredMHz, predictedMHz, burstMHz, demandMHz,
+         ramGovernor.level, newLevel);
+
+    if (newLevel != ramGovernor.level) {
+        ramGovernor.level = newLevel;
+        if (newLevel == 0) {
+            ram_set_vdd1_opp(0, OPERATING_POINT_1);
+        }
+        else {
+            ram_set_vdd1_opp(vdd1_opp_to_dsp_mhz(newLevel - 1), newLevel - 1);
+        }
+    }
+
+    /* keep sampling while a burst, a pending step down or an aging load
+       may still move the OPP without any new request */
+    ramGovernor.bTicking = burstMHz > 0 || ramGovernor.downSamples > 0 ||
+        ramGovernor.level > ram_governor_level(requestedMHz, RAM_GOVERNOR_DOWN_PERCENT);
+    if (ramGovernor.bTicking && !wasTicking) {
+        ramGovernor.nextTickMs = now + RAM_GOVERNOR_INTERVAL_MS;
+    }
+
+    return ramGovernor.level;
+}
+
+/*
+   Description : This function will hold a higher demand for a while, ahead
+                 of a burst that is known to come
+   
+   Parameter   : MHz the burst will need, how long to hold it
+   
+   Return      : n/a
+   
+*/
+void rm_governor_burst(int MHz, int holdMs)
+{
+    long long now = ram_now_ms();
+
+    if (!rm_governor_enabled()) {
+        return;
+    }
+    if (ramGovernor.burstEndMs <= now || MHz > ramGovernor.burstMHz) {
+        ramGovernor.burstMHz = MHz;
+    }
+    if (now + holdMs > ramGovernor.burstEndMs) {
+        ramGovernor.burstEndMs = now + holdMs;
+    }
+    LOGI("governor burst: %d MHz for %d ms\n", MHz, holdMs);
+    rm_governor_sample(ramGovernor.requestedMHz, RAM_LOAD_UNKNOWN);
+}
+
+/*
+   Description : This function will tell how long the caller may wait before
+                 the next rm_governor_tick(), however busy it was meanwhile
+   
+   Parameter   : n/a
+   
+   Return      : timeout in ms, 0 if a tick is due, -1 if no tick is needed
+   
+*/
+int rm_governor_timeout()
+{
+    long long left;
+
+    if (!rm_governor_enabled() || !ramGovernor.bTicking) {
+        return -1;
+    }
+    left = ramGovernor.nextTickMs - ram_now_ms();
+    return left > 0 ? (int)left : 0;
+}
+
+/*
+   Description : This function will sample again with the last request and
+                 no new load, so that bursts expire and the OPP can drop
+   
+   Parameter   : n/a
+   
+   Return      : n/a
+   
+*/
+void rm_governor_tick()
+{
+    ramGovernor.nextTickMs = ram_now_ms() + RAM_GOVERNOR_INTERVAL_MS;
+    rm_governor_sample(ramGovernor.requestedMHz, RAM_LOAD_UNKNOWN);
+}
+
 /* below are the new implementations frequency based constraints */
 
 /*
@@ -512,7 +943,6 @@ int rm_set_min_scaling_freq(int MHz)
     
 #ifdef DVFS_ENABLED
     
-    char command[100];
     /* for any MM case, set c-state to 2, unless no mm is active */
     int c_state = C_STATE_2;
     freq = rm_get_min_scaling_freq();
@@ -538,17 +968,11 @@ int rm_set_min_scaling_freq(int MHz)
 
     /* actually set the sysfs for cpufreq */
     RAM_DPRINT("[setting min scaling freq] requested MHz = %d new min scaling freq = %d\n",MHz,freq);
-    strcpy(command,"echo ");
-    strcat(command,ram_itoa(freq));
-    strcat(command," > /sys/devices/system/cpu/cpu0/cpufreq/scaling_min_freq");
-    system(command);
+    ram_write_sysfs(RAM_SYSFS_SCALING_MIN_FREQ, freq);
 
     /* actually set the sysfs for cpuidle/max_state */
     RAM_DPRINT("[setting c-state] c-state %d\n",c_state);
-    strcpy(command,"echo ");
-    strcat(command,ram_itoa(c_state));
-    strcat(command," > /sys/devices/system/cpu/cpu0/cpuidle/max_state");
-    system(command);
+    ram_write_sysfs(RAM_SYSFS_CPUIDLE_MAX_STATE, c_state);
 
 
 #endif
@@ -567,13 +991,10 @@ int rm_set_min_scaling_freq(int MHz)
 int rm_get_min_scaling_freq()
 {
     int min_scaling_freq = 0;
-    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cpufreq/scaling_min_freq","r");
-    if (fp == NULL) {
+    if (ram_read_sysfs(RAM_SYSFS_SCALING_MIN_FREQ, &min_scaling_freq) < 0) {
         RAM_DPRINT("open file failed, unable to get min_scaling_freq\n");
         return -1;
     }
-    fscanf(fp, "%d",&min_scaling_freq);
-    fclose(fp);
     RAM_DPRINT("[rm_get_min_scaling_freq] = %d \n",min_scaling_freq);
     return min_scaling_freq;
 }
@@ -42,6 +42,9 @@
 *! 24-Apr-2005 rg:  Initial Version. 
 *!
 * ============================================================================= */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // for struct ucred
+#endif
 #include <unistd.h>     // for sleep
 #include <stdlib.h>     // for calloc
 #include <sys/time.h>   // time is part of the select logic
@@ -49,6 +52,9 @@
 #include <sys/ioctl.h>  // for ioctl support
 #include <sys/file.h>
 #include <sys/stat.h>
+#include <sys/socket.h> // for the client connections
+#include <sys/un.h>
+#include <sys/epoll.h>
 #include <sys/errno.h>
 #include <string.h>     // for memset
 #include <stdio.h>      // for buffered io
@@ -80,7 +86,6 @@ PERF_OBJHANDLE pPERF = NULL;
 
 RM_ComponentList componentList;
 RM_ComponentList pendingComponentList;
-int fdread, fdwrite;
 int pmfdread, pmfdwrite;
 int eErrno;
 
@@ -100,10 +105,23 @@ unsigned int lcdTotalCpu=0;
 unsigned int cameraTotalCpu=0;
 
 RESOURCEMANAGER_COMMANDDATATYPE cmd_data;
-RESOURCEMANAGER_COMMANDDATATYPE globalrequest_cmd_data;
 POLICYMANAGER_COMMANDDATATYPE policy_data;
 POLICYMANAGER_RESPONSEDATATYPE policyresponse_data;
 
+/* connected client processes */
+RM_Client clientList[RM_MAXCLIENTS];
+int numClients = 0;
+
+/* MHz last requested by each kind of component, the size of its next burst */
+unsigned int lastRequestedCpu[OMX_DISPLAY_COMPONENT + 1];
+
+/* a component that is granted resources is covered by RM_GetQos, these are
+   the bursts nobody has asked for yet */
+static const RM_BurstHint burstHints[] = {
+    /* a still capture stops the preview, the JPEG encode of the frame follows */
+    { OMX_CAMERA_COMPONENT, OMX_StateExecuting, OMX_StateIdle, OMX_JPEG_Encoder_COMPONENT },
+};
+
 
 /*------------------------------------------------------------------------------------*
   * main() 
@@ -134,27 +152,28 @@ int main()
     
     int size = 0;
     int ret;
-    char rmsideNamedPipeName[120];
-    char rmsideHandleString[100];
-    OMX_S16 fdmax;
-    int status = 0;
-    fd_set watchset;
+    int listenfd;
+    int epollfd;
+    int clientIndex;
+    int index;
+    int i, nEvents;
+    struct epoll_event ev;
+    struct epoll_event events[RM_MAXEVENTS];
     OMX_BOOL Exitflag = OMX_FALSE;
-    OMX_ERRORTYPE eError = OMX_ErrorNone;
-    int reuse_pipe = -1;
     cpuStruct.snapshotsCaptured = 0;
     cpuStruct.averageCpuLoad = 0;
     pthread_t dsp_monitor = NULL;
 
-    RM_DPRINT("[Resource Manager] - going to create the read & write pipe\n");
-    unlink(RM_SERVER_IN);
-        
-    if((mknod(RM_SERVER_IN,S_IFIFO|PERMS,0)<0)&&(eErrno!=EEXIST)) 
-        RM_DPRINT("[Resource Manager] - mknod failure to create the read pipe, error=%d\n", eErrno);
+    /* a client that goes away while we reply must not take the server down */
+    signal(SIGPIPE, SIG_IGN);
 
+    RM_DPRINT("[Resource Manager] - going to create the server socket\n");
+    listenfd = RM_OpenServerSocket();
+    if (listenfd < 0) {
+        RM_EPRINT("[Resource Manager] - failure to create the server socket\n");
+        exit(1);
+    }
 
-    sleep(1); /* since the policy manager needs to create pipes that this process will 
-                        read we will wait to give time for the policy manager time to establish pipes */
     componentList.numRegisteredComponents = 0;
 
     /* start the MMU fault monitor */
@@ -166,211 +185,196 @@ int main()
         RM_EPRINT("OMAP version not supported by RM: falling back to stub mode\n");
     }
 
+    epollfd = epoll_create(RM_MAXCLIENTS + 2);
+    if (epollfd < 0) {
+        RM_EPRINT("[Resource Manager] - epoll_create failed, errno=%d\n", errno);
+        exit(1);
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listenfd;
+    epoll_ctl(epollfd, EPOLL_CTL_ADD, listenfd, &ev);
+
 #ifndef __ENABLE_RMPM_STUB__
     /* after here, we know for sure if we are in stub_mode or not. */
     if (!stub_mode) 
     {
+        RM_WaitForPolicyManager();
+
         // create pipe for read
         if((pmfdwrite=open(PM_SERVER_IN,O_WRONLY))<0)
             RM_DPRINT("[Policy Manager] - failure to open the WRITE pipe\n");
 
         if((pmfdread=open(PM_SERVER_OUT,O_RDONLY))<0)
             RM_DPRINT("[Policy Manager] - failure to open the READ pipe\n");
+
+        ev.events = EPOLLIN;
+        ev.data.fd = pmfdread;
+        epoll_ctl(epollfd, EPOLL_CTL_ADD, pmfdread, &ev);
     }
 
 #endif    
-    // create pipe for read
-    if((fdread=open(RM_SERVER_IN,O_RDONLY))<0)
-        RM_DPRINT("[Resource Manager] - failure to open the READ pipe\n");
-
-    FD_ZERO(&watchset);
     size=sizeof(cmd_data);
 
     RM_DPRINT("[Resource Manager] - going enter while loop\n");
 
     while(!Exitflag) {
-        FD_SET(fdread, &watchset);
-        fdmax = fdread;
-#ifndef __ENABLE_RMPM_STUB__
-        if (!stub_mode){
-            FD_SET(pmfdread, &watchset);
-            if (pmfdread > fdmax) {
-                fdmax = pmfdread;
-            }
+        /* the governor wakes us up while the OPP may still change on its own */
+        nEvents = epoll_wait(epollfd, events, RM_MAXEVENTS, rm_governor_timeout());
+        if (nEvents < 0) {
+            if (errno != EINTR)
+                RM_EPRINT("[Resource Manager] - epoll_wait failed, errno=%d\n", errno);
+            continue;
+        }
+        /* steady client traffic must not hold the ticks back */
+        if (rm_governor_timeout() == 0) {
+            rm_governor_tick();
         }
-#endif
-        sigset_t set;
-        sigemptyset (&set);
-        sigaddset (&set, SIGALRM);
-        status = pselect(fdmax+1, &watchset, NULL, NULL, NULL, &set);
-                 
-        if(FD_ISSET(fdread, &watchset)) {
-            ret = read(fdread, &cmd_data, size);
-            if((size>0)&&(ret>0)&&(-1 != ret)) {
-            
-#ifdef __PERF_INSTRUMENTATION__
-                PERF_ReceivedCommand(pPERF, cmd_data.RM_Cmd, cmd_data.param1,
-                                     PERF_ModuleLLMM);
-#endif
-                // actually get data 
-                RM_DPRINT("[Resource Manager] - get data\n");
-
-                switch (cmd_data.RM_Cmd) {  
-                    case RM_RequestResource:
-                        HandleRequestResource(cmd_data);
-                        break;
-
-                    case RM_WaitForResource:
-                        HandleWaitForResource(cmd_data);
-                        break;
-
-                    case RM_FreeResource:
-                        HandleFreeResource(cmd_data);
-                        RM_RemoveComponentFromList(cmd_data.hComponent,cmd_data.nPid);
-                        break;
-
-                    case RM_FreeAndCloseResource:
-                        HandleFreeResource(cmd_data);
-                        RM_ClosePipe(cmd_data);
-                        RM_RemoveComponentFromList(cmd_data.hComponent,cmd_data.nPid);
-                        break;
-
-                    case RM_CancelWaitForResource:
-                        HandleCancelWaitForResource(cmd_data);
-                        break;
-
-                    case RM_StateSet:
-                        HandleStateSet(cmd_data);
-                        break;
-
-                    case RM_OpenPipe:
-                        // create pipe for write
-                        RM_CreatePipe(cmd_data,rmsideNamedPipeName,rmsideHandleString);
-
-                        break;
-                        
-                    case RM_ReusePipe:
-                        reuse_pipe = RM_GetPipe((OMX_HANDLETYPE)cmd_data.param4,cmd_data.nPid);
-                        if(reuse_pipe != -1){
-                            RM_AddPipe(cmd_data,reuse_pipe);
-                        }
-                        else{
-                            RM_DPRINT("[Resource Manager] - Couldn't reuse pipe, opening a new one \n");
-                            RM_CreatePipe(cmd_data,rmsideNamedPipeName,rmsideHandleString);
-                        }
-                        break;
-
 
-                        case RM_Exit:
-                        case RM_Init:
-                        break;
+        for (i = 0; i < nEvents && !Exitflag; i++) {
+            int fd = events[i].data.fd;
 
-                        case RM_ExitTI:
-                            Exitflag = OMX_TRUE;
-                            break;
-                }  
-            }
-                else {
-                close(fdread);
-                if((fdread=open(RM_SERVER_IN,O_RDONLY))<0)                                
-                    RM_DPRINT("[Resource Manager] - failure to re-open the Read pipe\n");
-                RM_DPRINT("[Resource Manager] - re-opened Read pipe\n");
+            if (fd == listenfd) {
+                RM_AcceptClient(epollfd, listenfd);
+                continue;
             }
-        }
 #ifndef __ENABLE_RMPM_STUB__
-        else if (FD_ISSET(pmfdread,&watchset)) {
-            if (!stub_mode){
-            RM_DPRINT("if stub mode fallback, should not see this...\n");
-            read(pmfdread,&policyresponse_data,sizeof(policyresponse_data));
-
-            switch(policyresponse_data.PM_Cmd) {
-                case PM_PREEMPTED:
-                cmd_data.rm_status = RM_PREEMPT;
-                cmd_data.hComponent = policyresponse_data.hComponent;
-                RM_SetStatus(cmd_data.hComponent, cmd_data.nPid,RM_WaitingForClient);                
-                int preemptpipe = RM_GetPipe(policyresponse_data.hComponent,policyresponse_data.nPid);
-                if (write(preemptpipe,&cmd_data,sizeof(cmd_data)) < 0)
-                    RM_DPRINT("Didn't write pipe\n");
-                else
-                    RM_DPRINT("Wrote RMProxy pipe\n");
-                break;
+            if (!stub_mode && fd == pmfdread) {
+                read(pmfdread,&policyresponse_data,sizeof(policyresponse_data));
+                index = RM_GetListIndex(policyresponse_data.hComponent,policyresponse_data.nPid);
+                if (index == -1) {
+                    RM_DPRINT("[Resource Manager] - policy response for an unknown component\n");
+                    continue;
+                }
 
-                case PM_DENYPOLICY:
-                    globalrequest_cmd_data.rm_status = RM_DENY;
-                    RM_SetStatus(globalrequest_cmd_data.hComponent,globalrequest_cmd_data.nPid,RM_WaitingForClient);        
-                    if(write(RM_GetPipe(globalrequest_cmd_data.hComponent,globalrequest_cmd_data.nPid), &globalrequest_cmd_data, sizeof(globalrequest_cmd_data)) < 0)
-                        RM_DPRINT ("[Resource Manager] - failure write data back to component\n");
-                    else
-                        RM_DPRINT ("[Resource Manager] - Denied by policy, ok to write data back to component\n");
-                    
-                break;
+                switch(policyresponse_data.PM_Cmd) {
+                    case PM_PREEMPTED:
+                        RM_SetStatus(policyresponse_data.hComponent,policyresponse_data.nPid,RM_WaitingForClient);
+                        RM_SendStatus(index, RM_PREEMPT);
+                    break;
+
+                    case PM_DENYPOLICY:
+                        RM_SetStatus(policyresponse_data.hComponent,policyresponse_data.nPid,RM_WaitingForClient);
+                        RM_SendStatus(index, RM_DENY);
+                    break;
 
-                case PM_GRANTPOLICY:
-                    /* if policy request is granted then check to see if we are currently handling an MMU fault,
-                       then check to see if resource is available */
-
-                    if (!mmuRecoveryInProgress) {
-                        if (RM_GetQos() == QOS_OK)
-                        {
-                            globalrequest_cmd_data.rm_status = RM_GRANT;
-                            RM_SetStatus(globalrequest_cmd_data.hComponent,globalrequest_cmd_data.nPid,RM_ComponentActive);
-                            if(write(RM_GetPipe(globalrequest_cmd_data.hComponent,globalrequest_cmd_data.nPid),
-                                     &globalrequest_cmd_data, sizeof(globalrequest_cmd_data)) < 0)
+                    case PM_GRANTPOLICY:
+                        /* if policy request is granted then check to see if we are currently handling an MMU fault,
+                           then check to see if resource is available */
+
+                        if (!mmuRecoveryInProgress) {
+                            if (RM_GetQos(componentList.component[index].componentCPU,
+                                          componentList.component[index].componentMemory) == QOS_OK)
                             {
-                                RM_DPRINT ("[Resource Manager] - failure write data back to component\n");
+                                RM_SetStatus(policyresponse_data.hComponent,policyresponse_data.nPid,RM_ComponentActive);
+                                RM_SendStatus(index, RM_GRANT);
                             }
-                            else
-                            {
-                                RM_DPRINT ("[Resource Manager] - Granted by policy, ok to write data back to component\n");
+                            else {
+                                policy_data.PM_Cmd = PM_FreeResources;
+                                policy_data.param1 = componentList.component[index].componentId;
+                                policy_data.hComponent = policyresponse_data.hComponent;
+                                policy_data.nPid = policyresponse_data.nPid;
+                        
+                                if (write(pmfdwrite,&policy_data,sizeof(policy_data)) < 0)
+                                    RM_DPRINT ("[Resource Manager] - failure write data to the policy manager\n");
+                                else
+                                    RM_DPRINT ("[Resource Manager] - wrote the data to the policy manager\n");                        
                             }
                         }
                         else {
-                            policy_data.PM_Cmd = PM_FreeResources;
-                            policy_data.param1 = globalrequest_cmd_data.param1;
-                            policy_data.hComponent=globalrequest_cmd_data.hComponent;
-                            policy_data.nPid = globalrequest_cmd_data.nPid;
-                    
-                            if (write(pmfdwrite,&policy_data,sizeof(policy_data)) < 0)
-                                RM_DPRINT ("[Resource Manager] - failure write data to the policy manager\n");
-                            else
-                                RM_DPRINT ("[Resource Manager] - wrote the data to the policy manager\n");                        
-                        }
-                    }
-                    else {
-                        globalrequest_cmd_data.rm_status = RM_RESOURCEFATALERROR;
-                        RM_SetStatus(globalrequest_cmd_data.hComponent,globalrequest_cmd_data.nPid,RM_WaitingForClient);
-                        if(write(RM_GetPipe(globalrequest_cmd_data.hComponent,globalrequest_cmd_data.nPid),
-                                 &globalrequest_cmd_data, sizeof(globalrequest_cmd_data)) < 0)
-                        {
-                            RM_EPRINT ("[Resource Manager] - failure write data back to component\n");
-                        }
-                        else
-                        {
+                            RM_SetStatus(policyresponse_data.hComponent,policyresponse_data.nPid,RM_WaitingForClient);
+                            RM_SendStatus(index, RM_RESOURCEFATALERROR);
                             RM_EPRINT ("[Resource Manager] -Denied request due to pending DSP recovery\n");
-                        }   
-                    }
+                        }
 
 #ifdef __PERF_INSTRUMENTATION__
-                PERF_SendingCommand(pPERF, cmd_data.RM_Cmd, cmd_data.param1, PERF_ModuleLLMM);
+                        PERF_SendingCommand(pPERF, RM_RequestResource, componentList.component[index].componentId,
+                                            PERF_ModuleLLMM);
 #endif
+                    break;
 
-                break;
-                default: 
-                break;
+                    default: 
+                    break;
+                }
+                continue;
             }
-        }
-     }
 #endif
-        else {
-            RM_DPRINT("[Resource Manager] fdread not ready\n"); 
+
+            /* a packet, or the hangup, of a client connection */
+            ret = recv(fd, &cmd_data, size, 0);
+            if (ret < 0 && (errno == EINTR || errno == EAGAIN)) {
+                continue;
+            }
+            if (ret <= 0) {
+                RM_CloseClient(epollfd, fd);
+                continue;
+            }
+            if (ret != size) {
+                RM_EPRINT("[Resource Manager] - dropping a malformed packet of %d bytes\n", ret);
+                continue;
+            }
+
+            /* the kernel, not the client, tells us who is talking */
+            clientIndex = RM_GetClient(fd);
+            if (clientIndex == -1) {
+                continue;
+            }
+            cmd_data.nPid = clientList[clientIndex].pid;
+
+#ifdef __PERF_INSTRUMENTATION__
+            PERF_ReceivedCommand(pPERF, cmd_data.RM_Cmd, cmd_data.param1,
+                                 PERF_ModuleLLMM);
+#endif
+            RM_DPRINT("[Resource Manager] - get data\n");
+
+            switch (cmd_data.RM_Cmd) {  
+                case RM_RequestResource:
+                    HandleRequestResource(cmd_data);
+                    break;
+
+                case RM_WaitForResource:
+                    HandleWaitForResource(cmd_data);
+                    break;
+
+                case RM_FreeResource:
+                case RM_FreeAndCloseResource:
+                    /* the connection stays open for the other components of the client */
+                    HandleFreeResource(cmd_data);
+                    RM_RemoveComponentFromList(cmd_data.hComponent,cmd_data.nPid);
+                    break;
+
+                case RM_CancelWaitForResource:
+                    HandleCancelWaitForResource(cmd_data);
+                    break;
+
+                case RM_StateSet:
+                    HandleStateSet(cmd_data);
+                    break;
+
+                case RM_OpenPipe:
+                case RM_ReusePipe:
+                    RM_AddPipe(cmd_data, fd);
+                    break;
+
+                case RM_Exit:
+                case RM_Init:
+                    break;
+
+                case RM_ExitTI:
+                    Exitflag = OMX_TRUE;
+                    break;
+            }  
         }
     }
 
-    close(fdread);
-    close(fdwrite);
+    while (numClients > 0) {
+        RM_CloseClient(epollfd, clientList[0].fd);
+    }
+    close(epollfd);
+    close(listenfd);
 
-    if(unlink(RM_SERVER_IN)<0)
-        RM_DPRINT("[Resource Manager] - unlink RM_SERVER_IN error\n");
+    if(unlink(RM_SERVER_SOCKET)<0)
+        RM_DPRINT("[Resource Manager] - unlink RM_SERVER_SOCKET error\n");
 
 
 #ifdef __PERF_INSTRUMENTATION__
@@ -380,6 +384,193 @@ int main()
 }
 
 
+/*
+   Description : This function will create, bind and listen on the server socket
+   
+   Parameter   : 
+   
+   Return      : listening socket, or -1 on failure
+   
+*/
+int RM_OpenServerSocket()
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        RM_EPRINT("[Resource Manager] - socket failed, errno=%d\n", errno);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, RM_SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+    unlink(RM_SERVER_SOCKET);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        chmod(RM_SERVER_SOCKET, PERMS) < 0 ||
+        listen(fd, RM_MAXCLIENTS) < 0) {
+        RM_EPRINT("[Resource Manager] - failure to set up %s, errno=%d\n", RM_SERVER_SOCKET, errno);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/*
+   Description : This function will accept a client connection and record
+                 the credentials of the peer
+   
+   Parameter   : epollfd, listenfd
+   
+   Return      : 
+   
+*/
+void RM_AcceptClient(int epollfd, int listenfd)
+{
+    struct epoll_event ev;
+    struct ucred cred;
+    socklen_t len = sizeof(cred);
+    int fd;
+
+    fd = accept(listenfd, NULL, NULL);
+    if (fd < 0) {
+        RM_DPRINT("[Resource Manager] - accept failed, errno=%d\n", errno);
+        return;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    if (numClients == RM_MAXCLIENTS) {
+        RM_EPRINT("[Resource Manager] - too many clients, refusing connection\n");
+        close(fd);
+        return;
+    }
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+        RM_EPRINT("[Resource Manager] - no credentials for client, errno=%d\n", errno);
+        close(fd);
+        return;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        close(fd);
+        return;
+    }
+
+    clientList[numClients].fd = fd;
+    clientList[numClients].pid = cred.pid;
+    clientList[numClients].uid = cred.uid;
+    numClients++;
+    RM_DPRINT("[Resource Manager] - client pid %d uid %d connected\n", (int)cred.pid, (int)cred.uid);
+}
+
+/*
+   Description : This function will drop a client connection and release
+                 everything its components still hold
+   
+   Parameter   : epollfd, fd
+   
+   Return      : 
+   
+*/
+void RM_CloseClient(int epollfd, int fd)
+{
+    RESOURCEMANAGER_COMMANDDATATYPE cmd;
+    int clientIndex;
+    int i;
+
+    RM_DPRINT("[Resource Manager] - client connection closed\n");
+    memset(&cmd, 0, sizeof(cmd));
+    i = 0;
+    while (i < componentList.numRegisteredComponents) {
+        if (componentList.component[i].componentPipe != fd) {
+            i++;
+            continue;
+        }
+        cmd.hComponent = componentList.component[i].componentHandle;
+        cmd.nPid = componentList.component[i].nPid;
+        cmd.param1 = componentList.component[i].componentId;
+        HandleFreeResource(cmd);
+        RM_RemoveComponentFromList(cmd.hComponent, cmd.nPid);
+    }
+
+    epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+
+    clientIndex = RM_GetClient(fd);
+    if (clientIndex != -1) {
+        clientList[clientIndex] = clientList[--numClients];
+    }
+}
+
+int RM_GetClient(int fd)
+{
+    int i;
+
+    for (i = 0; i < numClients; i++) {
+        if (clientList[i].fd == fd) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+   Description : This function will wait for the policy manager to create
+                 its pipes, for at most a second
+   
+   Parameter   : 
+   
+   Return      : 
+   
+*/
+void RM_WaitForPolicyManager()
+{
+    struct stat sb;
+    struct timespec tv;
+    int tries = 100;
+
+    tv.tv_sec = 0;
+    tv.tv_nsec = 10000000;
+    while (tries-- > 0) {
+        if (stat(PM_SERVER_IN, &sb) == 0 && stat(PM_SERVER_OUT, &sb) == 0) {
+            return;
+        }
+        nanosleep(&tv, NULL);
+    }
+    RM_EPRINT("[Resource Manager] - policy manager pipes not found\n");
+}
+
+/*
+   Description : This function will send a status to the client of a component
+   
+   Parameter   : index in componentList, status
+   
+   Return      : 
+   
+*/
+void RM_SendStatus(int index, RESOURCEMANAGER_ERRORTYPE status)
+{
+    RESOURCEMANAGER_COMMANDDATATYPE cmd;
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.hComponent = componentList.component[index].componentHandle;
+    cmd.nPid = componentList.component[index].nPid;
+    cmd.RM_Cmd = RM_RequestResource;
+    cmd.param1 = componentList.component[index].componentId;
+    cmd.rm_status = status;
+
+    if (send(componentList.component[index].componentPipe, &cmd, sizeof(cmd), MSG_NOSIGNAL) < 0)
+        RM_DPRINT ("[Resource Manager] - failure write data back to component\n");
+    else
+        RM_DPRINT ("[Resource Manager] - wrote status %d back to component\n", status);
+}
+
+
 /*
    Description : This function will initialize Qos
    
@@ -477,6 +668,19 @@ OMX_ERRORTYPE InitializeQos()
 */
 void HandleRequestResource(RESOURCEMANAGER_COMMANDDATATYPE cmd)
 {
+    int index;
+
+    /* the policy manager answers with the handle only, keep what the
+       request asked for with the component */
+    index = RM_GetListIndex(cmd.hComponent,cmd.nPid);
+    if (index != -1) {
+        componentList.component[index].componentId = cmd.param1;
+        componentList.component[index].componentCPU = cmd.param2;
+        componentList.component[index].componentMemory = cmd.param3;
+    }
+    if (cmd.param1 <= OMX_DISPLAY_COMPONENT) {
+        lastRequestedCpu[cmd.param1] = cmd.param2;
+    }
 #ifndef __ENABLE_RMPM_STUB__
     if (!stub_mode)
     {
@@ -486,10 +690,6 @@ void HandleRequestResource(RESOURCEMANAGER_COMMANDDATATYPE cmd)
         policy_data.param1 = cmd.param1;
         policy_data.hComponent=cmd.hComponent;
         policy_data.nPid = cmd.nPid;
-        globalrequest_cmd_data.hComponent = cmd.hComponent;
-        globalrequest_cmd_data.nPid = cmd.nPid;
-        globalrequest_cmd_data.RM_Cmd = RM_RequestResource;
-        globalrequest_cmd_data.param1 = cmd.param1;
         if (write(pmfdwrite,&policy_data,sizeof(policy_data)) < 0)
              RM_DPRINT ("[Resource Manager] - failure write data to the policy manager\n");
         else
@@ -532,10 +732,10 @@ void HandleWaitForResource(RESOURCEMANAGER_COMMANDDATATYPE cmd)
     }
     
 #ifdef __PERF_INSTRUMENTATION__
-    PERF_SendingCommand(pPERF, cmd_data.RM_Cmd, cmd_data.param1, PERF_ModuleLLMM);
+    PERF_SendingCommand(pPERF, cmd.RM_Cmd, cmd.param1, PERF_ModuleLLMM);
 #endif    // 
 
-    if(write(RM_GetPipe(cmd_data.hComponent,cmd_data.nPid), &cmd_data, sizeof(cmd_data)) < 0)
+    if(send(RM_GetPipe(cmd.hComponent,cmd.nPid), &cmd, sizeof(cmd), MSG_NOSIGNAL) < 0)
         RM_DPRINT ("[Resource Manager] - failure write data back to component\n");
     else
         RM_DPRINT ("[Resource Manager] -sending wait for resources\n");
@@ -579,11 +779,7 @@ void HandleFreeResource(RESOURCEMANAGER_COMMANDDATATYPE cmd)
             if (componentList.component[i].componentState== OMX_StateWaitForResources) {
                 /* temporarily now assume policy is available */
                 RM_DPRINT("HandleFreeResource %d\n",__LINE__);
-                cmd_data.rm_status = RM_RESOURCEACQUIRED;
-                cmd_data.hComponent = componentList.component[i].componentHandle;
-            
-                RM_DPRINT("HandleFreeResource %d\n",__LINE__);
-                write(RM_GetPipe(componentList.component[i].componentHandle,componentList.component[i].nPid), &cmd_data, sizeof(cmd_data));
+                RM_SendStatus(i, RM_RESOURCEACQUIRED);
             }
             else if (componentList.component[i].status == RM_WaitingForResource) {
             }
@@ -733,7 +929,7 @@ void HandleStateSet(RESOURCEMANAGER_COMMANDDATATYPE cmd)
                        cameraTotalCpu + lcdTotalCpu;
             /* Inform the Resource Activity Monitor of the new CPU usage */
             RM_DPRINT("total CPU to set constraint = %d\n", totalCpu);
-            rm_set_vdd1_constraint(totalCpu);        
+            RM_SetDspConstraint(totalCpu);
         }
         else if (previousState == OMX_StateExecuting && (newState == OMX_StateIdle || newState == OMX_StatePause)) {
 
@@ -762,8 +958,9 @@ void HandleStateSet(RESOURCEMANAGER_COMMANDDATATYPE cmd)
             totalCpu = audioTotalCpu + videoTotalCpu + imageTotalCpu +
                        cameraTotalCpu + lcdTotalCpu;
             
-            rm_set_vdd1_constraint(totalCpu);
+            RM_SetDspConstraint(totalCpu);
         }
+        RM_ExpectBurst(cmd.param1, previousState, newState);
         RM_DPRINT("newState = %d\n",newState);
         if (newState == OMX_StateWaitForResources) {
             HandleWaitForResource(cmd);
@@ -775,6 +972,55 @@ void HandleStateSet(RESOURCEMANAGER_COMMANDDATATYPE cmd)
 }
 
 
+/*
+   Description : This function will pass the MHz of the executing components
+                 to the Resource Activity Monitor, directly or through its
+                 governor
+   
+   Parameter   : cpu, total MHz of the executing components
+   
+   Return      : 
+   
+*/
+void RM_SetDspConstraint(unsigned int cpu)
+{
+    if (rm_governor_enabled()) {
+        rm_governor_sample(cpu, RAM_LOAD_UNKNOWN);
+    }
+    else {
+        rm_set_vdd1_constraint(cpu);
+    }
+}
+
+/*
+   Description : This function will let the governor raise the OPP ahead of
+                 a burst that is known to follow this state change
+   
+   Parameter   : componentId, previousState, newState
+   
+   Return      : 
+   
+*/
+void RM_ExpectBurst(OMX_U32 componentId, OMX_STATETYPE previousState, OMX_STATETYPE newState)
+{
+    unsigned int i;
+
+    if (!rm_governor_enabled()) {
+        return;
+    }
+    for (i = 0; i < sizeof(burstHints)/sizeof(burstHints[0]); i++) {
+        if (burstHints[i].trigger == componentId &&
+            burstHints[i].previousState == previousState && burstHints[i].newState == newState &&
+            lastRequestedCpu[burstHints[i].follower] > 0) {
+            RM_DPRINT("expecting a burst of %d MHz\n", lastRequestedCpu[burstHints[i].follower]);
+            rm_governor_burst(totalCpu + lastRequestedCpu[burstHints[i].follower],
+                              RAM_GOVERNOR_BURST_MS);
+            break;
+        }
+    }
+}
+
+
 void RM_AddPipe(RESOURCEMANAGER_COMMANDDATATYPE cmd, int aPipe)
 {
     int alreadyRegistered = 0;
@@ -787,12 +1033,14 @@ void RM_AddPipe(RESOURCEMANAGER_COMMANDDATATYPE cmd, int aPipe)
         }
     }
 
-    if (!alreadyRegistered) {
+    if (!alreadyRegistered && componentList.numRegisteredComponents < RM_MAXCOMPONENTS) {
         componentList.component[componentList.numRegisteredComponents].componentHandle = cmd.hComponent;
         componentList.component[componentList.numRegisteredComponents].nPid = cmd.nPid;
         componentList.component[componentList.numRegisteredComponents].componentPipe = aPipe;
         componentList.component[componentList.numRegisteredComponents].componentState = OMX_StateIdle;
         componentList.component[componentList.numRegisteredComponents].reason = RM_ReasonNone;
+        componentList.component[componentList.numRegisteredComponents].componentId = cmd.param1;
+        componentList.component[componentList.numRegisteredComponents].componentMemory = cmd.param3;
         componentList.component[componentList.numRegisteredComponents++].componentCPU = cmd.param2;
         
     }
@@ -811,70 +1059,6 @@ int RM_GetPipe(OMX_HANDLETYPE hComponent,OMX_U32 aPid)
 }
 
 
-void RM_ClosePipe(RESOURCEMANAGER_COMMANDDATATYPE cmd_data)
-{
- 
-    int listIndex;
-    listIndex = RM_GetListIndex(cmd_data.hComponent,cmd_data.nPid);
-    /* If pipe is found close it */
-    if (listIndex != -1) {
-        fdwrite = componentList.component[listIndex].componentPipe;
-        close(fdwrite);
-    }
- }
-
-void RM_CreatePipe(RESOURCEMANAGER_COMMANDDATATYPE cmd_data, char rmsideNamedPipeName[],char rmsideHandleString[])
-{
-    RM_itoa((int)cmd_data.nPid,rmsideHandleString);
-    strcpy(rmsideNamedPipeName,RM_SERVER_OUT);
-    strcat(rmsideNamedPipeName,"_");
-    strcat(rmsideNamedPipeName,rmsideHandleString);
-
-    // try to create the pipe, don't fail it already exists (reuse the pipe instead)
-    RM_DPRINT("[Resource Manager] - Create and open the write (out) pipe\n");
-    if((mknod(rmsideNamedPipeName,S_IFIFO|PERMS,0)<0) && (errno!=EEXIST))
-    RM_DPRINT("[Resource Manager] - mknod failure to create the write pipe, error=%d\n", errno);
-    //wait for the pipe to be established before opening it.??
-
-    RM_DPRINT("[Resource Manager] - Try opening the write out pipe for PID %d\n", (int)cmd_data.nPid);
-    if((fdwrite=open(rmsideNamedPipeName,O_WRONLY))<0) {
-        RM_DPRINT("[Resource Manager] - failure to open the WRITE pipe, errno=%d\n", errno);
-    }
-    else {
-        RM_DPRINT("[Resource Manager] - WRITE pipe opened successfully, Add pipe to the table\n");
-        RM_AddPipe(cmd_data,fdwrite);
-    }
-}
-
-void RM_itoa(int n, char s[])
-{
-    int i, sign;
-
-    if ((sign = n) < 0)  /* record sign */
-        n = -n;          /* make n positive */
-    i = 0;
-    do {       /* generate digits in reverse order */
-        s[i++] = n % 10 + '0';   /* get next digit */
-    } while ((n /= 10) > 0);     /* delete it */
-    if (sign < 0)
-        s[i++] = '-';
-    s[i] = '\0';
-    RM_reverse(s);
-} 
-
-
-
-void RM_reverse(char s[])
-{
-    int c, i, j;
-
-    for (i = 0, j = strlen(s)-1; i<j; i++, j--) {
-        c = s[i];
-        s[i] = s[j];
-        s[j] = c;
-    }
-}
-
 int RM_SetStatus(OMX_HANDLETYPE hComponent, OMX_U32 aPid, RM_COMPONENTSTATUS status)
 {
     int listIndex;
@@ -923,13 +1107,7 @@ int RM_RemoveComponentFromList(OMX_HANDLETYPE hComponent,OMX_U32 aPid)
     if (index != -1) {
         /* Shift all other components in the list up */    
         for(i=index; i < componentList.numRegisteredComponents-1; i++) {
-            componentList.component[i].componentCPU = componentList.component[i+1].componentCPU;
-            componentList.component[i].componentHandle = componentList.component[i+1].componentHandle;
-            componentList.component[i].componentState = componentList.component[i+1].componentState;
-            componentList.component[i].componentPipe = componentList.component[i+1].componentPipe;
-            componentList.component[i].reason = componentList.component[i+1].reason;
-            componentList.component[i].status = componentList.component[i+1].status;
-            componentList.component[i].nPid = componentList.component[i+1].nPid;
+            componentList.component[i] = componentList.component[i+1];
         }
         /* Decrement the count of registered components */
         componentList.numRegisteredComponents--;
@@ -1081,10 +1259,12 @@ void RegisterQos()
    
    Parameter   : 
    
-   Return      : current IVA load in MHz
+   Parameter   : DSP cycles (MHz) and DSP heap bytes the component asks for
+   
+   Return      : QOS_OK if both are available
    
 */
-int RM_GetQos()
+int RM_GetQos(unsigned int cycles, OMX_U32 memory)
 {
     unsigned long NumFound;
     int i=0;
@@ -1133,7 +1313,7 @@ int RM_GetQos()
         }
 
         /* do not need to check DSP if reqested heap is 0 */
-        if (cmd_data.param3 > 0) {
+        if (memory > 0) {
             status = QosTI_DspMsg(QOS_TI_GETMEMSTAT,
                 request->heapId, USED_HEAPSIZE, ((DWORD *)
                 &request->size), ((DWORD *)&request->allocated));
@@ -1144,7 +1324,7 @@ int RM_GetQos()
                     NULL, ((DWORD *)&request->largestfree));
 
                 if (DSP_SUCCEEDED(status)) { /* 4 bytes alignment */
-                    if (request->size > (cmd_data.param3 + 4))
+                    if (request->size > (memory + 4))
                         memoryAvailable = true;
                 } else { /*DSP return defined in dspbridge/api/inc/errbase.h */
                     RM_EPRINT ("QOS_TI_GETMEMSTAT return ERR(0x%x)\n", (unsigned int)status);
@@ -1241,13 +1421,20 @@ int RM_GetQos()
         RM_EPRINT("Calculating QoS: \n\tdsp_max_freq = %d\n\tcyclesInUse = %d\n\n", dsp_max_freq, cpuStruct.cyclesInUse);
 
         RM_EPRINT("QoS Results: \n\tmemoryAvailable = %d\n\tcyclesAvailable = %d\n\trequestedCycles = %d\n", 
-                   memoryAvailable, cpuStruct.cyclesAvailable, cmd_data.param2);
+                   memoryAvailable, cpuStruct.cyclesAvailable, cycles);
 
         /* if memory is available and DSP cycles are available grant request */
-        if (memoryAvailable && (cpuStruct.cyclesAvailable >= cmd_data.param2)) {                        
+        if (memoryAvailable && (cpuStruct.cyclesAvailable >= (int)cycles)) {                        
+            /* the component will run soon, let the governor get ahead of it */
+            if (rm_governor_enabled()) {
+                rm_governor_sample(totalCpu + cycles, currentOverallUtilization);
+            }
             return QOS_OK;                        
         }
         else {
+            if (rm_governor_enabled()) {
+                rm_governor_sample(totalCpu, currentOverallUtilization);
+            }
             return QOS_DENY;
         }
     } //end not stub mode
@@ -1354,17 +1541,8 @@ void *RM_FatalErrorWatchThread()
                     RM_EPRINT("DSP ERROR [%d] ... starting to preempt MM components\n",index);
                     mmuRecoveryInProgress = 1;
                     for(i=0; i < componentList.numRegisteredComponents; i++) {
-                        cmd_data.rm_status = RM_RESOURCEFATALERROR;
-                        cmd_data.hComponent = componentList.component[i].componentHandle;
-                        cmd_data.nPid = componentList.component[i].nPid;
-                        RM_SetStatus(cmd_data.hComponent, cmd_data.nPid,RM_WaitingForClient);  
-                        int preemptpipe = RM_GetPipe(cmd_data.hComponent,cmd_data.nPid);
-                        if (write(preemptpipe,&cmd_data,sizeof(cmd_data)) < 0){
-                            RM_EPRINT("Didn't write pipe\n");
-                        }
-                        else {
-                            RM_EPRINT("Wrote RMProxy pipe, cleaned [%d] components\n", i+1);
-                        }
+                        componentList.component[i].status = RM_WaitingForClient;
+                        RM_SendStatus(i, RM_RESOURCEFATALERROR);
                     }
 
                     /* dsp close ensures that the dsp resources are freed by bridge */
@@ -22,3 +22,44 @@ LOCAL_CFLAGS := $(TI_OMX_CFLAGS) -DOMX_DEBUG
 LOCAL_MODULE:= rm_api_test
 
 include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_PRELINK_MODULE := false
+
+LOCAL_SRC_FILES:= \
+        rm_grant_bench.c
+
+LOCAL_C_INCLUDES := \
+    $(TI_OMX_SYSTEM)/resource_manager_proxy/inc \
+    $(TI_OMX_COMP_C_INCLUDES)
+
+LOCAL_SHARED_LIBRARIES := $(TI_OMX_COMP_SHARED_LIBRARIES) \
+                           libOMX_ResourceManagerProxy
+
+LOCAL_CFLAGS := $(TI_OMX_CFLAGS)
+
+LOCAL_MODULE:= rm_grant_bench
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+        ram_governor_test.c \
+        ../resource_activity_monitor/src/Resource_Activity_Monitor.c
+
+LOCAL_C_INCLUDES := \
+    $(TI_OMX_SYSTEM)/resource_manager/resource_activity_monitor/inc
+
+LOCAL_STATIC_LIBRARIES := liblog
+
+LOCAL_LDLIBS := -lrt
+
+LOCAL_CFLAGS := -DDVFS_ENABLED
+
+LOCAL_MODULE:= ram_governor_test
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_HOST_EXECUTABLE)
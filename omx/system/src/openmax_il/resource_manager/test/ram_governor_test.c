@@ -0,0 +1,269 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Runs the OPP governor of the Resource Activity Monitor against a fake
+ * sysfs tree.
+ *
+ *   ram_governor_test
+ *
+ * The tree is created in a temporary directory and stands for an OMAP3430;
+ * the OPP the governor sets is read back from its dsp_opp node. The
+ * governor runs on the real monotonic clock, so the burst test takes about
+ * half a second.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Resource_Activity_Monitor.h"
+
+#define TEST_DSP_MAX_FREQ       430000000   /* OMAP3430 */
+#define TEST_CLIENT_PERIOD_MS   20          /* well under RAM_GOVERNOR_INTERVAL_MS */
+#define TEST_TIMEOUT_MS         3000
+
+static const char *test_nodes[] = {
+    RAM_SYSFS_DSP_OPP,
+    RAM_SYSFS_MAX_DSP_FREQ,
+    RAM_SYSFS_CPUIDLE_MAX_STATE,
+    RAM_SYSFS_CPU_CUR_FREQ,
+    RAM_SYSFS_SCALING_MIN_FREQ,
+};
+
+static char test_root[PATH_MAX];
+static int failures;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static long long now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sleep_ms(int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR)
+        ;
+}
+
+static int write_node(const char *node, int value)
+{
+    char path[PATH_MAX];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s%s", test_root, node);
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        return -1;
+    }
+    fprintf(fp, "%d\n", value);
+    return fclose(fp);
+}
+
+/* mkdir -p for the directories of every node under test_root */
+static int make_tree(void)
+{
+    char path[PATH_MAX];
+    char *p;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(test_nodes) / sizeof(test_nodes[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", test_root, test_nodes[i]);
+        for (p = path + strlen(test_root) + 1; (p = strchr(p, '/')) != NULL; p++) {
+            *p = '\0';
+            if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+                return -1;
+            }
+            *p = '/';
+        }
+        if (write_node(test_nodes[i], 0) < 0) {
+            return -1;
+        }
+    }
+    return write_node(RAM_SYSFS_MAX_DSP_FREQ, TEST_DSP_MAX_FREQ);
+}
+
+static void remove_tree(void)
+{
+    char path[PATH_MAX];
+    char *p;
+    unsigned int i;
+
+    for (i = 0; i < sizeof(test_nodes) / sizeof(test_nodes[0]); i++) {
+        snprintf(path, sizeof(path), "%s%s", test_root, test_nodes[i]);
+        unlink(path);
+        /* parents go once they are empty */
+        while ((p = strrchr(path, '/')) != NULL && p > path + strlen(test_root)) {
+            *p = '\0';
+            if (rmdir(path) < 0) {
+                break;
+            }
+        }
+    }
+    rmdir(test_root);
+}
+
+static void reset(void)
+{
+    write_node(RAM_SYSFS_DSP_OPP, 0);
+    rm_governor_enable(1);
+    /* nothing running: idle, OPP1 */
+    CHECK(rm_governor_sample(0, RAM_LOAD_UNKNOWN) == 0);
+    CHECK(rm_get_vdd1_constraint() == 1);
+    CHECK(rm_governor_timeout() == -1);
+}
+
+static void test_step_up_down(void)
+{
+    int i;
+
+    reset();
+
+    /* 300 MHz measured needs OPP3 (360 MHz) within RAM_GOVERNOR_UP_PERCENT */
+    CHECK(rm_governor_sample(0, 300) == 3);
+    CHECK(rm_get_vdd1_constraint() == 3);
+    /* nothing requested it, so it has to be able to drop on its own */
+    CHECK(rm_governor_timeout() > 0 &&
+          rm_governor_timeout() <= RAM_GOVERNOR_INTERVAL_MS);
+
+    /* 100 MHz fits in OPP2, but only RAM_GOVERNOR_DOWN_SAMPLES in a row count */
+    for (i = 1; i < RAM_GOVERNOR_DOWN_SAMPLES; i++) {
+        CHECK(rm_governor_sample(0, 100) == 3);
+    }
+    /* a request that still needs OPP3 starts the count again */
+    CHECK(rm_governor_sample(250, RAM_LOAD_UNKNOWN) == 3);
+    for (i = 1; i < RAM_GOVERNOR_DOWN_SAMPLES; i++) {
+        CHECK(rm_governor_sample(0, 100) == 3);
+        CHECK(rm_get_vdd1_constraint() == 3);
+    }
+    CHECK(rm_governor_sample(0, 100) == 2);
+    CHECK(rm_get_vdd1_constraint() == 2);
+
+    /* a component asking for it keeps the OPP up */
+    CHECK(rm_governor_sample(300, RAM_LOAD_UNKNOWN) == 3);
+    CHECK(rm_get_vdd1_constraint() == 3);
+    for (i = 0; i < 2 * RAM_GOVERNOR_DOWN_SAMPLES; i++) {
+        CHECK(rm_governor_sample(300, RAM_LOAD_UNKNOWN) == 3);
+    }
+    CHECK(rm_get_vdd1_constraint() == 3);
+}
+
+/*
+ * A pre-boost is held for its time, then released by ticks alone while a
+ * client keeps the RM busy every TEST_CLIENT_PERIOD_MS without changing
+ * its request. Like the RM main loop, every wake-up ticks if
+ * rm_governor_timeout() says one is due.
+ */
+static void test_burst(void)
+{
+    long long start, now, lastTick, dropMs = -1;
+    int ticks = 0, lateTicks = 0, timeout;
+
+    reset();
+
+    rm_governor_burst(400, RAM_GOVERNOR_BURST_MS / 4);
+    /* 400 MHz needs OPP5 within RAM_GOVERNOR_UP_PERCENT */
+    CHECK(rm_get_vdd1_constraint() == 5);
+    CHECK(rm_governor_timeout() > 0);
+
+    start = lastTick = now_ms();
+    for (;;) {
+        timeout = rm_governor_timeout();
+        if (timeout < 0) {
+            break;
+        }
+        now = now_ms();
+        if (now - start > TEST_TIMEOUT_MS) {
+            break;
+        }
+        /* client traffic does not push the next tick out */
+        CHECK(timeout <= RAM_GOVERNOR_INTERVAL_MS - (now - lastTick) + 1);
+
+        sleep_ms(timeout < TEST_CLIENT_PERIOD_MS ? timeout : TEST_CLIENT_PERIOD_MS);
+        if (rm_governor_timeout() == 0) {
+            now = now_ms();
+            if (now - lastTick > 2 * RAM_GOVERNOR_INTERVAL_MS) {
+                lateTicks++;
+            }
+            lastTick = now;
+            rm_governor_tick();
+            ticks++;
+        }
+        if (dropMs < 0 && rm_get_vdd1_constraint() < 5) {
+            dropMs = now_ms() - start;
+        }
+    }
+
+    printf("burst released after %lld ms, %d ticks\n", dropMs, ticks);
+    CHECK(dropMs >= RAM_GOVERNOR_BURST_MS / 4);
+    CHECK(rm_get_vdd1_constraint() == 1);
+    CHECK(rm_governor_timeout() == -1);
+    /* expiry plus RAM_GOVERNOR_DOWN_SAMPLES ticks to step down */
+    CHECK(ticks >= RAM_GOVERNOR_DOWN_SAMPLES);
+    CHECK(lateTicks == 0);
+}
+
+static void test_disabled(void)
+{
+    write_node(RAM_SYSFS_DSP_OPP, 0);
+    rm_governor_enable(0);
+    CHECK(rm_governor_sample(0, 300) == -1);
+    rm_governor_burst(400, RAM_GOVERNOR_BURST_MS);
+    CHECK(rm_get_vdd1_constraint() == 0);
+    CHECK(rm_governor_timeout() == -1);
+}
+
+int main(void)
+{
+    const char *tmp = getenv("TMPDIR");
+
+    snprintf(test_root, sizeof(test_root), "%s/ram_governor_test.XXXXXX",
+             tmp != NULL ? tmp : "/tmp");
+    if (mkdtemp(test_root) == NULL || make_tree() < 0) {
+        printf("cannot create a fake sysfs tree in %s: %s\n", test_root, strerror(errno));
+        return 1;
+    }
+    rm_set_sysfs_root(test_root);
+
+    test_step_up_down();
+    test_burst();
+    test_disabled();
+
+    remove_tree();
+
+    if (failures) {
+        printf("ram governor test: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("ram governor test: passed\n");
+    return 0;
+}
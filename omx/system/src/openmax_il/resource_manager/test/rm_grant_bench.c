@@ -0,0 +1,188 @@
+/*
+ *  Copyright 2001-2008 Texas Instruments - http://www.ti.com/
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Acquire-to-grant latency of the Resource Manager with many components
+ * starting at once.
+ *
+ *   rm_grant_bench [components] [rounds] [MHz per component]
+ *
+ * Every round, <components> threads are released together and each one asks
+ * for resources the way an OMX component leaving the Loaded state does. The
+ * time from RMProxy_RequestResource to the grant or deny is recorded, then
+ * every component frees its resources before the next round starts.
+ * OMXResourceManager and OMXPolicyManager must be running.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ResourceManagerProxyAPI.h>
+
+#define BENCH_DEFAULT_COMPONENTS    24
+#define BENCH_DEFAULT_ROUNDS        50
+#define BENCH_DEFAULT_MHZ           1
+
+typedef struct BenchComponent
+{
+    pthread_t thread;
+    OMX_ERRORTYPE eError;
+    long long latency_ns;
+} BenchComponent;
+
+static int bench_components = BENCH_DEFAULT_COMPONENTS;
+static int bench_mhz = BENCH_DEFAULT_MHZ;
+
+/* bionic has no pthread_barrier_t */
+typedef struct BenchBarrier
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int waiting;
+    int generation;
+} BenchBarrier;
+
+static BenchBarrier bench_start = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0 };
+static BenchBarrier bench_granted = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0 };
+
+static void bench_barrier_wait(BenchBarrier *barrier)
+{
+    int generation;
+
+    pthread_mutex_lock(&barrier->lock);
+    generation = barrier->generation;
+    if (++barrier->waiting == bench_components) {
+        barrier->waiting = 0;
+        barrier->generation++;
+        pthread_cond_broadcast(&barrier->cond);
+    }
+    while (generation == barrier->generation) {
+        pthread_cond_wait(&barrier->cond, &barrier->lock);
+    }
+    pthread_mutex_unlock(&barrier->lock);
+}
+
+static void bench_callback(RMPROXY_COMMANDDATATYPE cbData)
+{
+    /* preemption and resource notifications are not part of the measurement */
+}
+
+static RMPROXY_CALLBACKTYPE bench_rmproxy_callback = { bench_callback };
+
+static long long bench_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+    long long x = *(const long long *) a;
+    long long y = *(const long long *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void *bench_component(void *arg)
+{
+    BenchComponent *component = (BenchComponent *) arg;
+    long long start;
+
+    /* the address of the slot stands in for the component handle */
+    bench_barrier_wait(&bench_start);
+    start = bench_now_ns();
+    component->eError = RMProxy_NewSendCommand((OMX_HANDLETYPE) component,
+                                               RMProxy_RequestResource,
+                                               OMX_PCM_Decoder_COMPONENT,
+                                               bench_mhz, 0,
+                                               &bench_rmproxy_callback);
+    component->latency_ns = bench_now_ns() - start;
+
+    /* hold the resources until everybody has an answer */
+    bench_barrier_wait(&bench_granted);
+    RMProxy_NewSendCommand((OMX_HANDLETYPE) component, RMProxy_FreeResource,
+                           OMX_PCM_Decoder_COMPONENT, 0, 0, NULL);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchComponent *components;
+    long long *samples;
+    long long sum = 0;
+    int rounds = BENCH_DEFAULT_ROUNDS;
+    int denied = 0;
+    int count = 0;
+    int i, round;
+
+    if (argc > 1) {
+        bench_components = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        rounds = atoi(argv[2]);
+    }
+    if (argc > 3) {
+        bench_mhz = atoi(argv[3]);
+    }
+    if (bench_components <= 0 || rounds <= 0) {
+        printf("usage: %s [components] [rounds] [MHz per component]\n", argv[0]);
+        return 1;
+    }
+
+    components = calloc(bench_components, sizeof(BenchComponent));
+    samples = calloc((size_t) bench_components * rounds, sizeof(long long));
+    if (components == NULL || samples == NULL) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    if (RMProxy_NewInitalizeEx(OMX_COMPONENTTYPE_AUDIO) != OMX_ErrorNone) {
+        printf("RMProxy_NewInitalizeEx failed\n");
+        return 1;
+    }
+
+    for (round = 0; round < rounds; round++) {
+        for (i = 0; i < bench_components; i++) {
+            pthread_create(&components[i].thread, NULL, bench_component, &components[i]);
+        }
+        for (i = 0; i < bench_components; i++) {
+            pthread_join(components[i].thread, NULL);
+            if (components[i].eError != OMX_ErrorNone) {
+                denied++;
+            }
+            samples[count++] = components[i].latency_ns;
+            sum += components[i].latency_ns;
+        }
+    }
+
+    qsort(samples, count, sizeof(long long), bench_compare);
+    printf("%d components x %d rounds, %d MHz each, %d denied\n",
+           bench_components, rounds, bench_mhz, denied);
+    printf("acquire-to-grant us: min %lld avg %lld p50 %lld p90 %lld p99 %lld max %lld\n",
+           samples[0] / 1000, sum / count / 1000,
+           samples[count / 2] / 1000, samples[count * 9 / 10] / 1000,
+           samples[count * 99 / 100] / 1000, samples[count - 1] / 1000);
+
+    RMProxy_DeinitalizeEx(OMX_COMPONENTTYPE_AUDIO);
+    free(samples);
+    free(components);
+    return 0;
+}
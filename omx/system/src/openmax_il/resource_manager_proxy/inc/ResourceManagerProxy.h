@@ -58,15 +58,15 @@
         #define RMPROXY_DPRINT(...)
 #endif
 
-#define RM_SERVER_IN "/dev/rm_server_in"
-#define RM_SERVER_OUT "/dev/rm_server_out"
+/* must match RM_SERVER_SOCKET of ResourceManagerAPI.h */
+#define RM_SERVER_SOCKET "/dev/rm_server"
 
 #define PERMS 0777
 
 #define MAXSTREAMCOUNT	10
 #define RMPROXY_MAXCOMPONENTS 100
 int flag = 0;
-int RMProxyfdread, RMProxyfdwrite;
+int RMProxyfd = -1;
 int eErrno;
 
 typedef struct _RMPROXY_CORE
@@ -110,6 +110,8 @@ typedef struct RMProxy_RegisteredComponentData
 {
     OMX_HANDLETYPE componentHandle;
     RMPROXY_CALLBACKTYPE *callback;
+    sem_t *sem;                 /* request waiting for a grant or deny */
+    OMX_ERRORTYPE *RM_Error;    /* where the answer to that request goes */
 } RMProxy_RegisteredComponentData;
 
 
@@ -130,8 +132,9 @@ void RM_WaitForResource(OMX_HANDLETYPE hComponent, OMX_U32 param, sem_t *sem, OM
 void RM_SetState(OMX_HANDLETYPE hComponent, OMX_U32 param1, OMX_U32 param2);
 void RM_FreeResource(OMX_HANDLETYPE hComponent, OMX_U32 param1, OMX_U32 param2, OMX_U32 numClients);
 void RM_CancelWaitForResource(OMX_HANDLETYPE hComponent, OMX_U32 param1, OMX_U32 param2);
-void RMProxy_itoa(int n, char s[]);
-void RMProxy_reverse(char s[]);
+int RMProxy_Connect(int epollfd);
+int RMProxy_GetListIndex(OMX_HANDLETYPE hComponent);
+void RMProxy_CompleteRequest(int index, OMX_ERRORTYPE error);
 void RMProxy_CallbackClient(OMX_HANDLETYPE hComponent, OMX_ERRORTYPE *error, RMPROXY_CORE *core);
 int RMProxy_CheckForStubMode();
 
@@ -51,6 +51,9 @@
 #include <sys/stat.h>
 #include <sys/errno.h>
 #include <sys/prctl.h>
+#include <sys/socket.h> // for the resource manager connection
+#include <sys/un.h>
+#include <sys/epoll.h>
 #include <pthread.h>    // for threading support
 #include <string.h>     // for memset
 #include <stdio.h>      // for buffered io
@@ -71,11 +74,8 @@ int nImageInstances = 0;
 int nCameraInstances = 0;
 int nDisplay1Instances = 0;
 int nDisplay2Instances = 0;
-int responsePending = 0;
-OMX_ERRORTYPE *RM_Error = NULL;
 int closeThreadFlag=0;
 RMProxy_ComponentList componentList;
-sem_t                    *sem = NULL;
 
 int boost_count = 0;
 static pthread_mutex_t boost_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -94,7 +94,7 @@ PERF_OBJHANDLE pPERFproxy = NULL;
 #define MAX_CAMERA_INSTANCES 1
 #define MAX_DISPLAY1_INSTANCES 1
 #define MAX_DISPLAY2_INSTANCES 1
-#define PIPE_SIZE 120
+#define RMPROXY_CONNECT_TRIES 100
 
 /*
 
@@ -468,24 +468,26 @@ OMX_ERRORTYPE RMProxy_NewSendCommand(OMX_HANDLETYPE hComponent, RMPROXY_COMMANDT
 {
     RMPROXY_COMMANDDATATYPE  RMProxy_CommandData ;
     OMX_ERRORTYPE            ReturnValue = OMX_ErrorNone ;
+    sem_t                    sem;
+    int                      waitForResponse = 0;
 
-    /* this ensures that one request completes before another starts */
-    while (responsePending) {
-        sleep(1);
+#ifndef __ENABLE_RMPM_STUB__
+    /* if we are stubbing out the actual implementation there will be no response */
+    if (cmd == RMProxy_RequestResource && !RMProxy_CheckForStubMode()) {
+        waitForResponse = 1;
     }
+#endif
 
-    if (cmd == RMProxy_RequestResource)
-    { 
-        responsePending = 1;
-        sem = malloc(sizeof(sem_t)) ; 
-        sem_init(sem, 0x00, 0x00);   
-        RM_Error = malloc(sizeof(OMX_ERRORTYPE)) ; 
-        if (NULL != RM_Error)
-            RMProxy_CommandData.RM_Error  = RM_Error ;
-        RMProxy_CommandData.sem       = sem;
+    /* each request waits on its own semaphore, so requests of different
+       components are in flight together */
+    RMProxy_CommandData.sem          = NULL ;
+    RMProxy_CommandData.RM_Error     = NULL ;
+    if (waitForResponse) {
+        sem_init(&sem, 0x00, 0x00);
+        RMProxy_CommandData.sem      = &sem ;
+        RMProxy_CommandData.RM_Error = &ReturnValue ;
     }
 
-
     RMProxy_CommandData.hComponent   = hComponent ;
     RMProxy_CommandData.RM_Cmd       = cmd ;
     RMProxy_CommandData.nPid       = getpid() ;
@@ -502,30 +504,10 @@ OMX_ERRORTYPE RMProxy_NewSendCommand(OMX_HANDLETYPE hComponent, RMPROXY_COMMANDT
         write(RMProxy_Handle.tothread[1],&RMProxy_CommandData,sizeof(RMPROXY_COMMANDDATATYPE)) ;
 
 
-    if (cmd == RMProxy_RequestResource) {
-#ifndef __ENABLE_RMPM_STUB__
-        if(!RMProxy_CheckForStubMode())
-        {
-            // wait for response back from resource manager server 
-            if (sem) { 
-                sem_wait(sem);
-            }
-            if (NULL != RM_Error)
-                ReturnValue = *RM_Error;
-
-            free(sem);
-            sem=NULL;
-            free(RM_Error);
-            RM_Error=NULL;
-        }
-#else
-        if(RMProxy_CheckForStubMode())
-        {
-            /* if using stubbed implementation always return grant */
-            ReturnValue = OMX_ErrorNone;
-        }
-#endif
-        responsePending = 0;
+    if (waitForResponse) {
+        // wait for response back from resource manager server 
+        sem_wait(&sem);
+        sem_destroy(&sem);
     }
     
     /* send the command and parameter using pipe */
@@ -574,20 +556,16 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
     RESOURCEMANAGER_COMMANDDATATYPE rm_data;
     
     RMPROXY_COMMANDDATATYPE *cmd_data= &(core->cmd_data);
-    fd_set rfds2 ;
-    fd_set rfds ;
-
-    int fdmax;
-    int status;
-    char namedPipeName[PIPE_SIZE];
-    char handleString[100];
+    struct epoll_event ev;
+    struct epoll_event events[2];
+    int epollfd;
+    int nEvents;
+    int n;
     int numClients=0;
     int i;
     int index=-1;
-    struct timespec tv;
-    int readPipeOpened=0;
     int fatalErrorHandled = 0;
-    OMX_PTR threadhandle=NULL;
+    OMX_ERRORTYPE eError;
 
     componentList.numRegisteredComponents = 0;
 
@@ -603,21 +581,22 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
 
     RMPROXY_DPRINT("[Resource_Manager_Proxy] - RMProxy_Thread\n");
 
+    /* the thread sleeps until a component or the resource manager talks */
+    epollfd = epoll_create(2);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = RMProxy_Handle.tothread[0];
+    epoll_ctl(epollfd, EPOLL_CTL_ADD, RMProxy_Handle.tothread[0], &ev);
 
-
-    fdmax = RMProxy_Handle.tothread[0];
-    tv.tv_sec = 0;
-    tv.tv_nsec = 100000000;
     while (1)
     {
-        //RMPROXY_DPRINT("RMProxy - Beginning of thread while loop\n");
-        FD_ZERO(&rfds2);
-        FD_SET(RMProxy_Handle.tothread[0], &rfds2);
-        sigset_t set;
-        sigemptyset (&set);
-        sigaddset (&set, SIGALRM);
-        status = pselect(fdmax+1, &rfds2, NULL, NULL, &tv, &set);
-        if (FD_ISSET(RMProxy_Handle.tothread[0], &rfds2)) {
+        nEvents = epoll_wait(epollfd, events, 2, -1);
+        if (nEvents < 0) {
+            continue;
+        }
+
+        for (n = 0; n < nEvents; n++) {
+        if (events[n].data.fd == RMProxy_Handle.tothread[0]) {
              // handle command from OMX component
             read(RMProxy_Handle.tothread[0], cmd_data, sizeof(RMPROXY_COMMANDDATATYPE));
 
@@ -637,21 +616,14 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
             case RMProxy_FreeResource:
                 RM_FreeResource(cmd_data->hComponent, cmd_data->param1, cmd_data->param2,numClients);
                 /* Find the index of the component to free */
-                for (i=0; i < componentList.numRegisteredComponents; i++) {
-                    if (componentList.component[i].componentHandle == cmd_data->hComponent) {
-                        index = i;
-                        break;
-                    }
-                }
+                index = RMProxy_GetListIndex(cmd_data->hComponent);
                 if (index != -1) {
                     /* Shift all other components in the list up */
                     for(i=index; i < componentList.numRegisteredComponents-1; i++) {
-                        componentList.component[i].componentHandle = componentList.component[i+1].componentHandle;
-                        componentList.component[i].callback = componentList.component[i+1].callback;
+                        componentList.component[i] = componentList.component[i+1];
                     }
                     /* set the end of the list to keep the list clean */
-                    componentList.component[i].componentHandle = NULL;
-                    componentList.component[i].callback = NULL;
+                    memset(&componentList.component[i], 0, sizeof(componentList.component[i]));
                     /* Decrement the count of registered components */
                     componentList.numRegisteredComponents--;
                     /* reset index */
@@ -671,68 +643,55 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
             // Forward command to resource manager server and waiting for response back
             case RMProxy_RequestResource:
                 RMPROXY_DPRINT("RMProxy_Thread %d\n",__LINE__);
-                /* add component and corresponding callback to the list */
-                componentList.component[componentList.numRegisteredComponents].componentHandle = cmd_data->hComponent;
-                componentList.component[componentList.numRegisteredComponents++].callback = (RMPROXY_CALLBACKTYPE*)cmd_data->param4;
-                if (numClients == 0) {
-                    if ((RMProxyfdwrite=open(RM_SERVER_IN, O_WRONLY))<0){
-                        RMPROXY_DPRINT("[Resource_Manager_Proxy] - failure to open WRITE pipe [RMProxyfdwrite=%d], [errno=%d]\n", RMProxyfdwrite, errno);
-                    } else {
-                        RMPROXY_DPRINT("[RM_PROXY] - WRITE pipe opened successfully\n");
+                if (RMProxyfd < 0 && RMProxy_Connect(epollfd) < 0) {
+                    if (cmd_data->RM_Error) {
+                        *cmd_data->RM_Error = OMX_ErrorHardware;
                     }
-                    
-                    rm_data.hComponent = cmd_data->hComponent;
-                    rm_data.nPid = getpid();
-                    rm_data.RM_Cmd = RMProxy_OpenPipe;
-                    rm_data.rm_status = RM_ErrorNone;
-                    rm_data.param1 = cmd_data->param1;
-                    threadhandle = cmd_data->hComponent;
-                    rm_data.param2 = cmd_data->param2;
-                    rm_data.param3 = cmd_data->param4;
-                    // send request to resource manager
-
-#ifdef __PERF_INSTRUMENTATION__
-                    PERF_SendingCommand(pPERFproxy, rm_data.RM_Cmd, rm_data.param1, PERF_ModuleHLMM);
-#endif
-
-                    /*  RMProxy_itoa((int)cmd_data.hComponent,handleString);*/
-                    RMProxy_itoa((int)rm_data.nPid,handleString);
-
-                    strcpy(namedPipeName,RM_SERVER_OUT);
-                    strcat(namedPipeName,"_");
-                    strcat(namedPipeName,handleString);
-
-                    //send the request to open the pipe
-
-                    if ((write(RMProxyfdwrite, &rm_data, sizeof(rm_data))) < 0) 
-                        RMPROXY_DPRINT("[RM_Proxy] - failure write data to resource manager\n");
-
-                    /* wait for the pipe to be created while trying to open it
-                       assumes the pipe open will eventually succeed */
-                    RMPROXY_DPRINT("[RM_Proxy] - try to open the IN Pipe, RM_SERVER_OUT for PID %d\n", (int)getpid());
-                    RMPROXY_DPRINT("namedPipeName = %s\n", (char*)namedPipeName);
-                    while((RMProxyfdread=open(namedPipeName, O_RDONLY )) < 0)
-                    {
-                        RMPROXY_DPRINT("[RM_Proxy] - waiting on pipe creation\
-                                        [RMProxyfdread=%d],\
-                                        [errno=%d]\n", RMProxyfdread, errno);
-                        sleep(.05);
+                    if (cmd_data->sem) {
+                        sem_post(cmd_data->sem);
                     }
-                    readPipeOpened = 1;
-                    RMPROXY_DPRINT("[RM_Proxy] - read pipe opened successfully\n");
+                    break;
+                }
 
+                /* add component and corresponding callback to the list, the
+                   reply is matched to the waiting request by the handle */
+                index = RMProxy_GetListIndex(cmd_data->hComponent);
+                if (index == -1 && componentList.numRegisteredComponents < RMPROXY_MAXCOMPONENTS) {
+                    index = componentList.numRegisteredComponents++;
+                    componentList.component[index].componentHandle = cmd_data->hComponent;
                 }
-                else {
-                    rm_data.RM_Cmd = RMProxy_ReusePipe;
-                    rm_data.hComponent = cmd_data->hComponent;
-                    rm_data.param1 = cmd_data->param1;
-                    rm_data.param2 = cmd_data->param2;
-                    rm_data.param4 = (OMX_U32)threadhandle;
-                    if ((write(RMProxyfdwrite, &rm_data, sizeof(rm_data))) < 0)
-                        RMPROXY_DPRINT("[RM_Proxy] - failure write data to resource manager\n");
-                    
-                    
+                if (index == -1) {
+                    /* no slot to route the reply to, fail it here */
+                    RMPROXY_DPRINT("[RM_Proxy] - too many components, request of %p refused\n",
+                                   cmd_data->hComponent);
+                    if (cmd_data->RM_Error) {
+                        *cmd_data->RM_Error = OMX_ErrorInsufficientResources;
+                    }
+                    if (cmd_data->sem) {
+                        sem_post(cmd_data->sem);
+                    }
+                    break;
                 }
+                componentList.component[index].callback = (RMPROXY_CALLBACKTYPE*)cmd_data->param4;
+                componentList.component[index].sem = cmd_data->sem;
+                componentList.component[index].RM_Error = cmd_data->RM_Error;
+
+                /* register the component with our connection */
+                rm_data.hComponent = cmd_data->hComponent;
+                rm_data.nPid = getpid();
+                rm_data.RM_Cmd = RMProxy_OpenPipe;
+                rm_data.rm_status = RM_ErrorNone;
+                rm_data.param1 = cmd_data->param1;
+                rm_data.param2 = cmd_data->param2;
+                rm_data.param3 = cmd_data->param3;
+                rm_data.param4 = 0;
+
+#ifdef __PERF_INSTRUMENTATION__
+                PERF_SendingCommand(pPERFproxy, rm_data.RM_Cmd, rm_data.param1, PERF_ModuleHLMM);
+#endif
+                if (send(RMProxyfd, &rm_data, sizeof(rm_data), MSG_NOSIGNAL) < 0)
+                    RMPROXY_DPRINT("[RM_Proxy] - failure write data to resource manager\n");
+
                 RM_RequestResource(cmd_data->hComponent,
                                    cmd_data->param1,
                                    cmd_data->param2,
@@ -758,19 +717,18 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
                 close(RMProxy_Handle.tothread[0]);
                 close(RMProxy_Handle.tothread[1]);
 
-                close(RMProxyfdread);
-                readPipeOpened = 0;
-                close(RMProxyfdwrite);
+                /* the resource manager releases whatever is left when we hang up */
+                if (RMProxyfd >= 0) {
+                    close(RMProxyfd);
+                    RMProxyfd = -1;
+                }
+                close(epollfd);
 
                 if (core != NULL)
                 {
                     free(core);
                     core = NULL;
                 }
-                if(unlink(namedPipeName)<0) {
-                    /*RMPROXY_DPRINT("[Resource Manager] - unlink RM_SERVER_OUT = %s error\n", namedPipeName);*/
-                }
-
                 
                 return (NULL);
 
@@ -779,61 +737,44 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
             }
 
         }
+        else if (events[n].data.fd == RMProxyfd) {
+            if (recv(RMProxyfd, &rm_data, sizeof(rm_data), 0) != sizeof(rm_data)) {
+                /* the resource manager went away, fail whoever is still waiting */
+                RMPROXY_DPRINT("[RM_Proxy] - lost the resource manager connection\n");
+                epoll_ctl(epollfd, EPOLL_CTL_DEL, RMProxyfd, NULL);
+                close(RMProxyfd);
+                RMProxyfd = -1;
+                for (i=0; i < componentList.numRegisteredComponents; i++) {
+                    RMProxy_CompleteRequest(i, OMX_ErrorHardware);
+                }
+                continue;
+            }
 
-        if (readPipeOpened) {
-        FD_ZERO(&rfds);
-        FD_SET(RMProxyfdread, &rfds);
-            
-         status = pselect(RMProxyfdread+1, &rfds, NULL, NULL, &tv, &set);
-
-        if (FD_ISSET(RMProxyfdread, &rfds)) {
-            //RMPROXY_DPRINT("RMProxyfdread set\n");
-            read(RMProxyfdread,&rm_data,sizeof(rm_data));
+            index = RMProxy_GetListIndex(rm_data.hComponent);
             if (rm_data.rm_status == RM_DENY) {
-            
-                if (RM_Error) {
-                    *RM_Error = OMX_ErrorInsufficientResources;  
-                }
-                if (sem) {
-                    sem_post(sem) ;
-                }
-                
+                RMProxy_CompleteRequest(index, OMX_ErrorInsufficientResources);
             }
             else if (rm_data.rm_status == RM_PREEMPT) {
-                if (!RM_Error)
-                    RM_Error = malloc(sizeof(OMX_ERRORTYPE));
-                if (NULL != RM_Error)
-                    *RM_Error = OMX_RmProxyCallback_ResourcesPreempted;
+                eError = OMX_RmProxyCallback_ResourcesPreempted;
                 cmd_data->hComponent = rm_data.hComponent;
                 if (NULL != core)
                 {
-                    RMProxy_CallbackClient(rm_data.hComponent,RM_Error, core);
-                    free (RM_Error);
-                    RM_Error = NULL;
+                    RMProxy_CallbackClient(rm_data.hComponent,&eError, core);
                 }
             }
             else if (rm_data.rm_status == RM_RESOURCEFATALERROR && !fatalErrorHandled) {
                 /* if RM denies us due to dsp recovery during request resource, we will deadlock the system if Callback is used
                    because the main thread in the OMX component is already blocked on RMProxy_RequestResource */
-                if(!responsePending){
-                    if (!RM_Error)
-                        RM_Error = malloc(sizeof(OMX_ERRORTYPE));
-                    if (NULL != RM_Error)
-                        *RM_Error = OMX_RmProxyCallback_FatalError;
+                if (index != -1 && componentList.component[index].sem) {
+                    RMPROXY_DPRINT("RM_RESOURCEFATALERROR while requesting resources");
+                    RMProxy_CompleteRequest(index, OMX_RmProxyCallback_FatalError);
+                }
+                else {
+                    eError = OMX_RmProxyCallback_FatalError;
                     cmd_data->hComponent = rm_data.hComponent;
                     if (NULL != core)
                     {
-                        RMProxy_CallbackClient(rm_data.hComponent,RM_Error, core);
-                        free (RM_Error);
-                        RM_Error = NULL;
-                    }
-                }else {
-                    RMPROXY_DPRINT("RM_RESOURCEFATALERROR while requesting resources");
-                    if (RM_Error) {
-                        *RM_Error = OMX_RmProxyCallback_FatalError;
-                    }
-                    if (sem) {
-                        sem_post(sem) ;
+                        RMProxy_CallbackClient(rm_data.hComponent,&eError, core);
                     }
                 }
                 /* unknown behavior can occur if we tell the system to handle a fatal error multiple times.
@@ -841,50 +782,103 @@ void *RMProxy_Thread(RMPROXY_CORE *core)
                 fatalErrorHandled = 1;
             }
             else if (rm_data.rm_status == RM_GRANT) {
-#ifndef __ENABLE_RMPM_STUB__
-                /* if not in stub mode... */
-                if(!RMProxy_CheckForStubMode())
-                {
-                    /* if we are stubbing out the actual implmentation there will be no response */
-                    if (RM_Error) {
-                        *RM_Error = OMX_ErrorNone;  
-                    }
-                
-                    if (sem) { 
-                        sem_post(sem) ;
-                    }
-                }
-#endif                
-            
                 // signal the component that resource is available
-                
+                RMProxy_CompleteRequest(index, OMX_ErrorNone);
             }
             else if (rm_data.rm_status == RM_RESOURCEACQUIRED) {
                 RMPROXY_DPRINT("Got RM_RESOURCEACQUIRED\n");
-                if (!RM_Error)
-                    RM_Error = malloc(sizeof(OMX_ERRORTYPE));
-                if ( NULL != RM_Error)
-                    *RM_Error = OMX_RmProxyCallback_ResourcesAcquired;
+                eError = OMX_RmProxyCallback_ResourcesAcquired;
                 if (NULL != core)
                 {
-                    RMProxy_CallbackClient(rm_data.hComponent,RM_Error, core);
-                    free (RM_Error);
-                    RM_Error = NULL;
+                    RMProxy_CallbackClient(rm_data.hComponent,&eError, core);
                 }
                     
             }
         }
+        }
 
     
     //RMPROXY_DPRINT("RMProxy - End of thread while loop\n");
 
     }
-}
 #ifdef __PERF_INSTRUMENTATION__
     PERF_Done(pPERFproxy);
 #endif
 }
 
+/*
+   Connect to the resource manager and watch the connection from epollfd.
+   The resource manager may still be starting, so retry for a second.
+*/
+int RMProxy_Connect(int epollfd)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+    struct timespec tv;
+    int tries;
+    int fd;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        RMPROXY_DPRINT("[RM_Proxy] - socket failed [errno=%d]\n", errno);
+        return -1;
+    }
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, RM_SERVER_SOCKET, sizeof(addr.sun_path) - 1);
+
+    tv.tv_sec = 0;
+    tv.tv_nsec = 10000000;
+    for (tries = 0; connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0; tries++) {
+        if (tries == RMPROXY_CONNECT_TRIES || (errno != ENOENT && errno != ECONNREFUSED && errno != EINTR)) {
+            RMPROXY_DPRINT("[RM_Proxy] - failure to connect to the resource manager [errno=%d]\n", errno);
+            close(fd);
+            return -1;
+        }
+        nanosleep(&tv, NULL);
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollfd, EPOLL_CTL_ADD, fd, &ev);
+
+    RMProxyfd = fd;
+    RMPROXY_DPRINT("[RM_Proxy] - connected to the resource manager\n");
+    return 0;
+}
+
+int RMProxy_GetListIndex(OMX_HANDLETYPE hComponent)
+{
+    int i;
+
+    for (i=0; i < componentList.numRegisteredComponents; i++) {
+        if (componentList.component[i].componentHandle == hComponent) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* answer the request the component at index is blocked on, if any */
+void RMProxy_CompleteRequest(int index, OMX_ERRORTYPE error)
+{
+    sem_t *sem;
+
+    if (index == -1 || componentList.component[index].sem == NULL) {
+        return;
+    }
+    sem = componentList.component[index].sem;
+    if (componentList.component[index].RM_Error) {
+        *componentList.component[index].RM_Error = error;
+    }
+    componentList.component[index].sem = NULL;
+    componentList.component[index].RM_Error = NULL;
+    sem_post(sem);
+}
+
 void RM_RequestResource(OMX_HANDLETYPE hComponent, OMX_U32 param, OMX_U32 param2, OMX_U32 param3,OMX_U32 nPid, sem_t *sem, OMX_ERRORTYPE *RM_Error)
 {
     RESOURCEMANAGER_COMMANDDATATYPE rm_data;
@@ -901,7 +895,7 @@ void RM_RequestResource(OMX_HANDLETYPE hComponent, OMX_U32 param, OMX_U32 param2
 #ifdef __PERF_INSTRUMENTATION__
     PERF_SendingCommand(pPERFproxy, rm_data.RM_Cmd, rm_data.param1, PERF_ModuleHLMM);
 #endif
-    if ((write(RMProxyfdwrite, &rm_data, sizeof(rm_data))) < 0)
+    if (send(RMProxyfd, &rm_data, sizeof(rm_data), MSG_NOSIGNAL) < 0)
         RMPROXY_DPRINT("[Resource_Manager_Proxy] - failure write data to resource manager\n");
 
 #ifdef __PERF_INSTRUMENTATION__
@@ -930,7 +924,7 @@ void RM_WaitForResource(OMX_HANDLETYPE hComponent, OMX_U32 param, sem_t *sem, OM
 #ifdef __PERF_INSTRUMENTATION__
     PERF_SendingCommand(pPERFproxy, rm_data.RM_Cmd, rm_data.param1, PERF_ModuleHLMM);
 #endif
-    if ((write(RMProxyfdwrite, &rm_data, sizeof(rm_data))) < 0)
+    if (send(RMProxyfd, &rm_data, sizeof(rm_data), MSG_NOSIGNAL) < 0)
         RMPROXY_DPRINT("[Resource_Manager_Proxy] - failure write data to resource manager\n");
 #ifdef __PERF_INSTRUMENTATION__
     PERF_ReceivedCommand(pPERFproxy, PERF_CommandStatus, rm_data.rm_status, PERF_ModuleHLMM);
@@ -950,7 +944,7 @@ void RM_SetState(OMX_HANDLETYPE hComponent, OMX_U32 param1, OMX_U32 param2)
     rm_data.param2 = param2;
     rm_data.nPid = getpid();
     rm_data.rm_status = RM_ErrorNone;
-    if ((write(RMProxyfdwrite, &rm_data, sizeof(rm_data))) < 0)
+    if (send(RMProxyfd, &rm_data, sizeof(rm_data), MSG_NOSIGNAL) < 0)
         RMPROXY_DPRINT("[Resource_Manager_Proxy] - failure write data to resource manager\n");
 }
 
@@ -973,7 +967,7 @@ void RM_FreeResource(OMX_HANDLETYPE hComponent, OMX_U32 param1, OMX_U32 param2,
     rm_data.param2 = param2;
     rm_data.rm_status = RM_ErrorNone;
 
-    if ((write(RMProxyfdwrite, &rm_data, sizeof(rm_data))) < 0)
+    if (send(RMProxyfd, &rm_data, sizeof(rm_data), MSG_NOSIGNAL) < 0)
         RMPROXY_DPRINT("[Resource_Manager_Proxy] - failure write data to resource manager\n");
 
 }
@@ -989,35 +983,6 @@ void RM_CancelWaitForResource(OMX_HANDLETYPE hComponent, OMX_U32 param1, OMX_U32
 
 
 
-void RMProxy_itoa(int n, char s[])
-{
-    int i, sign;
-
-    if ((sign = n) < 0)  /* record sign */
-        n = -n;          /* make n positive */
-    i = 0;
-    do {       /* generate digits in reverse order */
-        s[i++] = n % 10 + '0';   /* get next digit */
-    } while ((n /= 10) > 0);     /* delete it */
-    if (sign < 0)
-        s[i++] = '-';
-    s[i] = '\0';
-    RMProxy_reverse(s);
-}
-
-
-
-void RMProxy_reverse(char s[])
-{
-    int c, i, j;
-
-    for (i = 0, j = strlen(s)-1; i<j; i++, j--) {
-        c = s[i];
-        s[i] = s[j];
-        s[j] = c;
-    }
-}
-
 int RMProxy_RequestBoost(int level)
 {
     if(pthread_mutex_lock(&boost_mutex) != 0)
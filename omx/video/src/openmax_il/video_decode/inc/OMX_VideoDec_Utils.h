@@ -96,6 +96,8 @@
 #include "OMX_VideoDecoder.h"
 #include "OMX_VidDec_CustomCmd.h"
 #include "OMX_TI_Common.h"
+#include "OMX_TI_BufQueue.h"
+#include "OMX_TI_BitReader.h"
 
 
 
@@ -312,8 +314,7 @@ typedef enum VIDDEC_ENUM_MEMLEVELS{
 #define VIDDEC_DEFAULT_WMV_PORTINDEX                  VIDDEC_INPUT_PORT
 #define VIDDEC_DEFAULT_WMV_FORMAT                     OMX_VIDEO_WMVFormat9
 
-#define VIDDEC_PIPE_WRITE                             VIDDEC_ONE
-#define VIDDEC_PIPE_READ                              VIDDEC_ZERO
+#define VIDDEC_BUFQ_SIZE                              16
 
 #define VIDDEC_PADDING_FULL                           256
 #define VIDDEC_PADDING_HALF                           VIDDEC_PADDING_FULL / 2
@@ -631,6 +632,18 @@ typedef struct VIDDEC_PORT_TYPE
     OMX_U32 IsBuffer2D;   /*Used when buffer pointers come from Gralloc allocations */
 } VIDDEC_PORT_TYPE;
 
+/* ======================================================================= */
+/**
+ * VIDDEC_CMD_ELEM  Command queued to the component thread, pCmdData is
+ *                  only used by OMX_CommandMarkBuffer
+ */
+/* ======================================================================= */
+typedef struct VIDDEC_CMD_ELEM {
+    OMX_COMMANDTYPE eCmd;
+    OMX_U32 nParam1;
+    OMX_PTR pCmdData;
+} VIDDEC_CMD_ELEM;
+
 typedef struct VIDDEC_MUTEX{
     OMX_BOOL bEnabled;
     OMX_BOOL bSignaled;
@@ -924,12 +937,12 @@ typedef struct VIDDEC_COMPONENT_PRIVATE
     OMX_VERSIONTYPE pSpecVersion;
     OMX_STRING cComponentName;
     pthread_t ComponentThread;
-    int free_inpBuf_Q[2];
-    int free_outBuf_Q[2];
-    int filled_inpBuf_Q[2];
-    int filled_outBuf_Q[2];
-    int cmdPipe[2];
-    int cmdDataPipe[2];
+    OMX_TI_BUFQWAKE bufQWake;
+    OMX_TI_BUFQUEUE free_inpBuf_Q;
+    OMX_TI_BUFQUEUE free_outBuf_Q;
+    OMX_TI_BUFQUEUE filled_inpBuf_Q;
+    OMX_TI_BUFQUEUE filled_outBuf_Q;
+    OMX_TI_BUFQUEUE cmdQ;
     OMX_U32 bIsStopping;
     OMX_U32 bIsPaused;
     OMX_U32 bTransPause;
@@ -1407,7 +1420,6 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
                                      OMX_U32* nHeight, OMX_U32* nCropWidth, OMX_U32* nCropHeight, OMX_U32 nType);
 OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG2( OMX_U32* nWidth, OMX_U32* nHeight, OMX_BUFFERHEADERTYPE *pBuffHead);
 OMX_U32 VIDDEC_GetBits(OMX_U32* nPosition, OMX_U8 nBits, OMX_U8* pBuffer, OMX_BOOL bIcreasePosition);
-OMX_S32 VIDDEC_UVLC_dec(OMX_U32 *nPosition, OMX_U8* pBuffer);
 OMX_ERRORTYPE AddStateTransition(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
 OMX_ERRORTYPE RemoveStateTransition(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate, OMX_BOOL bEnableSignal);
 OMX_ERRORTYPE IncrementCount (OMX_U32 * pCounter, pthread_mutex_t *pMutex);
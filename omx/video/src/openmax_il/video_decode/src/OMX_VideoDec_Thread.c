@@ -93,14 +93,12 @@ extern OMX_ERRORTYPE VIDDEC_Stop_ComponentThread(OMX_HANDLETYPE pComponent);
 extern OMX_ERRORTYPE VIDDEC_HandleCommandMarkBuffer(VIDDEC_COMPONENT_PRIVATE *pComponentPrivate, OMX_U32 nParam1, OMX_PTR pCmdData);
 extern OMX_ERRORTYPE VIDDEC_HandleCommandFlush(VIDDEC_COMPONENT_PRIVATE *pComponentPrivate, OMX_U32 nParam1, OMX_BOOL bPass);
 extern OMX_ERRORTYPE VIDDEC_Handle_InvalidState (VIDDEC_COMPONENT_PRIVATE* pComponentPrivate);
-extern int pselect(int  n, fd_set*  readfds, fd_set*  writefds, fd_set*  errfds,
-        const struct timespec*  timeout, const sigset_t*  sigmask);
 
 
 /*----------------------------------------------------------------------------*/
 /**
   * OMX_VidDec_Thread() is the open max thread. This method is in charge of
-  * listening to the buffers coming from DSP, application or commands through the pipes
+  * listening to the buffers coming from DSP, application or commands through the queues
   **/
 /*----------------------------------------------------------------------------*/
 
@@ -111,10 +109,9 @@ void* OMX_VidDec_Thread (void* pThreadData)
 {
     int status;
     sigset_t set;
-    struct timespec tv;
-    int fdmax;
-    fd_set rfds;
+    OMX_U32 nMask;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
+    VIDDEC_CMD_ELEM sCmd;
     OMX_COMMANDTYPE eCmd;
     OMX_U32 nParam1;
     OMX_PTR pCmdData;
@@ -133,41 +130,22 @@ void* OMX_VidDec_Thread (void* pThreadData)
 
     pLcmlHandle = (LCML_DSP_INTERFACE *)pComponentPrivate->pLCML;
 
-    /**Looking for highest number of file descriptor for pipes in order to put in select loop */
-    fdmax = pComponentPrivate->cmdPipe[VIDDEC_PIPE_READ];
-    if (pComponentPrivate->bDynamicConfigurationInProgress) {
-        if (pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ] > fdmax) {
-            fdmax = pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ];
-        }
-
-        if (pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ] > fdmax) {
-            fdmax = pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ];
-        }
-
-        if (pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ] > fdmax) {
-            fdmax = pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ];
-        }
-
-        if (pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ] > fdmax) {
-            fdmax = pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ];
-        }
-    }
     while (1) {
-        FD_ZERO (&rfds);
-        FD_SET(pComponentPrivate->cmdPipe[VIDDEC_PIPE_READ], &rfds);
+        /* only wait on the queues the handlers below would consume, so a
+           queue that is held back does not keep waking the thread up */
+        nMask = pComponentPrivate->cmdQ.nMask;
         if (!pComponentPrivate->bDynamicConfigurationInProgress) {
-            FD_SET(pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ], &rfds);
-            FD_SET(pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ], &rfds);
-            FD_SET(pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ], &rfds);
-            FD_SET(pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ], &rfds);
+            nMask |= pComponentPrivate->filled_outBuf_Q.nMask |
+                     pComponentPrivate->free_inpBuf_Q.nMask |
+                     pComponentPrivate->filled_inpBuf_Q.nMask;
+            if (pComponentPrivate->bFirstHeader) {
+                nMask |= pComponentPrivate->free_outBuf_Q.nMask;
+            }
         }
-        tv.tv_sec = 0;
-        tv.tv_nsec = 30000;
-
 
         sigemptyset (&set);
         sigaddset (&set, SIGALRM);
-        status = pselect (fdmax+1, &rfds, NULL, NULL, NULL, &set);
+        status = omx_bufq_wait(&pComponentPrivate->bufQWake, nMask, NULL, &set);
         sigdelset (&set, SIGALRM);
         
         if (0 == status) {
@@ -190,12 +168,12 @@ void* OMX_VidDec_Thread (void* pThreadData)
          break;
         }
         else {
-            if (FD_ISSET(pComponentPrivate->cmdPipe[VIDDEC_PIPE_READ], &rfds)) {
-                if(!bFlag) {
+            if (status & pComponentPrivate->cmdQ.nMask) {
+                if(!bFlag && omx_bufq_pop(&pComponentPrivate->cmdQ, &sCmd)) {
 
                     bFlag = OMX_TRUE;
-                    read(pComponentPrivate->cmdPipe[VIDDEC_PIPE_READ], &eCmd, sizeof(eCmd));
-                    read(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_READ], &nParam1, sizeof(nParam1));
+                    eCmd = sCmd.eCmd;
+                    nParam1 = sCmd.nParam1;
 
 #ifdef __PERF_INSTRUMENTATION__
                     PERF_ReceivedCommand(pComponentPrivate->pPERFcomp,
@@ -254,7 +232,7 @@ void* OMX_VidDec_Thread (void* pThreadData)
                         }
                     }
                     else if (eCmd == OMX_CommandMarkBuffer)    {
-                        read(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_READ], &pCmdData, sizeof(pCmdData));
+                        pCmdData = sCmd.pCmdData;
                         pComponentPrivate->arrCmdMarkBufIndex[pComponentPrivate->nInCmdMarkBufIndex].hMarkTargetComponent = ((OMX_MARKTYPE*)(pCmdData))->hMarkTargetComponent;
                         pComponentPrivate->arrCmdMarkBufIndex[pComponentPrivate->nInCmdMarkBufIndex].pMarkData = ((OMX_MARKTYPE*)(pCmdData))->pMarkData;
                         pComponentPrivate->nInCmdMarkBufIndex++;
@@ -268,7 +246,7 @@ void* OMX_VidDec_Thread (void* pThreadData)
                 pComponentPrivate->bPipeCleaned =0;
             }
             else{
-                if (FD_ISSET(pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ], &rfds)) {
+                if (status & pComponentPrivate->filled_outBuf_Q.nMask) {
                     eError = VIDDEC_HandleDataBuf_FromDsp(pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
                         OMX_PRBUFFER4(pComponentPrivate->dbg, "Error while handling filled DSP output buffer\n");
@@ -277,7 +255,7 @@ void* OMX_VidDec_Thread (void* pThreadData)
 
                     }
                 }
-                if (FD_ISSET(pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ], &rfds)) {
+                if (status & pComponentPrivate->free_inpBuf_Q.nMask) {
                     eError = VIDDEC_HandleFreeDataBuf(pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
                         OMX_PRBUFFER4(pComponentPrivate->dbg, "Error while processing free input buffers\n");
@@ -288,7 +266,7 @@ void* OMX_VidDec_Thread (void* pThreadData)
                 if (pComponentPrivate->bDynamicConfigurationInProgress) {
                     continue;
                 }
-                if ((FD_ISSET(pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ], &rfds))){
+                if (status & pComponentPrivate->filled_inpBuf_Q.nMask) {
                     OMX_PRSTATE2(pComponentPrivate->dbg, "eExecuteToIdle 0x%x\n",pComponentPrivate->eExecuteToIdle);
                     /* When doing a reconfiguration, don't send input buffers to SN & wait for SN to be ready*/
                     eError = VIDDEC_HandleDataBuf_FromApp (pComponentPrivate);
@@ -301,7 +279,7 @@ void* OMX_VidDec_Thread (void* pThreadData)
                 if (pComponentPrivate->bDynamicConfigurationInProgress || !pComponentPrivate->bFirstHeader) {
                     continue;
                 }
-                if (FD_ISSET(pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ], &rfds)) {
+                if (status & pComponentPrivate->free_outBuf_Q.nMask) {
                     eError = VIDDEC_HandleFreeOutputBufferFromApp(pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
                         OMX_PRBUFFER4(pComponentPrivate->dbg, "Error while processing free output buffer\n");
@@ -326,9 +304,8 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
     struct timeval tv1;
     sigset_t set;
     struct timespec tv;
-    int fdmax = 0;
+    OMX_U32 nMask = 0;
     OMX_U32 iLock = 0;
-    fd_set rfds;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
     VIDDEC_COMPONENT_PRIVATE* pComponentPrivate = NULL;
 
@@ -336,12 +313,7 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
     OMX_PRINT1(pComponentPrivate->dbg, "+++ENTERING Port #%ld\n", nPortId);
     gettimeofday(&tv1, NULL);
     if ( nPortId == VIDDEC_INPUT_PORT || nPortId == OMX_ALL) {
-        /*Looking for highest number of file descriptor for pipes in order to put in select loop */
-        fdmax = pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ];
-
-        if (pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ] > fdmax) {
-            fdmax = pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ];
-        }
+        nMask = pComponentPrivate->free_inpBuf_Q.nMask | pComponentPrivate->filled_inpBuf_Q.nMask;
 
         /*remove extra parameters*/
         OMX_PRINT1(pComponentPrivate->dbg,
@@ -350,16 +322,12 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
             pComponentPrivate->nCountInputBFromDsp);
         while (pComponentPrivate->nCountInputBFromApp != 0 ||
             pComponentPrivate->nCountInputBFromDsp != 0) {
-            FD_ZERO (&rfds);
-            FD_SET(pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ], &rfds);
-            FD_SET(pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ], &rfds);
-
             tv.tv_sec = 0;
             tv.tv_nsec = 10000;
 
             sigemptyset (&set);
             sigaddset (&set, SIGALRM);
-            status = pselect (fdmax+1, &rfds, NULL, NULL, &tv, &set);
+            status = omx_bufq_wait(&pComponentPrivate->bufQWake, nMask, &tv, &set);
             sigdelset (&set, SIGALRM);
             if (0 == status) {
                 OMX_PRINT2(pComponentPrivate->dbg, "Pselect status 0\n");
@@ -381,7 +349,7 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
                 break;
             }
             else {
-                if (FD_ISSET(pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ], &rfds) && !bReturnOnlyOne) {
+                if ((status & pComponentPrivate->free_inpBuf_Q.nMask) && !bReturnOnlyOne) {
                     eError = VIDDEC_HandleFreeDataBuf (pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
                         OMX_PRBUFFER4(pComponentPrivate->dbg, "Error while handling free input buffer\n");
@@ -393,7 +361,7 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
                     /*in order to keep buffer order*/
                     continue;
                 }
-                if ((FD_ISSET(pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ], &rfds))) {
+                if (status & pComponentPrivate->filled_inpBuf_Q.nMask) {
                     eError = VIDDEC_HandleDataBuf_FromApp (pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
                         OMX_PRBUFFER4(pComponentPrivate->dbg, "Error while handling filled input buffer\n");
@@ -417,12 +385,7 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
     }
 
     if ((nPortId == VIDDEC_OUTPUT_PORT || nPortId == OMX_ALL)) {
-        /*Looking for highest number of file descriptor for pipes in order to put in select loop */
-        fdmax = pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ];
-
-        if (pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ] > fdmax) {
-            fdmax = pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ];
-        }
+        nMask = pComponentPrivate->free_outBuf_Q.nMask | pComponentPrivate->filled_outBuf_Q.nMask;
         
         OMX_PRINT1(pComponentPrivate->dbg,
             "Enter nCOutBFDsp %ld nCOutBFApp %ld\n",
@@ -430,14 +393,11 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
             pComponentPrivate->nCountOutputBFromApp);
         while (pComponentPrivate->nCountOutputBFromApp != 0 ||
             pComponentPrivate->nCountOutputBFromDsp != 0) {
-            FD_ZERO (&rfds);
-            FD_SET(pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ], &rfds);
-            FD_SET(pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ], &rfds);
             tv.tv_sec = 0;
             tv.tv_nsec = 10000;
             sigemptyset (&set);
             sigaddset (&set, SIGALRM);
-            status = pselect (fdmax+1, &rfds, NULL, NULL, &tv, &set);
+            status = omx_bufq_wait(&pComponentPrivate->bufQWake, nMask, &tv, &set);
             sigdelset (&set, SIGALRM);
             if (0 == status) {
                 iLock++;
@@ -458,7 +418,7 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
                 break;
             }
             else {
-                if (FD_ISSET(pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ], &rfds) && !bReturnOnlyOne) {
+                if ((status & pComponentPrivate->filled_outBuf_Q.nMask) && !bReturnOnlyOne) {
                     eError = VIDDEC_HandleDataBuf_FromDsp (pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
                         OMX_PRBUFFER4(pComponentPrivate->dbg, "Error while handling filled DSP output buffer\n");
@@ -470,7 +430,7 @@ void* OMX_VidDec_Return (void* pThreadData, OMX_U32 nPortId, OMX_BOOL bReturnOnl
                     /*in order to keep buffer order*/
                     continue;
                 }
-                if (FD_ISSET(pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ], &rfds)) {
+                if (status & pComponentPrivate->free_outBuf_Q.nMask) {
                     OMX_PRSTATE2(pComponentPrivate->dbg, "eExecuteToIdle 0x%x\n",pComponentPrivate->eExecuteToIdle);
                     eError = VIDDEC_HandleFreeOutputBufferFromApp (pComponentPrivate);
                     if (eError != OMX_ErrorNone) {
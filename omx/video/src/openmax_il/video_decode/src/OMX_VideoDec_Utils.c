@@ -1121,7 +1121,7 @@ EXIT:
 
 /*----------------------------------------------------------------------------*/
 /**
-  * VIDDEC_Start_ComponentThread() starts the component thread and all the pipes
+  * VIDDEC_Start_ComponentThread() starts the component thread and all the queues
   * to achieve communication between dsp and application for commands and buffer
   * interchanging
   **/
@@ -1135,45 +1135,44 @@ OMX_ERRORTYPE VIDDEC_Start_ComponentThread(OMX_HANDLETYPE hComponent)
     pComponentPrivate->bIsStopping =    0;
 
     OMX_PRINT1(pComponentPrivate->dbg, "+++ENTERING\n");
-    /* create the pipe used to maintain free input buffers*/
-    eError = pipe(pComponentPrivate->free_inpBuf_Q);
-    if (eError) {
-        eError = OMX_ErrorInsufficientResources;
+    /* create the wakeup descriptor shared by all the component queues */
+    eError = omx_bufq_wake_init(&pComponentPrivate->bufQWake);
+    if (eError != OMX_ErrorNone) {
         goto EXIT;
     }
 
-    /* create the pipe used to maintain free input buffers*/
-    eError = pipe(pComponentPrivate->free_outBuf_Q);
-    if (eError) {
-        eError = OMX_ErrorInsufficientResources;
+    /* create the queue used to maintain free input buffers*/
+    eError = omx_bufq_init(&pComponentPrivate->free_inpBuf_Q, &pComponentPrivate->bufQWake,
+                           sizeof(OMX_BUFFERHEADERTYPE*), VIDDEC_BUFQ_SIZE);
+    if (eError != OMX_ErrorNone) {
         goto EXIT;
     }
 
-    /* create the pipe used to maintain input buffers*/
-    eError = pipe(pComponentPrivate->filled_inpBuf_Q);
-    if (eError) {
-        eError = OMX_ErrorInsufficientResources;
+    /* create the queue used to maintain free output buffers*/
+    eError = omx_bufq_init(&pComponentPrivate->free_outBuf_Q, &pComponentPrivate->bufQWake,
+                           sizeof(OMX_BUFFERHEADERTYPE*), VIDDEC_BUFQ_SIZE);
+    if (eError != OMX_ErrorNone) {
         goto EXIT;
     }
 
-    /* create the pipe used to maintain dsp output/encoded buffers*/
-    eError = pipe(pComponentPrivate->filled_outBuf_Q);
-    if (eError) {
-        eError = OMX_ErrorInsufficientResources;
+    /* create the queue used to maintain input buffers*/
+    eError = omx_bufq_init(&pComponentPrivate->filled_inpBuf_Q, &pComponentPrivate->bufQWake,
+                           sizeof(OMX_BUFFERHEADERTYPE*), VIDDEC_BUFQ_SIZE);
+    if (eError != OMX_ErrorNone) {
         goto EXIT;
     }
 
-    /* create the pipe used to send commands to the thread */
-    eError = pipe(pComponentPrivate->cmdPipe);
-    if (eError) {
-        eError = OMX_ErrorInsufficientResources;
+    /* create the queue used to maintain dsp output/decoded buffers*/
+    eError = omx_bufq_init(&pComponentPrivate->filled_outBuf_Q, &pComponentPrivate->bufQWake,
+                           sizeof(OMX_BUFFERHEADERTYPE*), VIDDEC_BUFQ_SIZE);
+    if (eError != OMX_ErrorNone) {
         goto EXIT;
     }
 
-    /* create the pipe used to send commands to the thread */
-    eError = pipe(pComponentPrivate->cmdDataPipe);
-    if (eError) {
-        eError = OMX_ErrorInsufficientResources;
+    /* create the queue used to send commands and their data to the thread */
+    eError = omx_bufq_init(&pComponentPrivate->cmdQ, &pComponentPrivate->bufQWake,
+                           sizeof(VIDDEC_CMD_ELEM), VIDDEC_BUFQ_SIZE);
+    if (eError != OMX_ErrorNone) {
         goto EXIT;
     }
 
@@ -1204,7 +1203,7 @@ EXIT:
 /* ========================================================================== */
 /**
 * @Stop_ComponentThread() This function is called by the component during
-* de-init to close component thread, Command pipe & data pipes.
+* de-init to close component thread, command queue & data queues.
 *
 * @param pComponent  handle for this instance of the component
 *
@@ -1221,7 +1220,6 @@ OMX_ERRORTYPE VIDDEC_Stop_ComponentThread(OMX_HANDLETYPE pComponent)
     OMX_COMPONENTTYPE* pHandle = (OMX_COMPONENTTYPE*)pComponent;
     VIDDEC_COMPONENT_PRIVATE* pComponentPrivate = (VIDDEC_COMPONENT_PRIVATE*)pHandle->pComponentPrivate;
     OMX_ERRORTYPE threadError = OMX_ErrorNone;
-    OMX_ERRORTYPE err = OMX_ErrorNone;
     int pthreadError = 0;
 
     /* Join the component thread */
@@ -1240,68 +1238,13 @@ OMX_ERRORTYPE VIDDEC_Stop_ComponentThread(OMX_HANDLETYPE pComponent)
         }
     }
 
-    /* close the data pipe handles */
-    err = close(pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_READ]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing free_inpBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_READ]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing free_outBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_READ]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing filled_inpBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_READ]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing filled_outBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->free_inpBuf_Q[VIDDEC_PIPE_WRITE]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing free_inpBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->free_outBuf_Q[VIDDEC_PIPE_WRITE]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing free_outBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_WRITE]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing filled_inpBuf_Q pipe\n");
-    }
-
-    err = close(pComponentPrivate->filled_outBuf_Q[VIDDEC_PIPE_WRITE]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing filled_outBuf_Q pipe\n");
-    }
-
-    /* Close the command pipe handles */
-    err = close(pComponentPrivate->cmdPipe[VIDDEC_PIPE_READ]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing cmdPipe pipe\n");
-    }
-
-    err = close(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing cmdPipe pipe\n");
-    }
-
-    /* Close the command data pipe handles */
-    err = close (pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_READ]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing cmdDataPipe pipe\n");
-    }
-
-    err = close (pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE]);
-    if (err != 0) {
-        OMX_PRINT1(pComponentPrivate->dbg, "Error while closing cmdDataPipe pipe\n");
-    }
+    /* release the buffer and command queues, then their wakeup descriptor */
+    omx_bufq_deinit(&pComponentPrivate->free_inpBuf_Q);
+    omx_bufq_deinit(&pComponentPrivate->free_outBuf_Q);
+    omx_bufq_deinit(&pComponentPrivate->filled_inpBuf_Q);
+    omx_bufq_deinit(&pComponentPrivate->filled_outBuf_Q);
+    omx_bufq_deinit(&pComponentPrivate->cmdQ);
+    omx_bufq_wake_deinit(&pComponentPrivate->bufQWake);
     OMX_PRINT1(pComponentPrivate->dbg, "---EXITING(0x%x)\n",eError);
     return eError;
 }
@@ -3209,19 +3152,15 @@ OMX_ERRORTYPE VIDDEC_HandleFreeOutputBufferFromApp(VIDDEC_COMPONENT_PRIVATE *pCo
     OMX_ERRORTYPE eError = OMX_ErrorNone;
     OMX_BUFFERHEADERTYPE* pBuffHead;
     OMX_U32 size_out_buf;
-    int ret;
     LCML_DSP_INTERFACE* pLcmlHandle;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
     OMX_PRBUFFER1(pComponentPrivate->dbg, "+++ENTERING\n");
     OMX_PRBUFFER1(pComponentPrivate->dbg, "pComponentPrivate 0x%p\n", pComponentPrivate);
     size_out_buf = (OMX_U32)pComponentPrivate->pOutPortDef->nBufferSize;
     pLcmlHandle = (LCML_DSP_INTERFACE*)(pComponentPrivate->pLCML);
-    ret = read(pComponentPrivate->free_outBuf_Q[0], &pBuffHead, sizeof(pBuffHead));
-
-
-    if (ret == -1) {
-        OMX_PRCOMM4(pComponentPrivate->dbg, "Error while reading from the pipe\n");
-        eError = OMX_ErrorHardware;
+    if (!omx_bufq_pop(&pComponentPrivate->free_outBuf_Q, &pBuffHead)) {
+        /* a flush or port disable may already have drained the queue */
+        OMX_PRCOMM2(pComponentPrivate->dbg, "free_outBuf_Q queue empty\n");
         goto EXIT;
     }
     eError = DecrementCount (&(pComponentPrivate->nCountOutputBFromApp), &(pComponentPrivate->mutexOutputBFromApp));
@@ -3351,6 +3290,27 @@ OMX_U32 GET_NUM_BIT_REQ(OMX_U32 num)
 }
 #endif
 
+#ifdef VIDDEC_ACTIVATEPARSER
+/*  ==========================================================================*/
+/*  func    VIDDEC_FindStartCode                                              */
+/*                                                                            */
+/*  desc    Returns the byte offset of the next 0x000001 start code found     */
+/*          from nInBytePosition, or nTotalInBytes if there is none. Like     */
+/*          the byte loops it replaces, a match has to begin before           */
+/*          nTotalInBytes - 3.                                                */
+/*  ==========================================================================*/
+static OMX_U32 VIDDEC_FindStartCode(OMX_U8* pBuffer, OMX_U32 nTotalInBytes, OMX_U32 nInBytePosition)
+{
+    OMX_U32 nStartCode;
+
+    if (nTotalInBytes <= 3) {
+        return nTotalInBytes;
+    }
+    nStartCode = omx_bits_find_startcode(pBuffer, nTotalInBytes - 1, nInBytePosition);
+    return (nStartCode < nTotalInBytes - 1) ? nStartCode : nTotalInBytes;
+}
+#endif
+
 #ifdef VIDDEC_ACTIVATEPARSER
 /*  ==========================================================================*/
 /*  func    VIDDEC_ParseVideo_MPEG2                                        */
@@ -3371,16 +3331,13 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG2( OMX_U32* nWidth, OMX_U32* nHeight, OMX_BU
     nTotalInBytes = pBuffHead->nFilledLen;
 
     do{
-        for (; (!nStartFlag) && (nInBytePosition < nTotalInBytes - 3); ) {
-           if (VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_FALSE) != 0x000001) {
-                nBitPosition += 8;
-                nInBytePosition++;
-           }
-           else {
-               nStartFlag = OMX_TRUE;
-               nBitPosition += 24;
-               nInBytePosition += 3;
-           }
+        if (!nStartFlag) {
+            nInBytePosition = VIDDEC_FindStartCode(pHeaderStream, nTotalInBytes, nInBytePosition);
+            if (nInBytePosition < nTotalInBytes) {
+                nStartFlag = OMX_TRUE;
+                nInBytePosition += 3;
+                nBitPosition = nInBytePosition * 8;
+            }
         }
         if (!nStartFlag) {
             eError = OMX_ErrorStreamCorrupt;
@@ -3428,16 +3385,13 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_WMV9_VC1( OMX_U32* nWidth, OMX_U32* nHeight, OMX
     nTotalInBytes = pBuffHead->nFilledLen;
 
     do{
-        for (; (!nStartFlag) && (nInBytePosition < nTotalInBytes - 3); ) {
-           if (VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_FALSE) != 0x000001) {
-                nBitPosition += 8;
-                nInBytePosition++;
-           }
-           else {
-               nStartFlag = OMX_TRUE;
-               nBitPosition += 24;
-               nInBytePosition += 3;
-           }
+        if (!nStartFlag) {
+            nInBytePosition = VIDDEC_FindStartCode(pHeaderStream, nTotalInBytes, nInBytePosition);
+            if (nInBytePosition < nTotalInBytes) {
+                nStartFlag = OMX_TRUE;
+                nInBytePosition += 3;
+                nBitPosition = nInBytePosition * 8;
+            }
         }
         if (!nStartFlag) {
             eError = OMX_ErrorStreamCorrupt;
@@ -3522,6 +3476,7 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_U32* nWidth, OMX_U32* nHeight, OMX_BU
     OMX_ERRORTYPE eError = OMX_ErrorUndefined;
     OMX_U32    nSartCode = 0;
     OMX_U32    nBitPosition = 0;
+    OMX_U32    nInBytePosition = 0;
     OMX_BOOL   bHeaderParseCompleted = OMX_FALSE;
     OMX_BOOL   bFillHeaderInfo = OMX_FALSE;
     OMX_U8* pHeaderStream = (OMX_U8*)pBuffHead->pBuffer;
@@ -3599,11 +3554,13 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_MPEG4( OMX_U32* nWidth, OMX_U32* nHeight, OMX_BU
         }
         else if (nSartCode == 0x1B2) /*user data*/
         {
-            OMX_PARSER_CHECKLIMIT(nTotalInBytes, nBitPosition, 24);
-            while (VIDDEC_GetBits(&nBitPosition, 24, pHeaderStream, OMX_TRUE)!= 0x1)
-                nBitPosition-=16;        /*discard only 8 bits and try againg until*/
-                                        /*the next start code is found*/
-            nBitPosition -=24;            /* prepare to read the entire start code*/
+            /* skip to the next start code, the loop reads it in full */
+            nInBytePosition = VIDDEC_FindStartCode(pHeaderStream, pBuffHead->nFilledLen, nBitPosition / 8);
+            if (nInBytePosition >= pBuffHead->nFilledLen) {
+                eError = OMX_ErrorStreamCorrupt;
+                goto EXIT;
+            }
+            nBitPosition = nInBytePosition * 8;
         }
         else if ((nSartCode >= 0x120)&&(nSartCode <= 0x12F))
         {
@@ -3915,25 +3872,23 @@ EXIT:
 /*  func    VIDDEC_ScanConfigBufferAVC                                            */
 /*                                                                            */
 /*  desc    Use to scan buffer for certain patter. Used to know if ConfigBuffers are together                             */
+/*          The buffer is scanned a word at a time with omx_bits_find_prefix                                          */
 /*  ==========================================================================*/
 static OMX_U32 VIDDEC_ScanConfigBufferAVC(OMX_BUFFERHEADERTYPE* pBuffHead,  OMX_U32 pattern){
-    OMX_U32 nBitPosition = 0;
     OMX_U32 nInBytePosition = 0;
     OMX_U32 nPatternCounter = 0;
     OMX_U32 nTotalInBytes = pBuffHead->nFilledLen;
     OMX_U8* nBitStream = (OMX_U8*)pBuffHead->pBuffer;
-    
-    while (nInBytePosition < nTotalInBytes - 3){
-         if (VIDDEC_GetBits(&nBitPosition, 24, nBitStream, OMX_FALSE) != pattern) {
-              nBitPosition += 8;
-              nInBytePosition++;
-         }
-         else {
-             /*Pattern found; add count*/
-             nPatternCounter++;
-             nBitPosition += 24;
-             nInBytePosition += 3;
-         }
+
+    /* pattern is a 0x0000XX prefix, XX is matched against the third byte */
+    if (nTotalInBytes <= 3) {
+        return 0;
+    }
+    nInBytePosition = omx_bits_find_prefix(nBitStream, nTotalInBytes - 1, nInBytePosition, (OMX_U8)pattern);
+    while (nInBytePosition < nTotalInBytes - 1) {
+         /*Pattern found; add count*/
+         nPatternCounter++;
+         nInBytePosition = omx_bits_find_prefix(nBitStream, nTotalInBytes - 1, nInBytePosition + 3, (OMX_U8)pattern);
     }
     return nPatternCounter;
 }
@@ -3951,9 +3906,10 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
     OMX_ERRORTYPE eError = OMX_ErrorBadParameter;
     OMX_U32 i = 0;
     VIDDEC_AVC_ParserParam* sParserParam = NULL;
-    OMX_BOOL nStartFlag = OMX_FALSE;
     OMX_U32 nBitPosition = 0;
-    OMX_U32 nRbspPosition = 0;
+    OMX_TI_BITREADER sRbsp;
+    OMX_U32 nNalEnd = 0;
+    OMX_U32 nEmulationPosition = 0;
     OMX_U32 nTotalInBytes = 0;
     OMX_U32 nInBytePosition = 0;
     OMX_U32 nInPositionTemp = 0;
@@ -4077,47 +4033,21 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
          /* End of Handle fragmentation Config Buffer Code*/
 
         do{
-            for (; (!nStartFlag) && (nInBytePosition < nTotalInBytes - 3); )
-            {
-               if (VIDDEC_GetBits(&nBitPosition, 24, nBitStream, OMX_FALSE) != 0x000001)
-               {
-                    nBitPosition += 8;
-                    nInBytePosition++;
-               }
-               else
-               {
-                   /*Start Code found*/
-                   nStartFlag = OMX_TRUE;
-                   nBitPosition += 24;
-                   nInBytePosition += 3;
-               }
+            nInBytePosition = VIDDEC_FindStartCode(nBitStream, nTotalInBytes, nInBytePosition);
+            if (nInBytePosition < nTotalInBytes) {
+                /*Start Code found*/
+                nInBytePosition += 3;
             }
-            nStartFlag = OMX_FALSE;
+            nBitPosition = nInBytePosition * 8;
             /* offset to NumBytesInNALunit*/
-            nNumBytesInNALunit = nInBytePosition;
-            sParserParam->nBitPosTemp = nBitPosition;
-              for (;(!nStartFlag)&&(nNumBytesInNALunit < nTotalInBytes-3); )
-            {
-                if (VIDDEC_GetBits(&sParserParam->nBitPosTemp, 24, nBitStream, OMX_FALSE) != 0x000001)
-                /*find start code*/
-                {
-                    sParserParam->nBitPosTemp += 8;
-                    nNumBytesInNALunit++;
-                }
-                else
-                {
-                   /*Start Code found*/
-                    nStartFlag = OMX_TRUE;
-                    sParserParam->nBitPosTemp += 24;
-                    nNumBytesInNALunit += 3;
-                }
-            }
-
-            if (!nStartFlag)
+            nNumBytesInNALunit = VIDDEC_FindStartCode(nBitStream, nTotalInBytes, nInBytePosition);
+            if (nNumBytesInNALunit >= nTotalInBytes)
             {
                 eError = OMX_ErrorStreamCorrupt;
                 goto EXIT;
             }
+            nNumBytesInNALunit += 3;
+            sParserParam->nBitPosTemp = nNumBytesInNALunit * 8;
             /* forbidden_zero_bit */
             sParserParam->nForbiddenZeroBit = VIDDEC_GetBits(&nBitPosition, 1, nBitStream, OMX_TRUE);
             /* nal_ref_idc */
@@ -4130,7 +4060,6 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
             if (nNalUnitType != 7)
             {
                 OMX_PRINT2(pComponentPrivate->dbg, "nal_unit_type does not specify parameter information need to look for next startcode\n");
-                nStartFlag = OMX_FALSE;
             }
         }while (nNalUnitType != 7);
     }
@@ -4196,92 +4125,90 @@ OMX_ERRORTYPE VIDDEC_ParseVideo_H264(VIDDEC_COMPONENT_PRIVATE* pComponentPrivate
         nNumBytesInNALunit += nInBytePosition;/*sum to keep the code flow*/
                                 /*the buffer must had enough space to enter this number*/
     }
-    for (i=0; nInBytePosition < (nNumBytesInNALunit - 3); )
+    /* copy the NAL unit to the RBSP buffer, dropping every emulation
+       prevention byte of a 0x000003 sequence */
+    nNalEnd = nNumBytesInNALunit - 3;
+    i = 0;
+    while (nInBytePosition < nNalEnd)
     {
-
-        if (((nInBytePosition + 2) < (nNumBytesInNALunit - 3)) &&
-            (VIDDEC_GetBits(&nBitPosition, 24, nBitStream, OMX_FALSE) == 0x000003))
+        nEmulationPosition = omx_bits_find_prefix(nBitStream, nNalEnd, nInBytePosition, 0x03);
+        memcpy(nRbspByte + i, nBitStream + nInBytePosition, nEmulationPosition - nInBytePosition);
+        i += nEmulationPosition - nInBytePosition;
+        nNumOfBytesInRbsp += nEmulationPosition - nInBytePosition;
+        nInBytePosition = nEmulationPosition;
+        if (nEmulationPosition < nNalEnd)
         {
             OMX_PRINT2(pComponentPrivate->dbg, "discard emulation prev byte\n");
-            nRbspByte[i++] = nBitStream[nInBytePosition++];
-            nRbspByte[i++] = nBitStream[nInBytePosition++];
+            nRbspByte[i++] = 0;
+            nRbspByte[i++] = 0;
             nNumOfBytesInRbsp += 2;
             /* discard emulation prev byte */
-            nInBytePosition++;
-            nBitPosition += 24;
-        }
-        else
-        {
-            nRbspByte[i++] = nBitStream[nInBytePosition++];
-            nNumOfBytesInRbsp++;
-            nBitPosition += 8;
-        }
-        if (nInBytePosition >= (nNumBytesInNALunit - 3)) {
-            break;
+            nInBytePosition += 3;
         }
     }
 
 
     /*Parse RBSP sequence*/
     /*///////////////////*/
+    omx_bits_init(&sRbsp, nRbspByte, nNumOfBytesInRbsp, 0);
     /*  profile_idc u(8) */
-    sParserParam->nProfileIdc = VIDDEC_GetBits(&nRbspPosition, 8, nRbspByte, OMX_TRUE);
+    sParserParam->nProfileIdc = omx_bits_read(&sRbsp, 8);
     /* constraint_set0_flag u(1)*/
-    sParserParam->nConstraintSet0Flag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nConstraintSet0Flag = omx_bits_read(&sRbsp, 1);
     /* constraint_set1_flag u(1)*/
-    sParserParam->nConstraintSet1Flag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nConstraintSet1Flag = omx_bits_read(&sRbsp, 1);
     /* constraint_set2_flag u(1)*/
-    sParserParam->nConstraintSet2Flag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nConstraintSet2Flag = omx_bits_read(&sRbsp, 1);
     /* reserved_zero_5bits u(5)*/
-    sParserParam->nReservedZero5bits = VIDDEC_GetBits(&nRbspPosition, 5, nRbspByte, OMX_TRUE);
+    sParserParam->nReservedZero5bits = omx_bits_read(&sRbsp, 5);
     /* level_idc*/
-    sParserParam->nLevelIdc = VIDDEC_GetBits(&nRbspPosition, 8, nRbspByte, OMX_TRUE);
-    sParserParam->nSeqParameterSetId = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-    sParserParam->nLog2MaxFrameNumMinus4 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-    sParserParam->nPicOrderCntType = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+    sParserParam->nLevelIdc = omx_bits_read(&sRbsp, 8);
+    sParserParam->nSeqParameterSetId = omx_bits_ue(&sRbsp);
+    sParserParam->nLog2MaxFrameNumMinus4 = omx_bits_ue(&sRbsp);
+    sParserParam->nPicOrderCntType = omx_bits_ue(&sRbsp);
 
     if ( sParserParam->nPicOrderCntType == 0 )
     {
-        sParserParam->nLog2MaxPicOrderCntLsbMinus4 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        sParserParam->nLog2MaxPicOrderCntLsbMinus4 = omx_bits_ue(&sRbsp);
     }
     else if( sParserParam->nPicOrderCntType == 1 )
     {
         /* delta_pic_order_always_zero_flag*/
-        VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
-        sParserParam->nOffsetForNonRefPic = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        omx_bits_read(&sRbsp, 1);
+        sParserParam->nOffsetForNonRefPic = omx_bits_ue(&sRbsp);
         if (sParserParam->nOffsetForNonRefPic > 1)
               sParserParam->nOffsetForNonRefPic = sParserParam->nOffsetForNonRefPic & 0x1 ?
                                                 sParserParam->nOffsetForNonRefPic >> 1 :
                                               -(sParserParam->nOffsetForNonRefPic >> 1);
-        sParserParam->nOffsetForTopToBottomField = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nNumRefFramesInPicOrderCntCycle = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        sParserParam->nOffsetForTopToBottomField = omx_bits_ue(&sRbsp);
+        sParserParam->nNumRefFramesInPicOrderCntCycle = omx_bits_ue(&sRbsp);
         for(i = 0; i < sParserParam->nNumRefFramesInPicOrderCntCycle; i++ )
-            VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte); /*offset_for_ref_frame[i]*/
+            omx_bits_ue(&sRbsp); /*offset_for_ref_frame[i]*/
     }
 
-    sParserParam->nNumRefFrames = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-    sParserParam->nGapsInFrameNumValueAllowedFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
-    sParserParam->nPicWidthInMbsMinus1 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+    sParserParam->nNumRefFrames = omx_bits_ue(&sRbsp);
+    sParserParam->nGapsInFrameNumValueAllowedFlag = omx_bits_read(&sRbsp, 1);
+    sParserParam->nPicWidthInMbsMinus1 = omx_bits_ue(&sRbsp);
     (*nWidth) = (sParserParam->nPicWidthInMbsMinus1 + 1) * 16;
-    sParserParam->nPicHeightInMapUnitsMinus1 = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+    sParserParam->nPicHeightInMapUnitsMinus1 = omx_bits_ue(&sRbsp);
     (*nHeight) = (sParserParam->nPicHeightInMapUnitsMinus1 + 1) * 16;
     /* Checking for cropping in picture saze */
     /* getting frame_mbs_only_flag */
-    sParserParam->nFrameMbsOnlyFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nFrameMbsOnlyFlag = omx_bits_read(&sRbsp, 1);
     if (!sParserParam->nFrameMbsOnlyFlag)
     {
-        sParserParam->nMBAdaptiveFrameFieldFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+        sParserParam->nMBAdaptiveFrameFieldFlag = omx_bits_read(&sRbsp, 1);
     }
     /*getting direct_8x8_inference_flag and frame_cropping_flag*/
-    sParserParam->nDirect8x8InferenceFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
-    sParserParam->nFrameCroppingFlag = VIDDEC_GetBits(&nRbspPosition, 1, nRbspByte, OMX_TRUE);
+    sParserParam->nDirect8x8InferenceFlag = omx_bits_read(&sRbsp, 1);
+    sParserParam->nFrameCroppingFlag = omx_bits_read(&sRbsp, 1);
     /*getting the crop values if exist*/
     if (sParserParam->nFrameCroppingFlag)
     {
-        sParserParam->nFrameCropLeftOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nFrameCropRightOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nFrameCropTopOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
-        sParserParam->nFrameCropBottomOffset = VIDDEC_UVLC_dec(&nRbspPosition, nRbspByte);
+        sParserParam->nFrameCropLeftOffset = omx_bits_ue(&sRbsp);
+        sParserParam->nFrameCropRightOffset = omx_bits_ue(&sRbsp);
+        sParserParam->nFrameCropTopOffset = omx_bits_ue(&sRbsp);
+        sParserParam->nFrameCropBottomOffset = omx_bits_ue(&sRbsp);
         /* Update framesize taking into account the cropping values */
         (*nCropWidth) = (2 * sParserParam->nFrameCropLeftOffset + 2 * sParserParam->nFrameCropRightOffset);
         (*nCropHeight) = (2 * sParserParam->nFrameCropTopOffset + 2 * sParserParam->nFrameCropBottomOffset);
@@ -4308,77 +4235,7 @@ EXIT:
 /*  =========================================================================*/
 OMX_U32 VIDDEC_GetBits(OMX_U32* nPosition, OMX_U8 nBits, OMX_U8* pBuffer, OMX_BOOL bIcreasePosition)
 {
-    OMX_U32 nOutput;
-    OMX_U32 nNumBitsRead = 0;
-    OMX_U32 nBytePosition = 0;
-    OMX_U8  nBitPosition =  0;
-    nBytePosition = *nPosition / 8;
-    nBitPosition =  *nPosition % 8;
-
-    if (bIcreasePosition)
-        *nPosition += nBits;
-    nOutput = ((OMX_U32)pBuffer[nBytePosition] << (24+nBitPosition) );
-    nNumBitsRead = nNumBitsRead + (8 - nBitPosition);
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 1] << (16+nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 2] << (8+nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    if (nNumBitsRead < nBits)
-    {
-        nOutput = nOutput | ( pBuffer[nBytePosition + 3] << (nBitPosition));
-        nNumBitsRead = nNumBitsRead + 8;
-    }
-    nOutput = nOutput >> (32 - nBits) ;
-    return nOutput;
-}
-
-
-OMX_S32 VIDDEC_UVLC_dec(OMX_U32 *nPosition, OMX_U8* pBuffer)
-{
-
-    OMX_U32 nBytePosition = (*nPosition) / 8;
-    OMX_U8 cBitPosition =  (*nPosition) % 8;
-    OMX_U32 nLen = 1;
-    OMX_U32 nCtrBit = 0;
-    OMX_U32 nVal = 1;
-    OMX_U32 nInfoBit=0;
-
-    nCtrBit = pBuffer[nBytePosition] & (0x1 << (7-cBitPosition));
-    while (nCtrBit==0)
-    {
-        nLen++;
-        cBitPosition++;
-        (*nPosition)++;
-        if (!(cBitPosition%8))
-        {
-            cBitPosition=0;
-            nBytePosition++;
-        }
-        nCtrBit = pBuffer[nBytePosition] & (0x1<<(7-cBitPosition));
-    }
-    for(nInfoBit=0; (nInfoBit<(nLen-1)); nInfoBit++)
-    {
-        cBitPosition++;
-        (*nPosition)++;
-
-        if (!(cBitPosition%8))
-        {
-            cBitPosition=0;
-            nBytePosition++;
-        }
-        nVal=(nVal << 1);
-        if(pBuffer[nBytePosition] & (0x01 << (7 - cBitPosition)))
-            nVal |= 1;
-    }
-    (*nPosition)++;
-    nVal -= 1;
-    return nVal;
+    return omx_bits_get(nPosition, nBits, pBuffer, bIcreasePosition);
 }
 #endif
 
@@ -4693,7 +4550,6 @@ OMX_ERRORTYPE VIDDEC_HandleDataBuf_FromApp(VIDDEC_COMPONENT_PRIVATE *pComponentP
     OMX_BUFFERHEADERTYPE* pBuffHead = NULL;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
     OMX_U32 inpBufSize;
-    int ret = 0;
     OMX_U32 size_dsp;
     OMX_U8* pCSD = NULL;
     OMX_U8* pData = NULL;
@@ -4709,10 +4565,9 @@ OMX_ERRORTYPE VIDDEC_HandleDataBuf_FromApp(VIDDEC_COMPONENT_PRIVATE *pComponentP
     OMX_PRBUFFER1(pComponentPrivate->dbg, "pComponentPrivate 0x%p iEndofInputSent 0x%x\n", pComponentPrivate, pComponentPrivate->iEndofInputSent);
     inpBufSize = pComponentPrivate->pInPortDef->nBufferSize;
     pLcmlHandle = (LCML_DSP_INTERFACE*)pComponentPrivate->pLCML;
-    ret = read(pComponentPrivate->filled_inpBuf_Q[0], &(pBuffHead), sizeof(pBuffHead));
-    if (ret == -1) {
-        OMX_PRCOMM4(pComponentPrivate->dbg, "Error while reading from the pipe\n");
-        eError = OMX_ErrorHardware;
+    if (!omx_bufq_pop(&pComponentPrivate->filled_inpBuf_Q, &pBuffHead)) {
+        /* a flush or port disable may already have drained the queue */
+        OMX_PRCOMM2(pComponentPrivate->dbg, "filled_inpBuf_Q queue empty\n");
         goto EXIT;
     }
     eError = DecrementCount (&(pComponentPrivate->nCountInputBFromApp), &(pComponentPrivate->mutexInputBFromApp));
@@ -5414,9 +5269,8 @@ OMX_ERRORTYPE VIDDEC_HandleDataBuf_FromApp(VIDDEC_COMPONENT_PRIVATE *pComponentP
             if (eError != OMX_ErrorNone) {
                 return eError;
             }
-            ret = write(pComponentPrivate->free_inpBuf_Q[1], &pBuffHead, sizeof(pBuffHead));
-            if(ret == -1){
-                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input pipe %x (%d)\n", OMX_ErrorInsufficientResources,ret);
+            if (omx_bufq_push(&pComponentPrivate->free_inpBuf_Q, &pBuffHead) != OMX_ErrorNone) {
+                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input queue %x\n", OMX_ErrorInsufficientResources);
                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
                 pComponentPrivate->cbInfo.EventHandler(pComponentPrivate->pHandle,
                                                        pComponentPrivate->pHandle->pApplicationPrivate,
@@ -5863,9 +5717,8 @@ OMX_ERRORTYPE VIDDEC_HandleDataBuf_FromApp(VIDDEC_COMPONENT_PRIVATE *pComponentP
             if (eError != OMX_ErrorNone) {
                 return eError;
             }
-            ret = write(pComponentPrivate->free_inpBuf_Q[1], &pBuffHead, sizeof(pBuffHead));
-            if(ret == -1){
-                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input pipe %x (%d)\n", OMX_ErrorInsufficientResources,ret);
+            if (omx_bufq_push(&pComponentPrivate->free_inpBuf_Q, &pBuffHead) != OMX_ErrorNone) {
+                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input queue %x\n", OMX_ErrorInsufficientResources);
                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
                 pComponentPrivate->cbInfo.EventHandler(pComponentPrivate->pHandle,
                                                        pComponentPrivate->pHandle->pApplicationPrivate,
@@ -5895,14 +5748,12 @@ OMX_ERRORTYPE VIDDEC_HandleDataBuf_FromDsp(VIDDEC_COMPONENT_PRIVATE *pComponentP
     OMX_BUFFERHEADERTYPE* pBuffHead;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
     OMX_U32 nBytesConsumed = 0;
-    int ret;
 
     OMX_PRBUFFER1(pComponentPrivate->dbg, "+++ENTERING\n");
     OMX_PRBUFFER1(pComponentPrivate->dbg, "pComponentPrivate 0x%p\n", (int*)pComponentPrivate);
-    ret = read(pComponentPrivate->filled_outBuf_Q[0], &pBuffHead, sizeof(pBuffHead));
-    if (ret == -1) {
-        OMX_PRDSP4(pComponentPrivate->dbg, "Error while reading from dsp out pipe\n");
-        eError = OMX_ErrorHardware;
+    if (!omx_bufq_pop(&pComponentPrivate->filled_outBuf_Q, &pBuffHead)) {
+        /* a flush or port disable may already have drained the queue */
+        OMX_PRDSP2(pComponentPrivate->dbg, "filled_outBuf_Q queue empty\n");
         goto EXIT;
     }
     eError = DecrementCount (&(pComponentPrivate->nCountOutputBFromDsp), &(pComponentPrivate->mutexOutputBFromDSP));
@@ -6189,9 +6040,8 @@ OMX_ERRORTYPE VIDDEC_HandleDataBuf_FromDsp(VIDDEC_COMPONENT_PRIVATE *pComponentP
                     eError = OMX_EmptyThisBuffer(pComponentPrivate->pCompPort[1]->hTunnelComponent, pBuffHead);
                 }
                 else {
-                    ret = write(pComponentPrivate->free_outBuf_Q[1],&pBuffHead,sizeof(pBuffHead));
-                    if (ret == -1) {
-                        OMX_PRDSP4(pComponentPrivate->dbg, "Error while writing to out pipe to client\n");
+                    if (omx_bufq_push(&pComponentPrivate->free_outBuf_Q, &pBuffHead) != OMX_ErrorNone) {
+                        OMX_PRDSP4(pComponentPrivate->dbg, "Error while writing to out queue to client\n");
                         eError = OMX_ErrorHardware;
                         return eError;
                     }
@@ -6234,15 +6084,13 @@ OMX_ERRORTYPE VIDDEC_HandleFreeDataBuf( VIDDEC_COMPONENT_PRIVATE *pComponentPriv
     OMX_ERRORTYPE eError = OMX_ErrorNone;
     OMX_BUFFERHEADERTYPE* pBuffHead;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
-    int ret;
     /*int inputbufsize = (int)pComponentPrivate->pInPortDef->nBufferSize;*/
 
     OMX_PRBUFFER1(pComponentPrivate->dbg, "+++ENTERING\n");
     OMX_PRBUFFER1(pComponentPrivate->dbg, "pComponentPrivate 0x%p\n", (int*)pComponentPrivate);
-    ret = read(pComponentPrivate->free_inpBuf_Q[0], &pBuffHead, sizeof(pBuffHead));
-    if (ret == -1) {
-        OMX_PRCOMM4(pComponentPrivate->dbg, "Error while reading from the free Q\n");
-        eError = OMX_ErrorHardware;
+    if (!omx_bufq_pop(&pComponentPrivate->free_inpBuf_Q, &pBuffHead)) {
+        /* a flush or port disable may already have drained the queue */
+        OMX_PRCOMM2(pComponentPrivate->dbg, "free_inpBuf_Q queue empty\n");
         goto EXIT;
     }
     eError = DecrementCount (&(pComponentPrivate->nCountInputBFromDsp), &(pComponentPrivate->mutexInputBFromDSP));
@@ -7348,7 +7196,6 @@ OMX_ERRORTYPE VIDDEC_LCML_Callback (TUsnCodecEvent event,void * argsCb [10])
     VIDDEC_COMPONENT_PRIVATE* pComponentPrivate = NULL;
     OMX_ERRORTYPE eError = OMX_ErrorNone;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
-    OMX_S32 nRetVal = 0;
 
     pComponentPrivate = (VIDDEC_COMPONENT_PRIVATE*)((LCML_DSP_INTERFACE*)argsCb[6])->pComponentPrivate;
 
@@ -7485,11 +7332,10 @@ OMX_ERRORTYPE VIDDEC_LCML_Callback (TUsnCodecEvent event,void * argsCb [10])
                                 pBuffHead->nFilledLen = 0;
                                 pBuffHead->nTimeStamp = 0;
                             }
-                            nRetVal = write(pComponentPrivate->filled_outBuf_Q[1],&pBuffHead,sizeof(pBuffHead));
-                            if(nRetVal == -1){
+                            if (omx_bufq_push(&pComponentPrivate->filled_outBuf_Q, &pBuffHead) != OMX_ErrorNone) {
                                 DecrementCount (&(pComponentPrivate->nCountOutputBFromDsp), &(pComponentPrivate->mutexOutputBFromDSP));
                                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
-                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input pipe %x (%ld)\n", OMX_ErrorInsufficientResources,nRetVal);
+                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the output queue %x\n", OMX_ErrorInsufficientResources);
                                 pComponentPrivate->cbInfo.EventHandler(pComponentPrivate->pHandle,
                                                                        pComponentPrivate->pHandle->pApplicationPrivate,
                                                                        OMX_EventError,
@@ -7552,9 +7398,8 @@ OMX_ERRORTYPE VIDDEC_LCML_Callback (TUsnCodecEvent event,void * argsCb [10])
                                 pBuffHead->nOffset = VIDDEC_WMV_BUFFER_OFFSET;
 #endif
                             }
-                            nRetVal = write(pComponentPrivate->free_inpBuf_Q[1], &pBuffHead, sizeof(pBuffHead));
-                            if(nRetVal == -1){
-                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input pipe %x (%lu)\n", OMX_ErrorInsufficientResources,nRetVal);
+                            if (omx_bufq_push(&pComponentPrivate->free_inpBuf_Q, &pBuffHead) != OMX_ErrorNone) {
+                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input queue %x\n", OMX_ErrorInsufficientResources);
                                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
                                 DecrementCount (&(pComponentPrivate->nCountInputBFromDsp), &(pComponentPrivate->mutexInputBFromDSP));
                                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
@@ -7625,11 +7470,10 @@ OMX_ERRORTYPE VIDDEC_LCML_Callback (TUsnCodecEvent event,void * argsCb [10])
                                 pBuffHead->nFilledLen = 0;
                                 pBuffHead->nTimeStamp = 0;
                             }
-                            nRetVal = write(pComponentPrivate->filled_outBuf_Q[1],&pBuffHead,sizeof(pBuffHead));
-                            if(nRetVal == -1){
+                            if (omx_bufq_push(&pComponentPrivate->filled_outBuf_Q, &pBuffHead) != OMX_ErrorNone) {
                                 DecrementCount (&(pComponentPrivate->nCountOutputBFromDsp), &(pComponentPrivate->mutexOutputBFromDSP));
                                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
-                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input pipe %x (%ld)\n", OMX_ErrorInsufficientResources,nRetVal);
+                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the output queue %x\n", OMX_ErrorInsufficientResources);
                                 pComponentPrivate->cbInfo.EventHandler(pComponentPrivate->pHandle,
                                                                        pComponentPrivate->pHandle->pApplicationPrivate,
                                                                        OMX_EventError,
@@ -7691,9 +7535,8 @@ OMX_ERRORTYPE VIDDEC_LCML_Callback (TUsnCodecEvent event,void * argsCb [10])
                                 pBuffHead->nOffset = VIDDEC_WMV_BUFFER_OFFSET;
 #endif
                             }
-                            nRetVal = write(pComponentPrivate->free_inpBuf_Q[1], &pBuffHead, sizeof(pBuffHead));
-                            if(nRetVal == -1){
-                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input pipe %x (%lu)\n", OMX_ErrorInsufficientResources,nRetVal);
+                            if (omx_bufq_push(&pComponentPrivate->free_inpBuf_Q, &pBuffHead) != OMX_ErrorNone) {
+                                OMX_PRCOMM4(pComponentPrivate->dbg, "writing to the input queue %x\n", OMX_ErrorInsufficientResources);
                                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
                                 DecrementCount (&(pComponentPrivate->nCountInputBFromDsp), &(pComponentPrivate->mutexInputBFromDSP));
                                 pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_DSP;
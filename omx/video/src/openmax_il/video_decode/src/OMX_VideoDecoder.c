@@ -679,7 +679,7 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
                                          OMX_PTR pCmdData)
 {
     OMX_ERRORTYPE eError = OMX_ErrorNone;
-    OMX_S32 nRet;
+    VIDDEC_CMD_ELEM sCmd;
     OMX_COMPONENTTYPE* pHandle = NULL;
     VIDDEC_COMPONENT_PRIVATE* pComponentPrivate = NULL;
     OMX_CONF_CHECK_CMD(hComponent, OMX_TRUE, OMX_TRUE);
@@ -698,6 +698,10 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
                         PERF_ModuleComponent);
 #endif
 
+    sCmd.eCmd = Cmd;
+    sCmd.nParam1 = nParam1;
+    sCmd.pCmdData = pCmdData;
+
     switch (Cmd) {
         case OMX_CommandStateSet:
             /* Add a pending transition */
@@ -706,15 +710,7 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
             }
             pComponentPrivate->eIdleToLoad = nParam1;
             pComponentPrivate->eExecuteToIdle = nParam1;
-            nRet = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
-            if (nRet == -1) {
-                if(RemoveStateTransition(pComponentPrivate, OMX_FALSE) != OMX_ErrorNone) {
-                   return OMX_ErrorUndefined;
-                }
-                return OMX_ErrorUndefined;
-            }
-            nRet = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &nParam1, sizeof(nParam1));
-            if (nRet == -1) {
+            if (omx_bufq_push(&pComponentPrivate->cmdQ, &sCmd) != OMX_ErrorNone) {
                 if(RemoveStateTransition(pComponentPrivate, OMX_FALSE) != OMX_ErrorNone) {
                    return OMX_ErrorUndefined;
                 }
@@ -759,13 +755,7 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
                 eError = OMX_ErrorBadParameter;
                 goto EXIT;
             }
-            nRet = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
-            if (nRet == -1) {
-                eError = OMX_ErrorUndefined;
-                goto EXIT;
-            }
-            nRet = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &nParam1, sizeof(nParam1));
-            if (nRet == -1) {
+            if (omx_bufq_push(&pComponentPrivate->cmdQ, &sCmd) != OMX_ErrorNone) {
                 eError = OMX_ErrorUndefined;
                 goto EXIT;
             }
@@ -803,13 +793,7 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
                     goto EXIT;
                 }
             }
-            nRet = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
-            if (nRet == -1) {
-                eError = OMX_ErrorUndefined;
-                goto EXIT;
-            }
-            nRet = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &nParam1, sizeof(nParam1));
-            if (nRet == -1) {
+            if (omx_bufq_push(&pComponentPrivate->cmdQ, &sCmd) != OMX_ErrorNone) {
                 eError = OMX_ErrorUndefined;
                 goto EXIT;
             }
@@ -819,13 +803,7 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
                 eError = OMX_ErrorBadPortIndex;
                 goto EXIT;
             }
-            nRet = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
-            if (nRet == -1) {
-                eError = OMX_ErrorUndefined;
-                goto EXIT;
-            }
-            nRet = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &nParam1, sizeof(nParam1));
-            if (nRet == -1) {
+            if (omx_bufq_push(&pComponentPrivate->cmdQ, &sCmd) != OMX_ErrorNone) {
                 eError = OMX_ErrorUndefined;
                 goto EXIT;
             }
@@ -835,18 +813,7 @@ static OMX_ERRORTYPE VIDDEC_SendCommand (OMX_HANDLETYPE hComponent,
                 eError = OMX_ErrorBadPortIndex;
                 goto EXIT;
             }
-            nRet = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
-            if (nRet == -1) {
-                eError = OMX_ErrorUndefined;
-                goto EXIT;
-            }
-            nRet = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &nParam1, sizeof(nParam1));
-            if (nRet == -1) {
-                eError = OMX_ErrorUndefined;
-                goto EXIT;
-            }
-            nRet = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &pCmdData, sizeof(pCmdData));
-            if (nRet == -1) {
+            if (omx_bufq_push(&pComponentPrivate->cmdQ, &sCmd) != OMX_ErrorNone) {
                 eError = OMX_ErrorUndefined;
                 goto EXIT;
             }
@@ -2252,7 +2219,6 @@ static OMX_ERRORTYPE VIDDEC_EmptyThisBuffer (OMX_HANDLETYPE pComponent,
     OMX_COMPONENTTYPE *pHandle = NULL;
     VIDDEC_COMPONENT_PRIVATE *pComponentPrivate = NULL;
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
-    ssize_t bytesWritten = 0;
     VIDDEC_BUFFER_OWNER oldBufferOwner;
 
     OMX_CONF_CHECK_CMD(pComponent, pBuffHead, OMX_TRUE);
@@ -2308,11 +2274,10 @@ static OMX_ERRORTYPE VIDDEC_EmptyThisBuffer (OMX_HANDLETYPE pComponent,
     OMX_PRBUFFER1(pComponentPrivate->dbg, "Writing pBuffer 0x%p OldeBufferOwner %d nAllocLen %lu nFilledLen %lu eBufferOwner %d\n",
         pBuffHead, oldBufferOwner,pBuffHead->nAllocLen,pBuffHead->nFilledLen,pBufferPrivate->eBufferOwner);
 
-    bytesWritten = write (pComponentPrivate->filled_inpBuf_Q[VIDDEC_PIPE_WRITE], &(pBuffHead), sizeof(pBuffHead));
-    if (bytesWritten == -1) {
+    if (omx_bufq_push(&pComponentPrivate->filled_inpBuf_Q, &pBuffHead) != OMX_ErrorNone) {
         /*like function returns error buffer still with Client IL*/
         pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_CLIENT;
-        OMX_PRCOMM4(pComponentPrivate->dbg, "Error in Writing to the Data pipe\n");
+        OMX_PRCOMM4(pComponentPrivate->dbg, "Error in Writing to the Data queue\n");
         DecrementCount (&(pComponentPrivate->nCountInputBFromApp), &(pComponentPrivate->mutexInputBFromApp));
         eError = OMX_ErrorHardware;
         goto EXIT;
@@ -2349,7 +2314,6 @@ static OMX_ERRORTYPE VIDDEC_FillThisBuffer (OMX_HANDLETYPE pComponent,
     VIDDEC_BUFFER_PRIVATE* pBufferPrivate = NULL;
 	IMG_native_handle_t*  grallocHandle;
 	OMX_PARAM_PORTDEFINITIONTYPE sPortDef;
-    ssize_t bytesWritten = 0;
     VIDDEC_BUFFER_OWNER oldBufferOwner;
     OMX_CONF_CHECK_CMD(pComponent, pBuffHead, OMX_TRUE);
 
@@ -2428,11 +2392,10 @@ static OMX_ERRORTYPE VIDDEC_FillThisBuffer (OMX_HANDLETYPE pComponent,
     pBuffHead->nFlags = 0;
     OMX_PRBUFFER1(pComponentPrivate->dbg, "Writing pBuffer 0x%p OldeBufferOwner %d eBufferOwner %d nFilledLen %lu\n",
         pBuffHead, oldBufferOwner,pBufferPrivate->eBufferOwner,pBuffHead->nFilledLen);
-    bytesWritten = write (pComponentPrivate->free_outBuf_Q[1], &(pBuffHead), sizeof (pBuffHead));
-    if (bytesWritten == -1) {
+    if (omx_bufq_push(&pComponentPrivate->free_outBuf_Q, &pBuffHead) != OMX_ErrorNone) {
         /*like function returns error buffer still with Client IL*/
         pBufferPrivate->eBufferOwner = VIDDEC_BUFFER_WITH_CLIENT;
-        OMX_PRCOMM4(pComponentPrivate->dbg, "Error in Writing to the Data pipe\n");
+        OMX_PRCOMM4(pComponentPrivate->dbg, "Error in Writing to the Data queue\n");
         DecrementCount (&(pComponentPrivate->nCountOutputBFromApp), &(pComponentPrivate->mutexOutputBFromApp));
         eError = OMX_ErrorHardware;
         goto EXIT;
@@ -2467,6 +2430,7 @@ static OMX_ERRORTYPE VIDDEC_ComponentDeInit(OMX_HANDLETYPE hComponent)
     VIDDEC_COMPONENT_PRIVATE* pComponentPrivate = NULL;
     OMX_COMMANDTYPE Cmd = OMX_CommandStateSet;
     OMX_U32 nParam1 = -1;
+    VIDDEC_CMD_ELEM sCmd;
     OMX_U32 i = 0;
     OMX_U32 count = 0;
 
@@ -2499,12 +2463,11 @@ static OMX_ERRORTYPE VIDDEC_ComponentDeInit(OMX_HANDLETYPE hComponent)
             pComponentPrivate->eLCMLState = VidDec_LCML_State_Unload;
         }
     }
-    eError = write(pComponentPrivate->cmdPipe[VIDDEC_PIPE_WRITE], &Cmd, sizeof(Cmd));
-    if (eError == -1) {
-        eError = OMX_ErrorUndefined;
-    }
-    eError = write(pComponentPrivate->cmdDataPipe[VIDDEC_PIPE_WRITE], &nParam1, sizeof(nParam1));
-    if (eError == -1) {
+    sCmd.eCmd = Cmd;
+    sCmd.nParam1 = nParam1;
+    sCmd.pCmdData = NULL;
+    eError = omx_bufq_push(&pComponentPrivate->cmdQ, &sCmd);
+    if (eError != OMX_ErrorNone) {
        eError = OMX_ErrorUndefined;
     }
 
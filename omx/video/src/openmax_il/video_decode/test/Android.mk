@@ -0,0 +1,17 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES:= \
+        viddec_bufq_bench.c
+
+LOCAL_C_INCLUDES := \
+    $(TI_OMX_SYSTEM)/common/inc \
+    $(TI_OMX_SYSTEM)/omx_core/inc
+
+LOCAL_LDLIBS := -lpthread -lrt
+
+LOCAL_MODULE:= viddec_bufq_bench
+LOCAL_MODULE_TAGS:= optional tests
+
+include $(BUILD_HOST_EXECUTABLE)
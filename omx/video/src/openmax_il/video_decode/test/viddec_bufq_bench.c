@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) Texas Instruments - http://www.ti.com/
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Cost of handing buffer headers to the video decoder component thread.
+ *
+ *   viddec_bufq_bench [buffers]
+ *
+ * One thread stands for the IL client and passes <buffers> pointers to the
+ * component thread, alternating between an input and an output queue. The
+ * exchange is timed twice: through a pair of pipes the component thread
+ * pselect()s on, the way the decoder worked before, and through two
+ * OMX_TI_BUFQUEUEs sharing one OMX_TI_BUFQWAKE. Only the hand-over is
+ * measured; the frame rate it buys on a device has to be measured there.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "OMX_TI_BufQueue.h"
+
+#define BENCH_DEFAULT_BUFFERS   1000000
+
+static long bench_buffers = BENCH_DEFAULT_BUFFERS;
+static int bench_pipes[2][2];
+static OMX_TI_BUFQWAKE bench_wake;
+static OMX_TI_BUFQUEUE bench_queues[2];
+static int bench_failed;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *pipe_client(void *arg)
+{
+    long i;
+    void *pBuffer;
+
+    for (i = 0; i < bench_buffers; i++) {
+        pBuffer = (void *)i;
+        if (write(bench_pipes[i & 1][1], &pBuffer, sizeof(pBuffer)) != sizeof(pBuffer)) {
+            bench_failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void *bufq_client(void *arg)
+{
+    long i;
+    void *pBuffer;
+
+    for (i = 0; i < bench_buffers; i++) {
+        pBuffer = (void *)i;
+        if (omx_bufq_push(&bench_queues[i & 1], &pBuffer) != OMX_ErrorNone) {
+            bench_failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* what the component thread did before: pselect, then one read per buffer */
+static long long bench_pipe(void)
+{
+    pthread_t client;
+    long long start, elapsed;
+    long received = 0, expected[2] = { 0, 1 };
+    int fdmax, i;
+    void *pBuffer;
+    fd_set rfds;
+
+    for (i = 0; i < 2; i++) {
+        if (pipe(bench_pipes[i]) < 0) {
+            perror("pipe");
+            return -1;
+        }
+    }
+    fdmax = bench_pipes[0][0] > bench_pipes[1][0] ? bench_pipes[0][0] : bench_pipes[1][0];
+
+    start = now_ns();
+    pthread_create(&client, NULL, pipe_client, NULL);
+    while (received < bench_buffers && !bench_failed) {
+        FD_ZERO(&rfds);
+        FD_SET(bench_pipes[0][0], &rfds);
+        FD_SET(bench_pipes[1][0], &rfds);
+        if (pselect(fdmax + 1, &rfds, NULL, NULL, NULL, NULL) < 0) {
+            perror("pselect");
+            bench_failed = 1;
+            break;
+        }
+        for (i = 0; i < 2; i++) {
+            if (FD_ISSET(bench_pipes[i][0], &rfds)) {
+                if (read(bench_pipes[i][0], &pBuffer, sizeof(pBuffer)) != sizeof(pBuffer) ||
+                    (long)pBuffer != expected[i]) {
+                    bench_failed = 1;
+                }
+                expected[i] += 2;
+                received++;
+            }
+        }
+    }
+    pthread_join(client, NULL);
+    elapsed = now_ns() - start;
+
+    for (i = 0; i < 2; i++) {
+        close(bench_pipes[i][0]);
+        close(bench_pipes[i][1]);
+    }
+    return bench_failed ? -1 : elapsed;
+}
+
+/* what it does now: wait on the shared wakeup, then drain the ready queues */
+static long long bench_bufq(void)
+{
+    pthread_t client;
+    long long start, elapsed;
+    long received = 0, expected[2] = { 0, 1 };
+    OMX_U32 nMask;
+    int status, i;
+    void *pBuffer;
+
+    if (omx_bufq_wake_init(&bench_wake) != OMX_ErrorNone) {
+        return -1;
+    }
+    for (i = 0; i < 2; i++) {
+        if (omx_bufq_init(&bench_queues[i], &bench_wake, sizeof(void *), 4) != OMX_ErrorNone) {
+            return -1;
+        }
+    }
+    nMask = bench_queues[0].nMask | bench_queues[1].nMask;
+
+    start = now_ns();
+    pthread_create(&client, NULL, bufq_client, NULL);
+    while (received < bench_buffers && !bench_failed) {
+        status = omx_bufq_wait(&bench_wake, nMask, NULL, NULL);
+        if (status < 0) {
+            perror("omx_bufq_wait");
+            bench_failed = 1;
+            break;
+        }
+        for (i = 0; i < 2; i++) {
+            if (!(status & bench_queues[i].nMask)) {
+                continue;
+            }
+            while (omx_bufq_pop(&bench_queues[i], &pBuffer)) {
+                if ((long)pBuffer != expected[i]) {
+                    bench_failed = 1;
+                }
+                expected[i] += 2;
+                received++;
+            }
+        }
+    }
+    pthread_join(client, NULL);
+    elapsed = now_ns() - start;
+
+    for (i = 0; i < 2; i++) {
+        omx_bufq_deinit(&bench_queues[i]);
+    }
+    omx_bufq_wake_deinit(&bench_wake);
+    return bench_failed ? -1 : elapsed;
+}
+
+int main(int argc, char **argv)
+{
+    long long pipe_ns, bufq_ns;
+
+    if (argc > 1) {
+        bench_buffers = atol(argv[1]);
+    }
+    if (bench_buffers <= 0) {
+        printf("usage: %s [buffers]\n", argv[0]);
+        return 1;
+    }
+
+    pipe_ns = bench_pipe();
+    if (pipe_ns < 0) {
+        printf("pipe exchange failed\n");
+        return 1;
+    }
+    bufq_ns = bench_bufq();
+    if (bufq_ns < 0) {
+        printf("buffer queue exchange failed\n");
+        return 1;
+    }
+
+    printf("%ld buffers\n", bench_buffers);
+    printf("pipe + pselect: %lld ns per buffer\n", pipe_ns / bench_buffers);
+    printf("buffer queue:   %lld ns per buffer\n", bufq_ns / bench_buffers);
+    return 0;
+}
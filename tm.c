@@ -12,6 +12,7 @@ static void printf_log(const char *fmt, ...)
 
 /* Override this for non-printf reporting */
 extern void (*malloc_log)(const char *fmt, ...);
+extern void heaptracker_dump_profile(void);
 static void ctor(void) __attribute__((constructor));
 static void ctor(void)
 {
@@ -48,6 +49,7 @@ int main(void)
         cb = ptr[5];
         cb[60] = 'a';
 
+	heaptracker_dump_profile();
 	sleep(10);
 
 	return 0;